@@ -2,14 +2,23 @@
 #include <Wire.h>
 #include <Adafruit_Sensor.h>
 #include <Adafruit_HMC5883_U.h>
-#include <MPU6050_light.h>
 #include <AccelStepper.h>
 #include <BluetoothSerial.h>
 #include <FS.h>
 #include <SPIFFS.h>
 
 #include "HomingAdvanced.h"
+#include "SensorHub.h"
 #include "SphericalTracker.h"
+#include "SyncSlew.h"
+#include "StepDDA.h"
+#include "JogController.h"
+#include "PlanStore.h"
+#include "SiderealTracker.h"
+#include "FlightRecorder.h"
+#include "DeferredLog.h"
+#include "MotionCalibrator.h"
+#include <sys/time.h>
 
 // --- I2C pins ---
 #define SDA_PIN         25
@@ -39,13 +48,20 @@ const float gearRatioTilt   = GEAR_MOTOR / GEAR_AXIS_TILT;
 const float degPerMicroPan  = (STEP_ANGLE_DEG/MICROSTEPS) * gearRatioPan;
 const float degPerMicroTilt = (STEP_ANGLE_DEG/MICROSTEPS) * gearRatioTilt;
 
+// --- Cable wrap soft limits (pan, measured from home position) ---
+const float PAN_LIMIT_CCW_DEG = 270.0;
+const float PAN_LIMIT_CW_DEG  = 270.0;
+// --- Tilt travel from home (el 45°): down to the horizon, up to the zenith ---
+const float TILT_LIMIT_DOWN_DEG = 45.0;
+const float TILT_LIMIT_UP_DEG   = 45.0;
+
 // --- Homing params ---
 const float HOME_SPEED    = 500.0;
 const long  BACKOFF       = 100;
 
 // --- Sensors & Steppers ---
 Adafruit_HMC5883_Unified mag(12345);
-MPU6050                    mpu(Wire);
+SensorHub                  sensors(Wire, mag);
 AccelStepper               panStp(AccelStepper::DRIVER, PAN_STEP_PIN, PAN_DIR_PIN);
 AccelStepper               tiltStp(AccelStepper::DRIVER, TILT_STEP_PIN, TILT_DIR_PIN);
 
@@ -56,7 +72,7 @@ HomingAdvanced homing(
   panStp, PAN_ENDSTOP_PIN, PAN_ENABLE_PIN, PAN_DIR_PIN, PAN_STEP_PIN,
   tiltStp, TILT_ENDSTOP_PIN, TILT_ENABLE_PIN, TILT_DIR_PIN, TILT_STEP_PIN,
   degPerMicroPan, degPerMicroTilt,
-  mag, mpu,
+  sensors,
   HOME_SPEED, BACKOFF
 );
 
@@ -66,15 +82,66 @@ const char*      btName    = "ESP32-Tracker";
 const char*      btPin     = "1234";
 bool             wasClient = false;
 
-// --- Trajectory buffer ---
-constexpr int MAX_POINTS = 1024;
-static TrackPoint trajBuf[MAX_POINTS];
-static uint16_t   expectPts = 0, recvPts = 0;
+// --- Trajectory buffer (window streamed from SPIFFS) ---
+constexpr int MAX_POINTS = 256;
+static uint32_t   expectPts = 0, recvPts = 0;
 static uint32_t   T0_unix   = 0;
 static bool       inRxTraj  = false;
+static bool       skipTraj  = false;   // refused upload: its point lines are dropped up to TRAJ_END
+
+// --- Tracking step generator: interleaved pan/tilt pulses, shared by both trackers ---
+StepDDA stepDDA(panStp, PAN_STEP_PIN, PAN_DIR_PIN, tiltStp, TILT_STEP_PIN, TILT_DIR_PIN);
+
+// --- On-device tracking of fixed RA/Dec targets ---
+SiderealTracker sidereal(panStp, tiltStp, stepDDA, degPerMicroPan, degPerMicroTilt);
+bool            pendingSidereal = false;  // sidereal tracking starts after the GOTO slew
+bool            siderealReplyBT = false;  // where RADEC came from, for SIDEREAL_HALTED
+
+// --- Stored plans & session record ---
+PlanStore planStore(SPIFFS);
+PlanStore splicePlan(SPIFFS);        // second reader: the next plan opens here while the other plays
+bool      timeSynced        = false;
+bool      sessionActive     = false;
+int       pendingTrackIndex = -1;   // tracking starts here once the GOTO slew ends
+bool      spliceReplyPending = false;
+bool      spliceReplyBT      = false;
+char      spliceName[PlanStore::MAX_NAME + 1];
+bool      jogDuringTrack     = false;  // a jog that ends while tracking becomes a path offset
+bool      hostStepped        = false;  // PREP/STEP session timed by the app; a SPLICE hands it to the tracker
 
 // --- Tracker instance ---
-SphericalTracker tracker(panStp, tiltStp, degPerMicroPan, degPerMicroTilt, MAX_POINTS);
+SphericalTracker tracker(panStp, tiltStp, stepDDA, degPerMicroPan, degPerMicroTilt, MAX_POINTS);
+
+// --- GOTO engine (PREP positioning, homing reposition) ---
+const SyncSlew::Limits PAN_SLEW_LIMITS  = { 4000, 4000, 16000 };
+const SyncSlew::Limits TILT_SLEW_LIMITS = { 2000, 1000,  4000 };
+SyncSlew slew(panStp, tiltStp);
+bool     slewReplyPending = false;
+bool     slewReplyBT      = false;
+
+// --- Motion limits: measured per device by CALIBRATE_MOTION, defaults above until then ---
+const float CAL_PAN_TRAVEL_DEG  = 150.0;  // trial slews, measured from the endstop
+const float CAL_TILT_TRAVEL_DEG = 40.0;
+MotionCalibrator motionCal(panStp, PAN_ENDSTOP_PIN, degPerMicroPan,
+                           tiltStp, TILT_ENDSTOP_PIN, degPerMicroTilt,
+                           slew, sensors);
+
+// --- Streaming jog (JOG <pan> <tilt>, heartbeat-guarded) ---
+const float    JOG_PAN_MAX_SPEED  = 2000;
+const float    JOG_PAN_ACCEL      = 4000;
+const float    JOG_TILT_MAX_SPEED = 1000;
+const float    JOG_TILT_ACCEL     = 2000;
+const uint32_t JOG_TIMEOUT_MS     = 300;
+JogController jog(panStp, tiltStp);
+
+// --- Link benchmark (BENCH_BEGIN ... BENCH_END line sink) ---
+static bool     benchRx      = false;
+static uint32_t benchLines   = 0;
+static uint32_t benchBytes   = 0;
+static uint32_t benchStartUs = 0;
+
+// --- Flight recorder: loop iterations longer than this are logged while moving ---
+const uint32_t LOOP_GAP_US = 2000;
 
 // --- Manual drive flags & speeds ---
 bool  movingPan  = false;
@@ -83,9 +150,148 @@ float speedPan   = 0;
 float speedTilt  = 0;
 
 
+uint64_t nowUnixMs() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return uint64_t(tv.tv_sec) * 1000ull + tv.tv_usec / 1000;
+}
+
+// Limits in effect (calibrated or default) to everything that moves the axes
+void applyMotionLimits() {
+  const SyncSlew::Limits &pan  = motionCal.panLimits();
+  const SyncSlew::Limits &tilt = motionCal.tiltLimits();
+  slew.setLimits(pan, tilt);
+  panStp.setMaxSpeed(pan.vMax);
+  panStp.setAcceleration(pan.aMax);
+  tiltStp.setMaxSpeed(tilt.vMax);
+  tiltStp.setAcceleration(tilt.aMax);
+  tracker.setMaxRates(pan.vMax, tilt.vMax);
+  tracker.setAccelerations(pan.aMax, tilt.aMax);
+  sidereal.setMaxRates(pan.vMax, tilt.vMax);
+  sidereal.setAccelerations(pan.aMax, tilt.aMax);
+  jog.setLimits(fminf(JOG_PAN_MAX_SPEED, pan.vMax), fminf(JOG_PAN_ACCEL, pan.aMax),
+                fminf(JOG_TILT_MAX_SPEED, tilt.vMax), fminf(JOG_TILT_ACCEL, tilt.aMax));
+  homing.setHomeSpeed(motionCal.homeSpeed());
+}
+
+// Reader not used by the running session, for a plan to be spliced in
+PlanStore &idlePlanReader() {
+  return tracker.source() == &planStore ? splicePlan : planStore;
+}
+
+// Slews to the trajectory point and arms tracking from that index
+bool startSessionAt(int index) {
+  TrackPoint p;
+  if (!tracker.pointAt(index, p)) return false;
+
+  // Pan: the branch the app planned, otherwise the one nearest to the
+  // current position within the cable limits
+  float curPanDeg = panStp.currentPosition() * degPerMicroPan;
+  bool  hostPan   = tracker.source() && tracker.source()->hostPan();
+  float best      = p.az - 180.0f;
+  bool  found     = hostPan && best >= -PAN_LIMIT_CCW_DEG && best <= PAN_LIMIT_CW_DEG;
+  if (!found) {
+    float base = fmod(p.az - 180.0f + 540.0f, 360.0f) - 180.0f;
+    for (int k = -1; k <= 1; ++k) {
+      float cand = base + k * 360.0f;
+      if (cand < -PAN_LIMIT_CCW_DEG || cand > PAN_LIMIT_CW_DEG) continue;
+      if (!found || fabsf(cand - curPanDeg) < fabsf(best - curPanDeg)) best = cand;
+      found = true;
+    }
+  }
+  long panTarget  = lround(best / degPerMicroPan);
+  long tiltTarget = -lround((p.el - 45.0f) / degPerMicroTilt);
+
+  pendingTrackIndex = index;
+  if (!slew.start(panTarget - panStp.currentPosition(),
+                  tiltTarget - tiltStp.currentPosition())) {
+    tracker.prepare(index);
+    pendingTrackIndex = -1;
+    sessionActive     = true;
+  }
+  return true;
+}
+
+// "<t_ms> <az> <el>": three numeric fields, nothing else
+bool parsePointLine(const String &line, TrackPoint &p) {
+  const char *s = line.c_str();
+  char *end;
+  unsigned long t = strtoul(s, &end, 10);
+  if (end == s || *end != ' ' || *s == '-') return false;
+  s = end;
+  float az = strtof(s, &end);
+  if (end == s || *end != ' ') return false;
+  s = end;
+  float el = strtof(s, &end);
+  if (end == s || *end != '\0') return false;
+  p.t  = t;
+  p.az = az;
+  p.el = el;
+  return true;
+}
+
+// Line of an ongoing TRAJ upload: a point or TRAJ_END. Anything else ends
+// the upload (TRAJ_BAD_FORMAT) and is returned as not consumed, so the
+// caller runs it as the command it is
+bool processTrajLine(const String &line, bool viaBT) {
+  if (line == "TRAJ_END") {
+    inRxTraj = false;
+    // A short upload never replaces the stored plan of that name
+    const char *reply = "TRAJ_OK";
+    if (recvPts != expectPts) {
+      planStore.abortWrite();
+      reply = "TRAJ_INCOMPLETE";
+    } else if (!planStore.endWrite()) {
+      reply = "TRAJ_WRITE_FAILED";
+    }
+    if (viaBT) SerialBT.printf("%s %lu\n", reply, (unsigned long)recvPts);
+    else       Serial.printf("%s %lu\n", reply, (unsigned long)recvPts);
+    return true;
+  }
+  TrackPoint p;
+  if (!parsePointLine(line, p)) {
+    inRxTraj = false;
+    planStore.abortWrite();
+    if (viaBT) SerialBT.println("TRAJ_BAD_FORMAT"); else Serial.println("TRAJ_BAD_FORMAT");
+    return false;
+  }
+  if (!planStore.append(p)) {
+    inRxTraj = false;
+    if (viaBT) SerialBT.println("TRAJ_WRITE_FAILED"); else Serial.println("TRAJ_WRITE_FAILED");
+    return true;
+  }
+  ++recvPts;
+  return true;
+}
+
 void processCmd(const String &raw, bool viaBT) {
   String cmd = raw;
   cmd.trim();
+  REC_CMD_SCOPE(cmd.c_str());
+
+  // Stopping the axes does not wait for an upload; the upload goes on
+  bool urgent = cmd == "STOP" || cmd == "BREAK" || cmd.startsWith("JOG ");
+  if (inRxTraj && !urgent && processTrajLine(cmd, viaBT)) return;
+  if (skipTraj && !urgent) {
+    TrackPoint p;
+    if (cmd == "TRAJ_END") { skipTraj = false; return; }
+    if (parsePointLine(cmd, p)) return;
+    skipTraj = false;
+  }
+
+  if (benchRx) {
+    // Benchmark payload: only counted, the reply carries the device-side time
+    if (cmd == "BENCH_END") {
+      benchRx = false;
+      uint32_t us = micros() - benchStartUs;
+      if (viaBT) SerialBT.printf("BENCH_OK %lu %lu %lu\n", (unsigned long)benchLines, (unsigned long)benchBytes, (unsigned long)us);
+      else       Serial.printf("BENCH_OK %lu %lu %lu\n", (unsigned long)benchLines, (unsigned long)benchBytes, (unsigned long)us);
+    } else {
+      ++benchLines;
+      benchBytes += raw.length() + 1;
+    }
+    return;
+  }
 
   if (cmd == "HOME") {
     homing.homeAll();
@@ -94,8 +300,108 @@ void processCmd(const String &raw, bool viaBT) {
   else if (cmd == "PING") {
     if (viaBT) SerialBT.println("PONG"); else Serial.println("PONG");
   }
+  // Numbered ping for round-trip measurements: "PING <n>" -> "PONG <n>"
+  else if (cmd.startsWith("PING ")) {
+    if (viaBT) SerialBT.printf("PONG %s\n", cmd.substring(5).c_str());
+    else       Serial.printf("PONG %s\n", cmd.substring(5).c_str());
+  }
+  // Sensor task state: "IMU <az> <el> <calibrated> <samples> <overruns>"
+  else if (cmd == "IMU?") {
+    OrientationSample s;
+    char reply[64];
+    if (sensors.snapshot(s))
+      snprintf(reply, sizeof(reply), "IMU %.2f %.2f %d %lu %u", s.azDeg, s.elDeg,
+               s.calibrated ? 1 : 0, (unsigned long)s.samples, s.overruns);
+    else
+      snprintf(reply, sizeof(reply), "IMU NONE");
+    if (viaBT) SerialBT.println(reply); else Serial.println(reply);
+  }
+  // Axis positions and where they point: "POS <pan> <tilt> <az> <el>" (horizon recording)
+  else if (cmd == "POS?") {
+    const long pan  = panStp.currentPosition();
+    const long tilt = tiltStp.currentPosition();
+    const float az  = fmod(180.0f + pan * degPerMicroPan + 720.0f, 360.0f);
+    const float el  = 45.0f - tilt * degPerMicroTilt;
+    char reply[64];
+    snprintf(reply, sizeof(reply), "POS %ld %ld %.2f %.2f", pan, tilt, az, el);
+    if (viaBT) SerialBT.println(reply); else Serial.println(reply);
+  }
+  // Pan cable wrap from home, planned against by the app: "PAN_LIMITS <ccw> <cw>"
+  else if (cmd == "PAN_LIMITS?") {
+    char reply[48];
+    snprintf(reply, sizeof(reply), "PAN_LIMITS %.1f %.1f", PAN_LIMIT_CCW_DEG, PAN_LIMIT_CW_DEG);
+    if (viaBT) SerialBT.println(reply); else Serial.println(reply);
+  }
+  // Motion limits in effect: "LIMITS <panV> <panA> <tiltV> <tiltA> <homeV> <calibrated>"
+  else if (cmd == "LIMITS?") {
+    const SyncSlew::Limits &pan  = motionCal.panLimits();
+    const SyncSlew::Limits &tilt = motionCal.tiltLimits();
+    char reply[96];
+    snprintf(reply, sizeof(reply), "LIMITS %.0f %.0f %.0f %.0f %.0f %d", pan.vMax, pan.aMax,
+             tilt.vMax, tilt.aMax, motionCal.homeSpeed(), motionCal.isCalibrated() ? 1 : 0);
+    if (viaBT) SerialBT.println(reply); else Serial.println(reply);
+  }
+  // Graduated slews against the endstops; blocks for a few minutes, then homes
+  else if (cmd == "CALIBRATE_MOTION") {
+    if (slew.isActive() || tracker.isTracking() || sidereal.isTracking() || jog.isActive()) {
+      if (viaBT) SerialBT.println("CAL_BUSY"); else Serial.println("CAL_BUSY");
+      return;
+    }
+    bool ok = viaBT ? motionCal.run(SerialBT) : motionCal.run(Serial);
+    applyMotionLimits();
+    homing.homeAll();
+    char reply[96];
+    if (ok)
+      snprintf(reply, sizeof(reply), "CAL_DONE %.0f %.0f %.0f %.0f %.0f",
+               motionCal.panLimits().vMax, motionCal.panLimits().aMax,
+               motionCal.tiltLimits().vMax, motionCal.tiltLimits().aMax, motionCal.homeSpeed());
+    else
+      snprintf(reply, sizeof(reply), "CAL_FAILED");
+    if (viaBT) SerialBT.println(reply); else Serial.println(reply);
+  }
+  else if (cmd == "LIMITS_RESET") {
+    motionCal.reset();
+    applyMotionLimits();
+    if (viaBT) SerialBT.println("LIMITS_DEFAULT"); else Serial.println("LIMITS_DEFAULT");
+  }
+  else if (cmd == "BENCH_BEGIN") {
+    benchRx      = true;
+    benchLines   = 0;
+    benchBytes   = 0;
+    benchStartUs = micros();
+    if (viaBT) SerialBT.println("BENCH_READY"); else Serial.println("BENCH_READY");
+  }
+  // Command-to-motion: one tilt microstep out and back, timed from here
+  else if (cmd.startsWith("BENCH_MOVE ")) {
+    if (slew.isActive() || tracker.isTracking() || sidereal.isTracking() || jog.isActive()) {
+      if (viaBT) SerialBT.println("BENCH_BUSY"); else Serial.println("BENCH_BUSY");
+      return;
+    }
+    uint32_t t0    = micros();
+    long     start = tiltStp.currentPosition();
+    tiltStp.enableOutputs();
+    tiltStp.move(1);
+    while (tiltStp.currentPosition() == start) tiltStp.run();
+    uint32_t firstUs = micros() - t0;
+    tiltStp.move(-1);
+    tiltStp.runToPosition();
+    tiltStp.disableOutputs();
+    uint32_t totalUs = micros() - t0;
+    if (viaBT) SerialBT.printf("MOTION_ACK %s %lu %lu\n", cmd.substring(11).c_str(), (unsigned long)firstUs, (unsigned long)totalUs);
+    else       Serial.printf("MOTION_ACK %s %lu %lu\n", cmd.substring(11).c_str(), (unsigned long)firstUs, (unsigned long)totalUs);
+  }
   else if (cmd == "BREAK") {
-    // tracker.stop();
+    tracker.stop();
+    sidereal.stop();
+    hostStepped       = false;
+    pendingSidereal   = false;
+    pendingTrackIndex = -1;
+    sessionActive     = false;
+    planStore.clearSession();
+    if (slew.isActive()) {
+      slew.abort();
+      slewReplyPending = false;
+    }
     if (viaBT) SerialBT.println("TRACK_STOPPED"); else Serial.println("TRACK_STOPPED");
   }
   // Single-step manual
@@ -152,40 +458,288 @@ void processCmd(const String &raw, bool viaBT) {
     panStp.enableOutputs();
     panStp.setSpeed(speedPan);
   }else if (cmd == "FUP") {
-    tiltStp.enableOutputs();
-    tiltStp.move(-1);
-    tiltStp.runToPosition();
-    tiltStp.disableOutputs();
+    slew.queue(0, -1);
     if (viaBT) SerialBT.println("OK"); else Serial.println("OK");
   }
   else if (cmd == "FDOWN") {
-    tiltStp.enableOutputs();
-    tiltStp.move(+1);
-    tiltStp.runToPosition();
-    tiltStp.disableOutputs();
+    slew.queue(0, +1);
     if (viaBT) SerialBT.println("OK"); else Serial.println("OK");
   }
   else if (cmd == "FLEFT") {
-    panStp.enableOutputs();
-    panStp.move(-1);
-    panStp.runToPosition();
-    panStp.disableOutputs();
+    slew.queue(-1, 0);
     if (viaBT) SerialBT.println("OK"); else Serial.println("OK");
   }
   else if (cmd == "FRIGHT") {
-    panStp.enableOutputs();
-    panStp.move(+1);
-    panStp.runToPosition();
-    panStp.disableOutputs();
+    slew.queue(+1, 0);
     if (viaBT) SerialBT.println("OK"); else Serial.println("OK");
   }
+  // Relative move of both axes (host-stepped sessions, pan unwind); does not wait for the motion
+  else if (cmd.startsWith("MOVE ")) {
+    int space1 = cmd.indexOf(' ');
+    int space2 = cmd.indexOf(' ', space1 + 1);
+    if (space2 == -1) {
+      if (viaBT) SerialBT.println("MOVE_BAD_FORMAT"); else Serial.println("MOVE_BAD_FORMAT");
+      return;
+    }
+    if (tracker.isTracking() || sidereal.isTracking() || pendingSidereal
+        || pendingTrackIndex >= 0 || jog.isActive()) {
+      if (viaBT) SerialBT.println("MOVE_BUSY"); else Serial.println("MOVE_BUSY");
+      return;
+    }
+    long deltaPan  = cmd.substring(space1 + 1, space2).toInt();
+    long deltaTilt = cmd.substring(space2 + 1).toInt();
+    long targetPan = panStp.currentPosition() + slew.pendingPan() + deltaPan;
+    if (targetPan < -lround(PAN_LIMIT_CCW_DEG / degPerMicroPan) ||
+        targetPan >  lround(PAN_LIMIT_CW_DEG  / degPerMicroPan)) {
+      if (viaBT) SerialBT.println("MOVE_LIMIT"); else Serial.println("MOVE_LIMIT");
+      return;
+    }
+    // Run from loop() by the slew engine, after a move still in progress
+    slew.queue(deltaPan, -deltaTilt);
+    if (viaBT) SerialBT.println("OK"); else Serial.println("OK");
+  }
+  // Streaming jog: signed speeds [steps/s], pan + = right, tilt + = up
+  else if (cmd.startsWith("JOG ")) {
+    int space1 = cmd.indexOf(' ');
+    int space2 = cmd.indexOf(' ', space1 + 1);
+    if (space2 == -1) {
+      if (viaBT) SerialBT.println("JOG_BAD_FORMAT"); else Serial.println("JOG_BAD_FORMAT");
+      return;
+    }
+    float panSpeed  = cmd.substring(space1 + 1, space2).toFloat();
+    float tiltSpeed = cmd.substring(space2 + 1).toFloat();
+    movingPan = movingTilt = false;
+    jog.command(panSpeed, -tiltSpeed);
+  }
   else if (cmd == "STOP") {
+    jog.stop();
+    // A TRACK or RADEC still slewing to its start point is called off with the slew
+    pendingTrackIndex = -1;
+    pendingSidereal   = false;
+    if (slew.isActive()) {
+      slew.abort();
+      if (slewReplyPending) {
+        if (slewReplyBT) SerialBT.println("PREP_ABORTED"); else Serial.println("PREP_ABORTED");
+        slewReplyPending = false;
+      }
+    }
     movingPan = movingTilt = false;
     panStp.setSpeed(0);
     tiltStp.setSpeed(0);
     if (viaBT) SerialBT.println("MAN_STOPPED"); else Serial.println("MAN_STOPPED");
   }
+  // Host clock: "SYNC_TIME <unix ms>"
+  else if (cmd.startsWith("SYNC_TIME ")) {
+    uint64_t ms = strtoull(cmd.substring(10).c_str(), nullptr, 10);
+    struct timeval tv;
+    tv.tv_sec  = time_t(ms / 1000ull);
+    tv.tv_usec = suseconds_t((ms % 1000ull) * 1000ull);
+    settimeofday(&tv, nullptr);
+    timeSynced = true;
+    if (viaBT) SerialBT.println("TIME_SYNCED"); else Serial.println("TIME_SYNCED");
+
+    // Interrupted session still within its plan?
+    char     name[PlanStore::MAX_NAME + 1];
+    uint32_t t0;
+    if (!sessionActive && planStore.loadSession(name, t0) && planStore.open(name)) {
+      tracker.loadSource(&planStore, t0);
+      int idx = tracker.indexForTime(nowUnixMs());
+      if (idx < tracker.numPoints()) {
+        if (viaBT) SerialBT.printf("RESUME_READY %s %d\n", name, idx);
+        else       Serial.printf("RESUME_READY %s %d\n", name, idx);
+      } else {
+        planStore.clearSession();
+      }
+    }
+  }
+  // Fixed target: "RADEC <ra deg> <dec deg> <lat deg> <lon deg>", Alt/Az computed here
+  else if (cmd.startsWith("RADEC ")) {
+    float v[4];
+    int   from = 6;
+    for (int i = 0; i < 4; ++i) {
+      int sp = cmd.indexOf(' ', from);
+      v[i] = (sp == -1) ? cmd.substring(from).toFloat() : cmd.substring(from, sp).toFloat();
+      if (sp == -1 && i < 3) {
+        if (viaBT) SerialBT.println("RADEC_BAD_FORMAT"); else Serial.println("RADEC_BAD_FORMAT");
+        return;
+      }
+      from = sp + 1;
+    }
+    if (!timeSynced) {
+      if (viaBT) SerialBT.println("RADEC_NO_TIME"); else Serial.println("RADEC_NO_TIME");
+      return;
+    }
+    uint64_t now = nowUnixMs();
+    float az, el;
+    sidereal.setTarget(v[0], v[1], v[2], v[3], now);
+    sidereal.altAz(now, az, el);
+    if (el < 0) {
+      if (viaBT) SerialBT.println("RADEC_BELOW_HORIZON"); else Serial.println("RADEC_BELOW_HORIZON");
+      return;
+    }
+    long panTarget, tiltTarget;
+    sidereal.targetSteps(now, panTarget, tiltTarget);
+    if (!sidereal.tiltWithinLimits(tiltTarget)) {
+      if (viaBT) SerialBT.println("RADEC_TILT_LIMIT"); else Serial.println("RADEC_TILT_LIMIT");
+      return;
+    }
+    tracker.stop();
+    sidereal.stop();
+    hostStepped     = false;
+    siderealReplyBT = viaBT;
+    pendingSidereal = slew.start(panTarget - panStp.currentPosition(),
+                                 tiltTarget - tiltStp.currentPosition());
+    if (!pendingSidereal) sidereal.start(now);
+    if (viaBT) SerialBT.printf("RADEC_OK %.2f %.2f\n", az, el);
+    else       Serial.printf("RADEC_OK %.2f %.2f\n", az, el);
+  }
+  // Upload: "TRAJ <name> <T0 unix s> <nPts> [PAN]", then nPts point lines, then TRAJ_END;
+  // with PAN the azimuths are the app's planned pan angles (180 = home, not wrapped)
+  else if (cmd.startsWith("TRAJ ")) {
+    int space1 = cmd.indexOf(' ');
+    int space2 = cmd.indexOf(' ', space1 + 1);
+    int space3 = cmd.indexOf(' ', space2 + 1);
+    int space4 = cmd.indexOf(' ', space3 + 1);
+    if (space2 == -1 || space3 == -1) {
+      if (viaBT) SerialBT.println("TRAJ_BAD_FORMAT"); else Serial.println("TRAJ_BAD_FORMAT");
+      return;
+    }
+    String   name  = cmd.substring(space1 + 1, space2);
+    uint32_t flags = (space4 != -1 && cmd.substring(space4 + 1) == "PAN") ? PLAN_HOST_PAN : 0;
+    T0_unix   = strtoul(cmd.substring(space2 + 1, space3).c_str(), nullptr, 10);
+    expectPts = strtoul(cmd.substring(space3 + 1).c_str(), nullptr, 10);
+    recvPts   = 0;
+    // The plan being played, or armed for a splice, keeps its file
+    if ((planStore.isOpen() && name == planStore.openName())
+        || (splicePlan.isOpen() && name == splicePlan.openName())) {
+      skipTraj = true;
+      if (viaBT) SerialBT.println("TRAJ_BUSY"); else Serial.println("TRAJ_BUSY");
+      return;
+    }
+    if (!planStore.beginWrite(name.c_str(), T0_unix, expectPts, flags)) {
+      skipTraj = true;
+      if (viaBT) SerialBT.println("TRAJ_REJECTED"); else Serial.println("TRAJ_REJECTED");
+      return;
+    }
+    inRxTraj = true;
+    if (viaBT) SerialBT.println("TRAJ_READY"); else Serial.println("TRAJ_READY");
+  }
+  // Start a stored plan: "TRACK <name> [T0 unix s]"
+  else if (cmd.startsWith("TRACK ")) {
+    String args  = cmd.substring(6);
+    int    space = args.indexOf(' ');
+    String name  = (space == -1) ? args : args.substring(0, space);
+    if (!timeSynced || !planStore.open(name.c_str())) {
+      if (viaBT) SerialBT.println("TRACK_FAILED"); else Serial.println("TRACK_FAILED");
+      return;
+    }
+    uint32_t t0 = (space == -1) ? planStore.T0()
+                                : strtoul(args.substring(space + 1).c_str(), nullptr, 10);
+    tracker.stop();
+    hostStepped = false;
+    tracker.loadSource(&planStore, t0);
+    int idx = tracker.indexForTime(nowUnixMs());
+    if (idx > 0) --idx;  // aim at the point currently being tracked
+    if (idx >= tracker.numPoints() || !startSessionAt(idx)) {
+      if (viaBT) SerialBT.println("TRACK_EXPIRED"); else Serial.println("TRACK_EXPIRED");
+      return;
+    }
+    planStore.saveSession(name.c_str(), t0);
+    if (viaBT) SerialBT.printf("TRACK_STARTED %d\n", idx);
+    else       Serial.printf("TRACK_STARTED %d\n", idx);
+  }
+  // Resume the session reported by RESUME_READY (axes are homed first)
+  else if (cmd == "RESUME") {
+    char     name[PlanStore::MAX_NAME + 1];
+    uint32_t t0;
+    if (!timeSynced || !planStore.loadSession(name, t0) || !planStore.open(name)) {
+      if (viaBT) SerialBT.println("RESUME_FAILED"); else Serial.println("RESUME_FAILED");
+      return;
+    }
+    homing.homeAll();
+    hostStepped = false;
+    tracker.loadSource(&planStore, t0);
+    int idx = tracker.indexForTime(nowUnixMs());
+    if (idx > 0) --idx;
+    if (idx >= tracker.numPoints() || !startSessionAt(idx)) {
+      planStore.clearSession();
+      if (viaBT) SerialBT.println("RESUME_FAILED"); else Serial.println("RESUME_FAILED");
+      return;
+    }
+    if (viaBT) SerialBT.printf("RESUMED %s %d\n", name, idx);
+    else       Serial.printf("RESUMED %s %d\n", name, idx);
+  }
+  // Flight recorder: binary dump of the event ring, see FlightRecorder.h
+  else if (cmd == "REC_DUMP") {
+    if (viaBT) flightRecorder.dump(SerialBT, timeSynced ? nowUnixMs() : 0);
+    else       flightRecorder.dump(Serial,   timeSynced ? nowUnixMs() : 0);
+  }
+  else if (cmd == "REC_CLEAR") {
+    flightRecorder.clear();
+    if (viaBT) SerialBT.println("REC_CLEARED"); else Serial.println("REC_CLEARED");
+  }
+  // Hot swap: "SPLICE <name> <at unix ms>", the running session continues on
+  // the stored plan <name> from that moment without stopping; a host-stepped
+  // session is taken over by the tracker from wherever the axes are
+  else if (cmd.startsWith("SPLICE ")) {
+    String   args  = cmd.substring(7);
+    int      space = args.indexOf(' ');
+    if (space == -1) {
+      if (viaBT) SerialBT.println("SPLICE_BAD_FORMAT"); else Serial.println("SPLICE_BAD_FORMAT");
+      return;
+    }
+    String   name = args.substring(0, space);
+    uint64_t atMs = strtoull(args.substring(space + 1).c_str(), nullptr, 10);
+    tracker.cancelSplice();
+    PlanStore &next = idlePlanReader();
+    if (!timeSynced || !(tracker.isTracking() || hostStepped) || !next.open(name.c_str())) {
+      if (viaBT) SerialBT.println("SPLICE_FAILED"); else Serial.println("SPLICE_FAILED");
+      return;
+    }
+    int idx = (atMs > nowUnixMs()) ? tracker.scheduleSplice(&next, next.T0(), atMs) : -1;
+    if (idx < 0) {
+      next.close();
+      if (viaBT) SerialBT.println("SPLICE_EXPIRED"); else Serial.println("SPLICE_EXPIRED");
+      return;
+    }
+    strncpy(spliceName, name.c_str(), PlanStore::MAX_NAME);
+    spliceName[PlanStore::MAX_NAME] = '\0';
+    spliceReplyPending = true;
+    spliceReplyBT      = viaBT;
+    if (viaBT) SerialBT.printf("SPLICE_ARMED %d\n", idx);
+    else       Serial.printf("SPLICE_ARMED %d\n", idx);
+  }
+  // Path correction: "OFFSET <dAz> <dEl> [blend ms]", added to the current one
+  else if (cmd.startsWith("OFFSET ")) {
+    int space1 = cmd.indexOf(' ');
+    int space2 = cmd.indexOf(' ', space1 + 1);
+    int space3 = cmd.indexOf(' ', space2 + 1);
+    if (space2 == -1 || !tracker.isTracking()) {
+      if (viaBT) SerialBT.println("OFFSET_REJECTED"); else Serial.println("OFFSET_REJECTED");
+      return;
+    }
+    float    dAz     = cmd.substring(space1 + 1, space2).toFloat();
+    float    dEl     = cmd.substring(space2 + 1, space3 == -1 ? cmd.length() : space3).toFloat();
+    uint32_t blendMs = (space3 == -1) ? 1000 : strtoul(cmd.substring(space3 + 1).c_str(), nullptr, 10);
+    tracker.addOffset(dAz, dEl, blendMs, nowUnixMs());
+    if (viaBT) SerialBT.printf("OFFSET_OK %.3f %.3f\n", tracker.offsetAz(), tracker.offsetEl());
+    else       Serial.printf("OFFSET_OK %.3f %.3f\n", tracker.offsetAz(), tracker.offsetEl());
+  }
+  else if (cmd == "PLAN_LIST") {
+    if (viaBT) planStore.list(SerialBT); else planStore.list(Serial);
+  }
+  else if (cmd.startsWith("PLAN_DEL ")) {
+    bool ok = planStore.remove(cmd.substring(9).c_str());
+    if (viaBT) SerialBT.println(ok ? "PLAN_DELETED" : "PLAN_NOT_FOUND");
+    else       Serial.println(ok ? "PLAN_DELETED" : "PLAN_NOT_FOUND");
+  }
   else if (cmd == "PREP") {
+    // New host-stepped session: whatever the tracker was following ends here
+    tracker.stop();
+    sidereal.stop();
+    pendingSidereal   = false;
+    pendingTrackIndex = -1;
+    hostStepped = false;
     waitingForPrep = true;
     prepExecuted = false;
     if (viaBT) SerialBT.println("PREP_OK"); else Serial.println("PREP_OK");
@@ -193,6 +747,7 @@ void processCmd(const String &raw, bool viaBT) {
   else if (waitingForPrep && !prepExecuted && cmd.startsWith("STEP ")) {
     prepExecuted = true;
     waitingForPrep = false;
+    hostStepped = true;
     int space1 = cmd.indexOf(' ');
     int space2 = cmd.indexOf(' ', space1 + 1);
 
@@ -205,23 +760,19 @@ void processCmd(const String &raw, bool viaBT) {
     int deltaPan  = cmd.substring(space1 + 1, space2).toInt();
     int deltaTilt = cmd.substring(space2 + 1).toInt();
 
-    Serial.printf("[ESP] PREP Step: Pan=%d, Tilt=%d\n", deltaPan, deltaTilt);
+    LOGI("[ESP] PREP Step: Pan=%d, Tilt=%d", deltaPan, deltaTilt);
 
-    panStp.enableOutputs();
-    tiltStp.enableOutputs();
-    panStp.move(deltaPan/2);
-    tiltStp.move(-deltaTilt/2);
-    while (panStp.isRunning() || tiltStp.isRunning()) {
-      panStp.run();
-      tiltStp.run();
+    // Synchronized S-curve slew, finished from loop(); PREP_DONE is sent on arrival
+    if (slew.start(deltaPan, -deltaTilt)) {
+      LOGI("[ESP] PREP slew %.2f s", slew.duration());
+      slewReplyPending = true;
+      slewReplyBT      = viaBT;
+    } else {
+      if (viaBT) SerialBT.println("PREP_DONE"); else Serial.println("PREP_DONE");
     }
-    panStp.disableOutputs();
-    tiltStp.disableOutputs();
-
-    if (viaBT) SerialBT.println("PREP_DONE"); else Serial.println("PREP_DONE");
   }
   else if (cmd.startsWith("STEP ")) {
-    Serial.println("[ESP] Rejected repeated STEP");
+    LOGW("[ESP] Rejected repeated STEP");
   }
   else {
     if (viaBT) SerialBT.printf("UNKNOWN:%s\n", cmd.c_str());
@@ -231,6 +782,7 @@ void processCmd(const String &raw, bool viaBT) {
 
 void setup() {
   Serial.begin(115200);
+  deferredLog.begin(Serial);
   Wire.begin(SDA_PIN, SCL_PIN);
   delay(200);
 
@@ -238,17 +790,39 @@ void setup() {
   SerialBT.begin(btName, true);
   SerialBT.setPin(btPin, strlen(btPin));
   SerialBT.enableSSP();
-  Serial.printf("BT \"%s\" PIN %s\n", btName, btPin);
+  LOGI("BT \"%s\" PIN %s", btName, btPin);
 
-  // Homing & steppers config
+  // Plan storage
+  if (!SPIFFS.begin(true)) {
+    LOGE("Error: SPIFFS mount failed");
+  }
+  planStore.begin();
+
+  // Homing & steppers config: this device's measured limits if it has them
+  motionCal.setDefaults(PAN_SLEW_LIMITS, TILT_SLEW_LIMITS, HOME_SPEED);
+  motionCal.setTravel(CAL_PAN_TRAVEL_DEG, CAL_TILT_TRAVEL_DEG);
+  if (motionCal.load()) LOGI("Calibrated motion limits loaded");
+  homing.attachSlew(slew);
+  jog.setTimeout(JOG_TIMEOUT_MS);
   homing.begin();
-  panStp.setMaxSpeed(4000);
-  panStp.setAcceleration(4000);
-  tiltStp.setMaxSpeed(2000);
-  tiltStp.setAcceleration(1000);
+  applyMotionLimits();
+  tracker.setPanLimits(-lround(PAN_LIMIT_CCW_DEG / degPerMicroPan),
+                        lround(PAN_LIMIT_CW_DEG  / degPerMicroPan));
+  sidereal.setPanLimits(-lround(PAN_LIMIT_CCW_DEG / degPerMicroPan),
+                         lround(PAN_LIMIT_CW_DEG  / degPerMicroPan));
+  sidereal.setTiltLimits(-lround(TILT_LIMIT_UP_DEG   / degPerMicroTilt),
+                          lround(TILT_LIMIT_DOWN_DEG / degPerMicroTilt));
 }
 
 void loop() {
+  // Long iterations while moving mean late steps: processCmd blocking, SPIFFS, BT
+  static uint32_t lastLoopUs = 0;
+  uint32_t loopUs = micros();
+  if (lastLoopUs != 0 && loopUs - lastLoopUs > LOOP_GAP_US
+      && (slew.isActive() || tracker.isTracking() || sidereal.isTracking() || jog.isActive()))
+    REC_EVENT(REC_LOOP_GAP, REC_AXIS_NONE, int32_t(loopUs - lastLoopUs));
+  lastLoopUs = loopUs;
+
   // BT client tracking
   bool client = SerialBT.hasClient();
   if (client && !wasClient) {
@@ -261,7 +835,7 @@ void loop() {
     size_t avail = SerialBT.available();
     String line = SerialBT.readStringUntil('\n');
     line.trim();
-    Serial.printf("[ESP] Recived raw: '%s'\n", line.c_str());
+    LOGD("[ESP] Received raw: '%s'", line);
     processCmd(line, true);
   }
 
@@ -276,17 +850,87 @@ void loop() {
     processCmd(line, true);
   }
 
-  uint32_t nowSec = uint32_t(time(nullptr));
+  uint64_t nowMs = nowUnixMs();
+
+  if (slew.isActive()) {
+    // GOTO in progress: manual and tracking motion wait for it
+    if (!slew.update()) {
+      if (slewReplyPending) {
+        if (slewReplyBT) SerialBT.println("PREP_DONE"); else Serial.println("PREP_DONE");
+        slewReplyPending = false;
+      }
+      if (pendingSidereal) {
+        sidereal.start(nowMs);
+        pendingSidereal = false;
+      }
+      if (pendingTrackIndex >= 0) {
+        tracker.prepare(pendingTrackIndex);
+        pendingTrackIndex = -1;
+        sessionActive     = true;
+      }
+    }
+    return;
+  }
+
+  if (sessionActive && !tracker.isTracking()) {
+    // Plan finished: nothing left to resume
+    sessionActive = false;
+    planStore.clearSession();
+  }
+
+  if (hostStepped && tracker.takeOver(nowMs)) {
+    // The app stops stepping at the splice moment; from here the plan runs on the device
+    hostStepped   = false;
+    sessionActive = true;
+  }
+
+  if (spliceReplyPending && !tracker.splicePending()) {
+    spliceReplyPending = false;
+    if (tracker.isTracking()) {
+      // A resume after a reset continues on the new plan
+      planStore.saveSession(spliceName, tracker.T0());
+      if (spliceReplyBT) SerialBT.printf("SPLICED %lu %s\n", (unsigned long)tracker.planVersion(), spliceName);
+      else               Serial.printf("SPLICED %lu %s\n", (unsigned long)tracker.planVersion(), spliceName);
+    } else {
+      if (spliceReplyBT) SerialBT.println("SPLICE_CANCELLED"); else Serial.println("SPLICE_CANCELLED");
+    }
+  }
+
+  if (jog.isActive()) {
+    // Manual jog has priority, runs until the app stops sending heartbeats
+    jog.update();
+    jogDuringTrack = tracker.isTracking();
+    return;
+  }
+  if (jogDuringTrack) {
+    // Nudged by hand while tracking: the path continues from where the user left it
+    jogDuringTrack = false;
+    tracker.holdCurrentPosition(nowMs);
+    LOGI("[TRACK] Offset after jog %.3f/%.3f deg", tracker.offsetAz(), tracker.offsetEl());
+  }
+
+  if (sidereal.isTracking()) {
+    sidereal.update(nowMs);
+    if (!sidereal.isTracking()) {
+      // Target set or left the tilt travel: the axes stopped where they were
+      const char *why = sidereal.halted() == SiderealTracker::HALT_HORIZON ? "HORIZON" : "TILT_LIMIT";
+      if (siderealReplyBT) SerialBT.printf("SIDEREAL_HALTED %s\n", why);
+      else                 Serial.printf("SIDEREAL_HALTED %s\n", why);
+    }
+    return;
+  }
 
   if (tracker.isTracking()) {
-    // automatic tracking
-    tracker.update(nowSec);
+    // automatic tracking, not throttled: fast movers need kHz step rates
+    tracker.update(nowMs);
     tracker.runSteppers();
-  } else {
-    // manual continuous
-    if (movingPan)   panStp.runSpeed(); else panStp.disableOutputs();
-    if (movingTilt)  tiltStp.runSpeed(); else tiltStp.disableOutputs();
+    return;
   }
 
-  delay(10);
+  // manual continuous
+  if (movingPan)   panStp.runSpeed(); else panStp.disableOutputs();
+  if (movingTilt)  tiltStp.runSpeed(); else tiltStp.disableOutputs();
+
+  // Uploads are not throttled
+  if (!inRxTraj && !benchRx) delay(10);
 }
@@ -0,0 +1,127 @@
+#include "DeferredLog.h"
+
+DeferredLog deferredLog;
+
+DeferredLog::DeferredLog() {
+  for (uint32_t i = 0; i < CAPACITY; ++i) ring_[i].seq = 0;
+}
+
+void DeferredLog::begin(Stream& out, UBaseType_t priority) {
+  out_ = &out;
+  if (!task_) xTaskCreatePinnedToCore(taskEntry, "log", 3072, this, priority, &task_, 0);
+}
+
+void DeferredLog::taskEntry(void* arg) {
+  DeferredLog* self = static_cast<DeferredLog*>(arg);
+  for (;;) {
+    self->drain();
+    vTaskDelay(pdMS_TO_TICKS(DRAIN_PERIOD_MS));
+  }
+}
+
+void DeferredLog::pack(Record& r, uint8_t n, const char* v) {
+  // Strings are stored one after another, NUL-separated, as far as they fit
+  size_t off = 0;
+  for (uint8_t k = 0; k < n; ++k)
+    if (r.types[k] == ARG_STR) off += strlen(r.str + off) + 1;
+  r.types[n] = ARG_STR;
+  if (off >= STR_BYTES) return;
+  const size_t room = STR_BYTES - 1 - off;
+  size_t len = v ? strlen(v) : 0;
+  if (len > room) len = room;
+  memcpy(r.str + off, v ? v : "", len);
+  r.str[off + len] = '\0';
+}
+
+void DeferredLog::drain() {
+  if (!out_) return;
+  static uint32_t reportedDrops = 0;
+  char line[192];
+
+  for (;;) {
+    const uint32_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+    if (tail_ == head) break;
+    if (head - tail_ > CAPACITY) {
+      // Lapped by the writers: the oldest records are gone
+      dropped_ += head - CAPACITY - tail_;
+      tail_ = head - CAPACITY;
+    }
+
+    const Record& slot = ring_[tail_ & (CAPACITY - 1)];
+    const uint32_t s1 = __atomic_load_n(&slot.seq, __ATOMIC_ACQUIRE);
+    const int32_t lag = int32_t(s1 - (tail_ + 1));
+    if (s1 == 0 || lag < 0) break;       // still being written, next round
+    if (lag > 0) { ++dropped_; ++tail_; continue; }   // overwritten already
+
+    Record r = slot;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot.seq, __ATOMIC_RELAXED) != s1) { ++dropped_; ++tail_; continue; }
+    ++tail_;
+
+    format(r, line, sizeof(line));
+    out_->println(line);
+  }
+
+  if (dropped_ != reportedDrops) {
+    out_->printf("[LOG] %lu dropped\n", (unsigned long)(dropped_ - reportedDrops));
+    reportedDrops = dropped_;
+  }
+}
+
+size_t DeferredLog::format(const Record& r, char* out, size_t size) const {
+  static const char LEVELS[] = "?EWID";
+  size_t pos = snprintf(out, size, "%lu %c ", (unsigned long)r.tMs, LEVELS[r.level <= LOG_DEBUG ? r.level : 0]);
+  uint8_t arg = 0;
+  size_t strOff = 0;
+
+  for (const char* p = r.fmt; *p && pos + 1 < size; ++p) {
+    if (*p != '%') { out[pos++] = *p; continue; }
+    if (p[1] == '%') { out[pos++] = '%'; ++p; continue; }
+
+    // One conversion: flags/width/precision kept, length modifiers dropped
+    // (arguments are stored as 32-bit values)
+    char spec[16];
+    size_t n = 0;
+    spec[n++] = '%';
+    ++p;
+    while (*p && strchr("-+ #0123456789.", *p) && n < sizeof(spec) - 3) spec[n++] = *p++;
+    while (*p && strchr("hlzjtL", *p)) ++p;
+    if (!*p) break;
+    const char conv = *p;
+    spec[n++] = conv;
+    spec[n] = '\0';
+
+    const uint8_t type = arg < MAX_ARGS ? r.types[arg] : ARG_NONE;
+    double f = 0.0;
+    long   i = 0;
+    switch (type) {
+      case ARG_INT:   i = r.args[arg].i; f = i; break;
+      case ARG_UINT:  i = long(r.args[arg].u); f = r.args[arg].u; break;
+      case ARG_FLOAT: f = r.args[arg].f; i = long(f); break;
+      default: break;
+    }
+    ++arg;
+
+    int w;
+    if (conv == 's') {
+      const char* s = "?";
+      if (type == ARG_STR && strOff < STR_BYTES) {
+        s = r.str + strOff;
+        strOff += strlen(s) + 1;
+      }
+      w = snprintf(out + pos, size - pos, spec, s);
+    } else if (strchr("fFeEgGaA", conv)) {
+      w = snprintf(out + pos, size - pos, spec, f);
+    } else if (strchr("uxXo", conv)) {
+      w = snprintf(out + pos, size - pos, spec, (unsigned)i);
+    } else {
+      w = snprintf(out + pos, size - pos, spec, (int)i);
+    }
+    if (w > 0) pos += size_t(w) < size - pos ? size_t(w) : size - pos - 1;
+  }
+
+  // One record per line, the caller adds the line end
+  while (pos > 0 && (out[pos - 1] == '\n' || out[pos - 1] == '\r')) --pos;
+  out[pos] = '\0';
+  return pos;
+}
@@ -0,0 +1,126 @@
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Compile-time level: calls above it are removed by the preprocessor,
+// arguments included
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+enum LogLevel : uint8_t { LOG_ERROR = 1, LOG_WARN, LOG_INFO, LOG_DEBUG };
+
+/**
+ * Logging that costs the caller a few stores instead of a printf on the
+ * UART. A record keeps the format string's address (string literals live
+ * in flash, so the pointer is the message ID), a timestamp and up to
+ * MAX_ARGS raw arguments; %s arguments are copied into STR_BYTES shared
+ * by all strings of the record.
+ * A low-priority task formats and prints the records.
+ *
+ * Writers reserve a slot with one atomic increment, as in FlightRecorder,
+ * so loop(), the sensor task and callbacks can log without locks. When
+ * the drain falls a whole ring behind, the oldest records are lost and
+ * reported as "[LOG] n dropped".
+ */
+class DeferredLog {
+public:
+    static const uint32_t CAPACITY  = 128;   // power of two
+    static const uint8_t  MAX_ARGS  = 4;
+    static const uint8_t  STR_BYTES = 40;
+    static const uint16_t DRAIN_PERIOD_MS = 20;
+
+    enum ArgType : uint8_t { ARG_NONE = 0, ARG_INT, ARG_UINT, ARG_FLOAT, ARG_STR };
+
+    struct Record {
+        uint32_t    seq;          // write index + 1 once complete, 0 while written
+        uint32_t    tMs;
+        const char* fmt;
+        uint8_t     level;
+        uint8_t     types[MAX_ARGS];
+        union { int32_t i; uint32_t u; float f; } args[MAX_ARGS];
+        char        str[STR_BYTES];   // %s arguments, NUL-separated
+    };
+
+    DeferredLog();
+
+    // Starts the drain task on core 0; records logged earlier are kept
+    void begin(Stream& out, UBaseType_t priority = 1);
+
+    template <typename... Args>
+    void log(LogLevel level, const char* fmt, Args... args) {
+        static_assert(sizeof...(Args) <= MAX_ARGS, "too many log arguments");
+        const uint32_t i = __atomic_fetch_add(&head_, 1, __ATOMIC_RELAXED);
+        Record& r = ring_[i & (CAPACITY - 1)];
+        __atomic_store_n(&r.seq, 0, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        r.tMs   = millis();
+        r.fmt   = fmt;
+        r.level = level;
+        r.str[0] = '\0';
+        uint8_t n = 0;
+        int dummy[] = { 0, (pack(r, n++, args), 0)... };
+        (void)dummy;
+        for (; n < MAX_ARGS; ++n) r.types[n] = ARG_NONE;
+        __atomic_store_n(&r.seq, i + 1, __ATOMIC_RELEASE);
+    }
+
+    // Formats and prints everything logged so far (also used by the task)
+    void drain();
+    uint32_t dropped() const { return dropped_; }
+
+private:
+    static void pack(Record& r, uint8_t n, int v)           { r.types[n] = ARG_INT;  r.args[n].i = v; }
+    static void pack(Record& r, uint8_t n, long v)          { r.types[n] = ARG_INT;  r.args[n].i = int32_t(v); }
+    static void pack(Record& r, uint8_t n, unsigned v)      { r.types[n] = ARG_UINT; r.args[n].u = v; }
+    static void pack(Record& r, uint8_t n, unsigned long v) { r.types[n] = ARG_UINT; r.args[n].u = uint32_t(v); }
+    static void pack(Record& r, uint8_t n, float v)         { r.types[n] = ARG_FLOAT; r.args[n].f = v; }
+    static void pack(Record& r, uint8_t n, double v)        { r.types[n] = ARG_FLOAT; r.args[n].f = float(v); }
+    static void pack(Record& r, uint8_t n, const char* v);
+    static void pack(Record& r, uint8_t n, const String& v) { pack(r, n, v.c_str()); }
+
+    static void taskEntry(void* arg);
+    size_t format(const Record& r, char* out, size_t size) const;
+
+    Record    ring_[CAPACITY];
+    uint32_t  head_ = 0;      // next write index
+    uint32_t  tail_ = 0;      // next index to print (drain only)
+    uint32_t  dropped_ = 0;
+    Stream*   out_ = nullptr;
+    TaskHandle_t task_ = nullptr;
+};
+
+extern DeferredLog deferredLog;
+
+#define LOG_AT(level, fmt, ...) deferredLog.log(level, fmt, ##__VA_ARGS__)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOGE(fmt, ...) LOG_AT(LOG_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define LOGE(fmt, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOGW(fmt, ...) LOG_AT(LOG_WARN, fmt, ##__VA_ARGS__)
+#else
+#define LOGW(fmt, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOGI(fmt, ...) LOG_AT(LOG_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOGI(fmt, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOGD(fmt, ...) LOG_AT(LOG_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOGD(fmt, ...) do {} while (0)
+#endif
+
+#endif // DEFERRED_LOG_H
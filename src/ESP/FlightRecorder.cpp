@@ -0,0 +1,81 @@
+#include "FlightRecorder.h"
+#include <cstring>
+
+// Events copied per write() during a dump
+static const uint32_t DUMP_CHUNK = 32;
+// Lets writers that reserved a slot just before a dump finish it [us]
+static const uint32_t DUMP_SETTLE_US = 50;
+
+FlightRecorder flightRecorder;
+
+FlightRecorder::FlightRecorder()
+    : ring_(new RecEvent[CAPACITY])
+    , head_(0)
+    , enabled_(FLIGHT_RECORDER_ENABLED != 0)
+{
+    memset(ring_, 0, CAPACITY * sizeof(RecEvent));
+}
+
+void FlightRecorder::clear() {
+    bool was = enabled_;
+    enabled_ = false;
+    delayMicroseconds(DUMP_SETTLE_US);
+    memset(ring_, 0, CAPACITY * sizeof(RecEvent));
+    __atomic_store_n(&head_, 0, __ATOMIC_RELAXED);
+    enabled_ = was;
+}
+
+int32_t FlightRecorder::packTag(const char *s) {
+    uint32_t v = 0;
+    for (int k = 0; k < 4 && s[k]; ++k)
+        v |= uint32_t(uint8_t(s[k])) << (8 * k);
+    return int32_t(v);
+}
+
+uint32_t FlightRecorder::dump(Stream &out, uint64_t nowUnixMs) {
+    // Recording pauses for the dump, so the snapshot is stable
+    bool was = enabled_;
+    enabled_ = false;
+    delayMicroseconds(DUMP_SETTLE_US);
+
+    uint32_t head  = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+    uint32_t first = (head > CAPACITY) ? head - CAPACITY : 0;
+
+    // Slots still holding an older lap (a writer lost the race) are skipped
+    uint32_t count = 0;
+    for (uint32_t i = first; i < head; ++i)
+        if (__atomic_load_n(&ring_[i & (CAPACITY - 1)].seq, __ATOMIC_ACQUIRE) == uint16_t(i))
+            ++count;
+
+    out.printf("REC_DUMP %lu %lu %llu\n", (unsigned long)count,
+               (unsigned long)micros(), (unsigned long long)nowUnixMs);
+
+    RecEvent chunk[DUMP_CHUNK];
+    uint32_t n = 0;
+    for (uint32_t i = first; i < head; ++i) {
+        const RecEvent &e = ring_[i & (CAPACITY - 1)];
+        if (e.seq != uint16_t(i)) continue;
+        chunk[n++] = e;
+        if (n == DUMP_CHUNK) {
+            out.write(reinterpret_cast<const uint8_t *>(chunk), n * sizeof(RecEvent));
+            n = 0;
+        }
+    }
+    if (n) out.write(reinterpret_cast<const uint8_t *>(chunk), n * sizeof(RecEvent));
+    out.println();
+    out.println("REC_END");
+
+    enabled_ = was;
+    return count;
+}
+
+FlightRecorder::CmdScope::CmdScope(FlightRecorder &rec, const char *cmd)
+    : rec_(rec)
+    , startUs_(micros())
+{
+    rec_.record(REC_CMD_BEGIN, REC_AXIS_NONE, FlightRecorder::packTag(cmd));
+}
+
+FlightRecorder::CmdScope::~CmdScope() {
+    rec_.record(REC_CMD_END, REC_AXIS_NONE, int32_t(micros() - startUs_));
+}
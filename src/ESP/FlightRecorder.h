@@ -0,0 +1,119 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <Arduino.h>
+
+// Compile-time switches: the whole recorder, and per-step events (kHz rates,
+// fill the ring within a second; enable only when chasing step timing)
+#ifndef FLIGHT_RECORDER_ENABLED
+#define FLIGHT_RECORDER_ENABLED 1
+#endif
+#ifndef FLIGHT_RECORDER_STEPS
+#define FLIGHT_RECORDER_STEPS   0
+#endif
+
+enum RecType : uint8_t {
+    REC_NONE = 0,
+    REC_CMD_BEGIN,     // value: first 4 characters of the command, packed
+    REC_CMD_END,       // value: time spent in processCmd [us]
+    REC_LOOP_GAP,      // value: loop() iteration longer than LOOP_GAP_US [us]
+    REC_CTRL_LATE,     // value: tracker control update interval over its period [us]
+    REC_SEGMENT,       // value: trajectory index the tracker moved to
+    REC_POS_ERROR,     // axis, value: target - position [steps], sampled
+    REC_UNWIND,        // value: pan unwind [deg]
+    REC_STEP,          // axis, value: position after the step (FLIGHT_RECORDER_STEPS)
+    REC_SLEW_START,    // value: planned duration [ms]
+    REC_SLEW_END,      // value: actual duration [ms]
+    REC_TRACK_START,   // value: start index
+    REC_TRACK_STOP,    // value: index reached
+    REC_IMU_OVERRUN,   // value: MPU6050 FIFO byte count when it overflowed
+    REC_SPLICE,        // value: index of the spliced-in trajectory the tracker continues from
+    REC_OFFSET,        // axis, value: new path offset [millidegrees]
+};
+
+enum RecAxis : uint8_t { REC_AXIS_NONE = 0, REC_AXIS_PAN, REC_AXIS_TILT };
+
+// One event, 12 bytes; seq is the low half of the write index and marks
+// the slot as complete (written last)
+struct RecEvent {
+    uint32_t tUs;      // micros(), wraps every ~71 min
+    uint8_t  type;     // RecType
+    uint8_t  axis;     // RecAxis
+    uint16_t seq;
+    int32_t  value;
+};
+
+/**
+ * Fixed-size ring of binary events kept in RAM for post-mortem timing
+ * analysis. Writers reserve a slot with a single atomic increment, so the
+ * motion path, the command handler and other tasks can record without
+ * locks; a slow writer can at worst lose its own event to a lap of the
+ * ring. dump() sends a snapshot in bulk: a text header line
+ * "REC_DUMP <count> <micros now> <unix ms now>", count raw RecEvent
+ * records, then "REC_END". src/tools/rec_decode.py renders it.
+ */
+class FlightRecorder {
+public:
+    static const uint32_t CAPACITY = 4096;   // power of two, 48 KB
+
+    FlightRecorder();
+
+    inline void record(RecType type, RecAxis axis, int32_t value) {
+        if (!enabled_) return;
+        uint32_t i = __atomic_fetch_add(&head_, 1, __ATOMIC_RELAXED);
+        RecEvent &e = ring_[i & (CAPACITY - 1)];
+        e.tUs   = micros();
+        e.type  = type;
+        e.axis  = axis;
+        e.value = value;
+        __atomic_store_n(&e.seq, uint16_t(i), __ATOMIC_RELEASE);
+    }
+
+    /**
+     * Write the retained events, oldest first, to a stream
+     * @param nowUnixMs  wall clock matching the header's micros(), 0 if unknown
+     * @return number of events written
+     */
+    uint32_t dump(Stream &out, uint64_t nowUnixMs);
+
+    void clear();
+    void setEnabled(bool on) { enabled_ = on; }
+    bool isEnabled() const { return enabled_; }
+    uint32_t written() const { return __atomic_load_n(&head_, __ATOMIC_RELAXED); }
+
+    // First 4 characters of a command as one value (decoder prints them back)
+    static int32_t packTag(const char *s);
+
+    // Records REC_CMD_BEGIN/REC_CMD_END around a scope
+    class CmdScope {
+    public:
+        CmdScope(FlightRecorder &rec, const char *cmd);
+        ~CmdScope();
+    private:
+        FlightRecorder &rec_;
+        uint32_t startUs_;
+    };
+
+private:
+    RecEvent *ring_;
+    uint32_t  head_;       // total events ever reserved
+    volatile bool enabled_;
+};
+
+extern FlightRecorder flightRecorder;
+
+#if FLIGHT_RECORDER_ENABLED
+#define REC_EVENT(type, axis, value) flightRecorder.record((type), (axis), (value))
+#define REC_CMD_SCOPE(cmd)           FlightRecorder::CmdScope recScope_(flightRecorder, (cmd))
+#else
+#define REC_EVENT(type, axis, value) do {} while (0)
+#define REC_CMD_SCOPE(cmd)           do {} while (0)
+#endif
+
+#if FLIGHT_RECORDER_ENABLED && FLIGHT_RECORDER_STEPS
+#define REC_STEP_EVENT(axis, pos)    flightRecorder.record(REC_STEP, (axis), int32_t(pos))
+#else
+#define REC_STEP_EVENT(axis, pos)    do {} while (0)
+#endif
+
+#endif // FLIGHT_RECORDER_H
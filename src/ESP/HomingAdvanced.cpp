@@ -1,12 +1,13 @@
 #include "HomingAdvanced.h"
 #include <Arduino.h>
 #include <Wire.h>  // inicjalizację usuniemy stąd
+#include "DeferredLog.h"
 
 HomingAdvanced::HomingAdvanced(
     AccelStepper& panStp, uint8_t panEndPin, uint8_t panEn, uint8_t panDir, uint8_t panStep,
     AccelStepper& tiltStp, uint8_t tiltEndPin, uint8_t tiltEn, uint8_t tiltDir, uint8_t tiltStep,
     float degPerMicroPan, float degPerMicroTilt,
-    Adafruit_HMC5883_Unified& magSensor, MPU6050& mpuSensor,
+    SensorHub& sensorHub,
     float homeSpeed, long backoffSteps
   )
   : panStepper(panStp)
@@ -21,8 +22,7 @@ HomingAdvanced::HomingAdvanced(
   , tiltStepPin(tiltStep)
   , degPerStepPan(degPerMicroPan)
   , degPerStepTilt(degPerMicroTilt)
-  , mag(magSensor)
-  , mpu(mpuSensor)
+  , sensors(sensorHub)
   , speedHome(homeSpeed)
   , backoff(backoffSteps)
 {}
@@ -30,19 +30,11 @@ HomingAdvanced::HomingAdvanced(
 void HomingAdvanced::begin() {
   // I²C-inicjalizację wykonaj w szkicu:
   // Wire.begin(SDA_PIN, SCL_PIN);
-  Wire.setClock(100000);
 
-  // Sensory
-  if (!mag.begin()) {
-    Serial.println("Error: HMC5883L not found");
+  // Sensory: 400 kHz, odczyt w osobnym zadaniu, kalibracja żyroskopu w tle
+  if (!sensors.begin()) {
     while (1);
   }
-  if (mpu.begin() != 0) {
-    Serial.println("Error: MPU6050 init failed");
-    while (1);
-  }
-  mpu.calcGyroOffsets();
-  Serial.println("Sensors initialized");
 
   // Krańcówki
   pinMode(panEndstopPin, INPUT_PULLUP);
@@ -62,16 +54,19 @@ void HomingAdvanced::begin() {
 }
 
 void HomingAdvanced::homeAll() {
-  Serial.println("=== Starting full homing ===");
+  LOGI("=== Starting full homing ===");
   homeAxis(panStepper, panEndstopPin);
-  Serial.println("Pan homed at 0");
+  LOGI("Pan homed at 0");
   homeAxis(tiltStepper, tiltEndstopPin);
-  Serial.println("Tilt homed at 0");
+  LOGI("Tilt homed at 0");
   backoffBoth();
-  Serial.println("Repositioning to 180° azimuth & 45° elevation...");
+  LOGI("Repositioning to 180° azimuth & 45° elevation...");
   reposition(180.0f, 45.0f);
-  Serial.println("Repositioning done");
-  Serial.println("Drivers disabled – full homing complete");
+  // Home orientation is the zero of both axes (pan cable wrap is counted from here)
+  panStepper.setCurrentPosition(0);
+  tiltStepper.setCurrentPosition(0);
+  LOGI("Repositioning done");
+  LOGI("Drivers disabled – full homing complete");
 }
 
 void HomingAdvanced::homeAxis(AccelStepper& stp, uint8_t endPin) {
@@ -83,25 +78,25 @@ void HomingAdvanced::homeAxis(AccelStepper& stp, uint8_t endPin) {
 }
 
 void HomingAdvanced::backoffBoth() {
-  Serial.printf("Backoff %ld steps\n", backoff);
+  LOGI("Backoff %ld steps", backoff);
   panStepper.move(-backoff);
   tiltStepper.move(-backoff);
   panStepper.runToPosition();
   tiltStepper.runToPosition();
-  Serial.println("Drivers disabled");
+  LOGI("Drivers disabled");
 }
 
 void HomingAdvanced::readOrientation(float &azDeg, float &elDeg) {
-  sensors_event_t magEvent;
-  mag.getEvent(&magEvent);
-  mpu.update();
-  float ax = mpu.getAccX(), ay = mpu.getAccY(), az = mpu.getAccZ();
-
-  float heading = atan2(magEvent.magnetic.y, magEvent.magnetic.x) * 180.0 / M_PI;
-  if (heading < 0) heading += 360.0;
-  azDeg = heading;
-
-  elDeg = atan2(-ax, sqrt(ay*ay + az*az)) * 180.0 / M_PI;
+  // Najnowsza próbka z zadania czujników, bez czekania na I²C
+  OrientationSample s;
+  if (!sensors.waitForSample(1000) || !sensors.snapshot(s)) {
+    LOGW("Warning: no sensor data, assuming home orientation");
+    azDeg = 180.0f;
+    elDeg = 45.0f;
+    return;
+  }
+  azDeg = s.azDeg;
+  elDeg = s.elDeg;
 }
 
 void HomingAdvanced::moveAxis(uint8_t dirPin, uint8_t stepPin, float deltaDeg, float degPerMicrostep) {
@@ -123,7 +118,12 @@ void HomingAdvanced::reposition(float targetAz, float targetEl) {
   float deltaAz = (rawAz > 0) ? rawAz - 360.0 : rawAz;
   float deltaEl = targetEl - currEl;
 
-  Serial.printf("⏩ Reposition: AZ %.2f°, EL %.2f°\n", deltaAz, deltaEl);
+  LOGI("⏩ Reposition: AZ %.2f°, EL %.2f°", deltaAz, deltaEl);
+  if (slew) {
+    slew->start(lround(deltaAz / degPerStepPan), lround(-deltaEl / degPerStepTilt));
+    slew->runToCompletion();
+    return;
+  }
   moveAxis(panDirPin,  panStepPin,  deltaAz, degPerStepPan);
   moveAxis(tiltDirPin, tiltStepPin, -deltaEl, degPerStepTilt);
 }
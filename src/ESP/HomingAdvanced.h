@@ -2,10 +2,9 @@
 #define HOMING_ADVANCED_H
 
 #include <Arduino.h>
-#include <Adafruit_Sensor.h>
-#include <Adafruit_HMC5883_U.h>
-#include <MPU6050_light.h>
 #include <AccelStepper.h>
+#include "SyncSlew.h"
+#include "SensorHub.h"
 
 class HomingAdvanced {
 public:
@@ -13,12 +12,16 @@ public:
     AccelStepper& panStp, uint8_t panEndPin, uint8_t panEnablePin, uint8_t panDirPin, uint8_t panStepPin,
     AccelStepper& tiltStp, uint8_t tiltEndPin, uint8_t tiltEnablePin, uint8_t tiltDirPin, uint8_t tiltStepPin,
     float degPerMicroPan, float degPerMicroTilt,
-    Adafruit_HMC5883_Unified& magSensor, MPU6050& mpuSensor,
+    SensorHub& sensorHub,
     float homeSpeed, long backoffSteps
   );
 
   void begin();
   void homeAll();
+  // Use the synchronized GOTO engine for repositioning instead of bit-banging
+  void attachSlew(SyncSlew& slewEngine) { slew = &slewEngine; }
+  // Endstop approach speed, e.g. as measured by MotionCalibrator
+  void setHomeSpeed(float speed) { speedHome = speed; }
 
 private:
   void homeAxis(AccelStepper& stp, uint8_t endPin);
@@ -32,10 +35,10 @@ private:
   AccelStepper& tiltStepper;
   uint8_t tiltEndstopPin, tiltEnablePin, tiltDirPin, tiltStepPin;
   float degPerStepPan, degPerStepTilt;
-  Adafruit_HMC5883_Unified& mag;
-  MPU6050& mpu;
+  SensorHub& sensors;
   float speedHome;
   long backoff;
+  SyncSlew* slew = nullptr;
 };
 
 #endif // HOMING_ADVANCED_H
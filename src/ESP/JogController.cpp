@@ -0,0 +1,84 @@
+#include "JogController.h"
+#include <Arduino.h>
+#include <cmath>
+
+// Speed changes are applied at most this often, stepping runs every call
+static const uint32_t RAMP_PERIOD_US = 2000;
+
+JogController::JogController(AccelStepper &panStp, AccelStepper &tiltStp)
+    : panStp_(panStp)
+    , tiltStp_(tiltStp)
+    , panMax_(2000), panAccel_(4000)
+    , tiltMax_(1000), tiltAccel_(2000)
+    , panTarget_(0), tiltTarget_(0)
+    , panSpeed_(0), tiltSpeed_(0)
+    , timeoutMs_(300)
+    , lastCmdMs_(0)
+    , lastUpdateUs_(0)
+    , active_(false)
+{}
+
+void JogController::setLimits(float panMaxSpeed, float panAccel,
+                              float tiltMaxSpeed, float tiltAccel) {
+    panMax_    = panMaxSpeed;
+    panAccel_  = panAccel;
+    tiltMax_   = tiltMaxSpeed;
+    tiltAccel_ = tiltAccel;
+}
+
+void JogController::command(float panSpeed, float tiltSpeed) {
+    panTarget_  = constrain(panSpeed,  -panMax_,  panMax_);
+    tiltTarget_ = constrain(tiltSpeed, -tiltMax_, tiltMax_);
+    lastCmdMs_  = millis();
+    if (!active_ && (panTarget_ != 0 || tiltTarget_ != 0)) {
+        active_       = true;
+        lastUpdateUs_ = micros();
+        panStp_.setMaxSpeed(panMax_);
+        tiltStp_.setMaxSpeed(tiltMax_);
+        panStp_.enableOutputs();
+        tiltStp_.enableOutputs();
+    }
+}
+
+float JogController::approach(float current, float target, float maxDelta) {
+    if (target > current) return fminf(current + maxDelta, target);
+    return fmaxf(current - maxDelta, target);
+}
+
+bool JogController::update() {
+    if (!active_) return false;
+
+    uint32_t nowUs = micros();
+    uint32_t dtUs  = nowUs - lastUpdateUs_;
+    if (dtUs >= RAMP_PERIOD_US) {
+        lastUpdateUs_ = nowUs;
+        if (millis() - lastCmdMs_ > timeoutMs_) {
+            // Heartbeat lost: ramp down
+            panTarget_  = 0;
+            tiltTarget_ = 0;
+        }
+        float dt   = dtUs * 1e-6f;
+        panSpeed_  = approach(panSpeed_,  panTarget_,  panAccel_  * dt);
+        tiltSpeed_ = approach(tiltSpeed_, tiltTarget_, tiltAccel_ * dt);
+        panStp_.setSpeed(panSpeed_);
+        tiltStp_.setSpeed(tiltSpeed_);
+
+        if (panSpeed_ == 0 && tiltSpeed_ == 0 && panTarget_ == 0 && tiltTarget_ == 0) {
+            stop();
+            return false;
+        }
+    }
+    if (panSpeed_ != 0)  panStp_.runSpeed();
+    if (tiltSpeed_ != 0) tiltStp_.runSpeed();
+    return true;
+}
+
+void JogController::stop() {
+    active_     = false;
+    panTarget_  = tiltTarget_ = 0;
+    panSpeed_   = tiltSpeed_  = 0;
+    panStp_.setSpeed(0);
+    tiltStp_.setSpeed(0);
+    panStp_.disableOutputs();
+    tiltStp_.disableOutputs();
+}
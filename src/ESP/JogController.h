@@ -0,0 +1,44 @@
+#ifndef JOG_CONTROLLER_H
+#define JOG_CONTROLLER_H
+
+#include <AccelStepper.h>
+#include <cstdint>
+
+/**
+ * Streaming manual drive. Every JOG command is both a new velocity target
+ * and a heartbeat; when heartbeats stop the axes ramp down on their own,
+ * so a lost release packet cannot leave a motor running.
+ */
+class JogController {
+public:
+    JogController(AccelStepper &panStp, AccelStepper &tiltStp);
+
+    void setLimits(float panMaxSpeed, float panAccel,
+                   float tiltMaxSpeed, float tiltAccel);
+    void setTimeout(uint32_t ms) { timeoutMs_ = ms; }
+
+    // Signed target speeds in motor steps/s; also refreshes the heartbeat
+    void command(float panSpeed, float tiltSpeed);
+    // Ramps towards the targets and steps the motors; false once at rest
+    bool update();
+    // Immediate stop without ramp
+    void stop();
+
+    bool isActive() const { return active_; }
+
+private:
+    static float approach(float current, float target, float maxDelta);
+
+    AccelStepper &panStp_;
+    AccelStepper &tiltStp_;
+    float panMax_, panAccel_;
+    float tiltMax_, tiltAccel_;
+    float panTarget_, tiltTarget_;
+    float panSpeed_, tiltSpeed_;
+    uint32_t timeoutMs_;
+    uint32_t lastCmdMs_;
+    uint32_t lastUpdateUs_;
+    bool active_;
+};
+
+#endif // JOG_CONTROLLER_H
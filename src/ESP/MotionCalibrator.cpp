@@ -0,0 +1,280 @@
+#include "MotionCalibrator.h"
+#include <Preferences.h>
+#include <algorithm>
+#include "DeferredLog.h"
+
+// NVS namespace and layout version of the stored limits
+static const char    *NVS_NAMESPACE = "motion";
+static const uint32_t NVS_VERSION   = 1;
+
+// Reference position: this far out of the endstop, reached at creep speed
+static const long  BACKOFF_STEPS  = 200;
+static const float CREEP_SPEED    = 300;     // [steps/s], always reliable
+// Endstop repeatability: a count this far off is switch noise, not a lost step
+static const long  LOSS_TOL_STEPS = 16;      // two full steps at 1/8 microstepping
+// Orientation check at the far end of a slew, after the filter settles
+static const uint32_t SETTLE_MS     = 300;
+static const float    EL_TOL_DEG    = 2.0f;
+static const float    AZ_TOL_DEG    = 10.0f; // magnetometer next to the motors
+// Candidates: from half the default up, each 25 % above the last, at most 4x
+static const float START_FACTOR   = 0.5f;
+static const float STEP_FACTOR    = 1.25f;
+static const float CEIL_FACTOR    = 4.0f;
+// Time at full speed in a speed trial, and what is kept of the best result
+static const float CRUISE_S       = 0.3f;
+static const float MARGIN         = 0.8f;
+
+MotionCalibrator::MotionCalibrator(AccelStepper &panStp, uint8_t panEndPin, float degPerMicroPan,
+                                   AccelStepper &tiltStp, uint8_t tiltEndPin, float degPerMicroTilt,
+                                   SyncSlew &slew, SensorHub &sensors)
+    : slew_(slew)
+    , sensors_(sensors)
+    , pan_{"PAN", panStp, panEndPin, degPerMicroPan, true, 0, {4000, 4000, 16000}, {4000, 4000, 16000}}
+    , tilt_{"TILT", tiltStp, tiltEndPin, degPerMicroTilt, false, 0, {2000, 1000, 4000}, {2000, 1000, 4000}}
+    , homeDefault_(500)
+    , homeSpeed_(500)
+    , calibrated_(false)
+{}
+
+void MotionCalibrator::setDefaults(const SyncSlew::Limits &pan, const SyncSlew::Limits &tilt, float homeSpeed) {
+    pan_.def     = pan;
+    tilt_.def    = tilt;
+    homeDefault_ = homeSpeed;
+    if (!calibrated_) {
+        pan_.lim   = pan;
+        tilt_.lim  = tilt;
+        homeSpeed_ = homeSpeed;
+    }
+}
+
+void MotionCalibrator::setTravel(float panDeg, float tiltDeg) {
+    pan_.travel  = lroundf(panDeg  / pan_.degPerStep);
+    tilt_.travel = lroundf(tiltDeg / tilt_.degPerStep);
+}
+
+bool MotionCalibrator::load() {
+    Preferences prefs;
+    if (!prefs.begin(NVS_NAMESPACE, true)) return false;
+    bool ok = prefs.getUInt("ver", 0) == NVS_VERSION;
+    if (ok) {
+        pan_.lim   = { prefs.getFloat("panV"),  prefs.getFloat("panA"),  prefs.getFloat("panJ") };
+        tilt_.lim  = { prefs.getFloat("tiltV"), prefs.getFloat("tiltA"), prefs.getFloat("tiltJ") };
+        homeSpeed_ = prefs.getFloat("homeV", homeDefault_);
+        ok = pan_.lim.vMax > 0 && pan_.lim.aMax > 0 && tilt_.lim.vMax > 0 && tilt_.lim.aMax > 0;
+    }
+    prefs.end();
+    if (!ok) {
+        pan_.lim   = pan_.def;
+        tilt_.lim  = tilt_.def;
+        homeSpeed_ = homeDefault_;
+    }
+    calibrated_ = ok;
+    return ok;
+}
+
+void MotionCalibrator::save() const {
+    Preferences prefs;
+    if (!prefs.begin(NVS_NAMESPACE, false)) {
+        LOGE("[CAL] NVS not available, limits not stored");
+        return;
+    }
+    prefs.putFloat("panV",  pan_.lim.vMax);
+    prefs.putFloat("panA",  pan_.lim.aMax);
+    prefs.putFloat("panJ",  pan_.lim.jMax);
+    prefs.putFloat("tiltV", tilt_.lim.vMax);
+    prefs.putFloat("tiltA", tilt_.lim.aMax);
+    prefs.putFloat("tiltJ", tilt_.lim.jMax);
+    prefs.putFloat("homeV", homeSpeed_);
+    // Written last: a reset halfway leaves the old version, i.e. the defaults
+    prefs.putUInt("ver", NVS_VERSION);
+    prefs.end();
+}
+
+void MotionCalibrator::reset() {
+    Preferences prefs;
+    if (prefs.begin(NVS_NAMESPACE, false)) {
+        prefs.clear();
+        prefs.end();
+    }
+    pan_.lim    = pan_.def;
+    tilt_.lim   = tilt_.def;
+    homeSpeed_  = homeDefault_;
+    calibrated_ = false;
+}
+
+bool MotionCalibrator::sample(float &azDeg, float &elDeg, bool &hasHeading) {
+    delay(SETTLE_MS);
+    OrientationSample s;
+    if (!sensors_.snapshot(s)) return false;
+    azDeg      = s.azDeg;
+    elDeg      = s.elDeg;
+    hasHeading = s.hasHeading;
+    return true;
+}
+
+bool MotionCalibrator::slewAxis(Axis &a, long delta, const SyncSlew::Limits &lim) {
+    if (a.isPan) slew_.setLimits(lim, tilt_.lim);
+    else         slew_.setLimits(pan_.lim, lim);
+    if (!slew_.start(a.isPan ? delta : 0, a.isPan ? 0 : delta)) return true;
+    while (slew_.update()) {
+        // Away from the endstop it stays open; closed means the axis is not where it should be
+        if (delta > 0 && digitalRead(a.endPin) == LOW) {
+            slew_.abort();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MotionCalibrator::seek(Axis &a, float speed, long &counted) {
+    const long start = a.stp.currentPosition();
+    const long limit = a.travel + 4 * BACKOFF_STEPS;
+    a.stp.setMaxSpeed(speed);
+    a.stp.enableOutputs();
+    a.stp.setSpeed(speed);
+    while (digitalRead(a.endPin) == HIGH) {
+        a.stp.runSpeed();
+        if (a.stp.currentPosition() - start > limit) {
+            a.stp.setSpeed(0);
+            return false;
+        }
+    }
+    a.stp.setSpeed(0);
+    counted = a.stp.currentPosition() - start;
+    return true;
+}
+
+bool MotionCalibrator::trial(Axis &a, const SyncSlew::Limits &lim, long dist, long &lost) {
+    // Start: BACKOFF_STEPS out of the endstop; trials run away from it (negative)
+    float az0 = 0, el0 = 0, az1 = 0, el1 = 0;
+    bool  heading = false;
+    const bool haveStart = sample(az0, el0, heading);
+
+    slewAxis(a, -dist, lim);
+
+    // Far end: a large loss is visible here already, come back gently then
+    bool farOk = true;
+    if (haveStart && sample(az1, el1, heading)) {
+        const float moved = dist * a.degPerStep;
+        if (a.isPan) {
+            const float dAz = fmodf(az0 - az1 + 540.0f, 360.0f) - 180.0f;
+            farOk = !heading || fabsf(dAz - moved) <= AZ_TOL_DEG;
+        } else {
+            farOk = fabsf((el1 - el0) - moved) <= EL_TOL_DEG;
+        }
+    }
+
+    const bool backOk = slewAxis(a, dist, farOk ? lim : a.def);
+    long counted = 0;
+    if (!backOk) {
+        // Endstop closed early on the way back: the outbound move fell short
+        counted = 0;
+    } else if (!seek(a, CREEP_SPEED, counted)) {
+        return false;
+    }
+    lost = labs(counted - BACKOFF_STEPS);
+    if (!farOk && lost <= LOSS_TOL_STEPS) lost = LOSS_TOL_STEPS + 1;
+
+    // Ready for the next trial
+    slewAxis(a, -BACKOFF_STEPS, a.def);
+    return true;
+}
+
+bool MotionCalibrator::homeTrial(Axis &a, float speed, long &lost) {
+    long counted;
+    // Like homing: constant speed into the switch, no ramp either way
+    if (!seek(a, speed, counted)) return false;
+    slewAxis(a, -BACKOFF_STEPS, a.def);
+    if (!seek(a, CREEP_SPEED, counted)) return false;
+    lost = labs(counted - BACKOFF_STEPS);
+    slewAxis(a, -BACKOFF_STEPS, a.def);
+    return true;
+}
+
+bool MotionCalibrator::calibrateAxis(Axis &a, Stream &out, float &bestHome) {
+    long counted, lost;
+    const float jerkPerAccel = a.def.jMax / a.def.aMax;
+
+    // Reference: on the endstop, then out by the backoff
+    if (!seek(a, CREEP_SPEED, counted)) {
+        out.printf("CAL %s NO_ENDSTOP\n", a.name);
+        return false;
+    }
+    slewAxis(a, -BACKOFF_STEPS, a.def);
+
+    // 1) Speed at the default acceleration, as far as the travel lets it get
+    float bestV = 0;
+    for (float v = a.def.vMax * START_FACTOR; v <= a.def.vMax * CEIL_FACTOR; v *= STEP_FACTOR) {
+        const SyncSlew::Limits lim = { v, a.def.aMax, a.def.aMax * jerkPerAccel };
+        const long dist = std::min(a.travel, lroundf(v * v / lim.aMax + v * CRUISE_S));
+        const float reached = SCurveProfile::plan(float(dist), lim.vMax, lim.aMax, lim.jMax).vPeak;
+        if (!trial(a, lim, dist, lost)) return false;
+        const bool ok = lost <= LOSS_TOL_STEPS;
+        out.printf("CAL %s V %.0f %s %ld\n", a.name, reached, ok ? "OK" : "LOST", lost);
+        if (!ok) break;
+        bestV = fmaxf(bestV, reached);
+        if (reached < 0.95f * v) break;   // higher speeds do not fit in the travel
+    }
+    if (bestV <= 0) return false;
+
+    // 2) Acceleration at that speed
+    float bestA = 0;
+    for (float acc = a.def.aMax * START_FACTOR; acc <= a.def.aMax * CEIL_FACTOR; acc *= STEP_FACTOR) {
+        const SyncSlew::Limits lim = { bestV, acc, acc * jerkPerAccel };
+        const long dist = std::min(a.travel, lroundf(bestV * bestV / acc + bestV * CRUISE_S));
+        if (!trial(a, lim, dist, lost)) return false;
+        const bool ok = lost <= LOSS_TOL_STEPS;
+        out.printf("CAL %s A %.0f %s %ld\n", a.name, acc, ok ? "OK" : "LOST", lost);
+        if (!ok) break;
+        bestA = acc;
+    }
+    if (bestA <= 0) return false;
+
+    // 3) Margin, confirmed twice at the final values
+    const SyncSlew::Limits fin = { bestV * MARGIN, bestA * MARGIN, bestA * MARGIN * jerkPerAccel };
+    const long dist = std::min(a.travel, lroundf(fin.vMax * fin.vMax / fin.aMax + fin.vMax * CRUISE_S));
+    for (int k = 0; k < 2; ++k) {
+        if (!trial(a, fin, dist, lost) || lost > LOSS_TOL_STEPS) {
+            out.printf("CAL %s CONFIRM LOST %ld\n", a.name, lost);
+            return false;
+        }
+    }
+    a.lim = fin;
+
+    // 4) Endstop approach without a ramp, for homing
+    float home = 0;
+    for (float s = homeDefault_; s <= fin.vMax; s *= STEP_FACTOR) {
+        if (!homeTrial(a, s, lost)) return false;
+        const bool ok = lost <= LOSS_TOL_STEPS;
+        out.printf("CAL %s H %.0f %s %ld\n", a.name, s, ok ? "OK" : "LOST", lost);
+        if (!ok) break;
+        home = s;
+    }
+    bestHome = (home > 0) ? home * MARGIN : homeDefault_;
+    LOGI("[CAL] %s v %.0f a %.0f home %.0f", a.name, fin.vMax, fin.aMax, bestHome);
+    return true;
+}
+
+bool MotionCalibrator::run(Stream &out) {
+    const SyncSlew::Limits oldPan = pan_.lim, oldTilt = tilt_.lim;
+    const float oldHome = homeSpeed_;
+    // Trials start from the defaults; the other axis stays at its known limits meanwhile
+    pan_.lim  = pan_.def;
+    tilt_.lim = tilt_.def;
+
+    float panHome = 0, tiltHome = 0;
+    const bool ok = calibrateAxis(pan_, out, panHome) && calibrateAxis(tilt_, out, tiltHome);
+    if (!ok) {
+        pan_.lim   = oldPan;
+        tilt_.lim  = oldTilt;
+        homeSpeed_ = oldHome;
+        slew_.setLimits(pan_.lim, tilt_.lim);
+        return false;
+    }
+    // Homing drives both axes with one speed
+    homeSpeed_  = fminf(panHome, tiltHome);
+    calibrated_ = true;
+    slew_.setLimits(pan_.lim, tilt_.lim);
+    save();
+    return true;
+}
@@ -0,0 +1,86 @@
+#ifndef MOTION_CALIBRATOR_H
+#define MOTION_CALIBRATOR_H
+
+#include <Arduino.h>
+#include <AccelStepper.h>
+#include "SyncSlew.h"
+#include "SensorHub.h"
+
+/**
+ * Measures how fast each axis can really move. Graduated GOTO slews are run
+ * away from the axis' endstop and back; after each one the endstop is
+ * touched again at creep speed and the steps counted, so any step lost on
+ * the way shows up as a count that does not match. The orientation sensors
+ * check the far end of every slew as well, which stops a trial that lost a
+ * lot before it drives back into the switch.
+ *
+ * Speed is raised first at the default acceleration, then acceleration at
+ * the speed found, then the speed at which homing can hit the endstop
+ * without a ramp. The best passing values less a safety margin are kept
+ * in NVS (Preferences), so every tracker keeps its own limits across
+ * resets. Until a calibration exists the defaults apply.
+ *
+ * run() blocks like homing does; the axes' positions are lost afterwards
+ * and the caller homes again.
+ */
+class MotionCalibrator {
+public:
+    MotionCalibrator(AccelStepper &panStp, uint8_t panEndPin, float degPerMicroPan,
+                     AccelStepper &tiltStp, uint8_t tiltEndPin, float degPerMicroTilt,
+                     SyncSlew &slew, SensorHub &sensors);
+
+    // Limits used when nothing is stored, and the starting point of a calibration
+    void setDefaults(const SyncSlew::Limits &pan, const SyncSlew::Limits &tilt, float homeSpeed);
+    // How far each axis may travel from its endstop during the trials [deg]
+    void setTravel(float panDeg, float tiltDeg);
+
+    // Stored limits, false (defaults in effect) if there are none
+    bool load();
+    // Back to the defaults, stored limits erased
+    void reset();
+
+    /**
+     * Runs the whole calibration, progress lines go to `out`
+     * @return true if both axes passed; the new limits are then in effect and stored
+     */
+    bool run(Stream &out);
+
+    const SyncSlew::Limits &panLimits() const  { return pan_.lim; }
+    const SyncSlew::Limits &tiltLimits() const { return tilt_.lim; }
+    float homeSpeed() const { return homeSpeed_; }
+    bool isCalibrated() const { return calibrated_; }
+
+private:
+    struct Axis {
+        const char      *name;
+        AccelStepper    &stp;
+        uint8_t          endPin;
+        float            degPerStep;
+        bool             isPan;
+        long             travel;   // [steps]
+        SyncSlew::Limits def;
+        SyncSlew::Limits lim;
+    };
+
+    bool calibrateAxis(Axis &a, Stream &out, float &bestHome);
+    // Out and back at the given limits; lost = steps missing at the endstop
+    bool trial(Axis &a, const SyncSlew::Limits &lim, long dist, long &lost);
+    // Homing-style seek at `speed`, then checked at creep speed
+    bool homeTrial(Axis &a, float speed, long &lost);
+    // Creeps onto the endstop, false if it is not found within the travel
+    bool seek(Axis &a, float speed, long &counted);
+    // Slew of one axis; false if the endstop closed on the way
+    bool slewAxis(Axis &a, long delta, const SyncSlew::Limits &lim);
+    bool sample(float &azDeg, float &elDeg, bool &hasHeading);
+    void save() const;
+
+    SyncSlew  &slew_;
+    SensorHub &sensors_;
+    Axis       pan_;
+    Axis       tilt_;
+    float      homeDefault_;
+    float      homeSpeed_;
+    bool       calibrated_;
+};
+
+#endif // MOTION_CALIBRATOR_H
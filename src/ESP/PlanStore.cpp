@@ -0,0 +1,211 @@
+#include "PlanStore.h"
+#include <cstddef>
+
+static const uint32_t PLAN_MAGIC   = 0x504B5453;  // "STKP"
+static const uint16_t PLAN_VERSION = 2;
+static const char    *PLAN_DIR     = "/plans/";
+static const char    *PLAN_EXT     = ".trk";
+static const char    *SESSION_PATH = "/session.bin";
+
+struct SessionRecord {
+    char     name[PlanStore::MAX_NAME + 1];
+    uint32_t T0_unix;
+};
+
+PlanStore::PlanStore(fs::FS &fs)
+    : fs_(fs)
+    , header_()
+    , written_(0)
+    , writing_(false)
+    , open_(false)
+{
+    writeName_[0] = '\0';
+    openName_[0]  = '\0';
+}
+
+bool PlanStore::begin() {
+    // The filesystem itself is mounted by the sketch (SPIFFS.begin)
+    return true;
+}
+
+bool PlanStore::validName(const char *name) {
+    size_t n = strlen(name);
+    if (n == 0 || n > MAX_NAME) return false;
+    for (size_t i = 0; i < n; ++i) {
+        char c = name[i];
+        bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+               || (c >= '0' && c <= '9') || c == '_' || c == '-';
+        if (!ok) return false;
+    }
+    return true;
+}
+
+String PlanStore::pathFor(const char *name) {
+    return String(PLAN_DIR) + name + PLAN_EXT;
+}
+
+// ---------------------------------------------------------------------------
+// Writing
+// ---------------------------------------------------------------------------
+
+bool PlanStore::beginWrite(const char *name, uint32_t T0_unix, uint32_t nPts, uint32_t flags) {
+    abortWrite();
+    if (!validName(name)) return false;
+
+    // Written under a temporary name, renamed only when complete
+    wfile_ = fs_.open(String(PLAN_DIR) + name + ".tmp", FILE_WRITE);
+    if (!wfile_) return false;
+
+    PlanHeader h;
+    h.magic     = PLAN_MAGIC;
+    h.version   = PLAN_VERSION;
+    h.pointSize = sizeof(TrackPoint);
+    h.T0_unix   = T0_unix;
+    h.nPts      = nPts;
+    h.flags     = flags;
+    if (wfile_.write((const uint8_t *)&h, sizeof(h)) != sizeof(h)) {
+        wfile_.close();
+        return false;
+    }
+    strncpy(writeName_, name, MAX_NAME);
+    writeName_[MAX_NAME] = '\0';
+    written_ = 0;
+    writing_ = true;
+    return true;
+}
+
+bool PlanStore::append(const TrackPoint &p) {
+    if (!writing_) return false;
+    if (wfile_.write((const uint8_t *)&p, sizeof(p)) != sizeof(p)) {
+        abortWrite();
+        return false;
+    }
+    ++written_;
+    return true;
+}
+
+bool PlanStore::endWrite() {
+    if (!writing_) return false;
+    writing_ = false;
+
+    // Header count must match what actually arrived
+    wfile_.seek(offsetof(PlanHeader, nPts));
+    wfile_.write((const uint8_t *)&written_, sizeof(written_));
+    wfile_.close();
+
+    String tmp  = String(PLAN_DIR) + writeName_ + ".tmp";
+    String path = pathFor(writeName_);
+    if (open_ && strcmp(openName_, writeName_) == 0) {
+        // Being played from: the stored plan stays, the upload is dropped
+        fs_.remove(tmp);
+        return false;
+    }
+    fs_.remove(path);
+    return fs_.rename(tmp, path);
+}
+
+void PlanStore::abortWrite() {
+    if (!writing_) return;
+    writing_ = false;
+    wfile_.close();
+    fs_.remove(String(PLAN_DIR) + writeName_ + ".tmp");
+}
+
+// ---------------------------------------------------------------------------
+// Reading
+// ---------------------------------------------------------------------------
+
+bool PlanStore::open(const char *name) {
+    close();
+    if (!validName(name)) return false;
+    rfile_ = fs_.open(pathFor(name), FILE_READ);
+    if (!rfile_) return false;
+
+    if (rfile_.read((uint8_t *)&header_, sizeof(header_)) != sizeof(header_)
+        || header_.magic != PLAN_MAGIC
+        || header_.version != PLAN_VERSION
+        || header_.pointSize != sizeof(TrackPoint)) {
+        rfile_.close();
+        return false;
+    }
+    strncpy(openName_, name, MAX_NAME);
+    openName_[MAX_NAME] = '\0';
+    open_ = true;
+    return true;
+}
+
+void PlanStore::close() {
+    if (!open_) return;
+    rfile_.close();
+    open_ = false;
+    openName_[0] = '\0';
+}
+
+int PlanStore::read(int first, TrackPoint *dst, int count) {
+    if (!open_ || first < 0 || first >= int(header_.nPts)) return 0;
+    if (first + count > int(header_.nPts)) count = int(header_.nPts) - first;
+    if (!rfile_.seek(sizeof(PlanHeader) + uint32_t(first) * sizeof(TrackPoint))) return 0;
+    size_t got = rfile_.read((uint8_t *)dst, count * sizeof(TrackPoint));
+    return int(got / sizeof(TrackPoint));
+}
+
+// ---------------------------------------------------------------------------
+// Catalog
+// ---------------------------------------------------------------------------
+
+void PlanStore::list(Stream &out) {
+    fs::File root = fs_.open("/");
+    fs::File f = root.openNextFile();
+    while (f) {
+        String path = f.path();
+        if (path.startsWith(PLAN_DIR) && path.endsWith(PLAN_EXT)) {
+            PlanHeader h;
+            if (f.read((uint8_t *)&h, sizeof(h)) == sizeof(h) && h.magic == PLAN_MAGIC) {
+                String name = path.substring(strlen(PLAN_DIR), path.length() - strlen(PLAN_EXT));
+                out.printf("PLAN %s %lu %lu\n", name.c_str(),
+                           (unsigned long)h.T0_unix, (unsigned long)h.nPts);
+            }
+        }
+        f = root.openNextFile();
+    }
+    out.println("PLAN_LIST_END");
+}
+
+bool PlanStore::remove(const char *name) {
+    if (!validName(name)) return false;
+    if (open_ && strcmp(openName_, name) == 0) close();
+    return fs_.remove(pathFor(name));
+}
+
+// ---------------------------------------------------------------------------
+// Session record
+// ---------------------------------------------------------------------------
+
+bool PlanStore::saveSession(const char *name, uint32_t T0_unix) {
+    SessionRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    strncpy(rec.name, name, MAX_NAME);
+    rec.T0_unix = T0_unix;
+    fs::File f = fs_.open(SESSION_PATH, FILE_WRITE);
+    if (!f) return false;
+    bool ok = f.write((const uint8_t *)&rec, sizeof(rec)) == sizeof(rec);
+    f.close();
+    return ok;
+}
+
+bool PlanStore::loadSession(char *name, uint32_t &T0_unix) {
+    fs::File f = fs_.open(SESSION_PATH, FILE_READ);
+    if (!f) return false;
+    SessionRecord rec;
+    bool ok = f.read((uint8_t *)&rec, sizeof(rec)) == sizeof(rec);
+    f.close();
+    if (!ok) return false;
+    rec.name[MAX_NAME] = '\0';
+    strcpy(name, rec.name);
+    T0_unix = rec.T0_unix;
+    return validName(name);
+}
+
+void PlanStore::clearSession() {
+    fs_.remove(SESSION_PATH);
+}
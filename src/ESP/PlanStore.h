@@ -0,0 +1,76 @@
+#ifndef PLAN_STORE_H
+#define PLAN_STORE_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "SphericalTracker.h"
+
+// Header of a stored plan file, followed by nPts raw TrackPoint records
+struct PlanHeader {
+    uint32_t magic;      // PLAN_MAGIC
+    uint16_t version;    // PLAN_VERSION
+    uint16_t pointSize;  // sizeof(TrackPoint) at write time
+    uint32_t T0_unix;    // start of the plan [s]
+    uint32_t nPts;
+    uint32_t flags;      // PLAN_HOST_PAN
+};
+
+// Azimuths are the app's planned absolute pan angles (180 = home, not wrapped)
+const uint32_t PLAN_HOST_PAN = 1u << 0;
+
+/**
+ * Trajectory plans kept in SPIFFS (/plans/<name>.trk) so they survive a
+ * reset, plus a small session record used to resume after a power loss.
+ * The open plan is a TrackSource: the tracker streams it in chunks.
+ */
+class PlanStore : public TrackSource {
+public:
+    static const size_t MAX_NAME = 20;
+
+    explicit PlanStore(fs::FS &fs);
+
+    bool begin();
+
+    // --- Writing a plan during upload ---
+    bool beginWrite(const char *name, uint32_t T0_unix, uint32_t nPts, uint32_t flags = 0);
+    bool append(const TrackPoint &p);
+    // Replaces the stored plan of that name; false if this reader has it open
+    bool endWrite();
+    void abortWrite();
+    bool isWriting() const { return writing_; }
+
+    // --- Reading (TrackSource) ---
+    bool open(const char *name);
+    void close();
+    bool isOpen() const { return open_; }
+    const char *openName() const { return openName_; }
+    uint32_t T0() const { return header_.T0_unix; }
+    int read(int first, TrackPoint *dst, int count) override;
+    int size() const override { return open_ ? int(header_.nPts) : 0; }
+    bool hostPan() const override { return open_ && (header_.flags & PLAN_HOST_PAN); }
+
+    // --- Catalog ---
+    void list(Stream &out);
+    bool remove(const char *name);
+
+    // --- Session record ---
+    bool saveSession(const char *name, uint32_t T0_unix);
+    bool loadSession(char *name, uint32_t &T0_unix);
+    void clearSession();
+
+private:
+    static bool validName(const char *name);
+    static String pathFor(const char *name);
+
+    fs::FS &fs_;
+    fs::File wfile_;
+    fs::File rfile_;
+    PlanHeader header_;
+    uint32_t written_;
+    bool writing_;
+    bool open_;
+    char writeName_[MAX_NAME + 1];
+    char openName_[MAX_NAME + 1];
+};
+
+#endif // PLAN_STORE_H
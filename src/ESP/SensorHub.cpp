@@ -0,0 +1,215 @@
+#include "SensorHub.h"
+#include "FlightRecorder.h"
+#include "DeferredLog.h"
+
+// MPU6050 registers
+static const uint8_t MPU_ADDR        = 0x68;
+static const uint8_t REG_SMPLRT_DIV  = 0x19;
+static const uint8_t REG_CONFIG      = 0x1A;
+static const uint8_t REG_GYRO_CONFIG = 0x1B;
+static const uint8_t REG_ACCEL_CONFIG = 0x1C;
+static const uint8_t REG_FIFO_EN     = 0x23;
+static const uint8_t REG_INT_ENABLE  = 0x38;
+static const uint8_t REG_INT_STATUS  = 0x3A;
+static const uint8_t REG_USER_CTRL   = 0x6A;
+static const uint8_t REG_PWR_MGMT_1  = 0x6B;
+static const uint8_t REG_FIFO_COUNT  = 0x72;
+static const uint8_t REG_FIFO_RW     = 0x74;
+static const uint8_t REG_WHO_AM_I    = 0x75;
+
+static const uint8_t  SAMPLE_BYTES   = 12;     // accel xyz, gyro xyz (FIFO order)
+static const uint16_t FIFO_SIZE      = 1024;
+static const uint8_t  BURST_SAMPLES  = 10;     // 120 B, fits the 128 B Wire buffer
+static const float    ACC_LSB_PER_G  = 16384.0f;  // ±2 g
+static const float    GYRO_LSB_PER_DPS = 65.5f;   // ±500 °/s
+static const float    FILTER_ALPHA   = 0.98f;  // complementary filter, gyro share
+static const float    MAG_SMOOTHING  = 0.3f;
+static const float    CALIB_SPREAD_DPS = 2.0f; // more than this in the window = moving
+
+SensorHub::SensorHub(TwoWire& i2c, Adafruit_HMC5883_Unified& magSensor)
+  : wire(i2c)
+  , mag(magSensor)
+{}
+
+bool SensorHub::writeReg(uint8_t reg, uint8_t value) {
+  wire.beginTransmission(MPU_ADDR);
+  wire.write(reg);
+  wire.write(value);
+  return wire.endTransmission() == 0;
+}
+
+bool SensorHub::readRegs(uint8_t reg, uint8_t* buf, uint8_t len) {
+  wire.beginTransmission(MPU_ADDR);
+  wire.write(reg);
+  if (wire.endTransmission(false) != 0) return false;
+  if (wire.requestFrom(MPU_ADDR, len) != len) return false;
+  for (uint8_t i = 0; i < len; ++i) buf[i] = wire.read();
+  return true;
+}
+
+bool SensorHub::begin() {
+  wire.setClock(400000);
+
+  uint8_t who = 0;
+  if (!readRegs(REG_WHO_AM_I, &who, 1) || (who & 0x7E) != MPU_ADDR) {
+    LOGE("Error: MPU6050 not found");
+    return false;
+  }
+  writeReg(REG_PWR_MGMT_1, 0x80);                     // reset
+  delay(100);
+  writeReg(REG_PWR_MGMT_1, 0x01);                     // PLL on gyro X
+  writeReg(REG_CONFIG, 0x03);                         // DLPF 44 Hz, 1 kHz internal rate
+  writeReg(REG_SMPLRT_DIV, uint8_t(1000 / IMU_RATE_HZ - 1));
+  writeReg(REG_GYRO_CONFIG, 0x08);                    // ±500 °/s
+  writeReg(REG_ACCEL_CONFIG, 0x00);                   // ±2 g
+  writeReg(REG_INT_ENABLE, 0x10);                     // latch FIFO overflow in INT_STATUS
+  writeReg(REG_USER_CTRL, 0x04);                      // FIFO reset
+  writeReg(REG_USER_CTRL, 0x40);                      // FIFO on
+  writeReg(REG_FIFO_EN, 0x78);                        // accel + gyro xyz
+
+  if (!mag.begin()) {
+    LOGE("Error: HMC5883L not found");
+    return false;
+  }
+
+  if (xTaskCreatePinnedToCore(taskEntry, "sensors", 4096, this, 2, &task, 0) != pdPASS) {
+    LOGE("Error: sensor task not started");
+    return false;
+  }
+  LOGI("Sensors initialized, gyro calibration in background");
+  return true;
+}
+
+void SensorHub::taskEntry(void* arg) {
+  static_cast<SensorHub*>(arg)->run();
+}
+
+void SensorHub::run() {
+  TickType_t wake = xTaskGetTickCount();
+  for (;;) {
+    drainFifo();
+    if (millis() - lastMagMs >= MAG_PERIOD_MS) readMag();
+    publish();
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(TASK_PERIOD_MS));
+  }
+}
+
+void SensorHub::drainFifo() {
+  uint8_t status = 0, cnt[2];
+  if (!readRegs(REG_INT_STATUS, &status, 1) || !readRegs(REG_FIFO_COUNT, cnt, 2)) return;
+  uint16_t count = (uint16_t(cnt[0]) << 8) | cnt[1];
+
+  if ((status & 0x10) || count > FIFO_SIZE - SAMPLE_BYTES) {
+    // Overflow: the stream is misaligned, start over
+    writeReg(REG_USER_CTRL, 0x44);
+    lastSampleUs = 0;
+    ++state.overruns;
+    REC_EVENT(REC_IMU_OVERRUN, REC_AXIS_NONE, count);
+    return;
+  }
+
+  // Samples left the sensor one period apart, the newest one about now
+  const uint32_t periodUs = 1000000UL / IMU_RATE_HZ;
+  const uint32_t nowUs = micros();
+  uint16_t n = count / SAMPLE_BYTES;
+  uint8_t buf[BURST_SAMPLES * SAMPLE_BYTES];
+  while (n > 0) {
+    uint8_t burst = n < BURST_SAMPLES ? n : BURST_SAMPLES;
+    if (!readRegs(REG_FIFO_RW, buf, burst * SAMPLE_BYTES)) return;
+    for (uint8_t i = 0; i < burst; ++i) {
+      n--;
+      processSample(buf + i * SAMPLE_BYTES, nowUs - uint32_t(n) * periodUs);
+    }
+  }
+}
+
+void SensorHub::processSample(const uint8_t* raw, uint32_t tUs) {
+  int16_t v[6];
+  for (int i = 0; i < 6; ++i) v[i] = int16_t((uint16_t(raw[2 * i]) << 8) | raw[2 * i + 1]);
+
+  float g[3];
+  for (int i = 0; i < 3; ++i) {
+    state.accG[i] = v[i] / ACC_LSB_PER_G;
+    g[i] = v[3 + i] / GYRO_LSB_PER_DPS;
+  }
+  if (!state.calibrated) calibrate(g);
+  for (int i = 0; i < 3; ++i) state.gyroDps[i] = g[i] - gyroBias[i];
+
+  const float ax = state.accG[0], ay = state.accG[1], az = state.accG[2];
+  const float accEl = atan2(-ax, sqrt(ay * ay + az * az)) * 180.0 / M_PI;
+  const float dt = lastSampleUs ? (tUs - lastSampleUs) * 1e-6f : 0.0f;
+  if (!elValid || !state.calibrated) {
+    state.elDeg = accEl;
+    elValid = true;
+  } else {
+    state.elDeg = FILTER_ALPHA * (state.elDeg + state.gyroDps[1] * dt) + (1.0f - FILTER_ALPHA) * accEl;
+  }
+  lastSampleUs = tUs;
+  state.tUs = tUs;
+  state.samples++;
+}
+
+void SensorHub::calibrate(const float g[3]) {
+  if (calibCount == 0) {
+    for (int i = 0; i < 3; ++i) { calibSum[i] = 0; calibMin[i] = calibMax[i] = g[i]; }
+  }
+  for (int i = 0; i < 3; ++i) {
+    calibSum[i] += g[i];
+    if (g[i] < calibMin[i]) calibMin[i] = g[i];
+    if (g[i] > calibMax[i]) calibMax[i] = g[i];
+    if (calibMax[i] - calibMin[i] > CALIB_SPREAD_DPS) {
+      calibCount = 0;   // mount moved, the window starts again
+      return;
+    }
+  }
+  if (++calibCount < CALIB_SAMPLES) return;
+  for (int i = 0; i < 3; ++i) gyroBias[i] = calibSum[i] / calibCount;
+  state.calibrated = true;
+  LOGI("Gyro bias %.3f %.3f %.3f deg/s", gyroBias[0], gyroBias[1], gyroBias[2]);
+}
+
+void SensorHub::readMag() {
+  lastMagMs = millis();
+  sensors_event_t magEvent;
+  if (!mag.getEvent(&magEvent)) return;
+  if (!state.hasHeading) {
+    magX = magEvent.magnetic.x;
+    magY = magEvent.magnetic.y;
+    state.hasHeading = true;
+  } else {
+    magX += MAG_SMOOTHING * (magEvent.magnetic.x - magX);
+    magY += MAG_SMOOTHING * (magEvent.magnetic.y - magY);
+  }
+  float heading = atan2(magY, magX) * 180.0 / M_PI;
+  if (heading < 0) heading += 360.0;
+  state.azDeg = heading;
+}
+
+void SensorHub::publish() {
+  const uint32_t s = __atomic_load_n(&seq, __ATOMIC_RELAXED);
+  __atomic_store_n(&seq, s + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  pub = state;
+  __atomic_store_n(&seq, s + 2, __ATOMIC_RELEASE);
+}
+
+bool SensorHub::snapshot(OrientationSample& out) const {
+  for (;;) {
+    const uint32_t s1 = __atomic_load_n(&seq, __ATOMIC_ACQUIRE);
+    if (s1 & 1) continue;
+    out = pub;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&seq, __ATOMIC_RELAXED) == s1) break;
+  }
+  return out.samples > 0 && out.hasHeading;
+}
+
+bool SensorHub::waitForSample(uint32_t timeoutMs) const {
+  OrientationSample s;
+  const uint32_t start = millis();
+  while (!snapshot(s)) {
+    if (millis() - start >= timeoutMs) return false;
+    delay(5);
+  }
+  return true;
+}
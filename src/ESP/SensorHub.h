@@ -0,0 +1,90 @@
+#ifndef SENSOR_HUB_H
+#define SENSOR_HUB_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <Adafruit_Sensor.h>
+#include <Adafruit_HMC5883_U.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Filtered orientation published by the sensor task
+struct OrientationSample {
+  uint32_t tUs;         // micros() of the newest IMU sample used
+  float    azDeg;       // magnetic heading, 0..360
+  float    elDeg;       // elevation (pitch), gyro + accelerometer
+  float    gyroDps[3];  // bias-corrected rates [deg/s]
+  float    accG[3];     // acceleration [g]
+  uint32_t samples;     // IMU samples since start
+  uint16_t overruns;    // FIFO overflows (samples lost)
+  bool     calibrated;  // gyro bias known, elevation uses the gyro
+  bool     hasHeading;  // at least one magnetometer reading
+};
+
+/**
+ * I²C sensor acquisition on its own FreeRTOS task (core 0, away from the
+ * stepping loop). The MPU6050 samples at IMU_RATE_HZ into its hardware
+ * FIFO, which the task drains in bursts every TASK_PERIOD_MS; each sample
+ * gets a timestamp reconstructed from the sample rate. The HMC5883 is read
+ * at its own output rate. Elevation comes from a complementary filter,
+ * heading from low-passed field components.
+ *
+ * Gyro bias is estimated in the background: CALIB_SAMPLES consecutive
+ * samples at rest are averaged, the window restarts whenever the mount
+ * moves. Until then elevation is accelerometer-only.
+ *
+ * After begin() only the sensor task touches the bus. Readers get the
+ * latest OrientationSample through a seqlock, without locks and without
+ * waiting for I²C.
+ */
+class SensorHub {
+public:
+  static const uint16_t IMU_RATE_HZ    = 200;
+  static const uint16_t TASK_PERIOD_MS = 10;
+  static const uint16_t MAG_PERIOD_MS  = 70;    // HMC5883 default output rate 15 Hz
+  static const uint16_t CALIB_SAMPLES  = 400;   // 2 s at rest
+
+  SensorHub(TwoWire& i2c, Adafruit_HMC5883_Unified& magSensor);
+
+  // Bus at 400 kHz, sensor setup, task start; false if a sensor is missing
+  bool begin();
+
+  // Latest published sample; false until both sensors have delivered
+  bool snapshot(OrientationSample& out) const;
+  // Blocks the caller (not the bus) until a sample exists or the timeout ends
+  bool waitForSample(uint32_t timeoutMs) const;
+
+private:
+  static void taskEntry(void* arg);
+  void run();
+  void drainFifo();
+  void processSample(const uint8_t* raw, uint32_t tUs);
+  void readMag();
+  void publish();
+  void calibrate(const float g[3]);
+
+  bool writeReg(uint8_t reg, uint8_t value);
+  bool readRegs(uint8_t reg, uint8_t* buf, uint8_t len);
+
+  TwoWire&                  wire;
+  Adafruit_HMC5883_Unified& mag;
+  TaskHandle_t              task = nullptr;
+
+  // Owned by the sensor task
+  OrientationSample state = {};
+  float    gyroBias[3] = { 0, 0, 0 };
+  float    magX = 0, magY = 0;
+  bool     elValid = false;
+  uint32_t lastMagMs = 0;
+  uint32_t lastSampleUs = 0;
+  // Background calibration window
+  float    calibSum[3] = { 0, 0, 0 };
+  float    calibMin[3], calibMax[3];
+  uint16_t calibCount = 0;
+
+  // Seqlock: odd while the writer updates pub
+  uint32_t          seq = 0;
+  OrientationSample pub = {};
+};
+
+#endif // SENSOR_HUB_H
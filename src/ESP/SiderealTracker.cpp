@@ -0,0 +1,181 @@
+#include "SiderealTracker.h"
+#include "DeferredLog.h"
+#include <Arduino.h>
+#include <cmath>
+#include <climits>
+
+static const uint32_t CONTROL_PERIOD_MS = 50;
+static const float    KP_POS            = 5.0f;    // position feedback [1/s]
+// Earth rotation relative to the stars, per millisecond of UT
+static const float    SIDEREAL_DEG_PER_MS = 360.98564736629f / 86400000.0f;
+
+static float angularDiff(float target, float origin) {
+    float d = fmodf(target - origin + 540.0f, 360.0f);
+    if (d < 0) d += 360.0f;
+    return d - 180.0f;
+}
+
+SiderealTracker::SiderealTracker(AccelStepper &panStp, AccelStepper &tiltStp, StepDDA &dda,
+                                 float degPerStepPan, float degPerStepTilt)
+    : panStp_(panStp)
+    , tiltStp_(tiltStp)
+    , dda_(dda)
+    , degPerStepPan_(degPerStepPan)
+    , degPerStepTilt_(degPerStepTilt)
+    , sinDec_(0), cosDec_(1)
+    , sinLat_(0), cosLat_(1)
+    , raDeg_(0)
+    , lonDeg_(0)
+    , refMs_(0)
+    , refHaDeg_(0)
+    , panMin_(LONG_MIN), panMax_(LONG_MAX)
+    , tiltMin_(LONG_MIN), tiltMax_(LONG_MAX)
+    , panMaxRate_(4000), tiltMaxRate_(2000)
+    , panAccel_(4000), tiltAccel_(1000)
+    , tracking_(false)
+    , halted_(HALT_NONE)
+    , lastControlMs_(0)
+    , prevAz_(0)
+    , unwrappedPan_(0)
+    , panTarget_(0), tiltTarget_(0)
+    , panRate_(0), tiltRate_(0)
+{}
+
+void SiderealTracker::setTarget(float raDeg, float decDeg, float latDeg, float lonDeg,
+                                uint64_t unixMs) {
+    raDeg_  = raDeg;
+    lonDeg_ = lonDeg;
+    sinDec_ = sinf(decDeg * DEG_TO_RAD);
+    cosDec_ = cosf(decDeg * DEG_TO_RAD);
+    sinLat_ = sinf(latDeg * DEG_TO_RAD);
+    cosLat_ = cosf(latDeg * DEG_TO_RAD);
+
+    // GMST needs double once (JD ~ 2.46e6); afterwards only small float deltas
+    double d    = unixMs / 86400000.0 - 10957.5;   // days since J2000.0
+    double gmst = fmod(280.46061837 + 360.98564736629 * d, 360.0);
+    refMs_    = unixMs;
+    refHaDeg_ = fmod(gmst + lonDeg_ - raDeg_ + 720.0, 360.0);
+}
+
+float SiderealTracker::hourAngleDeg(uint64_t unixMs) const {
+    float dtMs = float(int64_t(unixMs - refMs_));
+    return float(refHaDeg_) + SIDEREAL_DEG_PER_MS * dtMs;
+}
+
+void SiderealTracker::altAz(uint64_t unixMs, float &azDeg, float &elDeg) const {
+    float ha    = hourAngleDeg(unixMs) * DEG_TO_RAD;
+    float sinHa = sinf(ha), cosHa = cosf(ha);
+    float sinEl = sinDec_ * sinLat_ + cosDec_ * cosLat_ * cosHa;
+    sinEl = constrain(sinEl, -1.0f, 1.0f);
+    elDeg = asinf(sinEl) * RAD_TO_DEG;
+    float az = atan2f(-cosDec_ * sinHa, sinDec_ * cosLat_ - cosDec_ * cosHa * sinLat_) * RAD_TO_DEG;
+    azDeg = (az < 0) ? az + 360.0f : az;
+}
+
+void SiderealTracker::targetSteps(uint64_t unixMs, long &panSteps, long &tiltSteps) const {
+    float az, el;
+    altAz(unixMs, az, el);
+    float curDeg = panStp_.currentPosition() * degPerStepPan_;
+    float base   = angularDiff(az, 180.0f);
+    float best   = base;
+    bool  found  = false;
+    for (int k = -1; k <= 1; ++k) {
+        float cand  = base + k * 360.0f;
+        long  steps = lroundf(cand / degPerStepPan_);
+        if (steps < panMin_ || steps > panMax_) continue;
+        if (!found || fabsf(cand - curDeg) < fabsf(best - curDeg)) best = cand;
+        found = true;
+    }
+    panSteps  = lroundf(best / degPerStepPan_);
+    tiltSteps = -lroundf((el - 45.0f) / degPerStepTilt_);
+}
+
+void SiderealTracker::setPanLimits(long minSteps, long maxSteps) {
+    panMin_ = minSteps;
+    panMax_ = maxSteps;
+}
+
+void SiderealTracker::setTiltLimits(long minSteps, long maxSteps) {
+    tiltMin_ = minSteps;
+    tiltMax_ = maxSteps;
+}
+
+void SiderealTracker::setMaxRates(float panStepsPerSec, float tiltStepsPerSec) {
+    panMaxRate_  = panStepsPerSec;
+    tiltMaxRate_ = tiltStepsPerSec;
+}
+
+void SiderealTracker::setAccelerations(float panStepsPerSec2, float tiltStepsPerSec2) {
+    panAccel_  = panStepsPerSec2;
+    tiltAccel_ = tiltStepsPerSec2;
+}
+
+void SiderealTracker::start(uint64_t unixMs) {
+    float az, el;
+    altAz(unixMs, az, el);
+    // Continue on the branch the axis is already on
+    float curDeg  = panStp_.currentPosition() * degPerStepPan_;
+    unwrappedPan_ = curDeg + angularDiff(az - 180.0f, curDeg);
+    prevAz_       = az;
+    lastControlMs_ = 0;
+    panStp_.enableOutputs();
+    tiltStp_.enableOutputs();
+    dda_.begin(micros());
+    tracking_ = true;
+    halted_   = HALT_NONE;
+}
+
+void SiderealTracker::stop() {
+    tracking_ = false;
+    dda_.stop();
+    panStp_.disableOutputs();
+    tiltStp_.disableOutputs();
+}
+
+void SiderealTracker::update(uint64_t unixMs) {
+    if (!tracking_) return;
+
+    if (unixMs - lastControlMs_ >= CONTROL_PERIOD_MS) {
+        lastControlMs_ = unixMs;
+        float az, el, azNext, elNext;
+        altAz(unixMs, az, el);
+        altAz(unixMs + CONTROL_PERIOD_MS, azNext, elNext);
+
+        // Set, or out of the tilt travel: stop rather than drive into it
+        long tilt = -lroundf((el - 45.0f) / degPerStepTilt_);
+        if (el < 0 || !tiltWithinLimits(tilt)) {
+            halted_ = (el < 0) ? HALT_HORIZON : HALT_TILT_LIMIT;
+            LOGI("[SIDEREAL] Halted at az %.2f el %.2f: %s", az, el,
+                 halted_ == HALT_HORIZON ? "below horizon" : "tilt limit");
+            stop();
+            return;
+        }
+
+        unwrappedPan_ += angularDiff(az, prevAz_);
+        prevAz_        = az;
+        long pan = lroundf(unwrappedPan_ / degPerStepPan_);
+        if (pan > panMax_ || pan < panMin_) {
+            // Cable limit: unwind one full turn, ramped by the feedback below
+            float unwind = (pan > panMax_) ? -360.0f : 360.0f;
+            unwrappedPan_ += unwind;
+            LOGI("[SIDEREAL] Pan unwind %.0f deg", unwind);
+        }
+        panTarget_  =  unwrappedPan_ / degPerStepPan_;
+        tiltTarget_ = -(el - 45.0f) / degPerStepTilt_;
+
+        const float dt = CONTROL_PERIOD_MS / 1000.0f;
+        panRate_  =  angularDiff(azNext, az) / dt / degPerStepPan_;
+        tiltRate_ = -(elNext - el)           / dt / degPerStepTilt_;
+
+        // Feedback on the DDA's exact position, so rounding never builds up;
+        // within the calibrated speed and acceleration of each axis
+        float errPan  = panTarget_  - dda_.panPosition();
+        float errTilt = tiltTarget_ - dda_.tiltPosition();
+        dda_.setRates(StepDDA::rampedRate(panRate_, KP_POS * errPan, errPan, dda_.panRate(),
+                                          panMaxRate_, panAccel_, dt),
+                      StepDDA::rampedRate(tiltRate_, KP_POS * errTilt, errTilt, dda_.tiltRate(),
+                                          tiltMaxRate_, tiltAccel_, dt));
+    }
+
+    dda_.run(micros());
+}
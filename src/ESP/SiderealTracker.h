@@ -0,0 +1,82 @@
+#ifndef SIDEREAL_TRACKER_H
+#define SIDEREAL_TRACKER_H
+
+#include <AccelStepper.h>
+#include <cstdint>
+#include "StepDDA.h"
+
+/**
+ * On-device tracking of a fixed RA/Dec target. Alt/Az is evaluated from the
+ * clock at the control rate (port of HorizonsManager::gmstDeg/radecToAltAz);
+ * no trajectory upload or buffer is needed and sessions are unlimited.
+ */
+class SiderealTracker {
+public:
+    // Why tracking ended on its own
+    enum Halt : uint8_t { HALT_NONE, HALT_HORIZON, HALT_TILT_LIMIT };
+
+    SiderealTracker(AccelStepper &panStp, AccelStepper &tiltStp, StepDDA &dda,
+                    float degPerStepPan, float degPerStepTilt);
+
+    // Target in degrees, equinox of date (the app precesses J2000 catalogue
+    // positions), site in degrees; unixMs is the reference time for the hour
+    // angle (needs a synced clock)
+    void setTarget(float raDeg, float decDeg, float latDeg, float lonDeg, uint64_t unixMs);
+
+    // Topocentric azimuth/elevation of the target [deg]
+    void altAz(uint64_t unixMs, float &azDeg, float &elDeg) const;
+
+    // Absolute motor positions (home = 0 at az 180°, el 45°) on the pan branch
+    // nearest to the current position within the limits
+    void targetSteps(uint64_t unixMs, long &panSteps, long &tiltSteps) const;
+
+    void setPanLimits(long minSteps, long maxSteps);
+    // Tilt travel in steps from home; a target outside it cannot be followed
+    void setTiltLimits(long minSteps, long maxSteps);
+    bool tiltWithinLimits(long tiltSteps) const { return tiltSteps >= tiltMin_ && tiltSteps <= tiltMax_; }
+
+    // Calibrated limits of both axes [steps/s], [steps/s^2]
+    void setMaxRates(float panStepsPerSec, float tiltStepsPerSec);
+    void setAccelerations(float panStepsPerSec2, float tiltStepsPerSec2);
+
+    void start(uint64_t unixMs);
+    void stop();
+    bool isTracking() const { return tracking_; }
+    // Set when update() stopped because the target set or left the tilt travel
+    Halt halted() const { return halted_; }
+
+    // Call from loop(): new target every CONTROL_PERIOD_MS, DDA steps every call
+    void update(uint64_t unixMs);
+
+private:
+    float hourAngleDeg(uint64_t unixMs) const;
+
+    AccelStepper &panStp_;
+    AccelStepper &tiltStp_;
+    StepDDA &dda_;
+    float degPerStepPan_;
+    float degPerStepTilt_;
+
+    float sinDec_, cosDec_;
+    float sinLat_, cosLat_;
+    float raDeg_;
+    double lonDeg_;
+
+    // Hour angle reference: evaluated once in double, then advanced linearly
+    uint64_t refMs_;
+    double   refHaDeg_;
+
+    long  panMin_, panMax_;
+    long  tiltMin_, tiltMax_;
+    float panMaxRate_, tiltMaxRate_;
+    float panAccel_, tiltAccel_;
+    bool  tracking_;
+    Halt  halted_;
+    uint64_t lastControlMs_;
+    float prevAz_;
+    float unwrappedPan_;   // continuous pan angle from home [deg]
+    float panTarget_, tiltTarget_;  // [steps], fraction kept for the DDA
+    float panRate_, tiltRate_;  // feed-forward [steps/s]
+};
+
+#endif // SIDEREAL_TRACKER_H
@@ -1,24 +1,70 @@
 #include "SphericalTracker.h"
+#include "FlightRecorder.h"
+#include "DeferredLog.h"
 #include <Arduino.h>
 #include <cmath>
+#include <climits>
+
+// Okres przeliczania pozycji zadanej; kroki wykonywane są w każdym przebiegu loop
+static const uint32_t CONTROL_PERIOD_MS = 2;
+// Wzmocnienie sprzężenia od błędu pozycji [1/s]
+static const float    KP_POS            = 10.0f;
+// Co który okres sterowania zapisywać błąd pozycji do rejestratora (50 ms)
+static const uint32_t POS_ERROR_DIV     = 25;
+// Czas wygaszania różnicy położeń po podmianie trajektorii
+static const uint32_t SPLICE_BLEND_MS   = 2000;
 
 SphericalTracker::SphericalTracker(AccelStepper &panStp,
                                    AccelStepper &tiltStp,
+                                   StepDDA &dda,
                                    float degPerStepPan,
                                    float degPerStepTilt,
                                    int maxPoints)
     : panStp_(panStp)
     , tiltStp_(tiltStp)
+    , dda_(dda)
     , degPerStepPan_(degPerStepPan)
     , degPerStepTilt_(degPerStepTilt)
     , maxPoints_(maxPoints)
     , buffer_(nullptr)
+    , source_(nullptr)
+    , windowStart_(0)
+    , windowCount_(0)
     , numPoints_(0)
     , T0_unix_(0)
     , currentIndex_(0)
     , tracking_(false)
-    , executedPan_(0)
-    , executedTilt_(0)
+    , startMillis_(0)
+    , lastControlMs_(0)
+    , controlCount_(0)
+    , segA_{0, 0, 0}
+    , segB_{0, 0, 0}
+    , panA_(0)
+    , panB_(0)
+    , hostPan_(false)
+    , panShift_(0)
+    , panTarget_(0)
+    , tiltTarget_(0)
+    , panRate_(0)
+    , tiltRate_(0)
+    , panMaxRate_(4000)
+    , tiltMaxRate_(2000)
+    , panAccel_(4000)
+    , tiltAccel_(1000)
+    , panMin_(LONG_MIN)
+    , panMax_(LONG_MAX)
+    , planVersion_(0)
+    , splicePending_(false)
+    , spliceSource_(nullptr)
+    , spliceT0_(0)
+    , spliceAtMs_(0)
+    , spliceIndex_(0)
+    , offFromAz_(0)
+    , offFromEl_(0)
+    , offToAz_(0)
+    , offToEl_(0)
+    , offStartMs_(0)
+    , offBlendMs_(0)
 {
     // Alokuj bufor trajektorii
     buffer_ = new TrackPoint[maxPoints_];
@@ -29,15 +75,246 @@ void SphericalTracker::loadTrajectory(const TrackPoint *traj, int nPts, uint32_t
     for (int i = 0; i < numPoints_; ++i) {
         buffer_[i] = traj[i];
     }
+    source_      = nullptr;
+    windowStart_ = 0;
+    windowCount_ = numPoints_;
     T0_unix_ = T0_unix;
+    hostPan_ = false;
+    splicePending_ = false;
+    ++planVersion_;
+}
+
+void SphericalTracker::loadSource(TrackSource *src, uint32_t T0_unix) {
+    source_      = src;
+    numPoints_   = src ? src->size() : 0;
+    windowStart_ = 0;
+    windowCount_ = 0;
+    T0_unix_     = T0_unix;
+    hostPan_     = src && src->hostPan();
+    splicePending_ = false;
+    ++planVersion_;
+}
+
+bool SphericalTracker::pointAt(int index, TrackPoint &out) {
+    if (index < 0 || index >= numPoints_) return false;
+    if (index < windowStart_ || index >= windowStart_ + windowCount_) {
+        if (!source_) return false;
+        // Doczytaj kolejne okno zaczynające się od żądanego punktu
+        windowStart_ = index;
+        windowCount_ = source_->read(index, buffer_, maxPoints_);
+        if (windowCount_ <= 0) {
+            windowCount_ = 0;
+            return false;
+        }
+    }
+    out = buffer_[index - windowStart_];
+    return true;
+}
+
+int SphericalTracker::indexForTime(uint64_t nowMs) {
+    if (nowMs < uint64_t(T0_unix_) * 1000ull) return 0;
+    uint64_t elapsedMs = nowMs - uint64_t(T0_unix_) * 1000ull;
+    // Wyszukiwanie binarne: punkty są posortowane po czasie
+    int lo = 0, hi = numPoints_;
+    TrackPoint p;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (!pointAt(mid, p)) return numPoints_;
+        if (p.t <= elapsedMs) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+void SphericalTracker::prepare(int startIndex) {
+    startMillis_   = millis();
+    currentIndex_  = startIndex;
+    lastControlMs_ = 0;
+    offFromAz_ = offToAz_ = 0;
+    offFromEl_ = offToEl_ = 0;
+    offBlendMs_ = 0;
+    segA_ = {0, 0, 0};
+    pointAt(startIndex, segA_);
+    REC_EVENT(REC_TRACK_START, REC_AXIS_NONE, startIndex);
+    if (!pointAt(startIndex + 1, segB_)) segB_ = segA_;
+
+    float curDeg = panStp_.currentPosition() * degPerStepPan_;
+    if (hostPan_) {
+        // Gałąź z planu hosta (GOTO dojechał właśnie na nią); gdyby oś stała
+        // o pełny obrót dalej, plan przesuwa się zamiast kręcić osią
+        panShift_ = 360.0f * roundf((curDeg - (segA_.az - 180.0f)) / 360.0f);
+        if (panShift_ != 0) LOGW("[TRACK] Host pan branch shifted by %.0f deg", panShift_);
+        panA_ = segA_.az - 180.0f + panShift_;
+        panB_ = segB_.az - 180.0f + panShift_;
+    } else {
+        // Gałąź kąta PAN najbliższa aktualnej pozycji (oś właśnie tam dojechała)
+        panA_ = curDeg + angularDiff(segA_.az - 180.0f, curDeg);
+        panB_ = panA_ + angularDiff(segB_.az, segA_.az);
+    }
+
+    panStp_.enableOutputs();
+    tiltStp_.enableOutputs();
+    dda_.begin(micros());
+    tracking_ = true;
+}
+
+void SphericalTracker::setMaxRates(float panStepsPerSec, float tiltStepsPerSec) {
+    panMaxRate_  = panStepsPerSec;
+    tiltMaxRate_ = tiltStepsPerSec;
+}
+
+void SphericalTracker::setAccelerations(float panStepsPerSec2, float tiltStepsPerSec2) {
+    panAccel_  = panStepsPerSec2;
+    tiltAccel_ = tiltStepsPerSec2;
+}
+
+void SphericalTracker::setPanLimits(long minSteps, long maxSteps) {
+    panMin_ = minSteps;
+    panMax_ = maxSteps;
+}
+
+int SphericalTracker::scheduleSplice(TrackSource *next, uint32_t T0_unix, uint64_t atMs) {
+    if (!next || next->size() < 2) return -1;
+    if (atMs < uint64_t(T0_unix) * 1000ull) return -1;
+    const uint64_t atElapsed = atMs - uint64_t(T0_unix) * 1000ull;
+
+    // Ostatni punkt nie późniejszy niż atMs; czytane bezpośrednio ze źródła,
+    // bufor okna należy wciąż do bieżącej trajektorii
+    int lo = 0, hi = next->size();
+    TrackPoint p;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (next->read(mid, &p, 1) != 1) return -1;
+        if (p.t <= atElapsed) lo = mid + 1; else hi = mid;
+    }
+    if (lo == 0 || lo >= next->size()) return -1;   // atMs poza zakresem nowej trajektorii
+
+    spliceSource_  = next;
+    spliceT0_      = T0_unix;
+    spliceAtMs_    = atMs;
+    spliceIndex_   = lo - 1;
+    splicePending_ = true;
+    return spliceIndex_;
+}
+
+void SphericalTracker::offsetAt(uint64_t nowMs, float &az, float &el, float &azRate, float &elRate) const {
+    if (offBlendMs_ == 0 || nowMs >= offStartMs_ + offBlendMs_) {
+        az = offToAz_;
+        el = offToEl_;
+        azRate = elRate = 0;
+        return;
+    }
+    // smoothstep: prędkość korekty ciągła na początku i końcu przejścia
+    float u  = float(nowMs - offStartMs_) / float(offBlendMs_);
+    float s  = u * u * (3.0f - 2.0f * u);
+    float ds = 6.0f * u * (1.0f - u) * 1000.0f / float(offBlendMs_);
+    az = offFromAz_ + s * (offToAz_ - offFromAz_);
+    el = offFromEl_ + s * (offToEl_ - offFromEl_);
+    azRate = ds * (offToAz_ - offFromAz_);
+    elRate = ds * (offToEl_ - offFromEl_);
+}
+
+void SphericalTracker::addOffset(float dAzDeg, float dElDeg, uint32_t blendMs, uint64_t nowMs) {
+    float az, el, azRate, elRate;
+    offsetAt(nowMs, az, el, azRate, elRate);
+    offFromAz_  = az;
+    offFromEl_  = el;
+    offToAz_   += dAzDeg;
+    offToEl_   += dElDeg;
+    offStartMs_ = nowMs;
+    offBlendMs_ = blendMs;
+    REC_EVENT(REC_OFFSET, REC_AXIS_PAN,  int32_t(lroundf(offToAz_ * 1000.0f)));
+    REC_EVENT(REC_OFFSET, REC_AXIS_TILT, int32_t(lroundf(offToEl_ * 1000.0f)));
 }
 
-void SphericalTracker::prepare() {
-    startMillis_  = millis();
-    currentIndex_ = 0;
-    executedPan_  = 0;
-    executedTilt_ = 0;
-    tracking_     = true;
+void SphericalTracker::holdCurrentPosition(uint64_t nowMs) {
+    if (!tracking_) return;
+    // Podczas ręcznego ruchu update() nie był wołany: najpierw bieżący odcinek
+    const int64_t elapsedMs = int64_t(nowMs) - int64_t(T0_unix_) * 1000;
+    if (!advanceTo(elapsedMs)) return;
+    float panDeg, elDeg;
+    pathAt(elapsedMs, panDeg, elDeg);
+    // Położenie osi wyrażone w stopniach toru (oś TILT: 45° w pozycji domowej)
+    float curPan = panStp_.currentPosition() * degPerStepPan_;
+    float curEl  = 45.0f - tiltStp_.currentPosition() * degPerStepTilt_;
+    addOffset(angularDiff(curPan, panDeg + offToAz_), curEl - (elDeg + offToEl_), 0, nowMs);
+    // Osie przesunął kto inny: generator kroków startuje od ich położenia
+    dda_.begin(micros());
+}
+
+void SphericalTracker::pathAt(int64_t elapsedMs, float &panDeg, float &elDeg) const {
+    // Interpolacja liniowa w obrębie odcinka [A, B]
+    float span = float(segB_.t - segA_.t);
+    float frac = (span > 0) ? float(elapsedMs - int64_t(segA_.t)) / span : 0.0f;
+    frac = constrain(frac, 0.0f, 1.0f);
+    panDeg = panA_    + frac * (panB_    - panA_);
+    elDeg  = segA_.el + frac * (segB_.el - segA_.el);
+}
+
+void SphericalTracker::applySplice(uint64_t nowMs) {
+    // Położenie zadane tuż przed podmianą (tor + korekta)
+    const int64_t oldElapsedMs = int64_t(nowMs) - int64_t(T0_unix_) * 1000;
+    if (!advanceTo(oldElapsedMs)) return;
+    float oldPan, oldEl;
+    pathAt(oldElapsedMs, oldPan, oldEl);
+    float az, el, azRate, elRate;
+    offsetAt(nowMs, az, el, azRate, elRate);
+
+    splicePending_ = false;
+    source_        = spliceSource_;
+    numPoints_     = source_->size();
+    T0_unix_       = spliceT0_;
+    hostPan_       = source_->hostPan();
+    windowStart_   = 0;
+    windowCount_   = 0;
+    currentIndex_  = spliceIndex_;
+    ++planVersion_;
+    if (!pointAt(currentIndex_, segA_)) {
+        stop();
+        return;
+    }
+    if (!pointAt(currentIndex_ + 1, segB_)) segB_ = segA_;
+    if (hostPan_) {
+        // Gałąź z planu hosta, przesunięta o pełne obroty do dotychczasowego toru
+        panShift_ = 360.0f * roundf((oldPan - (segA_.az - 180.0f)) / 360.0f);
+        panA_ = segA_.az - 180.0f + panShift_;
+        panB_ = segB_.az - 180.0f + panShift_;
+    } else {
+        // Gałąź kąta PAN najbliższa dotychczasowemu torowi
+        panA_ = oldPan + angularDiff(segA_.az - 180.0f, oldPan);
+        panB_ = panA_ + angularDiff(segB_.az, segA_.az);
+    }
+    REC_EVENT(REC_SPLICE, REC_AXIS_NONE, currentIndex_);
+
+    const int64_t elapsedMs = int64_t(nowMs) - int64_t(T0_unix_) * 1000;
+    if (!advanceTo(elapsedMs)) return;
+
+    // Skok między torami przejmuje korekta i wygasza go do dotychczasowej wartości
+    float newPan, newEl;
+    pathAt(elapsedMs, newPan, newEl);
+    offFromAz_  = angularDiff(oldPan + az, newPan);
+    offFromEl_  = oldEl + el - newEl;
+    offStartMs_ = nowMs;
+    offBlendMs_ = SPLICE_BLEND_MS;
+    LOGI("[TRACK] Spliced plan v%lu at point %d, jump %.3f/%.3f deg",
+         (unsigned long)planVersion_, currentIndex_, offFromAz_ - offToAz_, offFromEl_ - offToEl_);
+}
+
+bool SphericalTracker::takeOver(uint64_t nowMs) {
+    if (tracking_ || !splicePending_ || nowMs < spliceAtMs_) return false;
+    loadSource(spliceSource_, spliceT0_);
+    int idx = indexForTime(nowMs);
+    if (idx > 0) --idx;
+    if (idx >= numPoints_) return false;
+    prepare(idx);
+    REC_EVENT(REC_SPLICE, REC_AXIS_NONE, currentIndex_);
+
+    // Osie stoją tam, gdzie zostawił je host: skok przejmuje korekta i wygasza go do zera
+    holdCurrentPosition(nowMs);
+    if (!tracking_) return false;
+    LOGI("[TRACK] Took over plan v%lu at point %d, jump %.3f/%.3f deg",
+         (unsigned long)planVersion_, currentIndex_, offToAz_, offToEl_);
+    addOffset(-offToAz_, -offToEl_, SPLICE_BLEND_MS, nowMs);
+    return true;
 }
 
 bool SphericalTracker::isTracking() const {
@@ -46,42 +323,125 @@ bool SphericalTracker::isTracking() const {
 
 float SphericalTracker::angularDiff(float target, float origin) {
     // Różnica kąta w przedziale (-180,180]
-    float diff = fmod(target - origin + 540.0f, 360.0f) - 180.0f;
-    return diff;
+    float diff = fmodf(target - origin + 540.0f, 360.0f);
+    if (diff < 0) diff += 360.0f;
+    return diff - 180.0f;
+}
+
+bool SphericalTracker::advanceTo(int64_t elapsedMs) {
+    while (elapsedMs >= int64_t(segB_.t) && currentIndex_ < numPoints_) {
+        if (!advanceSegment()) {
+            stop();
+            return false;
+        }
+    }
+    return true;
 }
 
-void SphericalTracker::update(uint32_t nowSec) {
+bool SphericalTracker::advanceSegment() {
+    TrackPoint next;
+    if (!pointAt(currentIndex_ + 2, next)) {
+        currentIndex_ = numPoints_;
+        return false;
+    }
+    ++currentIndex_;
+    segA_ = segB_;
+    panA_ = panB_;
+    segB_ = next;
+    REC_EVENT(REC_SEGMENT, REC_AXIS_NONE, currentIndex_);
+
+    if (hostPan_) {
+        // Gałąź i odwinięcia zaplanował host (poza krytycznymi oknami): bez własnych decyzji
+        panB_ = segB_.az - 180.0f + panShift_;
+        if (fabsf(panB_ - panA_) > 180.0f) {
+            REC_EVENT(REC_UNWIND, REC_AXIS_PAN, int32_t(lroundf(panB_ - panA_)));
+            LOGI("[TRACK] Planned pan unwind %.0f deg at point %d", panB_ - panA_, currentIndex_);
+        }
+        return true;
+    }
+
+    // Rozwijanie przyrostowe: przejście przez 0/360° nie powoduje obrotu o 360°
+    panB_ = panA_ + angularDiff(segB_.az, segA_.az);
+
+    long absPan = lroundf(panB_ / degPerStepPan_);
+    if (absPan > panMax_ || absPan < panMin_) {
+        // Limit przewodów: odwiń o pełny obrót w przeciwną stronę
+        float unwind = (absPan > panMax_) ? -360.0f : 360.0f;
+        panA_ += unwind;
+        panB_ += unwind;
+        REC_EVENT(REC_UNWIND, REC_AXIS_PAN, int32_t(unwind));
+        LOGI("[TRACK] Pan unwind %.0f deg at point %d", unwind, currentIndex_);
+    }
+    return true;
+}
+
+void SphericalTracker::update(uint64_t nowMs) {
     if (!tracking_) return;
-    // Oblicz upływ milisekund od T0
-    uint32_t elapsedMs = (nowSec - T0_unix_) * 1000ul;
-    // Dla każdego punktu, którego czas już minął, ustaw prędkości
-    while (currentIndex_ < numPoints_ && buffer_[currentIndex_].t * 1000u <= elapsedMs) {
-        // --- Pan ---
-        float rawDeltaPan   = angularDiff(buffer_[currentIndex_].az, buffer_[0].az);
-        int   desiredPan    = lround(rawDeltaPan / degPerStepPan_);
-        int   stepPan       = desiredPan - executedPan_;
-        executedPan_       += stepPan;
-        panStp_.setSpeed((stepPan >= 0) ? 1000 : -1000);
-
-        // --- Tilt ---
-        float rawDeltaTilt  = buffer_[currentIndex_].el - buffer_[0].el;
-        int   desiredTilt   = lround(rawDeltaTilt / degPerStepTilt_);
-        int   stepTilt      = desiredTilt - executedTilt_;
-        executedTilt_      += stepTilt;
-        tiltStp_.setSpeed((stepTilt >= 0) ? 500 : -500);
-
-        ++currentIndex_;
+
+    if (nowMs - lastControlMs_ >= CONTROL_PERIOD_MS) {
+        // Pętla nie nadąża: przerwa między przeliczeniami ponad dwa okresy
+        if (lastControlMs_ != 0 && nowMs - lastControlMs_ > 2 * CONTROL_PERIOD_MS)
+            REC_EVENT(REC_CTRL_LATE, REC_AXIS_NONE,
+                      int32_t((nowMs - lastControlMs_ - CONTROL_PERIOD_MS) * 1000));
+        lastControlMs_ = nowMs;
+        if (++controlCount_ % POS_ERROR_DIV == 0) {
+            REC_EVENT(REC_POS_ERROR, REC_AXIS_PAN,  int32_t(lroundf(panTarget_  - panStp_.currentPosition())));
+            REC_EVENT(REC_POS_ERROR, REC_AXIS_TILT, int32_t(lroundf(tiltTarget_ - tiltStp_.currentPosition())));
+        }
+        if (splicePending_ && nowMs >= spliceAtMs_) {
+            applySplice(nowMs);
+            if (!tracking_) return;
+        }
+        int64_t elapsedMs = int64_t(nowMs) - int64_t(T0_unix_) * 1000;
+
+        // Odcinek [A, B] zawierający bieżący czas
+        if (!advanceTo(elapsedMs)) return;
+
+        // Pozycja zadana: tor w obrębie odcinka plus korekta
+        float panDeg, elDeg;
+        pathAt(elapsedMs, panDeg, elDeg);
+        float offAz, offEl, offAzRate, offElRate;
+        offsetAt(nowMs, offAz, offEl, offAzRate, offElRate);
+        // Bez zaokrąglania: część ułamkowa kroku przechodzi do generatora DDA
+        panTarget_  =  (panDeg + offAz) / degPerStepPan_;
+        tiltTarget_ = -(elDeg + offEl - 45.0f) / degPerStepTilt_;
+
+        // Prędkość odcinka; przed T0 oś stoi w punkcie startowym
+        float span = float(segB_.t - segA_.t);
+        if (span > 0 && elapsedMs >= int64_t(segA_.t)) {
+            float dt  = span / 1000.0f;
+            panRate_  =  (panB_ - panA_)       / dt / degPerStepPan_;
+            tiltRate_ = -(segB_.el - segA_.el) / dt / degPerStepTilt_;
+        } else {
+            panRate_ = tiltRate_ = 0;
+        }
+        panRate_  +=  offAzRate / degPerStepPan_;
+        tiltRate_ += -offElRate / degPerStepTilt_;
+
+        // Sprzężenie od położenia zadanego generatora (z częścią ułamkową), nie od
+        // wykonanych kroków: błąd kwantyzacji nie narasta. Odcinek odwinięcia
+        // (±360°) rozpędza i hamuje oś z przyspieszeniem aMax, bez skoku prędkości
+        const float ctlDt   = CONTROL_PERIOD_MS / 1000.0f;
+        const float errPan  = panTarget_  - dda_.panPosition();
+        const float errTilt = tiltTarget_ - dda_.tiltPosition();
+        dda_.setRates(StepDDA::rampedRate(panRate_, KP_POS * errPan, errPan, dda_.panRate(),
+                                          panMaxRate_, panAccel_, ctlDt),
+                      StepDDA::rampedRate(tiltRate_, KP_POS * errTilt, errTilt, dda_.tiltRate(),
+                                          tiltMaxRate_, tiltAccel_, ctlDt));
     }
 }
 
 void SphericalTracker::runSteppers() {
     if (isTracking()) {
-        panStp_.runSpeed();
-        tiltStp_.runSpeed();
+        // Kroki obu osi przeplatane wzdłuż toru
+        const uint8_t stepped = dda_.run(micros());
+        if (stepped & StepDDA::STEP_PAN)  REC_STEP_EVENT(REC_AXIS_PAN,  panStp_.currentPosition());
+        if (stepped & StepDDA::STEP_TILT) REC_STEP_EVENT(REC_AXIS_TILT, tiltStp_.currentPosition());
     }
 }
 void SphericalTracker::stop() {
+    if (tracking_) REC_EVENT(REC_TRACK_STOP, REC_AXIS_NONE, currentIndex_);
     tracking_ = false;
-    panStp_.setSpeed(0);
-    tiltStp_.setSpeed(0);
-}
\ No newline at end of file
+    splicePending_ = false;
+    dda_.stop();
+}
@@ -3,26 +3,46 @@
 
 #include <AccelStepper.h>
 #include <cstdint>
+#include "StepDDA.h"
 
 // Struktura definiująca pojedynczy punkt trajektorii
 typedef struct {
-    uint32_t t;    // od T0 w sekundach
+    uint32_t t;    // od T0 w milisekundach
     float    az;   // azymut [deg]
     float    el;   // elewacja [deg]
 } TrackPoint;
 
+// Źródło punktów trajektorii czytane porcjami (np. plik w SPIFFS)
+class TrackSource {
+public:
+    virtual ~TrackSource() {}
+    /**
+     * Odczytaj punkty [first, first + count)
+     * @return Liczba faktycznie odczytanych punktów
+     */
+    virtual int read(int first, TrackPoint *dst, int count) = 0;
+    virtual int size() const = 0;
+    /**
+     * Azymut punktów to kąt PAN zaplanowany w aplikacji (180 = pozycja domowa,
+     * bez zawijania): gałąź i odwinięcia wybrał host, tracker ich nie zmienia
+     */
+    virtual bool hostPan() const { return false; }
+};
+
 class SphericalTracker {
 public:
     /**
      * Konstruktor
      * @param panStp        Referencja do sterownika silnika PAN
      * @param tiltStp       Referencja do sterownika silnika TILT
+     * @param dda           Generator kroków obu osi (wspólny z SiderealTracker)
      * @param degPerStepPan Ilość stopni na jeden mikro-krok osi PAN
      * @param degPerStepTilt Ilość stopni na jeden mikro-krok osi TILT
-     * @param maxPoints     Maksymalna liczba punktów trajektorii
+     * @param maxPoints     Rozmiar bufora (okna) punktów trajektorii
      */
     SphericalTracker(AccelStepper &panStp,
                      AccelStepper &tiltStp,
+                     StepDDA &dda,
                      float degPerStepPan,
                      float degPerStepTilt,
                      int maxPoints);
@@ -35,10 +55,33 @@ public:
      */
     void loadTrajectory(const TrackPoint *traj, int nPts, uint32_t T0_unix);
 
+    /**
+     * Załaduj trajektorię strumieniowaną ze źródła (dowolnej długości)
+     * @param src       Źródło punktów, musi istnieć przez cały czas śledzenia
+     * @param T0_unix   Czas startu śledzenia w sekundach unix
+     */
+    void loadSource(TrackSource *src, uint32_t T0_unix);
+
     /**
      * Przygotowanie do śledzenia (ustawienie startMillis i flagi)
+     * @param startIndex Punkt, od którego zaczyna się śledzenie (wznowienie sesji)
      */
-    void prepare();
+    void prepare(int startIndex = 0);
+
+    /**
+     * Indeks pierwszego punktu, który nie jest jeszcze wymagalny
+     * @param nowMs Aktualny czas w milisekundach UNIX
+     */
+    int indexForTime(uint64_t nowMs);
+
+    /**
+     * Pobierz punkt trajektorii (doczytuje okno ze źródła w razie potrzeby)
+     */
+    bool pointAt(int index, TrackPoint &out);
+
+    int numPoints() const { return numPoints_; }
+    int currentIndex() const { return currentIndex_; }
+    uint32_t T0() const { return T0_unix_; }
 
     /**
      * Sprawdź, czy aktualnie trwa śledzenie
@@ -47,9 +90,9 @@ public:
 
     /**
      * Aktualizacja trybu śledzenia; wywoływane w loop
-     * @param nowSec Aktualny czas w sekundach UNIX
+     * @param nowMs Aktualny czas w milisekundach UNIX
      */
-    void update(uint32_t nowSec);
+    void update(uint64_t nowMs);
 
     /**
      * Wykonanie kroków; wywoływane w loop
@@ -57,21 +100,152 @@ public:
     void runSteppers();
     void stop();
 
+    /**
+     * Maksymalne prędkości śledzenia [kroki/s]; szybkie obiekty (satelity LEO)
+     * wymagają tysięcy mikrokroków na sekundę na osi PAN
+     */
+    void setMaxRates(float panStepsPerSec, float tiltStepsPerSec);
+
+    /**
+     * Maksymalne przyspieszenia śledzenia [kroki/s^2]; zmiana prędkości na
+     * okres sterowania nie przekracza aMax*dt, także przy odwinięciu o 360°
+     */
+    void setAccelerations(float panStepsPerSec2, float tiltStepsPerSec2);
+
+    /**
+     * Miękkie limity osi PAN (ograniczenie skręcenia przewodów)
+     * @param minSteps Najmniejsza dozwolona pozycja PAN w krokach od pozycji domowej
+     * @param maxSteps Największa dozwolona pozycja PAN w krokach od pozycji domowej
+     */
+    void setPanLimits(long minSteps, long maxSteps);
+
+    /**
+     * Podmiana trajektorii w locie: od chwili atMs tor jest czytany z next,
+     * bez zatrzymania osi; różnica położeń w chwili podmiany jest wygaszana
+     * płynnie w ciągu SPLICE_BLEND_MS
+     * @param next      Źródło nowej trajektorii, musi istnieć przez cały czas śledzenia
+     * @param T0_unix   Czas startu nowej trajektorii w sekundach unix
+     * @param atMs      Chwila podmiany w milisekundach UNIX
+     * @return Indeks punktu nowej trajektorii, od którego nastąpi podmiana; -1, gdy nie obejmuje atMs
+     */
+    int scheduleSplice(TrackSource *next, uint32_t T0_unix, uint64_t atMs);
+    /**
+     * Przejęcie sesji prowadzonej krokami z aplikacji (PREP/STEP): gdy śledzenie
+     * stoi, a podmiana zaplanowana przez scheduleSplice jest wymagalna, tor jest
+     * czytany z nowego źródła od położenia, w którym host zostawił osie;
+     * różnica wygasa płynnie w ciągu SPLICE_BLEND_MS
+     * @param nowMs Aktualny czas w milisekundach UNIX
+     * @return true, gdy śledzenie ruszyło
+     */
+    bool takeOver(uint64_t nowMs);
+    void cancelSplice() { splicePending_ = false; }
+    bool splicePending() const { return splicePending_; }
+    TrackSource *source() const { return source_; }
+    TrackSource *spliceSource() const { return splicePending_ ? spliceSource_ : nullptr; }
+
+    /**
+     * Numer wersji trajektorii: rośnie przy każdym załadowaniu i podmianie
+     */
+    uint32_t planVersion() const { return planVersion_; }
+
+    /**
+     * Korekta (przesunięcie) toru względem trajektorii, dodawana do bieżącej
+     * i osiągana płynnie (smoothstep) w czasie blendMs
+     * @param dAzDeg   Przyrost korekty azymutu [deg]
+     * @param dElDeg   Przyrost korekty elewacji [deg]
+     * @param blendMs  Czas przejścia; 0 = natychmiast
+     * @param nowMs    Aktualny czas w milisekundach UNIX
+     */
+    void addOffset(float dAzDeg, float dElDeg, uint32_t blendMs, uint64_t nowMs);
+
+    /**
+     * Przyjmij bieżące położenie osi jako nową korektę (po ręcznym
+     * przesunięciu w trakcie śledzenia): tor biegnie dalej od miejsca,
+     * w którym użytkownik zostawił obiekt
+     */
+    void holdCurrentPosition(uint64_t nowMs);
+
+    float offsetAz() const { return offToAz_; }
+    float offsetEl() const { return offToEl_; }
+
 
 private:
     AccelStepper &panStp_;
     AccelStepper &tiltStp_;
+    StepDDA &dda_;
     float degPerStepPan_;
     float degPerStepTilt_;
     int maxPoints_;
     TrackPoint *buffer_;    // dynamicznie alokowany bufor
+    TrackSource *source_;   // nullptr: cała trajektoria w buforze
+    int windowStart_;       // indeks pierwszego punktu w buforze
+    int windowCount_;       // liczba punktów w buforze
     int numPoints_;
     uint32_t T0_unix_;
     int currentIndex_;
     bool tracking_;
     uint32_t startMillis_;
-    int executedPan_;
-    int executedTilt_;
+    uint64_t lastControlMs_;
+    uint32_t controlCount_;  // licznik okresów sterowania (próbkowanie rejestratora)
+    TrackPoint segA_;       // początek bieżącego odcinka trajektorii
+    TrackPoint segB_;       // koniec bieżącego odcinka
+    float panA_;            // ciągły kąt PAN w punktach A i B [deg], 0 = pozycja domowa, bez skoków o 360°
+    float panB_;
+    bool hostPan_;          // kąty PAN z planu hosta (TrackSource::hostPan)
+    float panShift_;        // pełne obroty dodane do planu hosta, by oś nie wykonała skoku
+    float panTarget_;       // pozycja zadana [kroki], z częścią ułamkową
+    float tiltTarget_;
+    float panRate_;         // prędkość odcinka (sprzężenie w przód) [kroki/s]
+    float tiltRate_;
+    float panMaxRate_;
+    float tiltMaxRate_;
+    float panAccel_;
+    float tiltAccel_;
+    long panMin_;
+    long panMax_;
+    uint32_t planVersion_;
+    // Oczekująca podmiana trajektorii
+    bool splicePending_;
+    TrackSource *spliceSource_;
+    uint32_t spliceT0_;
+    uint64_t spliceAtMs_;
+    int spliceIndex_;
+    // Korekta toru: przejście od offFrom do offTo w czasie offBlendMs_ od offStartMs_
+    float offFromAz_;
+    float offFromEl_;
+    float offToAz_;
+    float offToEl_;
+    uint64_t offStartMs_;
+    uint32_t offBlendMs_;
+
+    /**
+     * Przejdź do kolejnego odcinka (B staje się A)
+     * @return false, gdy trajektoria się skończyła
+     */
+    bool advanceSegment();
+
+    /**
+     * Przejdź do odcinka zawierającego podany czas
+     * @param elapsedMs Czas od T0 [ms]
+     * @return false, gdy trajektoria się skończyła (śledzenie zatrzymane)
+     */
+    bool advanceTo(int64_t elapsedMs);
+
+    /**
+     * Przełącz na trajektorię oczekującą na podmianę
+     */
+    void applySplice(uint64_t nowMs);
+
+    /**
+     * Położenie na trajektorii (bez korekty) w bieżącym odcinku
+     * @param elapsedMs Czas od T0 [ms]
+     */
+    void pathAt(int64_t elapsedMs, float &panDeg, float &elDeg) const;
+
+    /**
+     * Bieżąca korekta i jej prędkość [deg], [deg/s]
+     */
+    void offsetAt(uint64_t nowMs, float &az, float &el, float &azRate, float &elRate) const;
 
     /**
      * Oblicza różnicę kątową sferycznie (-180, +180]
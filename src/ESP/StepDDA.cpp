@@ -0,0 +1,105 @@
+#include "StepDDA.h"
+#include <Arduino.h>
+#include <cmath>
+
+// STEP high time and DIR setup time before a step edge (A4988 / DRV8825)
+static const uint32_t PULSE_US     = 2;
+static const uint32_t DIR_SETUP_US = 1;
+// A longer gap between calls (SPIFFS, BT) is integrated only up to this,
+// the steps it leaves behind are caught up by the trackers' feedback
+static const uint32_t MAX_DT_US    = 20000;
+
+static const int64_t ONE  = int64_t(1) << 32;
+static const int64_t HALF = int64_t(1) << 31;
+
+StepDDA::StepDDA(AccelStepper &panStp, uint8_t panStepPin, uint8_t panDirPin,
+                 AccelStepper &tiltStp, uint8_t tiltStepPin, uint8_t tiltDirPin)
+    : pan_{panStp, panStepPin, panDirPin, 0, 0, 0, 0}
+    , tilt_{tiltStp, tiltStepPin, tiltDirPin, 0, 0, 0, 0}
+    , lastUs_(0)
+    , active_(false)
+{}
+
+void StepDDA::reset(Axis &a) {
+    a.emitted = a.stp.currentPosition();
+    a.pos     = int64_t(a.emitted) * ONE;
+    a.rate    = 0;
+    a.dir     = 0;
+}
+
+void StepDDA::begin(uint32_t nowUs) {
+    reset(pan_);
+    reset(tilt_);
+    lastUs_ = nowUs;
+    active_ = true;
+}
+
+void StepDDA::setRates(float panStepsPerSec, float tiltStepsPerSec) {
+    pan_.rate  = int64_t(double(panStepsPerSec)  * 1e-6 * double(ONE));
+    tilt_.rate = int64_t(double(tiltStepsPerSec) * 1e-6 * double(ONE));
+}
+
+float StepDDA::rampedRate(float ffRate, float feedback, float err, float prevRate,
+                          float vMax, float aMax, float dt) {
+    // Braking curve: a large error (an unwind) is closed at the deceleration
+    // the axis has, a small one is left to the proportional feedback. Sampled
+    // every dt, so v*dt/2 is taken off sqrt(2*a*err) or it overshoots
+    const float adt   = aMax * dt;
+    const float brake = adt * (sqrtf(0.25f + 2.0f * fabsf(err) / (adt * dt)) - 0.5f);
+    const float v     = constrain(ffRate + constrain(feedback, -brake, brake), -vMax, vMax);
+    return constrain(v, prevRate - adt, prevRate + adt);
+}
+
+void StepDDA::stop() {
+    pan_.rate = tilt_.rate = 0;
+    active_   = false;
+}
+
+int8_t StepDDA::due(Axis &a) {
+    // Nearest whole step to the commanded position
+    const long target = long((a.pos + HALF) >> 32);
+    if (target == a.emitted) return 0;
+    const int8_t dir = (target > a.emitted) ? 1 : -1;
+    if (dir != a.dir) {
+        digitalWrite(a.dirPin, dir > 0 ? HIGH : LOW);
+        a.dir = dir;
+        delayMicroseconds(DIR_SETUP_US);
+    }
+    return dir;
+}
+
+uint8_t StepDDA::run(uint32_t nowUs) {
+    if (!active_) return 0;
+    uint32_t dt = nowUs - lastUs_;
+    lastUs_ = nowUs;
+    if (dt > MAX_DT_US) dt = MAX_DT_US;
+    // Moved by someone else meanwhile (jog): continue from there
+    if (pan_.stp.currentPosition()  != pan_.emitted)  reset(pan_);
+    if (tilt_.stp.currentPosition() != tilt_.emitted) reset(tilt_);
+    pan_.pos  += pan_.rate  * int64_t(dt);
+    tilt_.pos += tilt_.rate * int64_t(dt);
+
+    const int8_t dPan  = due(pan_);
+    const int8_t dTilt = due(tilt_);
+    if (!dPan && !dTilt) return 0;
+
+    // Steps due on both axes leave in one pulse
+    if (dPan)  digitalWrite(pan_.stepPin,  HIGH);
+    if (dTilt) digitalWrite(tilt_.stepPin, HIGH);
+    delayMicroseconds(PULSE_US);
+    if (dPan)  digitalWrite(pan_.stepPin,  LOW);
+    if (dTilt) digitalWrite(tilt_.stepPin, LOW);
+
+    uint8_t stepped = 0;
+    if (dPan) {
+        pan_.emitted += dPan;
+        pan_.stp.setCurrentPosition(pan_.emitted);
+        stepped |= STEP_PAN;
+    }
+    if (dTilt) {
+        tilt_.emitted += dTilt;
+        tilt_.stp.setCurrentPosition(tilt_.emitted);
+        stepped |= STEP_TILT;
+    }
+    return stepped;
+}
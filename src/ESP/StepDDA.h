@@ -0,0 +1,75 @@
+#ifndef STEP_DDA_H
+#define STEP_DDA_H
+
+#include <AccelStepper.h>
+#include <cstdint>
+
+/**
+ * Two-axis DDA step generator for the trackers. Both axes integrate their
+ * commanded rate on one microsecond time base into 32.32 fixed-point
+ * positions, and a step is emitted when a position crosses the middle
+ * between two steps. Pan and tilt pulses therefore interleave along the
+ * straight path between control updates instead of each axis running its
+ * own timer.
+ *
+ * The fractional part of each position is never rounded away. It carries
+ * across rate changes and trajectory segments, so quantization error does
+ * not accumulate. Pulses are driven on the STEP/DIR pins directly; the
+ * AccelStepper objects are only kept in sync so currentPosition() stays
+ * valid for everything else.
+ */
+class StepDDA {
+public:
+    enum : uint8_t { STEP_PAN = 1, STEP_TILT = 2 };
+
+    StepDDA(AccelStepper &panStp, uint8_t panStepPin, uint8_t panDirPin,
+            AccelStepper &tiltStp, uint8_t tiltStepPin, uint8_t tiltDirPin);
+
+    // Takes over from the axes' current positions, residuals cleared
+    void begin(uint32_t nowUs);
+    // Signed rates [steps/s]; positions, including the sub-step part, carry over
+    void setRates(float panStepsPerSec, float tiltStepsPerSec);
+    // Emits the steps that are due, at most one per axis; call every loop pass
+    // @return STEP_PAN / STEP_TILT bits of the axes that stepped
+    uint8_t run(uint32_t nowUs);
+    // Rates to zero, positions stay
+    void stop();
+
+    // Rate for one axis: feed-forward plus position feedback within vMax, the
+    // feedback no faster than the axis can still brake before the target, and
+    // at most aMax*dt away from the rate commanded so far
+    static float rampedRate(float ffRate, float feedback, float err, float prevRate,
+                            float vMax, float aMax, float dt);
+
+    // Commanded position with the sub-step part [steps]
+    float panPosition() const  { return position(pan_); }
+    float tiltPosition() const { return position(tilt_); }
+    // Commanded rates [steps/s]
+    float panRate() const  { return rateOf(pan_); }
+    float tiltRate() const { return rateOf(tilt_); }
+    bool isActive() const { return active_; }
+
+private:
+    struct Axis {
+        AccelStepper &stp;
+        uint8_t stepPin;
+        uint8_t dirPin;
+        int64_t pos;      // commanded position, 32.32 fixed point [steps]
+        int64_t rate;     // 32.32 fixed point [steps/us]
+        long    emitted;  // steps actually sent
+        int8_t  dir;      // level on the DIR pin: +1 high, -1 low, 0 unknown
+    };
+
+    static void reset(Axis &a);
+    static float position(const Axis &a) { return float(double(a.pos) / 4294967296.0); }
+    static float rateOf(const Axis &a) { return float(double(a.rate) * 1e6 / 4294967296.0); }
+    // Direction for the next step, 0 if the axis is where it should be
+    static int8_t due(Axis &a);
+
+    Axis pan_;
+    Axis tilt_;
+    uint32_t lastUs_;
+    bool active_;
+};
+
+#endif // STEP_DDA_H
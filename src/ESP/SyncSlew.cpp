@@ -0,0 +1,240 @@
+#include "SyncSlew.h"
+#include "FlightRecorder.h"
+#include <Arduino.h>
+#include <cmath>
+
+// Position error feedback on top of the profile feed-forward [1/s]
+static const float KP_POS    = 20.0f;
+// Speed used to settle the last few steps at the end of a slew [steps/s]
+static const float MIN_SPEED = 50.0f;
+
+// ---------------------------------------------------------------------------
+// SCurveProfile
+// ---------------------------------------------------------------------------
+
+SCurveProfile SCurveProfile::shape(float dist, float vp, float aMax, float jMax) {
+    SCurveProfile p;
+    p.dist  = dist;
+    p.vPeak = vp;
+    p.jerk  = jMax;
+    if (vp * jMax >= aMax * aMax) {
+        // Trapezoidal acceleration: the acceleration limit is reached
+        p.tj    = aMax / jMax;
+        p.ta    = vp / aMax + p.tj;
+        p.aPeak = aMax;
+    } else {
+        // Triangular acceleration: peak velocity reached before aMax
+        p.tj    = sqrtf(vp / jMax);
+        p.ta    = 2.0f * p.tj;
+        p.aPeak = jMax * p.tj;
+    }
+    float accelDist = vp * p.ta * 0.5f;
+    p.tv = (dist - 2.0f * accelDist) / vp;
+    if (p.tv < 0) p.tv = 0;
+    return p;
+}
+
+SCurveProfile SCurveProfile::plan(float dist, float vMax, float aMax, float jMax) {
+    if (dist <= 0 || vMax <= 0) return SCurveProfile();
+
+    SCurveProfile p = shape(dist, vMax, aMax, jMax);
+    if (p.vPeak * p.ta <= dist) return p;
+
+    // Too short to reach vMax: find the peak velocity that fills the distance
+    float lo = 0, hi = vMax;
+    for (int i = 0; i < 40; ++i) {
+        float mid = 0.5f * (lo + hi);
+        SCurveProfile q = shape(dist, mid, aMax, jMax);
+        if (q.vPeak * q.ta > dist) hi = mid; else lo = mid;
+    }
+    p = shape(dist, lo > 0 ? lo : hi, aMax, jMax);
+    return p;
+}
+
+SCurveProfile SCurveProfile::planForDuration(float dist, float duration,
+                                             float vMax, float aMax, float jMax) {
+    SCurveProfile fast = plan(dist, vMax, aMax, jMax);
+    if (dist <= 0 || fast.total() >= duration) return fast;
+
+    // Total time decreases monotonically with the velocity cap
+    float lo = 0, hi = vMax;
+    for (int i = 0; i < 40; ++i) {
+        float mid = 0.5f * (lo + hi);
+        if (plan(dist, mid, aMax, jMax).total() > duration) lo = mid; else hi = mid;
+    }
+    return plan(dist, hi, aMax, jMax);
+}
+
+float SCurveProfile::accelPos(float t) const {
+    float v1 = 0.5f * jerk * tj * tj;
+    float s1 = jerk * tj * tj * tj / 6.0f;
+    if (t <= tj) return jerk * t * t * t / 6.0f;
+    if (t <= ta - tj) {
+        float dt = t - tj;
+        return s1 + v1 * dt + 0.5f * aPeak * dt * dt;
+    }
+    float tau = ta - t;
+    return vPeak * ta * 0.5f - (vPeak * tau - jerk * tau * tau * tau / 6.0f);
+}
+
+float SCurveProfile::accelVel(float t) const {
+    if (t <= tj) return 0.5f * jerk * t * t;
+    if (t <= ta - tj) return 0.5f * jerk * tj * tj + aPeak * (t - tj);
+    float tau = ta - t;
+    return vPeak - 0.5f * jerk * tau * tau;
+}
+
+float SCurveProfile::position(float t) const {
+    if (dist <= 0 || t <= 0) return 0;
+    float T = total();
+    if (t >= T) return dist;
+    if (t <= ta) return accelPos(t);
+    if (t <= ta + tv) return vPeak * ta * 0.5f + vPeak * (t - ta);
+    return dist - accelPos(T - t);
+}
+
+float SCurveProfile::velocity(float t) const {
+    if (dist <= 0 || t <= 0) return 0;
+    float T = total();
+    if (t >= T) return 0;
+    if (t <= ta) return accelVel(t);
+    if (t <= ta + tv) return vPeak;
+    return accelVel(T - t);
+}
+
+// ---------------------------------------------------------------------------
+// SyncSlew
+// ---------------------------------------------------------------------------
+
+SyncSlew::SyncSlew(AccelStepper &panStp, AccelStepper &tiltStp)
+    : panStp_(panStp)
+    , tiltStp_(tiltStp)
+    , panLim_{4000, 4000, 16000}
+    , tiltLim_{2000, 1000, 4000}
+    , panStart_(0)
+    , tiltStart_(0)
+    , panDir_(1)
+    , tiltDir_(1)
+    , duration_(0)
+    , startUs_(0)
+    , active_(false)
+    , queuedPan_(0)
+    , queuedTilt_(0)
+    , panMaxSpeed_(0)
+    , tiltMaxSpeed_(0)
+{}
+
+void SyncSlew::setLimits(const Limits &pan, const Limits &tilt) {
+    panLim_  = pan;
+    tiltLim_ = tilt;
+}
+
+bool SyncSlew::start(long deltaPan, long deltaTilt) {
+    queuedPan_  = 0;
+    queuedTilt_ = 0;
+    if (deltaPan == 0 && deltaTilt == 0) return false;
+
+    float dPan  = fabsf((float)deltaPan);
+    float dTilt = fabsf((float)deltaTilt);
+    SCurveProfile fastPan  = SCurveProfile::plan(dPan,  panLim_.vMax,  panLim_.aMax,  panLim_.jMax);
+    SCurveProfile fastTilt = SCurveProfile::plan(dTilt, tiltLim_.vMax, tiltLim_.aMax, tiltLim_.jMax);
+
+    // The slower axis sets the pace, the other one is stretched to match it
+    duration_ = fmaxf(fastPan.total(), fastTilt.total());
+    panProf_  = SCurveProfile::planForDuration(dPan,  duration_, panLim_.vMax,  panLim_.aMax,  panLim_.jMax);
+    tiltProf_ = SCurveProfile::planForDuration(dTilt, duration_, tiltLim_.vMax, tiltLim_.aMax, tiltLim_.jMax);
+
+    panStart_  = panStp_.currentPosition();
+    tiltStart_ = tiltStp_.currentPosition();
+    panDir_    = (deltaPan  >= 0) ? 1 : -1;
+    tiltDir_   = (deltaTilt >= 0) ? 1 : -1;
+
+    // setSpeed() is clamped to maxSpeed, leave room for the position feedback;
+    // the limits in effect before the slew are put back when it ends
+    if (!active_) {
+        panMaxSpeed_  = panStp_.maxSpeed();
+        tiltMaxSpeed_ = tiltStp_.maxSpeed();
+    }
+    panStp_.setMaxSpeed(panLim_.vMax * 1.2f);
+    tiltStp_.setMaxSpeed(tiltLim_.vMax * 1.2f);
+    panStp_.enableOutputs();
+    tiltStp_.enableOutputs();
+
+    startUs_ = micros();
+    active_  = true;
+    REC_EVENT(REC_SLEW_START, REC_AXIS_NONE, int32_t(duration_ * 1000.0f));
+    return true;
+}
+
+void SyncSlew::driveAxis(AccelStepper &stp, const SCurveProfile &prof,
+                         long startPos, int dir, float t) {
+    long  want = startPos + dir * lroundf(prof.position(t));
+    long  err  = want - stp.currentPosition();
+    float vff  = dir * prof.velocity(t);
+    float v    = vff + KP_POS * err;
+    if (err != 0 && fabsf(v) < MIN_SPEED) v = (err > 0) ? MIN_SPEED : -MIN_SPEED;
+    if (err == 0 && vff == 0) v = 0;
+    stp.setSpeed(v);
+    if (v != 0) stp.runSpeed();
+}
+
+bool SyncSlew::update() {
+    if (!active_) return false;
+
+    float t = (micros() - startUs_) * 1e-6f;
+    driveAxis(panStp_,  panProf_,  panStart_,  panDir_,  t);
+    driveAxis(tiltStp_, tiltProf_, tiltStart_, tiltDir_, t);
+
+    if (t >= duration_
+        && panStp_.currentPosition()  == panStart_  + panDir_  * lroundf(panProf_.dist)
+        && tiltStp_.currentPosition() == tiltStart_ + tiltDir_ * lroundf(tiltProf_.dist)) {
+        if (queuedPan_ != 0 || queuedTilt_ != 0) {
+            // Next queued move starts from rest, outputs stay enabled
+            REC_EVENT(REC_SLEW_END, REC_AXIS_NONE, int32_t((micros() - startUs_) / 1000));
+            return start(queuedPan_, queuedTilt_);
+        }
+        abort();
+        return false;
+    }
+    return true;
+}
+
+void SyncSlew::queue(long deltaPan, long deltaTilt) {
+    if (!active_) {
+        start(deltaPan, deltaTilt);
+        return;
+    }
+    queuedPan_  += deltaPan;
+    queuedTilt_ += deltaTilt;
+}
+
+long SyncSlew::pendingPan() const {
+    long left = active_ ? panStart_ + panDir_ * lroundf(panProf_.dist) - panStp_.currentPosition() : 0;
+    return left + queuedPan_;
+}
+
+long SyncSlew::pendingTilt() const {
+    long left = active_ ? tiltStart_ + tiltDir_ * lroundf(tiltProf_.dist) - tiltStp_.currentPosition() : 0;
+    return left + queuedTilt_;
+}
+
+void SyncSlew::runToCompletion() {
+    while (update()) {
+        // runSpeed() emits at most one step per call, keep the loop tight
+    }
+}
+
+void SyncSlew::abort() {
+    if (active_) {
+        REC_EVENT(REC_SLEW_END, REC_AXIS_NONE, int32_t((micros() - startUs_) / 1000));
+        panStp_.setMaxSpeed(panMaxSpeed_);
+        tiltStp_.setMaxSpeed(tiltMaxSpeed_);
+    }
+    active_ = false;
+    queuedPan_  = 0;
+    queuedTilt_ = 0;
+    panStp_.setSpeed(0);
+    tiltStp_.setSpeed(0);
+    panStp_.disableOutputs();
+    tiltStp_.disableOutputs();
+}
@@ -0,0 +1,92 @@
+#ifndef SYNC_SLEW_H
+#define SYNC_SLEW_H
+
+#include <AccelStepper.h>
+#include <cstdint>
+
+// Jerk-limited (7-segment) S-curve for a rest-to-rest move of one axis
+struct SCurveProfile {
+    float dist  = 0;  // distance [steps], always >= 0
+    float vPeak = 0;  // reached velocity [steps/s]
+    float aPeak = 0;  // reached acceleration [steps/s^2]
+    float jerk  = 0;  // [steps/s^3]
+    float tj    = 0;  // duration of one jerk segment [s]
+    float ta    = 0;  // duration of the whole acceleration phase [s]
+    float tv    = 0;  // duration of the cruise phase [s]
+
+    float total() const { return 2.0f * ta + tv; }
+    float position(float t) const;
+    float velocity(float t) const;
+
+    // Fastest profile for the distance within the given limits
+    static SCurveProfile plan(float dist, float vMax, float aMax, float jMax);
+    // Profile that takes exactly `duration` (>= fastest time) with the same limits
+    static SCurveProfile planForDuration(float dist, float duration,
+                                         float vMax, float aMax, float jMax);
+
+private:
+    static SCurveProfile shape(float dist, float vp, float aMax, float jMax);
+    float accelPos(float t) const;
+    float accelVel(float t) const;
+};
+
+/**
+ * Non-blocking GOTO engine: both axes follow S-curves of equal duration,
+ * so they start and finish together. Call update() from loop().
+ */
+class SyncSlew {
+public:
+    struct Limits {
+        float vMax;  // [steps/s]
+        float aMax;  // [steps/s^2]
+        float jMax;  // [steps/s^3]
+    };
+
+    SyncSlew(AccelStepper &panStp, AccelStepper &tiltStp);
+
+    void setLimits(const Limits &pan, const Limits &tilt);
+
+    // Starts a relative move in motor steps; false if nothing to do.
+    // Replaces a slew in progress and drops queued moves
+    bool start(long deltaPan, long deltaTilt);
+    // Relative move run after the current slew (right away when idle)
+    void queue(long deltaPan, long deltaTilt);
+    // Advances the motion; returns false once the slew has finished
+    bool update();
+    // Blocking variant for callers that must wait (homing)
+    void runToCompletion();
+    // Stops both axes where they are, queued moves are dropped; the
+    // steppers get back the maxSpeed they had before the slew
+    void abort();
+
+    bool isActive() const { return active_; }
+    float duration() const { return duration_; }
+    // Steps still to go, queued moves included
+    long pendingPan() const;
+    long pendingTilt() const;
+
+private:
+    void driveAxis(AccelStepper &stp, const SCurveProfile &prof,
+                   long startPos, int dir, float t);
+
+    AccelStepper &panStp_;
+    AccelStepper &tiltStp_;
+    Limits panLim_;
+    Limits tiltLim_;
+
+    SCurveProfile panProf_;
+    SCurveProfile tiltProf_;
+    long  panStart_;
+    long  tiltStart_;
+    int   panDir_;
+    int   tiltDir_;
+    float duration_;
+    uint32_t startUs_;
+    bool  active_;
+    long  queuedPan_;
+    long  queuedTilt_;
+    float panMaxSpeed_;   // maxSpeed before the slew raised it
+    float tiltMaxSpeed_;
+};
+
+#endif // SYNC_SLEW_H
@@ -0,0 +1,139 @@
+#include "AstroMath.h"
+#include <QtMath>
+
+namespace AstroMath {
+
+double julianDay(const QDateTime &dtUtc)
+{
+    return dtUtc.toMSecsSinceEpoch() / 86400000.0 + 2440587.5;
+}
+
+double gmstDeg(double jd)
+{
+    double T = (jd - 2451545.0) / 36525.0;
+    double gmst = 280.46061837
+                  + 360.98564736629 * (jd - 2451545.0)
+                  + 0.000387933 * T * T
+                  - T * T * T / 38710000.0;
+    gmst = fmod(gmst, 360.0);
+    if (gmst < 0) gmst += 360.0;
+    return gmst;
+}
+
+double lstDeg(double jd, double lonDeg)
+{
+    double lst = fmod(gmstDeg(jd) + lonDeg, 360.0);
+    if (lst < 0) lst += 360.0;
+    return lst;
+}
+
+void raDecToAltAz(double raDeg, double decDeg, double latDeg, double lstDeg,
+                  double &azDeg, double &elDeg)
+{
+    const double ha  = qDegreesToRadians(lstDeg - raDeg);
+    const double dec = qDegreesToRadians(decDeg);
+    const double lat = qDegreesToRadians(latDeg);
+    double sinEl = qSin(dec) * qSin(lat) + qCos(dec) * qCos(lat) * qCos(ha);
+    sinEl = qBound(-1.0, sinEl, 1.0);
+    elDeg = qRadiansToDegrees(qAsin(sinEl));
+    double az = qRadiansToDegrees(qAtan2(-qCos(dec) * qSin(ha),
+                                         qSin(dec) * qCos(lat) - qCos(dec) * qCos(ha) * qSin(lat)));
+    azDeg = (az < 0) ? az + 360.0 : az;
+}
+
+void altAzToRaDec(double azDeg, double elDeg, double latDeg, double lstDeg,
+                  double &raDeg, double &decDeg)
+{
+    const double az  = qDegreesToRadians(azDeg);
+    const double el  = qDegreesToRadians(elDeg);
+    const double lat = qDegreesToRadians(latDeg);
+    double sinDec = qSin(el) * qSin(lat) + qCos(el) * qCos(lat) * qCos(az);
+    sinDec = qBound(-1.0, sinDec, 1.0);
+    decDeg = qRadiansToDegrees(qAsin(sinDec));
+    double ha = qRadiansToDegrees(qAtan2(-qCos(el) * qSin(az),
+                                         qSin(el) * qCos(lat) - qCos(el) * qCos(az) * qSin(lat)));
+    double ra = fmod(lstDeg - ha, 360.0);
+    raDeg = (ra < 0) ? ra + 360.0 : ra;
+}
+
+void precessionMatrix(double jd, double m[3][3])
+{
+    const double T = (jd - 2451545.0) / 36525.0;
+    const double arcsec = M_PI / (180.0 * 3600.0);
+    const double zeta  = (2306.2181 * T + 0.30188 * T * T + 0.017998 * T * T * T) * arcsec;
+    const double z     = (2306.2181 * T + 1.09468 * T * T + 0.018203 * T * T * T) * arcsec;
+    const double theta = (2004.3109 * T - 0.42665 * T * T - 0.041833 * T * T * T) * arcsec;
+    const double cz = qCos(zeta),  sz = qSin(zeta);
+    const double cZ = qCos(z),     sZ = qSin(z);
+    const double ct = qCos(theta), st = qSin(theta);
+    m[0][0] =  cz * ct * cZ - sz * sZ;
+    m[0][1] = -sz * ct * cZ - cz * sZ;
+    m[0][2] = -st * cZ;
+    m[1][0] =  cz * ct * sZ + sz * cZ;
+    m[1][1] = -sz * ct * sZ + cz * cZ;
+    m[1][2] = -st * sZ;
+    m[2][0] =  cz * st;
+    m[2][1] = -sz * st;
+    m[2][2] =  ct;
+}
+
+void unitVector(double raDeg, double decDeg, double v[3])
+{
+    const double ra  = qDegreesToRadians(raDeg);
+    const double dec = qDegreesToRadians(decDeg);
+    v[0] = qCos(dec) * qCos(ra);
+    v[1] = qCos(dec) * qSin(ra);
+    v[2] = qSin(dec);
+}
+
+double separationDeg(double ra1, double dec1, double ra2, double dec2)
+{
+    double a[3], b[3];
+    unitVector(ra1, dec1, a);
+    unitVector(ra2, dec2, b);
+    double dot = qBound(-1.0, a[0] * b[0] + a[1] * b[1] + a[2] * b[2], 1.0);
+    return qRadiansToDegrees(qAcos(dot));
+}
+
+void slerpAzEl(double az0, double el0, double az1, double el1, int n,
+               double *azOut, double *elOut)
+{
+    if (n <= 0) return;
+    double v0[3], v1[3];
+    unitVector(az0, el0, v0);
+    unitVector(az1, el1, v1);
+
+    // Angle from atan2(|v0 x v1|, v0.v1), accurate for the tiny steps of dense plans
+    const double cx = v0[1] * v1[2] - v0[2] * v1[1];
+    const double cy = v0[2] * v1[0] - v0[0] * v1[2];
+    const double cz = v0[0] * v1[1] - v0[1] * v1[0];
+    const double sinOmega = qSqrt(cx * cx + cy * cy + cz * cz);
+    const double cosOmega = v0[0] * v1[0] + v0[1] * v1[1] + v0[2] * v1[2];
+    const double omega = qAtan2(sinOmega, cosOmega);
+
+    // u: unit vector in the v0-v1 plane, perpendicular to v0; v(t) = v0 cos(t omega) + u sin(t omega).
+    // Coincident points leave u = 0, every sample is then v0.
+    double u[3] = { 0.0, 0.0, 0.0 };
+    if (sinOmega >= 1e-12)
+        for (int j = 0; j < 3; ++j) u[j] = (v1[j] - v0[j] * cosOmega) / sinOmega;
+
+    // Rotation by omega/n in the form c -= a c + b s, s -= a s - b c (a = 2 sin^2(theta/2)),
+    // which keeps full precision when theta is small
+    const double theta = omega / n;
+    const double h = qSin(0.5 * theta);
+    const double a = 2.0 * h * h;
+    const double b = qSin(theta);
+    double c = 1.0, s = 0.0;
+    for (int k = 0; k < n; ++k) {
+        const double x = v0[0] * c + u[0] * s;
+        const double y = v0[1] * c + u[1] * s;
+        const double z = v0[2] * c + u[2] * s;
+        azOut[k] = qRadiansToDegrees(qAtan2(y, x));
+        elOut[k] = qRadiansToDegrees(qAtan2(z, qSqrt(x * x + y * y)));
+        const double cn = c - (a * c + b * s);
+        s -= a * s - b * c;
+        c = cn;
+    }
+}
+
+} // namespace AstroMath
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QDateTime>
+
+// Small set of shared astronomical helpers (angles in degrees)
+namespace AstroMath {
+
+// Julian Day of a UTC time
+double julianDay(const QDateTime &dtUtc);
+// Greenwich mean sidereal time [deg, 0..360)
+double gmstDeg(double jd);
+// Local sidereal time [deg, 0..360)
+double lstDeg(double jd, double lonDeg);
+
+// Equatorial -> horizontal for a given local sidereal time; az from north, eastwards
+void raDecToAltAz(double raDeg, double decDeg, double latDeg, double lstDeg,
+                  double &azDeg, double &elDeg);
+// Horizontal -> equatorial (inverse of raDecToAltAz)
+void altAzToRaDec(double azDeg, double elDeg, double latDeg, double lstDeg,
+                  double &raDeg, double &decDeg);
+
+// Rotation from the mean equator and equinox of J2000 to those of date
+// (IAU 1976 precession angles); v_date = m * v_J2000
+void precessionMatrix(double jd, double m[3][3]);
+
+// Unit vector of a point on the celestial sphere
+void unitVector(double raDeg, double decDeg, double v[3]);
+// Angle between two points [deg]
+double separationDeg(double ra1, double dec1, double ra2, double dec2);
+
+// Great-circle interpolation from (az0, el0) towards (az1, el1): n samples at
+// t = k/n, k = 0..n-1, written to azOut/elOut [deg, az in (-180, 180]].
+// The rotation is set up once per call and advanced by recurrence, so the
+// only per-sample trig is the final conversion back to az/el.
+void slerpAzEl(double az0, double el0, double az1, double el1, int n,
+               double *azOut, double *elOut);
+
+} // namespace AstroMath
@@ -0,0 +1,399 @@
+#include "DeviceRegistry.h"
+#include "bluetoothmanager.h"
+#include "HorizonsManager.h"
+#include "TrackingSession.h"
+#include "PlanFile.h"
+#include <QDebug>
+#include <QtNumeric>
+#include <algorithm>
+#include <climits>
+
+// Splice moment: this long after the request, plus the upload time at this link rate
+static const int    SPLICE_MIN_LEAD_MS  = 3000;
+static const double UPLOAD_BYTES_PER_MS = 8.0;
+// A stored plan starts this far ahead of now; the PREP slew fits in between
+static const int    PLAN_SLEW_LEAD_SEC  = 30;
+
+DeviceRegistry::DeviceRegistry(QObject *parent)
+    : QObject(parent)
+{
+    m_scheduledTimer.setSingleShot(true);
+    connect(&m_scheduledTimer, &QTimer::timeout, this, [this]() {
+        const QVector<EphemPoint> traj = m_scheduledTraj;
+        m_scheduledTraj.clear();
+        startStepSessions(traj);
+    });
+}
+
+DeviceRegistry::~DeviceRegistry()
+{
+    // Links and sessions are children and go with the QObject
+    qDeleteAll(m_devices);
+    m_devices.clear();
+}
+
+int DeviceRegistry::addDevice(const QBluetoothAddress &address, const QString &name,
+                              const DeviceCalibration &calibration)
+{
+    auto *bt = new BluetoothManager(this);
+    const int id = insert(bt, true, name, calibration);
+    bt->connectToDevice(address);
+    return id;
+}
+
+int DeviceRegistry::adoptDevice(BluetoothManager *bt, const QString &name,
+                                const DeviceCalibration &calibration)
+{
+    return insert(bt, false, name, calibration);
+}
+
+int DeviceRegistry::insert(BluetoothManager *bt, bool owned, const QString &name,
+                           const DeviceCalibration &calibration)
+{
+    const int id = m_nextId++;
+    auto *d = new Device;
+    d->name        = name;
+    d->bt          = bt;
+    d->owned       = owned;
+    d->calibration = calibration;
+    d->session     = new TrackingSession(bt, this);
+    d->panPlanner.setCriticalWindows(m_critical);
+    d->panPlanner.setSoftLimits(calibration.panLimitCcwDeg, calibration.panLimitCwDeg);
+    m_devices.insert(id, d);
+
+    // Each link reports on its own; one slow device never holds up another
+    connect(bt, &BluetoothManager::connected, this, [this, id, bt]() {
+        bt->sendCommand("PAN_LIMITS?\n");
+        emit deviceConnected(id);
+    });
+    connect(bt, &BluetoothManager::disconnected, this, [this, id]() {
+        if (TrackingSession *s = session(id)) s->cancel();
+        emit deviceDisconnected(id);
+    });
+    connect(bt, &BluetoothManager::dataReceived, this, [this, id](const QByteArray &data) {
+        onDeviceData(id, data);
+        emit deviceData(id, data);
+    });
+    connect(bt, &BluetoothManager::errorOccurred, this,
+            [this, id](const QString &message) { emit deviceError(id, message); });
+    qDebug() << "Tracker" << id << name << "registered";
+    return id;
+}
+
+void DeviceRegistry::removeDevice(int id)
+{
+    Device *d = m_devices.take(id);
+    if (!d) return;
+    d->session->cancel();
+    d->session->deleteLater();
+    disconnect(d->bt, nullptr, this, nullptr);
+    if (d->owned) d->bt->deleteLater();
+    delete d;
+}
+
+void DeviceRegistry::onDeviceData(int id, const QByteArray &data)
+{
+    Device *d = m_devices.value(id);
+    if (!d) return;
+    d->rx += data;
+    int nl;
+    while ((nl = d->rx.indexOf('\n')) >= 0) {
+        const QByteArray line = d->rx.left(nl).trimmed();
+        d->rx.remove(0, nl + 1);
+        if (line == "SPLICE_FAILED" || line == "SPLICE_EXPIRED") {
+            d->session->handOver(QDateTime());
+            qDebug() << "Tracker" << id << d->name << "refused the splice:" << line;
+        } else if (line.startsWith("PAN_LIMITS ")) {
+            // "PAN_LIMITS <ccw> <cw>": the firmware's cable wrap, degrees from home
+            const QList<QByteArray> f = line.split(' ');
+            bool okCcw = false, okCw = false;
+            const double ccw = f.value(1).toDouble(&okCcw);
+            const double cw  = f.value(2).toDouble(&okCw);
+            if (okCcw && okCw) {
+                d->calibration.panLimitCcwDeg = ccw;
+                d->calibration.panLimitCwDeg  = cw;
+                d->panPlanner.setSoftLimits(ccw, cw);
+            }
+        } else if (line.startsWith("SIDEREAL_HALTED ") || line == "RADEC_BELOW_HORIZON"
+                   || line == "RADEC_TILT_LIMIT") {
+            // Fixed target out of reach: the device stopped, or never started
+            const bool horizon = line.endsWith("HORIZON");
+            qWarning() << "Tracker" << id << d->name << "stopped tracking:" << line;
+            emit deviceError(id, d->name + (horizon ? ": target below the horizon, tracking stopped"
+                                                    : ": target outside the tilt travel, tracking stopped"));
+        }
+    }
+}
+
+int DeviceRegistry::connectedCount() const
+{
+    int n = 0;
+    for (const Device *d : m_devices)
+        if (d->bt->isConnected()) ++n;
+    return n;
+}
+
+QString DeviceRegistry::name(int id) const
+{
+    const Device *d = m_devices.value(id);
+    return d ? d->name : QString();
+}
+
+BluetoothManager *DeviceRegistry::link(int id) const
+{
+    const Device *d = m_devices.value(id);
+    return d ? d->bt : nullptr;
+}
+
+TrackingSession *DeviceRegistry::session(int id) const
+{
+    const Device *d = m_devices.value(id);
+    return d ? d->session : nullptr;
+}
+
+DeviceCalibration DeviceRegistry::calibration(int id) const
+{
+    const Device *d = m_devices.value(id);
+    return d ? d->calibration : DeviceCalibration();
+}
+
+void DeviceRegistry::setCalibration(int id, const DeviceCalibration &calibration)
+{
+    Device *d = m_devices.value(id);
+    if (!d) return;
+    d->calibration = calibration;
+    d->panPlanner.setSoftLimits(calibration.panLimitCcwDeg, calibration.panLimitCwDeg);
+}
+
+bool DeviceRegistry::panPlanFits(Device *d, const PanPlan &plan)
+{
+    if (plan.feasible) return true;
+    const QString message = QString("%1: path does not fit the pan cable limits (%2..%3°), not sent")
+                                .arg(d->name)
+                                .arg(d->panPlanner.minDeg(), 0, 'f', 0)
+                                .arg(d->panPlanner.maxDeg(), 0, 'f', 0);
+    qWarning() << message;
+    emit deviceError(m_devices.key(d), message);
+    return false;
+}
+
+void DeviceRegistry::broadcast(const QByteArray &cmd)
+{
+    for (Device *d : m_devices)
+        if (d->bt->isConnected()) d->bt->sendCommand(cmd);
+}
+
+void DeviceRegistry::resetToHome()
+{
+    for (Device *d : m_devices)
+        d->panPlanner.resetToHome();
+}
+
+void DeviceRegistry::setCriticalWindows(const QVector<QPair<QDateTime, QDateTime>> &windows)
+{
+    m_critical = windows;
+    for (Device *d : m_devices)
+        d->panPlanner.setCriticalWindows(windows);
+}
+
+QVector<EphemPoint> DeviceRegistry::plannedPanTrajectory(const QVector<EphemPoint> &traj,
+                                                         const PanPlan &plan)
+{
+    QVector<EphemPoint> out = traj;
+    for (int i = 0; i < out.size() && i < plan.panAbsDeg.size(); ++i)
+        out[i].az = plan.panAbsDeg[i];
+    return out;
+}
+
+double DeviceRegistry::plannedPanAt(const QVector<EphemPoint> &planned, const QDateTime &t)
+{
+    if (planned.isEmpty() || t < planned.first().utc || t > planned.last().utc) return qQNaN();
+    auto it = std::lower_bound(planned.cbegin(), planned.cend(), t,
+                               [](const EphemPoint &p, const QDateTime &v) { return p.utc < v; });
+    if (it == planned.cbegin()) return it->az;
+    const EphemPoint &b = *it;
+    const EphemPoint &a = *(it - 1);
+    const qint64 span = a.utc.msecsTo(b.utc);
+    return span > 0 ? a.az + (b.az - a.az) * a.utc.msecsTo(t) / double(span) : b.az;
+}
+
+QVector<EphemPoint> DeviceRegistry::alignedTrajectory(const QVector<EphemPoint> &traj,
+                                                      const DeviceCalibration &cal)
+{
+    if (cal.azOffsetDeg == 0.0 && cal.elOffsetDeg == 0.0) return traj;   // implicitly shared
+    QVector<EphemPoint> out = traj;
+    for (EphemPoint &p : out) {
+        p.az += cal.azOffsetDeg;
+        p.el += cal.elOffsetDeg;
+    }
+    return out;
+}
+
+int DeviceRegistry::sendTrajectorySteps(const QVector<EphemPoint> &traj)
+{
+    if (traj.isEmpty()) return 0;
+    m_scheduledTimer.stop();
+    m_scheduledTraj.clear();
+
+    // Session after the next rise: the trackers stay free until shortly before it
+    const qint64 waitMs = QDateTime::currentDateTimeUtc().msecsTo(HorizonsManager::stepSessionBaseTime(traj))
+                          - STEP_PREP_LEAD_SEC * 1000;
+    if (waitMs > 0) {
+        m_scheduledTraj = traj;
+        m_scheduledTimer.start(int(qMin<qint64>(waitMs, INT_MAX)));
+        qDebug() << "Step sessions scheduled for" << traj.first().utc.toString(Qt::ISODate);
+        return connectedCount();
+    }
+    return startStepSessions(traj);
+}
+
+QDateTime DeviceRegistry::scheduledStart() const
+{
+    return m_scheduledTraj.isEmpty() ? QDateTime() : m_scheduledTraj.first().utc;
+}
+
+int DeviceRegistry::startStepSessions(const QVector<EphemPoint> &traj)
+{
+    if (traj.isEmpty()) return 0;
+    // Offsets count from the first sample; samples already past are merged into one catch-up move
+    const QDateTime baseTime = HorizonsManager::stepSessionBaseTime(traj);
+    int started = 0;
+    for (Device *d : m_devices) {
+        if (!d->bt->isConnected()) continue;
+        const QVector<EphemPoint> aligned = alignedTrajectory(traj, d->calibration);
+        // The branch buildStepPlan is about to commit: a copy or splice on the device continues it
+        const PanPlan pan = d->panPlanner.plan(aligned);
+        if (!panPlanFits(d, pan)) {
+            d->plannedPan.clear();
+            continue;
+        }
+        d->plannedPan = plannedPanTrajectory(aligned, pan);
+        const QVector<StepRecord> plan = HorizonsManager::buildStepPlan(
+            d->panPlanner, aligned, d->calibration.panStepsPerDeg, d->calibration.tiltStepsPerDeg);
+        d->session->cancel();
+        d->session->startWithPrep(plan, baseTime);
+        ++started;
+    }
+    qDebug() << "Step sessions started on" << started << "of" << m_devices.size() << "trackers";
+    return started;
+}
+
+int DeviceRegistry::uploadTrajectory(const QVector<EphemPoint> &traj, const QString &name)
+{
+    int sent = 0;
+    for (Device *d : m_devices) {
+        if (!d->bt->isConnected() || traj.isEmpty()) continue;
+        const QVector<EphemPoint> aligned = alignedTrajectory(traj, d->calibration);
+        const bool stepped = d->plannedPan.size() == aligned.size()
+                             && d->plannedPan.first().utc == aligned.first().utc;
+        if (stepped) {
+            HorizonsManager::uploadTrajectory(d->bt, d->plannedPan, name, true);
+        } else {
+            const PanPlan pan = d->panPlanner.plan(aligned);
+            if (!panPlanFits(d, pan)) continue;
+            HorizonsManager::uploadTrajectory(d->bt, plannedPanTrajectory(aligned, pan), name, true);
+        }
+        ++sent;
+    }
+    return sent;
+}
+
+int DeviceRegistry::trackOnDevices(const QVector<EphemPoint> &traj, const QString &name)
+{
+    if (traj.isEmpty()) return 0;
+    m_scheduledTimer.stop();
+    m_scheduledTraj.clear();
+    int started = 0;
+    for (Device *d : m_devices) {
+        if (!d->bt->isConnected()) continue;
+        d->session->cancel();
+        const QVector<EphemPoint> aligned = alignedTrajectory(traj, d->calibration);
+        const PanPlan pan = d->panPlanner.plan(aligned);
+        if (!panPlanFits(d, pan)) continue;
+        d->panPlanner.commit(pan);
+        d->plannedPan = plannedPanTrajectory(aligned, pan);
+        HorizonsManager::uploadTrajectory(d->bt, d->plannedPan, name, true);
+        // Queued behind TRAJ_END: the ESP starts it once the plan is stored
+        d->bt->sendCommand(QString("TRACK %1\n").arg(name).toUtf8());
+        ++started;
+    }
+    return started;
+}
+
+int DeviceRegistry::spliceOnDevices(const QVector<EphemPoint> &traj, const QString &baseName)
+{
+    if (traj.isEmpty()) return 0;
+    const int version = ++m_planVersions[baseName];
+    const QString name = HorizonsManager::versionedPlanName(baseName, version);
+
+    // The switch waits for the slowest upload: ~24 bytes per point over the link
+    const qint64 leadMs = SPLICE_MIN_LEAD_MS + qint64(traj.size() * 24 / UPLOAD_BYTES_PER_MS);
+    const QDateTime spliceAt = QDateTime::currentDateTimeUtc().addMSecs(leadMs);
+    int sent = 0;
+    for (Device *d : m_devices) {
+        if (!d->bt->isConnected()) continue;
+        // Planned on from where the current plan has the axis at the splice moment
+        const QVector<EphemPoint> aligned = alignedTrajectory(traj, d->calibration);
+        PanWrapPlanner planner = d->panPlanner;
+        const double panAtSplice = plannedPanAt(d->plannedPan, spliceAt);
+        if (!qIsNaN(panAtSplice)) planner.setCurrentDeg(panAtSplice);
+        const PanPlan pan = planner.plan(aligned);
+        // The running plan carries on unchanged
+        if (!panPlanFits(d, pan)) continue;
+        d->panPlanner.commit(pan);
+        d->plannedPan = plannedPanTrajectory(aligned, pan);
+        HorizonsManager::spliceOnDevice(d->bt, d->plannedPan, name, spliceAt, true);
+        d->session->handOver(spliceAt);
+        ++sent;
+    }
+    qDebug() << "Plan" << name << "splices in at" << spliceAt.toString(Qt::ISODateWithMs)
+             << "on" << sent << "trackers";
+    return version;
+}
+
+void DeviceRegistry::offsetOnDevices(double dAzDeg, double dElDeg, int blendMs)
+{
+    for (Device *d : m_devices) {
+        if (!d->bt->isConnected()) continue;
+        const int pan = qRound(dAzDeg * d->calibration.panStepsPerDeg);
+        if (d->session->nudge(pan, qRound(dElDeg * d->calibration.tiltStepsPerDeg)))
+            d->panPlanner.setCurrentDeg(d->panPlanner.currentDeg() + pan / d->calibration.panStepsPerDeg);
+        else
+            HorizonsManager::sendPathOffset(d->bt, dAzDeg, dElDeg, blendMs);
+    }
+}
+
+int DeviceRegistry::startPlanFile(const PlanFile &file)
+{
+    QDateTime baseTime;
+    const QVector<StepRecord> plan = file.planFrom(
+        QDateTime::currentDateTimeUtc().addSecs(PLAN_SLEW_LEAD_SEC), &baseTime);
+    if (plan.isEmpty()) return 0;
+    m_scheduledTimer.stop();
+    m_scheduledTraj.clear();
+
+    int started = 0;
+    for (Device *d : m_devices) {
+        if (!d->bt->isConnected() || !file.fits(d->calibration)) continue;
+        // Record 0 moves from the pan the plan was compiled from; this axis may be elsewhere
+        QVector<StepRecord> own = plan;
+        const int fix = qRound((file.startPanDeg() - d->panPlanner.currentDeg()) * d->calibration.panStepsPerDeg);
+        own[0].deltaPan = int16_t(qBound(-32768, own[0].deltaPan + fix, 32767));
+        d->session->cancel();
+        d->session->startWithPrep(own, baseTime);
+        d->panPlanner.setCurrentDeg(file.endPanDeg());
+        d->plannedPan.clear();
+        ++started;
+    }
+    qDebug() << "Plan file for" << file.objectId() << "started on" << started << "of" << m_devices.size()
+             << "trackers, records:" << plan.size();
+    return started;
+}
+
+void DeviceRegistry::stopAll()
+{
+    m_scheduledTimer.stop();
+    m_scheduledTraj.clear();
+    for (Device *d : m_devices)
+        d->session->cancel();
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <QObject>
+#include <QVector>
+#include <QMap>
+#include <QHash>
+#include <QTimer>
+#include <QtBluetooth/QBluetoothAddress>
+#include "EphemerisTypes.h"
+#include "PanWrapPlanner.h"
+
+class BluetoothManager;
+class TrackingSession;
+class PlanFile;
+
+// Mechanics and alignment of one tracker
+struct DeviceCalibration {
+    double panStepsPerDeg  = (8 * 180) / (14 * 1.8);
+    double tiltStepsPerDeg = (8 * 84)  / (14 * 1.8);
+    double azOffsetDeg = 0.0;   // added to every planned azimuth
+    double elOffsetDeg = 0.0;   // added to every planned elevation
+    // Pan cable wrap from home; the device reports its own (PAN_LIMITS?) once connected
+    double panLimitCcwDeg = 270.0;
+    double panLimitCwDeg  = 270.0;
+};
+
+/**
+ * Set of trackers driven from one app instance. Every device has its own
+ * Bluetooth link (socket and write buffer), cable wrap state, step session
+ * and calibration; one computed trajectory is fanned out to all of them,
+ * so an extra tracker costs a step conversion, not a Horizons request.
+ * Devices are identified by small integer IDs.
+ */
+class DeviceRegistry : public QObject {
+    Q_OBJECT
+public:
+    explicit DeviceRegistry(QObject *parent = nullptr);
+    ~DeviceRegistry();
+
+    /**
+     * Connects a new tracker
+     * @param address  paired device
+     * @param name     label for the UI and logs
+     * @return device ID
+     */
+    int addDevice(const QBluetoothAddress &address, const QString &name,
+                  const DeviceCalibration &calibration = DeviceCalibration());
+    // Registers a link created elsewhere (the main connection); not owned
+    int adoptDevice(BluetoothManager *bt, const QString &name,
+                    const DeviceCalibration &calibration = DeviceCalibration());
+    void removeDevice(int id);
+
+    QList<int> ids() const { return m_devices.keys(); }
+    int size() const { return m_devices.size(); }
+    int connectedCount() const;
+    QString name(int id) const;
+    BluetoothManager *link(int id) const;
+    TrackingSession *session(int id) const;
+    DeviceCalibration calibration(int id) const;
+    void setCalibration(int id, const DeviceCalibration &calibration);
+
+    // Same command to every connected device
+    void broadcast(const QByteArray &cmd);
+    // After HOME: every device is back at its reference position
+    void resetToHome();
+    /**
+     * Time ranges in which no pan unwind may be planned (culmination,
+     * exposures); applies to the sessions planned from now on
+     */
+    void setCriticalWindows(const QVector<QPair<QDateTime, QDateTime>> &windows);
+    QVector<QPair<QDateTime, QDateTime>> criticalWindows() const { return m_critical; }
+
+    /**
+     * Host-timed step sessions on all connected devices, sharing one base
+     * time (the first sample) so they move in step. A trajectory starting
+     * more than STEP_PREP_LEAD_SEC from now is kept and started that long
+     * before its first sample
+     * @return number of devices started or scheduled
+     */
+    int sendTrajectorySteps(const QVector<EphemPoint> &traj);
+    // First sample of a scheduled step session, invalid if none is waiting
+    QDateTime scheduledStart() const;
+
+    // PREP goes out this long before the first sample of a step session
+    static const int STEP_PREP_LEAD_SEC = 30;
+    /**
+     * Stores the plan on every connected device and starts it there (TRACK).
+     * Plans go out with the pan branch and unwinds chosen here (TRAJ ... PAN),
+     * the device does not pick its own
+     */
+    int trackOnDevices(const QVector<EphemPoint> &traj, const QString &name);
+    // Upload only, e.g. to keep a copy for RESUME; same pan branch as the step session
+    int uploadTrajectory(const QVector<EphemPoint> &traj, const QString &name);
+
+    /**
+     * Corrected plan for devices that are already tracking: uploaded in the
+     * background as the next version of baseName and spliced in once stored,
+     * without stopping (see HorizonsManager::spliceOnDevice). A device playing
+     * a step session runs the new plan itself from the splice moment on; its
+     * steps stop there unless it refuses the splice
+     * @return version put in the plan name
+     */
+    int spliceOnDevices(const QVector<EphemPoint> &traj, const QString &baseName);
+    /**
+     * Small correction of every tracking device's path: blended in over
+     * blendMs on a device running its plan, one relative move on a device
+     * playing a step session
+     */
+    void offsetOnDevices(double dAzDeg, double dElDeg, int blendMs = 1000);
+    /**
+     * Step sessions from a compiled plan file on the connected devices it
+     * fits (same mechanics and alignment); what is already past is folded
+     * into the PREP slew
+     * @return number of devices started
+     */
+    int startPlanFile(const PlanFile &file);
+    void stopAll();
+
+    // Plan in the device's frame: shared samples unless it has an alignment offset
+    static QVector<EphemPoint> alignedTrajectory(const QVector<EphemPoint> &traj,
+                                                 const DeviceCalibration &cal);
+    // Plan as uploaded: every azimuth replaced by its planned absolute pan angle (180 = home)
+    static QVector<EphemPoint> plannedPanTrajectory(const QVector<EphemPoint> &traj,
+                                                    const PanPlan &plan);
+    // Pan angle of such a plan at t, interpolated; NaN outside it
+    static double plannedPanAt(const QVector<EphemPoint> &planned, const QDateTime &t);
+
+signals:
+    void deviceConnected(int id);
+    void deviceDisconnected(int id);
+    void deviceData(int id, const QByteArray &data);
+    void deviceError(int id, const QString &message);
+
+private:
+    struct Device {
+        QString            name;
+        BluetoothManager  *bt = nullptr;
+        bool               owned = false;
+        PanWrapPlanner     panPlanner;
+        TrackingSession   *session = nullptr;
+        DeviceCalibration  calibration;
+        QByteArray         rx;   // partial reply line
+        QVector<EphemPoint> plannedPan;   // plan the device follows, plannedPanTrajectory
+    };
+
+    int insert(BluetoothManager *bt, bool owned, const QString &name,
+               const DeviceCalibration &calibration);
+    int startStepSessions(const QVector<EphemPoint> &traj);
+    // Replies the registry acts on itself (a refused splice keeps the steps going)
+    void onDeviceData(int id, const QByteArray &data);
+    // A plan that leaves the cable limits is not sent; reported as deviceError
+    bool panPlanFits(Device *d, const PanPlan &plan);
+
+    QMap<int, Device *> m_devices;
+    int                 m_nextId = 1;
+    QHash<QString, int> m_planVersions;   // last spliced version per base name
+    QVector<QPair<QDateTime, QDateTime>> m_critical;   // no pan unwinds in these
+    QTimer              m_scheduledTimer;   // deferred sendTrajectorySteps
+    QVector<EphemPoint> m_scheduledTraj;
+};
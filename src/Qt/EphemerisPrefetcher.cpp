@@ -0,0 +1,103 @@
+#include "EphemerisPrefetcher.h"
+#include "HorizonsManager.h"
+#include "VisibilityPlanner.h"
+#include <QDebug>
+
+EphemerisPrefetcher::EphemerisPrefetcher(HorizonsManager *horizons, int stepSec, QObject *parent)
+    : QObject(parent)
+    , m_horizons(horizons)
+    , m_stepSec(stepSec)
+{
+    connect(m_horizons, &HorizonsManager::ephemerisReady,
+            this, &EphemerisPrefetcher::onEphemerisReady);
+    connect(m_horizons, &HorizonsManager::ephemerisError,
+            this, &EphemerisPrefetcher::onEphemerisError);
+
+    m_refreshTimer.setInterval(REFRESH_SECS * 1000);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &EphemerisPrefetcher::refresh);
+}
+
+void EphemerisPrefetcher::setPosition(const QGeoCoordinate &center)
+{
+    if (!center.isValid()) return;
+    const bool moved = !m_center.isValid() || m_center.distanceTo(center) > MOVE_THRESHOLD_M;
+    if (!moved) return;
+    m_center = center;
+    refresh();
+    m_refreshTimer.start();
+}
+
+void EphemerisPrefetcher::setLastUsed(const QString &horizonsId)
+{
+    m_lastUsed = horizonsId;
+}
+
+QStringList EphemerisPrefetcher::candidates(const QDateTime &start, const QDateTime &end) const
+{
+    // Bodies with a button, only those that get above the horizon in the window
+    QStringList ids;
+    for (int b = PlanetEphemeris::Sun; b <= PlanetEphemeris::Saturn; ++b) {
+        const auto body = PlanetEphemeris::Body(b);
+        const TargetVisibility vis = VisibilityPlanner::evaluate(
+            VisibilityTarget::planet(body), m_center, start, end, MIN_EL_DEG);
+        if (vis.isVisible()) ids.append(PlanetEphemeris::horizonsId(body));
+    }
+    if (!m_lastUsed.isEmpty() && !ids.contains(m_lastUsed))
+        ids.append(m_lastUsed);
+    return ids;
+}
+
+void EphemerisPrefetcher::refresh()
+{
+    if (!m_center.isValid()) return;
+
+    // Full minutes, like the sessions, so a cached slice falls on the same sample grid
+    QDateTime start = QDateTime::currentDateTimeUtc().addSecs(60);
+    start.setTime(QTime(start.time().hour(), start.time().minute(), 0));
+    const QDateTime end = start.addSecs(WINDOW_SECS);
+
+    const QStringList ids = candidates(start, end);
+    if (ids.isEmpty()) return;
+    // Background traffic: no debug CSVs on the Desktop for replies nobody asked for
+    const QVector<int> requestIds = m_horizons->fetchEphemerides(
+        ids, m_center, start.toLocalTime(), end.toLocalTime(), m_stepSec, false);
+    for (int requestId : requestIds)
+        m_pending.insert(requestId, { m_center, start, end, {} });
+    qDebug() << "Prefetching" << ids << "until" << end.toString(Qt::ISODate);
+}
+
+void EphemerisPrefetcher::onEphemerisReady(int requestId, const QString &objectId,
+                                           const QVector<EphemPoint> &traj)
+{
+    auto it = m_pending.find(requestId);
+    if (it == m_pending.end()) return;
+    Entry e = it.value();
+    m_pending.erase(it);
+    e.traj = traj;
+    m_cache.insert(objectId, e);
+    emit prefetched(objectId, traj.size());
+}
+
+void EphemerisPrefetcher::onEphemerisError(int requestId, const QString &objectId,
+                                           const QString &errorString)
+{
+    if (m_pending.remove(requestId))
+        qDebug() << "Prefetch of" << objectId << "failed:" << errorString;
+}
+
+QVector<EphemPoint> EphemerisPrefetcher::lookup(const QString &horizonsId,
+                                                const QGeoCoordinate &center,
+                                                const QDateTime &start,
+                                                const QDateTime &end) const
+{
+    QVector<EphemPoint> out;
+    auto it = m_cache.constFind(horizonsId);
+    if (it == m_cache.constEnd()) return out;
+    const Entry &e = it.value();
+    if (!center.isValid() || e.center.distanceTo(center) > MOVE_THRESHOLD_M) return out;
+    if (e.start > start.toUTC() || e.end < end.toUTC()) return out;
+
+    for (const EphemPoint &p : e.traj)
+        if (p.utc >= start && p.utc <= end) out.append(p);
+    return out;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QTimer>
+#include <QDateTime>
+#include <QGeoCoordinate>
+#include "EphemerisTypes.h"
+#include "PlanetEphemeris.h"
+
+class HorizonsManager;
+
+/**
+ * Fetches Horizons trajectories ahead of time, so pressing a target button
+ * can start motion from a local copy. Once a position is known, the
+ * planets above the horizon in the coming window (checked locally with
+ * VisibilityPlanner) and the last-used object are requested in one batch;
+ * the batch is renewed as the window runs out or when the observer moves
+ * farther than MOVE_THRESHOLD_M.
+ */
+class EphemerisPrefetcher : public QObject {
+    Q_OBJECT
+public:
+    static const int    WINDOW_SECS      = 2 * 3600;  // fetched ahead of now
+    static const int    REFRESH_SECS     = 15 * 60;   // renew this often
+    static constexpr double MOVE_THRESHOLD_M = 2000.0;
+    static constexpr double MIN_EL_DEG       = 0.0;   // planets lower than this all window are skipped
+
+    /**
+     * @param horizons  manager doing the requests; its results are filtered by request ID
+     * @param stepSec   trajectory step, the same the sessions use
+     */
+    EphemerisPrefetcher(HorizonsManager *horizons, int stepSec, QObject *parent = nullptr);
+
+    // New fix: the first one, or a move past the threshold, starts a batch
+    void setPosition(const QGeoCoordinate &center);
+    // Object the user asked for last, fetched with the planets from now on
+    void setLastUsed(const QString &horizonsId);
+
+    /**
+     * Cached samples for a session, cut to [start, end]
+     * @return empty if nothing cached covers the range at this position
+     */
+    QVector<EphemPoint> lookup(const QString &horizonsId,
+                               const QGeoCoordinate &center,
+                               const QDateTime &start,
+                               const QDateTime &end) const;
+
+public slots:
+    void refresh();
+
+signals:
+    void prefetched(const QString &horizonsId, int points);
+
+private slots:
+    void onEphemerisReady(int requestId, const QString &objectId,
+                          const QVector<EphemPoint> &traj);
+    void onEphemerisError(int requestId, const QString &objectId,
+                          const QString &errorString);
+
+private:
+    struct Entry {
+        QGeoCoordinate      center;
+        QDateTime           start;   // UTC
+        QDateTime           end;     // UTC
+        QVector<EphemPoint> traj;
+    };
+    QStringList candidates(const QDateTime &start, const QDateTime &end) const;
+
+    HorizonsManager       *m_horizons;
+    int                    m_stepSec;
+    QGeoCoordinate         m_center;         // position of the last batch
+    QString                m_lastUsed;
+    QTimer                 m_refreshTimer;
+    QHash<int, Entry>      m_pending;        // by request ID, traj still empty
+    QHash<QString, Entry>  m_cache;          // by Horizons ID
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <QDateTime>
+#include <cstdint>
+
+// Ephemeris point: UTC time and azimuth/elevation
+struct EphemPoint {
+    QDateTime utc;
+    double az;   // degrees: azimuth
+    double el;   // degrees: elevation
+};
+
+// Temporary structure for parsing RA/Dec from Horizons
+struct EphemRD {
+    QDateTime utc;
+    double    raDeg;  // degrees
+    double    decDeg; // degrees
+};
+
+// Single motor step record to send to ESP
+struct StepRecord {
+    uint32_t offset_ms;
+    int16_t  deltaPan;
+    int16_t  deltaTilt;
+};
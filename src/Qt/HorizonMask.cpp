@@ -0,0 +1,178 @@
+#include "HorizonMask.h"
+#include <QDir>
+#include <QFile>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QtMath>
+#include <QDebug>
+#include <cmath>
+
+HorizonMask::HorizonMask()
+{
+    for (float &l : m_limit) l = 0.0f;
+}
+
+bool HorizonMask::isFlat() const
+{
+    for (float l : m_limit)
+        if (l > 0.0f) return false;
+    return true;
+}
+
+double HorizonMask::maxLimit() const
+{
+    float best = m_limit[0];
+    for (float l : m_limit) best = qMax(best, l);
+    return best;
+}
+
+void HorizonMask::beginRecording()
+{
+    m_recorded.fill(qQNaN(), BINS);
+}
+
+void HorizonMask::record(double azDeg, double elDeg)
+{
+    if (m_recorded.isEmpty()) return;
+    int bin = int(std::floor(azDeg)) % BINS;
+    if (bin < 0) bin += BINS;
+    // Several samples in a bin: the highest obstruction counts
+    float &r = m_recorded[bin];
+    if (qIsNaN(r) || elDeg > r) r = float(qBound(-5.0, elDeg, 90.0));
+}
+
+int HorizonMask::recordedBins() const
+{
+    int n = 0;
+    for (float r : m_recorded)
+        if (!qIsNaN(r)) ++n;
+    return n;
+}
+
+bool HorizonMask::finishRecording()
+{
+    QVector<int> known;
+    for (int b = 0; b < m_recorded.size(); ++b)
+        if (!qIsNaN(m_recorded[b])) known.append(b);
+    if (known.size() < 2) {
+        m_recorded.clear();
+        return false;
+    }
+
+    // Linear between consecutive recorded bins, wrapping through 360°
+    for (int k = 0; k < known.size(); ++k) {
+        const int a = known[k];
+        const int b = known[(k + 1) % known.size()];
+        const int span = (b - a + BINS) % BINS;
+        const float la = m_recorded[a], lb = m_recorded[b];
+        m_limit[a] = la;
+        for (int i = 1; i < span; ++i)
+            m_limit[(a + i) % BINS] = la + (lb - la) * float(i) / float(span);
+    }
+    m_recorded.clear();
+    return true;
+}
+
+QString HorizonMask::masksDir()
+{
+    QString loc = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (loc.isEmpty()) loc = QStandardPaths::writableLocation(QStandardPaths::TempLocation);
+    return loc + "/horizon";
+}
+
+bool HorizonMask::save(const QGeoCoordinate &site, QString *error) const
+{
+    auto fail = [error](const QString &message) {
+        if (error) *error = message;
+        return false;
+    };
+    if (!site.isValid()) return fail("no site position");
+
+    // One file per site: position on the first line, then a limit per bin
+    const QString path = QString("%1/%2_%3.horizon")
+                             .arg(masksDir())
+                             .arg(site.latitude(), 0, 'f', 4)
+                             .arg(site.longitude(), 0, 'f', 4);
+    QDir().mkpath(masksDir());
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Text)) return fail(f.errorString());
+    QTextStream out(&f);
+    out << QString::number(site.latitude(), 'f', 6) << ' '
+        << QString::number(site.longitude(), 'f', 6) << '\n';
+    for (int b = 0; b < BINS; ++b)
+        out << QString::number(m_limit[b], 'f', 2) << ((b % 12 == 11) ? '\n' : ' ');
+    out.flush();
+    if (!f.commit()) return fail(f.errorString());
+    qDebug() << "Horizon mask" << path << "max" << maxLimit();
+    return true;
+}
+
+bool HorizonMask::load(const QGeoCoordinate &site)
+{
+    for (float &l : m_limit) l = 0.0f;
+    if (!site.isValid()) return false;
+
+    QString best;
+    double  bestDist = SITE_TOLERANCE_M;
+    const QFileInfoList files = QDir(masksDir()).entryInfoList({ "*.horizon" }, QDir::Files);
+    for (const QFileInfo &fi : files) {
+        QFile f(fi.absoluteFilePath());
+        if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) continue;
+        const QStringList pos = QString::fromUtf8(f.readLine()).split(' ', Qt::SkipEmptyParts);
+        if (pos.size() < 2) continue;
+        const double d = QGeoCoordinate(pos[0].toDouble(), pos[1].toDouble()).distanceTo(site);
+        if (d <= bestDist) {
+            best     = fi.absoluteFilePath();
+            bestDist = d;
+        }
+    }
+    if (best.isEmpty()) return false;
+
+    QFile f(best);
+    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
+    f.readLine();
+    const QStringList values = QString::fromUtf8(f.readAll()).split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
+    if (values.size() != BINS) {
+        qDebug() << "Horizon mask" << best << "has" << values.size() << "bins, ignored";
+        return false;
+    }
+    for (int b = 0; b < BINS; ++b)
+        m_limit[b] = values[b].toFloat();
+    return true;
+}
+
+QVector<QVector<EphemPoint>> HorizonMask::visibleRuns(const QVector<EphemPoint> &traj,
+                                                      double minElDeg,
+                                                      int bridgeSec) const
+{
+    // Index ranges [first, last] of the clear stretches
+    QVector<QPair<int, int>> ranges;
+    int first = -1;
+    for (int i = 0; i < traj.size(); ++i) {
+        const bool clear = isClear(traj[i].az, traj[i].el, minElDeg);
+        if (clear && first < 0) first = i;
+        if (!clear && first >= 0) {
+            ranges.append({ first, i - 1 });
+            first = -1;
+        }
+    }
+    if (first >= 0) ranges.append({ first, traj.size() - 1 });
+
+    // Short obstructions are tracked through
+    QVector<QPair<int, int>> merged;
+    for (const auto &r : ranges) {
+        if (!merged.isEmpty()
+            && traj[merged.last().second].utc.secsTo(traj[r.first].utc) <= bridgeSec)
+            merged.last().second = r.second;
+        else
+            merged.append(r);
+    }
+
+    QVector<QVector<EphemPoint>> runs;
+    for (const auto &r : merged)
+        if (r.second > r.first)
+            runs.append(traj.mid(r.first, r.second - r.first + 1));
+    return runs;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QGeoCoordinate>
+#include "EphemerisTypes.h"
+#include <cmath>
+
+/**
+ * Local horizon of one site: the lowest usable elevation in each 1° azimuth
+ * bin (trees, buildings, the roof edge). Lookup is a single table read, so
+ * it can sit inside the planners' sampling loops. A mask is recorded by
+ * sweeping the tracker along the top of the obstructions while the app
+ * samples where the axes point; bins the sweep skipped are interpolated
+ * from their neighbours. Without a recording the horizon is flat at 0°.
+ */
+class HorizonMask {
+public:
+    static const int BINS = 360;
+    // A stored mask is used only this close to where it was recorded
+    static constexpr double SITE_TOLERANCE_M = 500.0;
+
+    HorizonMask();
+
+    // Elevation limit [deg] at an azimuth in any range
+    double limitAt(double azDeg) const
+    {
+        int bin = int(std::floor(azDeg)) % BINS;
+        if (bin < 0) bin += BINS;
+        return m_limit[bin];
+    }
+    bool isClear(double azDeg, double elDeg, double minElDeg = 0.0) const
+    {
+        return elDeg >= qMax(minElDeg, limitAt(azDeg));
+    }
+    // No obstruction anywhere above 0°
+    bool isFlat() const;
+    // Highest limit of all bins
+    double maxLimit() const;
+
+    // Recording: samples replace nothing until finishRecording
+    void beginRecording();
+    void record(double azDeg, double elDeg);
+    bool isRecording() const { return !m_recorded.isEmpty(); }
+    int recordedBins() const;
+    /**
+     * Fills the bins the sweep did not reach by interpolating around the
+     * circle and makes the recording the active mask
+     * @return false (mask unchanged) if fewer than two bins were recorded
+     */
+    bool finishRecording();
+
+    // Per-site storage in the app data location
+    static QString masksDir();
+    bool save(const QGeoCoordinate &site, QString *error = nullptr) const;
+    // Nearest stored mask within SITE_TOLERANCE_M; flat if there is none
+    bool load(const QGeoCoordinate &site);
+
+    /**
+     * Splits a trajectory into the stretches that can be observed
+     * @param minElDeg   lowest elevation used even where the horizon is lower
+     * @param bridgeSec  shorter obstructions (a pole, a branch) do not split
+     *                   a stretch; the tracker just keeps going behind them
+     * @return visible runs in time order, each at least two points
+     */
+    QVector<QVector<EphemPoint>> visibleRuns(const QVector<EphemPoint> &traj,
+                                             double minElDeg = 0.0,
+                                             int bridgeSec = 0) const;
+
+private:
+    float          m_limit[BINS];
+    QVector<float> m_recorded;   // per bin, NaN until a sample arrives
+};
@@ -1,5 +1,6 @@
 #include "HorizonsManager.h"
 #include "bluetoothmanager.h"
+#include "AstroMath.h"
 #include <QUrlQuery>
 #include <QNetworkRequest>
 #include <QDebug>
@@ -7,41 +8,192 @@
 #include <QStandardPaths>
 #include <QFile>
 #include <QTextStream>
-#include <QVector3D>
 #include <QtMath>
+#include <QtNumeric>
 #include <QLocale>
 #include <QList>
-#include <QThread>
 #include <QTimer>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QSslCertificate>
+#include <QSslSocket>
+#include <QFuture>
+#include <QtConcurrent/QtConcurrentRun>
+#include "StartupProfiler.h"
+
+namespace {
+// CA bundle being parsed by loadCaCertificates
+QFuture<QList<QSslCertificate>> g_caCerts;
+bool g_caApplied = false;
+
+// Waits for the bundle (normally parsed long before) and makes it the default
+void applyCaCertificates()
+{
+    if (g_caApplied || !g_caCerts.isStarted()) return;
+    g_caApplied = true;
+    const QList<QSslCertificate> certs = g_caCerts.result();
+    StartupProfiler::mark("CA bundle applied");
+    if (certs.isEmpty()) {
+        qWarning() << "Failed to load the CA bundle";
+        return;
+    }
+    QSslConfiguration cfg = QSslConfiguration::defaultConfiguration();
+    cfg.setCaCertificates(certs);
+    QSslConfiguration::setDefaultConfiguration(cfg);
+    qDebug() << "CA certificates loaded:" << certs.size()
+             << "TLS library:" << QSslSocket::sslLibraryVersionString();
+}
+} // namespace
 
 
 HorizonsManager::HorizonsManager(QObject *parent)
     : QObject(parent),
-    m_liveTimer(nullptr),
-    m_stepIdx(nullptr)
+    m_baseUrl(defaultBaseUrl())
 {
     connect(&m_manager, &QNetworkAccessManager::finished,
             this, &HorizonsManager::onNetworkFinished);
+    connect(&m_manager, &QNetworkAccessManager::encrypted,
+            this, &HorizonsManager::onEncrypted);
+}
+
+void HorizonsManager::loadCaCertificates(const QString &path)
+{
+    g_caCerts = QtConcurrent::run([path]() { return QSslCertificate::fromPath(path, QSsl::Pem); });
+}
+
+QString HorizonsManager::sessionTicketPath() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+           + "/tls/" + m_baseUrl.host() + ".ticket";
+}
+
+QSslConfiguration HorizonsManager::tlsConfiguration()
+{
+    if (m_tlsReady) return m_tls;
+    m_tlsReady = true;
+    applyCaCertificates();
+    m_tls = QSslConfiguration::defaultConfiguration();
+    // Keep the session so later connections (and the next run) can resume it
+    m_tls.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+    m_tls.setAllowedNextProtocols({ QSslConfiguration::ALPNProtocolHTTP2,
+                                    QSslConfiguration::NextProtocolHttp1_1 });
+    QFile f(sessionTicketPath());
+    if (f.open(QIODevice::ReadOnly)) {
+        m_sessionTicket = f.readAll();
+        m_tls.setSessionTicket(m_sessionTicket);
+    }
+    return m_tls;
+}
+
+QNetworkRequest HorizonsManager::makeRequest(const QUrl &url)
+{
+    // One manager for all requests: the TLS connection is kept alive and,
+    // over HTTP/2, parallel requests are multiplexed on it. Accept-Encoding
+    // (gzip/deflate) is added and decoded by QNetworkAccessManager itself.
+    QNetworkRequest req(url);
+    req.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+    if (url.scheme() == "https")
+        req.setSslConfiguration(tlsConfiguration());
+    if (!m_firstReplySeen)
+        StartupProfiler::mark("first Horizons request");
+    return req;
+}
+
+void HorizonsManager::prewarm()
+{
+    const QString host = m_baseUrl.host();
+    if (host.isEmpty()) return;
+    QElapsedTimer t;
+    t.start();
+    if (m_baseUrl.scheme() == "https")
+        m_manager.connectToHostEncrypted(host, quint16(m_baseUrl.port(443)), tlsConfiguration());
+    else
+        m_manager.connectToHost(host, quint16(m_baseUrl.port(80)));
+    qDebug() << "Horizons connection pre-warm to" << host
+             << (m_sessionTicket.isEmpty() ? "(full handshake)" : "(session ticket offered)")
+             << t.elapsed() << "ms to queue";
+}
+
+void HorizonsManager::onEncrypted(QNetworkReply *reply)
+{
+    StartupProfiler::mark("Horizons TLS ready");
+    storeSessionTicket(reply);
+}
+
+void HorizonsManager::storeSessionTicket(QNetworkReply *reply)
+{
+    // Tickets may arrive after the handshake (TLS 1.3): the newest is kept for the next run
+    const QByteArray ticket = reply->sslConfiguration().sessionTicket();
+    if (ticket.isEmpty() || ticket == m_sessionTicket) return;
+    m_sessionTicket = ticket;
+    m_tls.setSessionTicket(ticket);
+    QDir().mkpath(QFileInfo(sessionTicketPath()).path());
+    QSaveFile f(sessionTicketPath());
+    if (f.open(QIODevice::WriteOnly)) {
+        f.write(ticket);
+        f.commit();
+    }
 }
 
-void HorizonsManager::fetchEphemeris(const QString &objectId,
-                                     const QGeoCoordinate &m_currentCenter,
-                                     const QDateTime &start,
-                                     const QDateTime &end,
-                                     int stepSec)
+QUrl HorizonsManager::defaultBaseUrl()
 {
-    m_stepSec = stepSec;
-    m_center = m_currentCenter;
-    double alt_km = m_center.altitude() / 1000.0;
-    QUrl url("https://ssd.jpl.nasa.gov/api/horizons.api");
+    const QByteArray env = qgetenv("HORIZONS_BASE_URL");
+    if (!env.isEmpty()) return QUrl(QString::fromUtf8(env));
+    return QUrl("https://ssd.jpl.nasa.gov/api/horizons.api");
+}
+
+QString HorizonsManager::requestKey(const QString &objectId,
+                                    const QGeoCoordinate &center,
+                                    const QDateTime &start,
+                                    const QDateTime &end,
+                                    int stepSec)
+{
+    return QString("%1|%2|%3|%4|%5|%6|%7")
+        .arg(objectId)
+        .arg(center.latitude(),  0, 'f', 6)
+        .arg(center.longitude(), 0, 'f', 6)
+        .arg(qIsNaN(center.altitude()) ? 0.0 : center.altitude(), 0, 'f', 0)
+        .arg(start.toUTC().toString(Qt::ISODate))
+        .arg(end.toUTC().toString(Qt::ISODate))
+        .arg(stepSec);
+}
+
+int HorizonsManager::fetchEphemeris(const QString &objectId,
+                                    const QGeoCoordinate &m_currentCenter,
+                                    const QDateTime &start,
+                                    const QDateTime &end,
+                                    int stepSec,
+                                    bool debugDump)
+{
+    // Same query already on the wire: share its reply
+    const QString key = requestKey(objectId, m_currentCenter, start, end, stepSec);
+    auto inflight = m_inflightByKey.constFind(key);
+    if (inflight != m_inflightByKey.constEnd()) {
+        qDebug() << "Horizons request coalesced:" << objectId << "id" << inflight.value();
+        // A user fetch riding on a prefetch still gets its dumps
+        if (debugDump) m_requests[inflight.value()].debugDump = true;
+        return inflight.value();
+    }
+
+    Request r;
+    r.id       = m_nextRequestId++;
+    r.objectId = objectId;
+    r.key      = key;
+    r.center   = m_currentCenter;
+    r.stepSec  = stepSec;
+    r.debugDump = debugDump;
+
+    double alt_km = qIsNaN(r.center.altitude()) ? 0.0 : r.center.altitude() / 1000.0;
+    QUrl url(m_baseUrl);
     QUrlQuery q;
     q.addQueryItem("format",     "text");
     q.addQueryItem("COMMAND",    QString("'%1'").arg(objectId));
     q.addQueryItem("CENTER",     "'coord@399'");
     q.addQueryItem("COORD_TYPE", "'GEODETIC'");
     q.addQueryItem("SITE_COORD", QString("'%1,%2,%3'")
-                                     .arg(m_center.longitude(), 0, 'f', 6)
-                                     .arg(m_center.latitude(),  0, 'f', 6)
+                                     .arg(r.center.longitude(), 0, 'f', 6)
+                                     .arg(r.center.latitude(),  0, 'f', 6)
                                      .arg(alt_km,              0, 'f', 6));
     q.addQueryItem("START_TIME",
                    QString("'%1'").arg(start.toUTC().toString("yyyy-MMM-dd HH:mm")));
@@ -55,35 +207,197 @@ void HorizonsManager::fetchEphemeris(const QString &objectId,
     q.addQueryItem("QUANTITIES","'2'");
     url.setQuery(q);
     qDebug() << "Horizons query URL:" << url.toString();
-    m_manager.get(QNetworkRequest(url));
+
+    QNetworkReply *reply = m_manager.get(makeRequest(url));
+    r.timer.start();
+
+    m_requests.insert(r.id, r);
+    m_inflightByKey.insert(key, r.id);
+    m_replyIds.insert(reply, r.id);
+    return r.id;
+}
+
+QVector<int> HorizonsManager::fetchEphemerides(const QStringList &objectIds,
+                                               const QGeoCoordinate &center,
+                                               const QDateTime &start,
+                                               const QDateTime &end,
+                                               int stepSec,
+                                               bool debugDump)
+{
+    // All requests leave at once, results arrive independently
+    QVector<int> ids;
+    ids.reserve(objectIds.size());
+    for (const QString &id : objectIds)
+        ids.append(fetchEphemeris(id, center, start, end, stepSec, debugDump));
+    return ids;
+}
+
+QString HorizonsManager::smallBodyCommand(const QString &designation)
+{
+    static const QRegularExpression comet("^([CPDXI]/|\\d+[PDI](/|$))");
+    static const QRegularExpression provisional("^\\d{4} [A-Z]{2}\\d*$");
+    const QString d = designation.trimmed();
+    // Current apparition of a comet, main nucleus only
+    if (comet.match(d).hasMatch())       return QString("DES=%1;CAP;NOFRAG").arg(d);
+    if (provisional.match(d).hasMatch()) return QString("DES=%1;").arg(d);
+    // Number or name; the trailing ';' restricts the lookup to small bodies
+    return d + ";";
+}
+
+int HorizonsManager::fetchElements(const QString &designation)
+{
+    const QDateTime start = QDateTime::currentDateTimeUtc();
+    const QString key = "elements|" + designation.trimmed();
+    auto inflight = m_inflightByKey.constFind(key);
+    if (inflight != m_inflightByKey.constEnd())
+        return inflight.value();
+
+    Request r;
+    r.id       = m_nextRequestId++;
+    r.objectId = designation.trimmed();
+    r.key      = key;
+    r.elements = true;
+
+    QUrl url(m_baseUrl);
+    QUrlQuery q;
+    q.addQueryItem("format",     "text");
+    q.addQueryItem("COMMAND",    QString("'%1'").arg(smallBodyCommand(r.objectId)));
+    q.addQueryItem("EPHEM_TYPE", "'ELEMENTS'");
+    q.addQueryItem("CENTER",     "'500@10'");
+    q.addQueryItem("REF_PLANE",  "'ECLIPTIC'");
+    q.addQueryItem("REF_SYSTEM", "'J2000'");
+    q.addQueryItem("OUT_UNITS",  "'AU-D'");
+    q.addQueryItem("TP_TYPE",    "'ABSOLUTE'");
+    q.addQueryItem("START_TIME",
+                   QString("'%1'").arg(start.toString("yyyy-MMM-dd")));
+    q.addQueryItem("STOP_TIME",
+                   QString("'%1'").arg(start.addDays(1).toString("yyyy-MMM-dd")));
+    q.addQueryItem("STEP_SIZE",  "'1 d'");
+    q.addQueryItem("CSV_FORMAT", "YES");
+    q.addQueryItem("OBJ_DATA",   "NO");
+    url.setQuery(q);
+    qDebug() << "Horizons elements URL:" << url.toString();
+
+    QNetworkReply *reply = m_manager.get(makeRequest(url));
+    r.timer.start();
+
+    m_requests.insert(r.id, r);
+    m_inflightByKey.insert(key, r.id);
+    m_replyIds.insert(reply, r.id);
+    return r.id;
+}
+
+void HorizonsManager::finishElements(const Request &r, const QString &raw)
+{
+    OrbitalElements el;
+    if (!OrbitalElements::parseHorizons(raw, r.objectId, el)) {
+        // Unknown or ambiguous designations come back as a text body with HTTP 200
+        emit ephemerisError(r.id, r.objectId, "No orbital elements in the Horizons reply");
+        return;
+    }
+    if (!SmallBodyOrbit::saveHorizons(el, raw))
+        qDebug() << "Could not store elements of" << el.designation;
+    qDebug().noquote() << QString("Horizons elements %1 id %2: %3, q %4 AU, e %5, network %6 ms")
+                              .arg(r.objectId).arg(r.id).arg(el.name)
+                              .arg(el.q, 0, 'f', 6).arg(el.e, 0, 'f', 6).arg(r.timer.elapsed());
+    emit elementsReady(r.id, el);
+}
+
+QVector<EphemPoint> HorizonsManager::propagateTrajectory(const OrbitalElements &el,
+                                                         const QGeoCoordinate &center,
+                                                         const QDateTime &start,
+                                                         const QDateTime &end,
+                                                         int stepSec) const
+{
+    // Same 1-minute node spacing as a Horizons reply, then the same chain
+    QElapsedTimer stage;
+    stage.start();
+    const QVector<EphemRD> nodes = SmallBodyOrbit(el).ephemeris(center, start, end, 60);
+    const qint64 propagateUs = stage.nsecsElapsed() / 1000;
+    stage.restart();
+    const QVector<EphemPoint> topo = radecToAltAz(nodes, center.latitude(), center.longitude());
+    const QVector<EphemPoint> traj = interpolateTrajectory(topo, stepSec);
+    qDebug().noquote() << QString("Propagated %1: %2 nodes in %3 us, Alt/Az + interpolate %4 us (%5 points)")
+                              .arg(el.designation).arg(nodes.size()).arg(propagateUs)
+                              .arg(stage.nsecsElapsed() / 1000).arg(traj.size());
+    return traj;
 }
 
 void HorizonsManager::onNetworkFinished(QNetworkReply *reply)
 {
+    reply->deleteLater();
+    const int id = m_replyIds.take(reply);
+    if (!m_requests.contains(id)) return;   // cancelled
+    const Request r = m_requests.take(id);
+    m_inflightByKey.remove(r.key);
+
     if (reply->error() != QNetworkReply::NoError) {
-        emit ephemerisError(reply->errorString());
-        reply->deleteLater();
+        emit ephemerisError(r.id, r.objectId, reply->errorString());
+        return;
+    }
+    const qint64 networkMs = r.timer.elapsed();
+    storeSessionTicket(reply);
+    if (!m_firstReplySeen) {
+        // Launch to first usable reply closes the startup profile
+        m_firstReplySeen = true;
+        StartupProfiler::mark("first Horizons reply");
+        StartupProfiler::report();
+    }
+    const QByteArray body = reply->readAll();
+    QString raw = QString::fromUtf8(body);
+    if (r.elements) {
+        finishElements(r, raw);
+        return;
+    }
+    if (r.debugDump) dumpRawCsv(r.objectId, raw);
+    if (raw.contains("$$SOE") && !raw.contains("$$EOE")) {
+        // Cut-off body: the last row may be partial, do not plan from it
+        emit ephemerisError(r.id, r.objectId, "Truncated Horizons reply");
         return;
     }
-    QString raw = QString::fromUtf8(reply->readAll());
-    reply->deleteLater();
-    dumpRawCsv(raw);
 
     // 1) parse RA/DEC
+    QElapsedTimer stage;
+    stage.start();
     QVector<EphemRD> rawPts = parseHorizonsText(raw);
-    dumpParsedCsv(rawPts);
+    const qint64 parseUs = stage.nsecsElapsed() / 1000;
+    if (r.debugDump) dumpParsedCsv(r.objectId, rawPts);
 
     // 2) RA/DEC -> topocentric Az/El
+    stage.restart();
     QVector<EphemPoint> topo = radecToAltAz(rawPts,
-                                            m_center.latitude(),
-                                            m_center.longitude());
-    dumpTopoCsv(topo);
+                                            r.center.latitude(),
+                                            r.center.longitude());
+    const qint64 convertUs = stage.nsecsElapsed() / 1000;
+    if (r.debugDump) dumpTopoCsv(r.objectId, topo);
+
+    // 3) Interpolation r.stepSec
+    stage.restart();
+    QVector<EphemPoint> traj = interpolateTrajectory(topo, r.stepSec);
+    const qint64 interpUs = stage.nsecsElapsed() / 1000;
+    if (r.debugDump) dumpDebugCsv(r.objectId, traj);
+
+    // Stage timings, comparable between live and stand-in runs
+    qDebug().noquote() << QString("Horizons %1 id %2: %3 B, network %4 ms, parse %5 us (%6 rows), "
+                                  "Alt/Az %7 us, interpolate %8 us (%9 points)")
+                              .arg(r.objectId).arg(r.id).arg(body.size()).arg(networkMs)
+                              .arg(parseUs).arg(rawPts.size()).arg(convertUs)
+                              .arg(interpUs).arg(traj.size());
+    if (rawPts.isEmpty()) {
+        // Horizons reports bad queries in the text body with HTTP 200
+        emit ephemerisError(r.id, r.objectId, "No ephemeris rows in the Horizons reply");
+        return;
+    }
 
-    // 3) Interpolation m_stepSec
-    m_fullTraj = interpolateTrajectory(topo);
-    dumpDebugCsv(m_fullTraj);
+    m_trajectories.insert(r.objectId, traj);
+    emit ephemerisReady(r.id, r.objectId, traj);
+}
 
-    emit ephemerisReady(m_fullTraj);
+void HorizonsManager::cancelAll()
+{
+    // Replies still finish, but their results are dropped
+    m_requests.clear();
+    m_inflightByKey.clear();
 }
 
 QVector<EphemRD> HorizonsManager::parseHorizonsText(const QString &txt) const {
@@ -113,25 +427,11 @@ QVector<EphemRD> HorizonsManager::parseHorizonsText(const QString &txt) const {
 }
 
 double HorizonsManager::julianDay(const QDateTime &dtUtc) const {
-    int Y=dtUtc.date().year(), M=dtUtc.date().month();
-    if(M<=2){ Y--; M+=12; }
-    int D=dtUtc.date().day();
-    double frac = (dtUtc.time().hour()
-                   +dtUtc.time().minute()/60.0
-                   +dtUtc.time().second()/3600.0)/24.0;
-    int A=Y/100, B=2-A+A/4;
-    return qFloor(365.25*(Y+4716)) + qFloor(30.6001*(M+1))
-           + D + B - 1524.5 + frac;
+    return AstroMath::julianDay(dtUtc);
 }
 
 double HorizonsManager::gmstDeg(const QDateTime &dtUtc) const {
-    double JD=julianDay(dtUtc), T=(JD-2451545.0)/36525.0;
-    double gmst=280.46061837
-                  +360.98564736629*(JD-2451545.0)
-                  +0.000387933*T*T
-                  -T*T*T/38710000.0;
-    gmst=fmod(gmst,360.0); if(gmst<0) gmst+=360.0;
-    return gmst;
+    return AstroMath::gmstDeg(AstroMath::julianDay(dtUtc));
 }
 
 QVector<EphemPoint> HorizonsManager::radecToAltAz(
@@ -163,55 +463,48 @@ QVector<EphemPoint> HorizonsManager::radecToAltAz(
 }
 
 QVector<EphemPoint> HorizonsManager::interpolateTrajectory(
-    const QVector<EphemPoint> &in) const
+    const QVector<EphemPoint> &in, int stepSec) const
 {
     QVector<EphemPoint> out;
-    if(in.size()<2) return out;
-    auto toVec=[&](double az,double el){
-        double a=qDegreesToRadians(az), e=qDegreesToRadians(el);
-        return QVector3D(qCos(e)*qCos(a), qCos(e)*qSin(a), qSin(e));
-    };
-    auto toAzEl=[&](const QVector3D &v){
-        double r=v.length();
-        double el=qRadiansToDegrees(qAsin(v.z()/r));
-        double az=qRadiansToDegrees(qAtan2(v.y(),v.x()));
-        return qMakePair(az,el);
-    };
+    if(in.size()<2 || stepSec<=0) return out;
+
+    // Sample counts first, so the az/el buffers and the output are allocated once
+    QVector<int> steps(in.size()-1);
+    int total=0;
     for(int i=0;i+1<in.size();++i){
-        const auto &p0=in[i], &p1=in[i+1];
-        int delta=p0.utc.secsTo(p1.utc);
-        int steps=delta/m_stepSec;
-        QVector3D v0=toVec(p0.az,p0.el), v1=toVec(p1.az,p1.el);
-        double dot=QVector3D::dotProduct(v0,v1);
-        dot=qBound(-1.0,dot,1.0);
-        double omega=qAcos(dot);
-        for(int s=0;s<steps;++s){
-            double t=(double)s/steps;
-            QVector3D vs = qFuzzyIsNull(omega)? v0
-                                               : (v0*qSin((1-t)*omega) + v1*qSin(t*omega)) / qSin(omega);
-            auto pr=toAzEl(vs);
-            out.append({p0.utc.addSecs(s*m_stepSec), pr.first, pr.second});
-        }
+        steps[i]=qMax(0, int(in[i].utc.secsTo(in[i+1].utc)/stepSec));
+        total+=steps[i];
+    }
+    QVector<double> az(total), el(total);
+    for(int i=0, k=0;i+1<in.size();k+=steps[i], ++i)
+        AstroMath::slerpAzEl(in[i].az, in[i].el, in[i+1].az, in[i+1].el,
+                             steps[i], az.data()+k, el.data()+k);
+
+    out.reserve(total+1);
+    for(int i=0, k=0;i+1<in.size();++i){
+        const QDateTime &t0=in[i].utc;
+        for(int s=0;s<steps[i];++s, ++k)
+            out.append({t0.addSecs(qint64(s)*stepSec), az[k], el[k]});
     }
     out.append(in.last());
     return out;
 }
 
 // Debug dumps
-void HorizonsManager::dumpRawCsv(const QString &raw) const{
+void HorizonsManager::dumpRawCsv(const QString &objectId, const QString &raw) const{
     QString loc=QStandardPaths::writableLocation(QStandardPaths::DesktopLocation);
     if(loc.isEmpty()) loc=QStandardPaths::writableLocation(QStandardPaths::TempLocation);
-    QString path=loc+QDir::separator()+"horizons_raw.txt";
+    QString path=loc+QDir::separator()+"horizons_raw_"+objectId+".txt";
     QFile f(path);
     if(f.open(QIODevice::WriteOnly|QIODevice::Truncate)){
         f.write(raw.toUtf8()); f.close();
         qDebug()<<"Raw saved to"<<path;
     }
 }
-void HorizonsManager::dumpParsedCsv(const QVector<EphemRD> &parsed) const{
+void HorizonsManager::dumpParsedCsv(const QString &objectId, const QVector<EphemRD> &parsed) const{
     QString loc=QStandardPaths::writableLocation(QStandardPaths::DesktopLocation);
     if(loc.isEmpty()) loc=QStandardPaths::writableLocation(QStandardPaths::TempLocation);
-    QString path=loc+QDir::separator()+"horizons_parsed.csv";
+    QString path=loc+QDir::separator()+"horizons_parsed_"+objectId+".csv";
     QFile f(path);
     if(f.open(QIODevice::WriteOnly|QIODevice::Truncate)){
         QTextStream out(&f);
@@ -222,10 +515,10 @@ void HorizonsManager::dumpParsedCsv(const QVector<EphemRD> &parsed) const{
         f.close(); qDebug()<<"Parsed CSV saved to"<<path;
     }
 }
-void HorizonsManager::dumpTopoCsv(const QVector<EphemPoint> &topo) const{
+void HorizonsManager::dumpTopoCsv(const QString &objectId, const QVector<EphemPoint> &topo) const{
     QString loc=QStandardPaths::writableLocation(QStandardPaths::DesktopLocation);
     if(loc.isEmpty()) loc=QStandardPaths::writableLocation(QStandardPaths::TempLocation);
-    QString path=loc+QDir::separator()+"horizons_topo.csv";
+    QString path=loc+QDir::separator()+"horizons_topo_"+objectId+".csv";
     QFile f(path);
     if(f.open(QIODevice::WriteOnly|QIODevice::Truncate)){
         QTextStream out(&f);
@@ -236,11 +529,11 @@ void HorizonsManager::dumpTopoCsv(const QVector<EphemPoint> &topo) const{
         f.close(); qDebug()<<"Topo CSV saved to"<<path;
     }
 }
-void HorizonsManager::dumpDebugCsv(const QList<EphemPoint> &traj) const
+void HorizonsManager::dumpDebugCsv(const QString &objectId, const QList<EphemPoint> &traj) const
 {
     QString loc = QStandardPaths::writableLocation(QStandardPaths::DesktopLocation);
     if (loc.isEmpty()) loc = QStandardPaths::writableLocation(QStandardPaths::TempLocation);
-    QString path = loc + QDir::separator() + "horizons_debug.csv";
+    QString path = loc + QDir::separator() + "horizons_debug_" + objectId + ".csv";
     QFile f(path);
     if (f.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
         QTextStream out(&f);
@@ -269,26 +562,32 @@ void HorizonsManager::dumpStepsCsv(const QVector<StepRecord> &steps) const {
     qDebug()<<"Steps CSV saved to"<<path;
 }
 
-void HorizonsManager::sendTrajectorySteps(BluetoothManager *bt,
-                                          double degPerStepPan,
-                                          double degPerStepTilt)
+QVector<StepRecord> HorizonsManager::buildStepPlan(PanWrapPlanner &panPlanner,
+                                                   const QVector<EphemPoint> &traj,
+                                                   double degPerStepPan,
+                                                   double degPerStepTilt)
 {
-    if (!bt || m_fullTraj.isEmpty()) return;
-
     QVector<StepRecord> buf;
-    buf.reserve(m_fullTraj.size());
+    if (traj.isEmpty()) return buf;
+    buf.reserve(traj.size());
 
     const double panStartAz  = 180.0;
     const double tiltStartEl =  45.0;
-    int executedPan  = 0;
+    // Pan starts wherever the previous session left it, not necessarily at home
+    int executedPan  = qRound((panPlanner.currentDeg() - panStartAz) * degPerStepPan);
     int executedTilt = 0;
 
-    for (int i = 0; i < m_fullTraj.size(); ++i) {
-        const auto &p = m_fullTraj[i];
-        uint32_t offset_ms = uint32_t(i * m_stepSec * 1000);
+    // Absolute pan angles on one unwrap branch for the whole session
+    const PanPlan panPlan = panPlanner.plan(traj);
+    if (!panPlan.reversals.isEmpty())
+        qDebug() << "Pan unwinds scheduled at samples" << panPlan.reversals;
 
-        double rawDeltaPan = p.az - panStartAz;
-        double deltaPan    = fmod(rawDeltaPan + 540.0, 360.0) - 180.0;
+    const QDateTime trajStart = traj.first().utc;
+    for (int i = 0; i < traj.size(); ++i) {
+        const auto &p = traj[i];
+        uint32_t offset_ms = uint32_t(trajStart.msecsTo(p.utc));
+
+        double deltaPan    = panPlan.panAbsDeg[i] - panStartAz;
         int desiredPan     = qRound(deltaPan * degPerStepPan);
 
         double deltaTilt   = p.el - tiltStartEl;
@@ -302,76 +601,99 @@ void HorizonsManager::sendTrajectorySteps(BluetoothManager *bt,
         buf.append({ offset_ms, stepPan, stepTilt });
     }
 
-    if (buf.isEmpty()) return;
-
-    // T0 = now rounded to full minute + 2 minutes (seconds = 0)
-    QDateTime tNow = QDateTime::currentDateTime();
-    int secs = tNow.time().second();
-    QDateTime t0 = tNow.addSecs(120 - secs);
-    t0.setTime(QTime(t0.time().hour(), t0.time().minute(), 0));
-    QDateTime baseTime = t0.addSecs(-30);  // wykonanie PREP 30s wcześniej
-
-    const StepRecord &prep = buf.first();
-
-    // 1. Send PREP command
-    bt->sendCommand("PREP\n");
-    QThread::msleep(200);
-
-    // 2. Send initial STEP deltaPan deltaTilt
-    QString stepCmd = QString("STEP %1 %2\n")
-                          .arg(prep.deltaPan)
-                          .arg(prep.deltaTilt);
-    bt->sendCommand(stepCmd.toUtf8());
-
-    // 3. Set up a timer for real-time tracking
-    m_liveTimer = new QTimer(bt);
-    m_stepIdx = new int(1);  // start from 1, because 0 was already sent as STEP
-
-    m_liveTimer->setInterval(100);
-    m_liveTimer->start();
-
-    QObject::connect(m_liveTimer, &QTimer::timeout, bt, [=]() mutable {
-        if (*m_stepIdx >= buf.size()) {
-            m_liveTimer->stop();
-            m_liveTimer->deleteLater();
-            delete m_stepIdx;
-            qDebug() << "Trajectory completed.";
-            return;
-        }
+    panPlanner.commit(panPlan);
+    return buf;
+}
 
-        const StepRecord &r = buf[*m_stepIdx];
-        QDateTime execTime = baseTime.addMSecs(r.offset_ms);
-        QDateTime now = QDateTime::currentDateTime();
-
-        if (now >= execTime) {
-            if (r.deltaPan != 0) {
-                if (r.deltaPan > 0) bt->sendCommand(QByteArray("FRIGHT\n"));
-                else                bt->sendCommand(QByteArray("FLEFT\n"));
-
-                QTimer::singleShot(100, bt, [=]() {
-                    if (r.deltaTilt > 0) bt->sendCommand(QByteArray("FUP\n"));
-                    else if (r.deltaTilt < 0) bt->sendCommand(QByteArray("FDOWN\n"));
-                });
-            } else {
-                if (r.deltaTilt > 0) bt->sendCommand(QByteArray("FUP\n"));
-                else if (r.deltaTilt < 0) bt->sendCommand(QByteArray("FDOWN\n"));
-            }
-
-            (*m_stepIdx)++;
-        }
-    });
+QDateTime HorizonsManager::stepSessionBaseTime(const QVector<EphemPoint> &traj)
+{
+    // buildStepPlan measures offsets from the first sample
+    return traj.isEmpty() ? QDateTime() : traj.first().utc.toUTC();
+}
+
+void HorizonsManager::uploadTrajectory(BluetoothManager *bt,
+                                       const QVector<EphemPoint> &traj,
+                                       const QString &name,
+                                       bool plannedPan)
+{
+    if (!bt || traj.isEmpty()) return;
+    bt->sendCommand(trajectoryPayload(traj, name, plannedPan));
+    qDebug() << "Uploaded plan" << name << "points:" << traj.size();
 }
-void HorizonsManager::stopLiveTracking() {
-    if (m_liveTimer) {
-        m_liveTimer->stop();
-        m_liveTimer->deleteLater();
-        m_liveTimer = nullptr;
-    }
 
-    if (m_stepIdx) {
-        delete m_stepIdx;
-        m_stepIdx = nullptr;
+QByteArray HorizonsManager::trajectoryPayload(const QVector<EphemPoint> &traj, const QString &name,
+                                              bool plannedPan)
+{
+    QByteArray payload;
+    if (traj.isEmpty()) return payload;
+
+    // TRAJ <name> <T0 unix s> <nPts> [PAN], one "<t_ms> <az> <el>" line per point, TRAJ_END.
+    // The device plays point i at T0 * 1000 + t_ms: offsets count from the
+    // whole second sent, not from the first sample's milliseconds
+    const QDateTime t0 = QDateTime::fromSecsSinceEpoch(traj.first().utc.toSecsSinceEpoch(), Qt::UTC);
+    payload.reserve(traj.size() * 24 + 64);
+    payload += QString("TRAJ %1 %2 %3%4\n")
+                   .arg(name)
+                   .arg(t0.toSecsSinceEpoch())
+                   .arg(traj.size())
+                   .arg(plannedPan ? " PAN" : "").toUtf8();
+    for (const auto &p : traj) {
+        payload += QByteArray::number(t0.msecsTo(p.utc)) + ' '
+                 + QByteArray::number(p.az, 'f', 4) + ' '
+                 + QByteArray::number(p.el, 'f', 4) + '\n';
     }
+    payload += "TRAJ_END\n";
+    return payload;
+}
+
+void HorizonsManager::spliceOnDevice(BluetoothManager *bt,
+                                     const QVector<EphemPoint> &traj,
+                                     const QString &name,
+                                     const QDateTime &spliceAt,
+                                     bool plannedPan)
+{
+    if (!bt || traj.isEmpty()) return;
+    uploadTrajectory(bt, traj, name, plannedPan);
+    // Queued behind TRAJ_END; SPLICE_ARMED now, SPLICED when it takes over
+    bt->sendCommand(QString("SPLICE %1 %2\n").arg(name).arg(spliceAt.toMSecsSinceEpoch()).toUtf8());
+}
+
+void HorizonsManager::sendPathOffset(BluetoothManager *bt, double dAzDeg, double dElDeg, int blendMs)
+{
+    if (!bt) return;
+    bt->sendCommand(QString("OFFSET %1 %2 %3\n")
+                        .arg(dAzDeg, 0, 'f', 4)
+                        .arg(dElDeg, 0, 'f', 4)
+                        .arg(blendMs).toUtf8());
+}
+
+QString HorizonsManager::versionedPlanName(const QString &base, int version)
+{
+    const QString suffix = QString("-v%1").arg(version);
+    return base.left(20 - suffix.size()) + suffix;
+}
 
-    qDebug() << "Tracking stopped.";
+void HorizonsManager::startSiderealTracking(BluetoothManager *bt,
+                                            double raDeg,
+                                            double decDeg,
+                                            const QGeoCoordinate &center)
+{
+    if (!bt) return;
+    // Catalogue J2000 to the equator and equinox of date: a third of a degree
+    // by now, far more than the firmware's pointing error
+    double P[3][3], v[3], d[3];
+    AstroMath::precessionMatrix(AstroMath::julianDay(QDateTime::currentDateTimeUtc()), P);
+    AstroMath::unitVector(raDeg, decDeg, v);
+    for (int r = 0; r < 3; ++r)
+        d[r] = P[r][0] * v[0] + P[r][1] * v[1] + P[r][2] * v[2];
+    double raDate = qRadiansToDegrees(qAtan2(d[1], d[0]));
+    if (raDate < 0) raDate += 360.0;
+    const double decDate = qRadiansToDegrees(qAsin(qBound(-1.0, d[2], 1.0)));
+
+    // Clock is synced on connect (SYNC_TIME), the ESP needs nothing else
+    bt->sendCommand(QString("RADEC %1 %2 %3 %4\n")
+                        .arg(raDate,              0, 'f', 5)
+                        .arg(decDate,             0, 'f', 5)
+                        .arg(center.latitude(),  0, 'f', 6)
+                        .arg(center.longitude(), 0, 'f', 6).toUtf8());
 }
@@ -8,27 +8,14 @@
 #include <QNetworkReply>
 #include "bluetoothmanager.h"
 #include <QTimer>
-
-// Ephemeris point: UTC time and azimuth/elevation
-struct EphemPoint {
-    QDateTime utc;
-    double az;   // degrees: azimuth
-    double el;   // degrees: elevation
-};
-
-// Temporary structure for parsing RA/Dec from Horizons
-struct EphemRD {
-    QDateTime utc;
-    double    raDeg;  // degrees
-    double    decDeg; // degrees
-};
-
-// Single motor step record to send to ESP
-struct StepRecord {
-    uint32_t offset_ms;
-    int16_t  deltaPan;
-    int16_t  deltaTilt;
-};
+#include <QHash>
+#include <QStringList>
+#include <QUrl>
+#include <QElapsedTimer>
+#include <QSslConfiguration>
+#include "EphemerisTypes.h"
+#include "PanWrapPlanner.h"
+#include "SmallBodyOrbit.h"
 
 class HorizonsManager : public QObject {
     Q_OBJECT
@@ -36,39 +23,188 @@ public:
     explicit HorizonsManager(QObject *parent = nullptr);
 
     /**
-     * Downloads observer-based ephemeris data from JPL Horizons
+     * Endpoint queried by fetchEphemeris; a local stand-in
+     * (src/tools/horizons_standin.py) can replace the JPL API for offline
+     * runs and benchmarks
+     */
+    void setBaseUrl(const QUrl &url) { m_baseUrl = url; }
+    QUrl baseUrl() const { return m_baseUrl; }
+    // JPL API, or $HORIZONS_BASE_URL when set
+    static QUrl defaultBaseUrl();
+
+    /**
+     * Parses a CA bundle (e.g. ":/certs/cacert.pem") on a worker thread;
+     * it is made the default TLS configuration before the first HTTPS use,
+     * so startup does not wait for it
+     */
+    static void loadCaCertificates(const QString &path);
+
+    /**
+     * Opens the connection to the Horizons host in the background (DNS,
+     * TCP, TLS handshake), so the first fetch does not pay for it. The
+     * TLS session ticket of the previous run is offered, letting the
+     * server resume the session with an abbreviated handshake
+     */
+    void prewarm();
+
+    /**
+     * Downloads observer-based ephemeris data from JPL Horizons. Requests run
+     * in parallel; an identical request still in flight is not sent again,
+     * its ID is returned instead
      * @param objectId  Horizons object ID (e.g. "301")
      * @param center    observer location (latitude, longitude)
      * @param start     local time range start
      * @param end       local time range end
      * @param stepSec   interpolation time step in seconds
+     * @param debugDump write the debug CSVs (raw, parsed, topo, interpolated)
+     *                  for this reply; off for background fetches
+     * @return request ID reported by ephemerisReady / ephemerisError
      */
-    void fetchEphemeris(const QString &objectId,
-                        const QGeoCoordinate &center,
-                        const QDateTime &start,
-                        const QDateTime &end,
-                        int stepSec);
+    int fetchEphemeris(const QString &objectId,
+                       const QGeoCoordinate &center,
+                       const QDateTime &start,
+                       const QDateTime &end,
+                       int stepSec,
+                       bool debugDump = true);
 
     /**
-     * Sends a trajectory of motor steps to the ESP, based on latest ephemeris
-     * @param bt            pointer to BluetoothManager
-     * @param degPerStepPan degrees per step for pan axis
-     * @param degPerStepTilt degrees per step for tilt axis
+     * Fetches several targets at once (e.g. a night's target list); total
+     * latency is about one round trip instead of one per object
+     * @return request IDs in the order of objectIds
      */
-    void sendTrajectorySteps(BluetoothManager *bt,
-                             double degPerStepPan,
-                             double degPerStepTilt);
-    void stopLiveTracking();
+    QVector<int> fetchEphemerides(const QStringList &objectIds,
+                                  const QGeoCoordinate &center,
+                                  const QDateTime &start,
+                                  const QDateTime &end,
+                                  int stepSec,
+                                  bool debugDump = true);
+
+    /**
+     * Fetches current osculating elements of a comet or asteroid (heliocentric,
+     * ecliptic J2000) instead of a sampled ephemeris; one small reply is
+     * enough for weeks of local propagation. The reply is stored in
+     * SmallBodyOrbit::orbitsDirectory()
+     * @param designation  e.g. "C/2023 A3", "12P", "433", "2024 YR4"
+     * @return request ID reported by elementsReady / ephemerisError
+     */
+    int fetchElements(const QString &designation);
+
+    /**
+     * Local counterpart of fetchEphemeris for a small body: the orbit is
+     * propagated on 60 s nodes and goes through the same Alt/Az conversion
+     * and interpolation as a Horizons reply
+     */
+    QVector<EphemPoint> propagateTrajectory(const OrbitalElements &el,
+                                            const QGeoCoordinate &center,
+                                            const QDateTime &start,
+                                            const QDateTime &end,
+                                            int stepSec) const;
+
+    // Drops all pending requests, their results are not reported
+    void cancelAll();
+
+    // Last trajectory received for an object, empty if none
+    QVector<EphemPoint> trajectory(const QString &objectId) const { return m_trajectories.value(objectId); }
+
+    /**
+     * Converts a trajectory into relative step records from the pan
+     * position the planner holds, and commits the plan to it
+     * @param panPlanner     cable wrap state of the target device
+     * @param traj           Alt/Az samples
+     * @param degPerStepPan  pan steps per degree
+     * @param degPerStepTilt tilt steps per degree
+     */
+    static QVector<StepRecord> buildStepPlan(PanWrapPlanner &panPlanner,
+                                             const QVector<EphemPoint> &traj,
+                                             double degPerStepPan,
+                                             double degPerStepTilt);
+    /**
+     * Wall-clock time of record 0 of a plan built from traj: its first
+     * sample, so every record plays when the sky is where it was computed
+     * for, however far the trajectory lies ahead (or behind) of now
+     */
+    static QDateTime stepSessionBaseTime(const QVector<EphemPoint> &traj);
+
+    /**
+     * Uploads a trajectory to the ESP plan storage (SPIFFS)
+     * @param bt    pointer to BluetoothManager
+     * @param traj  Alt/Az samples
+     * @param name  plan name on the device, [A-Za-z0-9_-], max 20 chars
+     * @param plannedPan  azimuths are planned absolute pan angles (PanPlan,
+     *                    180 = home): the device keeps this branch and these unwinds
+     */
+    static void uploadTrajectory(BluetoothManager *bt,
+                                 const QVector<EphemPoint> &traj,
+                                 const QString &name,
+                                 bool plannedPan = false);
+    // The upload's wire text, TRAJ header to TRAJ_END
+    static QByteArray trajectoryPayload(const QVector<EphemPoint> &traj, const QString &name,
+                                        bool plannedPan = false);
+
+    /**
+     * Uploads a corrected trajectory while the ESP keeps tracking and has
+     * it swapped in at spliceAt (SPLICE); the device blends the difference
+     * between the two paths out, motion does not stop
+     * @param bt        pointer to BluetoothManager
+     * @param traj      Alt/Az samples covering spliceAt
+     * @param name      plan name on the device, other than the running one
+     * @param spliceAt  switch moment, after the upload has been stored
+     * @param plannedPan  as for uploadTrajectory
+     */
+    static void spliceOnDevice(BluetoothManager *bt,
+                               const QVector<EphemPoint> &traj,
+                               const QString &name,
+                               const QDateTime &spliceAt,
+                               bool plannedPan = false);
+    // Shifts the running path by (dAz, dEl) degrees, reached over blendMs (OFFSET)
+    static void sendPathOffset(BluetoothManager *bt, double dAzDeg, double dElDeg, int blendMs = 1000);
+    // "<base>-v<version>", cut to the device's 20-character plan names
+    static QString versionedPlanName(const QString &base, int version);
+
+    /**
+     * Starts on-device tracking of a fixed RA/Dec target (stars, deep sky);
+     * the ESP computes Alt/Az itself, nothing is downloaded or uploaded
+     * @param bt      pointer to BluetoothManager
+     * @param raDeg   right ascension in degrees, J2000 (precessed to date here)
+     * @param decDeg  declination in degrees, J2000
+     * @param center  observer location (latitude, longitude)
+     */
+    void startSiderealTracking(BluetoothManager *bt,
+                               double raDeg,
+                               double decDeg,
+                               const QGeoCoordinate &center);
 
 signals:
-    void ephemerisReady(const QVector<EphemPoint> &traj);
-    void ephemerisError(const QString &errorString);
+    void ephemerisReady(int requestId, const QString &objectId,
+                        const QVector<EphemPoint> &traj);
+    void ephemerisError(int requestId, const QString &objectId,
+                        const QString &errorString);
+    void elementsReady(int requestId, const OrbitalElements &elements);
 
 private slots:
     void onNetworkFinished(QNetworkReply *reply);
+    void onEncrypted(QNetworkReply *reply);
 
 private:
-    QGeoCoordinate m_center;
+    // One Horizons query, shared by all callers asking for the same thing
+    struct Request {
+        int            id = 0;
+        QString        objectId;
+        QString        key;
+        QGeoCoordinate center;
+        int            stepSec = 60;
+        bool           elements = false;   // fetchElements: objectId is the designation
+        bool           debugDump = false;  // someone waiting for it asked for the CSVs
+        QElapsedTimer  timer;       // started when the query is sent
+    };
+    static QString requestKey(const QString &objectId,
+                              const QGeoCoordinate &center,
+                              const QDateTime &start,
+                              const QDateTime &end,
+                              int stepSec);
+    // COMMAND value for a small-body designation (record lookup, not a major body ID)
+    static QString smallBodyCommand(const QString &designation);
+    void finishElements(const Request &r, const QString &raw);
 
     // Step 1: parse Horizons response to RA/Dec
     QVector<EphemRD> parseHorizonsText(const QString &txt) const;
@@ -76,24 +212,36 @@ private:
     QVector<EphemPoint> radecToAltAz(const QVector<EphemRD> &in,
                                      double latDeg,
                                      double lonDeg) const;
-    // Step 3: interpolate trajectory with resolution m_stepSec
-    QVector<EphemPoint> interpolateTrajectory(const QVector<EphemPoint> &in) const;
+    // Step 3: interpolate trajectory with resolution stepSec
+    QVector<EphemPoint> interpolateTrajectory(const QVector<EphemPoint> &in, int stepSec) const;
+
+    // CA bundle, ALPN and the stored session ticket; the same for prewarm and fetches
+    QSslConfiguration tlsConfiguration();
+    QNetworkRequest makeRequest(const QUrl &url);
+    // <AppDataLocation>/tls/<host>.ticket
+    QString sessionTicketPath() const;
+    void storeSessionTicket(QNetworkReply *reply);
 
     // Helper functions
     double julianDay(const QDateTime &dtUtc) const;
     double gmstDeg(const QDateTime &dtUtc) const;
 
     // Debug CSV logs
-    void dumpRawCsv(const QString &raw) const;
-    void dumpParsedCsv(const QVector<EphemRD> &parsed) const;
-    void dumpTopoCsv(const QVector<EphemPoint> &topo) const;
-    void dumpDebugCsv(const QVector<EphemPoint> &traj) const;
+    void dumpRawCsv(const QString &objectId, const QString &raw) const;
+    void dumpParsedCsv(const QString &objectId, const QVector<EphemRD> &parsed) const;
+    void dumpTopoCsv(const QString &objectId, const QVector<EphemPoint> &topo) const;
+    void dumpDebugCsv(const QString &objectId, const QVector<EphemPoint> &traj) const;
     void dumpStepsCsv(const QVector<StepRecord> &steps) const;
 
     QNetworkAccessManager m_manager;
-    QVector<EphemPoint>   m_fullTraj;
-    int                   m_stepSec = 60;
-
-    QTimer *m_liveTimer = nullptr;
-    int *m_stepIdx = nullptr;
+    QUrl                  m_baseUrl;
+    QSslConfiguration     m_tls;
+    bool                  m_tlsReady = false;
+    QByteArray            m_sessionTicket;    // last one stored
+    bool                  m_firstReplySeen = false;
+    QHash<int, Request>            m_requests;       // by request ID
+    QHash<QString, int>            m_inflightByKey;  // coalescing
+    QHash<QNetworkReply *, int>    m_replyIds;
+    int                            m_nextRequestId = 1;
+    QHash<QString, QVector<EphemPoint>> m_trajectories;  // by object ID
 };
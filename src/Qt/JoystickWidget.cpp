@@ -0,0 +1,67 @@
+#include "JoystickWidget.h"
+#include <QPainter>
+#include <QMouseEvent>
+#include <QtMath>
+
+JoystickWidget::JoystickWidget(QWidget *parent)
+    : QWidget(parent)
+{
+    setMinimumSize(120, 120);
+}
+
+double JoystickWidget::radius() const
+{
+    return qMin(width(), height()) / 2.0 - 4.0;
+}
+
+void JoystickWidget::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
+    QPainter p(this);
+    p.setRenderHint(QPainter::Antialiasing);
+
+    const QPointF c(width() / 2.0, height() / 2.0);
+    const double r = radius();
+    p.setPen(QPen(palette().color(QPalette::Mid), 2));
+    p.setBrush(palette().color(QPalette::Base));
+    p.drawEllipse(c, r, r);
+    p.drawLine(QPointF(c.x() - r, c.y()), QPointF(c.x() + r, c.y()));
+    p.drawLine(QPointF(c.x(), c.y() - r), QPointF(c.x(), c.y() + r));
+
+    const QPointF knob(c.x() + m_deflection.x() * r,
+                       c.y() - m_deflection.y() * r);
+    p.setBrush(palette().color(m_held ? QPalette::Highlight : QPalette::Button));
+    p.drawEllipse(knob, r / 3.0, r / 3.0);
+}
+
+void JoystickWidget::updateFromPos(const QPointF &pos)
+{
+    const double r = radius();
+    double x = (pos.x() - width() / 2.0) / r;
+    double y = (height() / 2.0 - pos.y()) / r;
+    const double len = qSqrt(x * x + y * y);
+    if (len > 1.0) { x /= len; y /= len; }
+    m_deflection = QPointF(x, y);
+    update();
+    emit moved(x, y);
+}
+
+void JoystickWidget::mousePressEvent(QMouseEvent *event)
+{
+    m_held = true;
+    updateFromPos(event->position());
+}
+
+void JoystickWidget::mouseMoveEvent(QMouseEvent *event)
+{
+    if (m_held) updateFromPos(event->position());
+}
+
+void JoystickWidget::mouseReleaseEvent(QMouseEvent *event)
+{
+    Q_UNUSED(event)
+    m_held = false;
+    m_deflection = QPointF();
+    update();
+    emit released();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QWidget>
+#include <QPointF>
+
+// On-screen joystick for manual control; reports a normalized deflection
+class JoystickWidget : public QWidget {
+    Q_OBJECT
+public:
+    explicit JoystickWidget(QWidget *parent = nullptr);
+
+    // Deflection in [-1, 1]; y is positive upwards
+    QPointF deflection() const { return m_deflection; }
+    bool isHeld() const { return m_held; }
+
+signals:
+    void moved(double x, double y);
+    void released();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+
+private:
+    void updateFromPos(const QPointF &pos);
+    double radius() const;
+
+    QPointF m_deflection;
+    bool    m_held = false;
+};
@@ -0,0 +1,299 @@
+#include "LinkBenchmark.h"
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QStandardPaths>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Nearest-rank percentile of sorted samples
+double percentile(const QVector<double> &sorted, double p)
+{
+    if (sorted.isEmpty()) return 0.0;
+    int k = qBound(0, int(std::ceil(p / 100.0 * sorted.size())) - 1, int(sorted.size()) - 1);
+    return sorted[k];
+}
+
+QString fileNameFor(const QString &device)
+{
+    QString name = device;
+    for (QChar &c : name)
+        if (!c.isLetterOrNumber() && c != '-' && c != '_') c = '_';
+    return name.isEmpty() ? QString("unknown") : name;
+}
+
+} // namespace
+
+QJsonObject LinkBenchmarkResult::toJson() const
+{
+    QJsonArray tp;
+    for (const Throughput &t : throughput) {
+        tp.append(QJsonObject{
+            { "payload", t.payload },
+            { "bytes", double(t.bytes) },
+            { "seconds", t.seconds },
+            { "deviceSeconds", t.deviceSeconds },
+            { "kBps", t.kBps() },
+            { "complete", t.complete },
+        });
+    }
+    return QJsonObject{
+        { "device", device },
+        { "when", when.toUTC().toString(Qt::ISODateWithMs) },
+        { "completed", completed },
+        { "error", error },
+        { "ping", QJsonObject{
+              { "sent", pingSent }, { "lost", pingLost },
+              { "minMs", rttMinMs }, { "p50Ms", rttP50Ms }, { "p90Ms", rttP90Ms },
+              { "p99Ms", rttP99Ms }, { "maxMs", rttMaxMs } } },
+        { "upload", tp },
+        { "motion", QJsonObject{
+              { "samples", motionSamples }, { "p50Ms", motionP50Ms }, { "maxMs", motionMaxMs } } },
+    };
+}
+
+QString LinkBenchmarkResult::summary() const
+{
+    QString s = QString("RTT p50 %1 / p90 %2 / p99 %3 / max %4 ms, lost %5/%6\n")
+                    .arg(rttP50Ms, 0, 'f', 1).arg(rttP90Ms, 0, 'f', 1)
+                    .arg(rttP99Ms, 0, 'f', 1).arg(rttMaxMs, 0, 'f', 1)
+                    .arg(pingLost).arg(pingSent);
+    for (const Throughput &t : throughput)
+        s += QString("Upload %1 B lines: %2 kB/s%3\n")
+                 .arg(t.payload).arg(t.kBps(), 0, 'f', 1)
+                 .arg(t.complete ? "" : " (lines lost)");
+    if (motionSamples > 0)
+        s += QString("Command to motion: p50 %1 ms, max %2 ms\n")
+                 .arg(motionP50Ms, 0, 'f', 1).arg(motionMaxMs, 0, 'f', 1);
+    if (!completed)
+        s += "Incomplete: " + error + "\n";
+    return s.trimmed();
+}
+
+LinkBenchmark::LinkBenchmark(Sender send, QObject *parent)
+    : QObject(parent)
+    , m_send(std::move(send))
+{
+    m_timeout.setSingleShot(true);
+    connect(&m_timeout, &QTimer::timeout, this, &LinkBenchmark::onTimeout);
+}
+
+void LinkBenchmark::start(const QString &device, const LinkBenchmarkConfig &cfg)
+{
+    m_cfg = cfg;
+    m_result = LinkBenchmarkResult();
+    m_result.device = device;
+    m_result.when = QDateTime::currentDateTimeUtc();
+    m_rxBuffer.clear();
+    m_rtts.clear();
+    m_motion.clear();
+    m_seq = 0;
+    m_sizeIndex = 0;
+    m_clock.start();
+
+    m_phase = Ping;
+    sendPing();
+}
+
+void LinkBenchmark::cancel()
+{
+    if (m_phase != Idle) finish("cancelled");
+}
+
+double LinkBenchmark::elapsedMs() const
+{
+    return m_clock.nsecsElapsed() / 1e6;
+}
+
+void LinkBenchmark::arm(Phase phase)
+{
+    m_phase = phase;
+    m_timeout.start(m_cfg.timeoutMs);
+}
+
+void LinkBenchmark::sendPing()
+{
+    ++m_seq;
+    ++m_result.pingSent;
+    emit progress("Round trip", 100 * m_result.pingSent / qMax(1, m_cfg.pingCount));
+    m_sentMs = elapsedMs();
+    m_send(QString("PING %1\n").arg(m_seq).toUtf8());
+    arm(Ping);
+}
+
+void LinkBenchmark::startUpload()
+{
+    if (m_sizeIndex >= m_cfg.payloadSizes.size()) {
+        m_seq = 0;
+        sendMotion();
+        return;
+    }
+    emit progress("Upload", 100 * m_sizeIndex / m_cfg.payloadSizes.size());
+    m_send("BENCH_BEGIN\n");
+    arm(UploadStart);
+}
+
+void LinkBenchmark::sendMotion()
+{
+    if (m_seq >= m_cfg.motionCount) {
+        finish();
+        return;
+    }
+    ++m_seq;
+    emit progress("Command to motion", 100 * m_seq / qMax(1, m_cfg.motionCount));
+    m_sentMs = elapsedMs();
+    m_send(QString("BENCH_MOVE %1\n").arg(m_seq).toUtf8());
+    arm(Motion);
+}
+
+void LinkBenchmark::feed(const QByteArray &data)
+{
+    if (m_phase == Idle) return;
+    m_rxBuffer += data;
+    int nl;
+    while ((nl = m_rxBuffer.indexOf('\n')) >= 0) {
+        const QString line = QString::fromUtf8(m_rxBuffer.left(nl)).trimmed();
+        m_rxBuffer.remove(0, nl + 1);
+        handleLine(line);
+        if (m_phase == Idle) return;
+    }
+}
+
+void LinkBenchmark::handleLine(const QString &line)
+{
+    const QStringList parts = line.split(' ', Qt::SkipEmptyParts);
+    if (parts.isEmpty()) return;
+
+    switch (m_phase) {
+    case Ping:
+        if (parts[0] != "PONG" || parts.value(1).toInt() != m_seq) return;
+        m_rtts.append(elapsedMs() - m_sentMs);
+        if (m_result.pingSent < m_cfg.pingCount) sendPing(); else startUpload();
+        break;
+
+    case UploadStart: {
+        if (parts[0] != "BENCH_READY") return;
+        // Whole batch handed to the socket at once: measures the sustained rate
+        const int size = qMax(3, m_cfg.payloadSizes[m_sizeIndex]);
+        m_uploadLines = qMax(1, m_cfg.bytesPerSize / size);
+        const QByteArray oneLine = "B" + QByteArray(size - 2, 'x') + "\n";
+        QByteArray batch;
+        batch.reserve(oneLine.size() * m_uploadLines + 16);
+        for (int i = 0; i < m_uploadLines; ++i) batch += oneLine;
+        batch += "BENCH_END\n";
+
+        LinkBenchmarkResult::Throughput t;
+        t.payload = size;
+        t.bytes   = qint64(oneLine.size()) * m_uploadLines;
+        m_result.throughput.append(t);
+        m_sentMs = elapsedMs();
+        m_send(batch);
+        // Timeout scaled for slow links: allow 1 kB/s at least
+        m_phase = Upload;
+        m_timeout.start(m_cfg.timeoutMs + int(t.bytes));
+        break;
+    }
+
+    case Upload: {
+        if (parts[0] != "BENCH_OK") return;
+        LinkBenchmarkResult::Throughput &t = m_result.throughput.last();
+        t.seconds       = (elapsedMs() - m_sentMs) / 1000.0;
+        t.complete      = parts.value(1).toInt() == m_uploadLines;
+        t.deviceSeconds = parts.value(3).toDouble() / 1e6;
+        ++m_sizeIndex;
+        startUpload();
+        break;
+    }
+
+    case Motion: {
+        // MOTION_ACK <seq> <us to first step> <us total on the device>
+        if (parts[0] == "BENCH_BUSY") {
+            finish("device busy (tracking or slewing)");
+            return;
+        }
+        if (parts[0] != "MOTION_ACK" || parts.value(1).toInt() != m_seq) return;
+        const double rtt     = elapsedMs() - m_sentMs;
+        const double firstMs = parts.value(2).toDouble() / 1000.0;
+        const double totalMs = parts.value(3).toDouble() / 1000.0;
+        m_motion.append(qMax(0.0, (rtt - totalMs) / 2.0) + firstMs);
+        sendMotion();
+        break;
+    }
+
+    case Idle:
+        break;
+    }
+}
+
+void LinkBenchmark::onTimeout()
+{
+    switch (m_phase) {
+    case Ping:
+        ++m_result.pingLost;
+        if (m_result.pingSent < m_cfg.pingCount) sendPing(); else startUpload();
+        break;
+    case UploadStart:
+    case Upload:
+        finish("no reply to upload");
+        break;
+    case Motion:
+        finish("no reply to BENCH_MOVE");
+        break;
+    case Idle:
+        break;
+    }
+}
+
+void LinkBenchmark::finish(const QString &error)
+{
+    m_timeout.stop();
+    m_phase = Idle;
+
+    std::sort(m_rtts.begin(), m_rtts.end());
+    if (!m_rtts.isEmpty()) {
+        m_result.rttMinMs = m_rtts.first();
+        m_result.rttP50Ms = percentile(m_rtts, 50);
+        m_result.rttP90Ms = percentile(m_rtts, 90);
+        m_result.rttP99Ms = percentile(m_rtts, 99);
+        m_result.rttMaxMs = m_rtts.last();
+    }
+    std::sort(m_motion.begin(), m_motion.end());
+    m_result.motionSamples = m_motion.size();
+    if (!m_motion.isEmpty()) {
+        m_result.motionP50Ms = percentile(m_motion, 50);
+        m_result.motionMaxMs = m_motion.last();
+    }
+    m_result.completed = error.isEmpty();
+    m_result.error = error;
+
+    qDebug().noquote() << "Link benchmark" << m_result.device << "\n" << m_result.summary();
+    emit finished(m_result);
+}
+
+QString LinkBenchmark::resultsDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/linkbench";
+}
+
+bool LinkBenchmark::saveResult(const LinkBenchmarkResult &result)
+{
+    QDir().mkpath(resultsDirectory());
+    QFile f(resultsDirectory() + "/" + fileNameFor(result.device) + ".json");
+
+    QJsonArray runs;
+    if (f.open(QIODevice::ReadOnly)) {
+        runs = QJsonDocument::fromJson(f.readAll()).array();
+        f.close();
+    }
+    runs.append(result.toJson());
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "Link benchmark: cannot write" << f.fileName();
+        return false;
+    }
+    f.write(QJsonDocument(runs).toJson());
+    return true;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <QObject>
+#include <QVector>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QJsonObject>
+#include <functional>
+
+struct LinkBenchmarkConfig {
+    int          pingCount    = 100;
+    QVector<int> payloadSizes = { 16, 64, 256, 1024 };   // bytes per line, incl. '\n'
+    int          bytesPerSize = 16 * 1024;
+    int          motionCount  = 10;
+    int          timeoutMs    = 3000;
+};
+
+struct LinkBenchmarkResult {
+    struct Throughput {
+        int    payload = 0;       // line size [B]
+        qint64 bytes   = 0;
+        double seconds = 0.0;     // first byte written -> BENCH_OK received
+        double deviceSeconds = 0.0;
+        bool   complete = false;  // the device counted every line
+        double kBps() const { return seconds > 0 ? bytes / 1024.0 / seconds : 0.0; }
+    };
+
+    QString   device;
+    QDateTime when;
+    bool      completed = false;
+    QString   error;
+
+    int    pingSent = 0;
+    int    pingLost = 0;
+    double rttMinMs = 0, rttP50Ms = 0, rttP90Ms = 0, rttP99Ms = 0, rttMaxMs = 0;
+
+    QVector<Throughput> throughput;
+
+    int    motionSamples = 0;
+    double motionP50Ms = 0, motionMaxMs = 0;   // command sent -> first step
+
+    QJsonObject toJson() const;
+    QString summary() const;
+};
+
+/**
+ * Measures the command link to the ESP: round-trip time of PING <n>,
+ * sustained line upload throughput per payload size (BENCH_BEGIN / lines
+ * / BENCH_END) and command-to-motion latency (BENCH_MOVE, the device
+ * reports when its first step went out). The link is two hooks, a send
+ * function and feed() for incoming data, so the same run works on the
+ * Bluetooth socket and on SimulatedLink.
+ */
+class LinkBenchmark : public QObject {
+    Q_OBJECT
+public:
+    using Sender = std::function<void(const QByteArray &)>;
+
+    explicit LinkBenchmark(Sender send, QObject *parent = nullptr);
+
+    void start(const QString &device, const LinkBenchmarkConfig &cfg = LinkBenchmarkConfig());
+    void cancel();
+    bool isRunning() const { return m_phase != Idle; }
+
+    // Runs are appended to <AppDataLocation>/linkbench/<device>.json
+    static QString resultsDirectory();
+    static bool saveResult(const LinkBenchmarkResult &result);
+
+public slots:
+    void feed(const QByteArray &data);
+
+signals:
+    void progress(const QString &phase, int percent);
+    void finished(const LinkBenchmarkResult &result);
+
+private slots:
+    void onTimeout();
+
+private:
+    enum Phase { Idle, Ping, UploadStart, Upload, Motion };
+
+    void handleLine(const QString &line);
+    void sendPing();
+    void startUpload();
+    void sendMotion();
+    void finish(const QString &error = QString());
+    double elapsedMs() const;
+    void arm(Phase phase);
+
+    Sender              m_send;
+    LinkBenchmarkConfig m_cfg;
+    LinkBenchmarkResult m_result;
+    Phase               m_phase = Idle;
+    QTimer              m_timeout;
+    QElapsedTimer       m_clock;
+    QByteArray          m_rxBuffer;
+
+    int                 m_seq = 0;
+    double              m_sentMs = 0.0;
+    int                 m_sizeIndex = 0;
+    int                 m_uploadLines = 0;
+    QVector<double>     m_rtts;
+    QVector<double>     m_motion;
+};
@@ -0,0 +1,143 @@
+#include "PanWrapPlanner.h"
+#include <QtMath>
+#include <QDebug>
+#include <limits>
+
+PanWrapPlanner::PanWrapPlanner(double homeAzDeg, double ccwDeg, double cwDeg)
+    : m_homeAz(homeAzDeg)
+    , m_ccwDeg(ccwDeg)
+    , m_cwDeg(cwDeg)
+    , m_currentDeg(homeAzDeg)
+{
+}
+
+void PanWrapPlanner::setSoftLimits(double ccwDeg, double cwDeg)
+{
+    m_ccwDeg = ccwDeg;
+    m_cwDeg  = cwDeg;
+}
+
+void PanWrapPlanner::setCriticalWindows(const QVector<QPair<QDateTime, QDateTime>> &windows)
+{
+    m_critical = windows;
+}
+
+void PanWrapPlanner::resetToHome()
+{
+    m_currentDeg = m_homeAz;
+}
+
+double PanWrapPlanner::wrapDelta(double deg)
+{
+    double d = fmod(deg + 540.0, 360.0);
+    if (d < 0) d += 360.0;
+    return d - 180.0;
+}
+
+bool PanWrapPlanner::inLimits(double absDeg) const
+{
+    return absDeg >= minDeg() && absDeg <= maxDeg();
+}
+
+bool PanWrapPlanner::isCritical(const QDateTime &t) const
+{
+    for (const auto &w : m_critical) {
+        if (t >= w.first && t <= w.second) return true;
+    }
+    return false;
+}
+
+int PanWrapPlanner::pickReversal(const QVector<EphemPoint> &traj,
+                                 const QVector<double> &unwrapped,
+                                 double offset, double unwind,
+                                 int from, int to) const
+{
+    // Both branches must be legal at the reversal sample; among those prefer
+    // non-critical samples where the target moves slowest in azimuth, so the
+    // re-acquisition after the unwind is the shortest.
+    int best = -1;
+    bool bestCritical = true;
+    double bestRate = std::numeric_limits<double>::max();
+    for (int i = from; i <= to; ++i) {
+        if (!inLimits(unwrapped[i] + offset + unwind)) continue;
+        bool critical = isCritical(traj[i].utc);
+        double rate = (i > 0) ? qAbs(unwrapped[i] - unwrapped[i - 1]) : 0.0;
+        if (best < 0
+            || (bestCritical && !critical)
+            || (bestCritical == critical && rate < bestRate)) {
+            best = i;
+            bestCritical = critical;
+            bestRate = rate;
+        }
+    }
+    return (best < 0) ? to : best;
+}
+
+PanPlan PanWrapPlanner::plan(const QVector<EphemPoint> &traj) const
+{
+    PanPlan out;
+    const int n = traj.size();
+    if (n == 0) return out;
+
+    // 1) Continuous azimuth without 360° jumps
+    QVector<double> u(n);
+    u[0] = traj[0].az;
+    for (int i = 1; i < n; ++i)
+        u[i] = u[i - 1] + wrapDelta(traj[i].az - traj[i - 1].az);
+
+    auto legalPrefix = [&](double off, int from) {
+        for (int i = from; i < n; ++i)
+            if (!inLimits(u[i] + off)) return i;
+        return n;
+    };
+
+    // 2) Session branch: longest legal run, then the shortest initial slew
+    double offset = 0.0;
+    int    reach  = -1;
+    double slew   = std::numeric_limits<double>::max();
+    for (int k = -2; k <= 2; ++k) {
+        double off = k * 360.0;
+        if (!inLimits(u[0] + off)) continue;
+        int    r = legalPrefix(off, 0);
+        double s = qAbs(u[0] + off - m_currentDeg);
+        if (r > reach || (r == reach && s < slew)) {
+            offset = off;
+            reach  = r;
+            slew   = s;
+        }
+    }
+    if (reach < 0) {
+        qWarning() << "PanWrapPlanner: start azimuth outside soft limits";
+        out.feasible = false;
+        offset = 360.0 * qRound((m_currentDeg - u[0]) / 360.0);
+        reach  = n;
+    }
+
+    // 3) Unavoidable reversals, scheduled away from critical moments
+    out.panAbsDeg.resize(n);
+    int segStart = 0;
+    while (reach < n) {
+        double unwind = (u[reach] + offset > maxDeg()) ? -360.0 : 360.0;
+        if (!inLimits(u[reach] + offset + unwind)) {
+            qWarning() << "PanWrapPlanner: soft limits narrower than one turn";
+            out.feasible = false;
+            break;
+        }
+        int r = pickReversal(traj, u, offset, unwind, segStart + 1, reach);
+        for (int i = segStart; i < r; ++i) out.panAbsDeg[i] = u[i] + offset;
+        out.reversals.append(r);
+        offset  += unwind;
+        segStart = r;
+        reach    = legalPrefix(offset, r);
+    }
+    for (int i = segStart; i < n; ++i) out.panAbsDeg[i] = u[i] + offset;
+
+    out.startSlewDeg = out.panAbsDeg[0] - m_currentDeg;
+    return out;
+}
+
+void PanWrapPlanner::commit(const PanPlan &plan)
+{
+    if (!plan.panAbsDeg.isEmpty())
+        m_currentDeg = plan.panAbsDeg.last();
+}
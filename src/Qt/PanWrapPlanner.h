@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QVector>
+#include <QPair>
+#include <QDateTime>
+#include "EphemerisTypes.h"
+
+// Pan axis plan with absolute (unwrapped) angles for every trajectory sample
+struct PanPlan {
+    QVector<double> panAbsDeg;  // absolute pan angle per sample, 180 = home, no wrapping
+    QVector<int>    reversals;  // sample indices where a 360° unwind is executed
+    double          startSlewDeg = 0.0;  // move from the current position to sample 0
+    bool            feasible = true;     // false if the limits are narrower than 360°
+};
+
+/**
+ * Keeps track of the absolute pan position against the cable wrap limits
+ * and chooses the unwrap branch for a whole tracking session.
+ */
+class PanWrapPlanner {
+public:
+    /**
+     * @param homeAzDeg azimuth the pan axis points to after homing
+     * @param ccwDeg    allowed rotation from home towards lower azimuth
+     * @param cwDeg     allowed rotation from home towards higher azimuth
+     */
+    explicit PanWrapPlanner(double homeAzDeg = 180.0,
+                            double ccwDeg = 270.0,
+                            double cwDeg = 270.0);
+
+    void setSoftLimits(double ccwDeg, double cwDeg);
+    double minDeg() const { return m_homeAz - m_ccwDeg; }
+    double maxDeg() const { return m_homeAz + m_cwDeg; }
+
+    // Time ranges in which no reversal may be scheduled (e.g. exposures)
+    void setCriticalWindows(const QVector<QPair<QDateTime, QDateTime>> &windows);
+
+    // Position bookkeeping: reset after HOME, advanced after a plan is sent
+    void resetToHome();
+    double currentDeg() const { return m_currentDeg; }
+    void setCurrentDeg(double absDeg) { m_currentDeg = absDeg; }
+
+    /**
+     * Plans absolute pan angles for the trajectory. The branch is chosen once
+     * for the whole session; reversals are only added when the path cannot
+     * stay inside the limits on a single branch.
+     */
+    PanPlan plan(const QVector<EphemPoint> &traj) const;
+
+    // Marks the plan as executed: the axis ends at its last sample
+    void commit(const PanPlan &plan);
+
+    // Difference of two angles wrapped into (-180, 180]
+    static double wrapDelta(double deg);
+
+private:
+    bool inLimits(double absDeg) const;
+    bool isCritical(const QDateTime &t) const;
+    int pickReversal(const QVector<EphemPoint> &traj,
+                     const QVector<double> &unwrapped,
+                     double offset, double unwind,
+                     int from, int to) const;
+
+    double m_homeAz;
+    double m_ccwDeg;
+    double m_cwDeg;
+    double m_currentDeg;
+    QVector<QPair<QDateTime, QDateTime>> m_critical;
+};
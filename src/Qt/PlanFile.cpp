@@ -0,0 +1,224 @@
+#include "PlanFile.h"
+#include "HorizonsManager.h"
+#include <QDir>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+static_assert(sizeof(StepRecord) == 8, "StepRecord is stored raw");
+static_assert(sizeof(PlanFileHeader) % alignof(StepRecord) == 0, "records follow the header aligned");
+
+QString PlanFile::plansDir()
+{
+    QString loc = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (loc.isEmpty()) loc = QStandardPaths::writableLocation(QStandardPaths::TempLocation);
+    return loc + "/plans";
+}
+
+bool PlanFile::compile(const QString &path,
+                       const QString &objectId,
+                       const QGeoCoordinate &site,
+                       const QVector<EphemPoint> &traj,
+                       PanWrapPlanner planner,
+                       const DeviceCalibration &cal,
+                       QString *error)
+{
+    auto fail = [error](const QString &message) {
+        if (error) *error = message;
+        return false;
+    };
+    if (traj.isEmpty()) return fail("empty trajectory");
+
+    const double startPanDeg = planner.currentDeg();
+    const QVector<EphemPoint> aligned = DeviceRegistry::alignedTrajectory(traj, cal);
+    if (!planner.plan(aligned).feasible) return fail("path does not fit the pan cable limits");
+    const QVector<StepRecord> plan = HorizonsManager::buildStepPlan(
+        planner, aligned, cal.panStepsPerDeg, cal.tiltStepsPerDeg);
+    if (plan.isEmpty()) return fail("empty plan");
+
+    PlanFileHeader h;
+    std::memset(&h, 0, sizeof(h));
+    h.magic           = MAGIC;
+    h.version         = VERSION;
+    h.headerSize      = sizeof(PlanFileHeader);
+    h.recordSize      = sizeof(StepRecord);
+    h.count           = quint32(plan.size());
+    h.baseUtcMs       = traj.first().utc.toMSecsSinceEpoch();
+    h.validUntilUtcMs = h.baseUtcMs + plan.last().offset_ms;
+    h.latDeg          = site.latitude();
+    h.lonDeg          = site.longitude();
+    h.altM            = qIsNaN(site.altitude()) ? 0.0 : site.altitude();
+    h.panStepsPerDeg  = cal.panStepsPerDeg;
+    h.tiltStepsPerDeg = cal.tiltStepsPerDeg;
+    h.azOffsetDeg     = cal.azOffsetDeg;
+    h.elOffsetDeg     = cal.elOffsetDeg;
+    h.startPanDeg     = startPanDeg;
+    h.endPanDeg       = planner.currentDeg();
+    const QByteArray id = objectId.toUtf8().left(sizeof(h.objectId) - 1);
+    std::memcpy(h.objectId, id.constData(), size_t(id.size()));
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) return fail(f.errorString());
+    const qint64 bytes = qint64(plan.size()) * qint64(sizeof(StepRecord));
+    if (f.write(reinterpret_cast<const char *>(&h), sizeof(h)) != qint64(sizeof(h))
+        || f.write(reinterpret_cast<const char *>(plan.constData()), bytes) != bytes) {
+        f.cancelWriting();
+        return fail(f.errorString());
+    }
+    if (!f.commit()) return fail(f.errorString());
+    qDebug() << "Plan file" << path << "records:" << plan.size();
+    return true;
+}
+
+bool PlanFile::open(const QString &path)
+{
+    close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    const qint64 fileSize = m_file.size();
+    if (fileSize < qint64(sizeof(PlanFileHeader))) {
+        m_error = "too short for a plan";
+        close();
+        return false;
+    }
+    m_map = m_file.map(0, fileSize);
+    if (!m_map) {
+        m_error = m_file.errorString();
+        close();
+        return false;
+    }
+
+    const auto *h = reinterpret_cast<const PlanFileHeader *>(m_map);
+    if (h->magic != MAGIC || h->version != VERSION
+        || h->headerSize != sizeof(PlanFileHeader) || h->recordSize != sizeof(StepRecord)) {
+        m_error = QString("not a version %1 plan").arg(VERSION);
+        close();
+        return false;
+    }
+    if (fileSize < qint64(h->headerSize) + qint64(h->count) * qint64(h->recordSize)) {
+        m_error = "truncated plan";
+        close();
+        return false;
+    }
+    m_header  = h;
+    m_records = reinterpret_cast<const StepRecord *>(m_map + h->headerSize);
+    m_error.clear();
+    return true;
+}
+
+void PlanFile::close()
+{
+    if (m_map) m_file.unmap(m_map);
+    m_map     = nullptr;
+    m_header  = nullptr;
+    m_records = nullptr;
+    if (m_file.isOpen()) m_file.close();
+}
+
+QString PlanFile::objectId() const
+{
+    if (!m_header) return QString();
+    return QString::fromUtf8(m_header->objectId, int(qstrnlen(m_header->objectId, sizeof(m_header->objectId))));
+}
+
+QGeoCoordinate PlanFile::site() const
+{
+    if (!m_header) return QGeoCoordinate();
+    return QGeoCoordinate(m_header->latDeg, m_header->lonDeg, m_header->altM);
+}
+
+DeviceCalibration PlanFile::calibration() const
+{
+    DeviceCalibration cal;
+    if (!m_header) return cal;
+    cal.panStepsPerDeg  = m_header->panStepsPerDeg;
+    cal.tiltStepsPerDeg = m_header->tiltStepsPerDeg;
+    cal.azOffsetDeg     = m_header->azOffsetDeg;
+    cal.elOffsetDeg     = m_header->elOffsetDeg;
+    return cal;
+}
+
+QDateTime PlanFile::baseTime() const
+{
+    return m_header ? QDateTime::fromMSecsSinceEpoch(m_header->baseUtcMs, Qt::UTC) : QDateTime();
+}
+
+QDateTime PlanFile::validUntil() const
+{
+    return m_header ? QDateTime::fromMSecsSinceEpoch(m_header->validUntilUtcMs, Qt::UTC) : QDateTime();
+}
+
+bool PlanFile::fits(const DeviceCalibration &cal) const
+{
+    if (!m_header) return false;
+    const DeviceCalibration own = calibration();
+    return qFuzzyCompare(own.panStepsPerDeg, cal.panStepsPerDeg)
+        && qFuzzyCompare(own.tiltStepsPerDeg, cal.tiltStepsPerDeg)
+        && qFuzzyCompare(1.0 + own.azOffsetDeg, 1.0 + cal.azOffsetDeg)
+        && qFuzzyCompare(1.0 + own.elOffsetDeg, 1.0 + cal.elOffsetDeg);
+}
+
+QVector<StepRecord> PlanFile::planFrom(const QDateTime &from, QDateTime *baseTime) const
+{
+    QVector<StepRecord> out;
+    const int n = size();
+    if (n == 0) return out;
+
+    // Last record due at or before `from`: it and everything earlier become record 0
+    const qint64 fromOffset = from.toMSecsSinceEpoch() - m_header->baseUtcMs;
+    int k = 0;
+    if (fromOffset > 0) {
+        if (fromOffset > qint64(m_records[n - 1].offset_ms)) return out;
+        const StepRecord *it = std::upper_bound(
+            m_records, m_records + n, quint32(fromOffset),
+            [](quint32 t, const StepRecord &r) { return t < r.offset_ms; });
+        k = qMax(0, int(it - m_records) - 1);
+    }
+
+    int pan = 0, tilt = 0;
+    for (int i = 0; i <= k; ++i) {
+        pan  += m_records[i].deltaPan;
+        tilt += m_records[i].deltaTilt;
+    }
+    const quint32 origin = m_records[k].offset_ms;
+    out.reserve(n - k);
+    out.append({ 0, int16_t(qBound(-32768, pan, 32767)), int16_t(qBound(-32768, tilt, 32767)) });
+    for (int i = k + 1; i < n; ++i)
+        out.append({ m_records[i].offset_ms - origin, m_records[i].deltaPan, m_records[i].deltaTilt });
+
+    if (baseTime) *baseTime = QDateTime::fromMSecsSinceEpoch(m_header->baseUtcMs + origin, Qt::UTC);
+    return out;
+}
+
+QString PlanFile::find(const QString &objectId, const QGeoCoordinate &site, const QDateTime &from)
+{
+    if (!site.isValid()) return QString();
+    const qint64 fromMs = from.toMSecsSinceEpoch();
+
+    // Headers only; of the plans still running at `from`, the one that starts first
+    QString best;
+    qint64  bestBase = 0;
+    const QFileInfoList files = QDir(plansDir()).entryInfoList({ "*.plan" }, QDir::Files);
+    for (const QFileInfo &fi : files) {
+        QFile f(fi.absoluteFilePath());
+        PlanFileHeader h;
+        if (!f.open(QIODevice::ReadOnly)
+            || f.read(reinterpret_cast<char *>(&h), sizeof(h)) != qint64(sizeof(h)))
+            continue;
+        if (h.magic != MAGIC || h.version != VERSION || h.validUntilUtcMs <= fromMs) continue;
+        const QString id = QString::fromUtf8(h.objectId, int(qstrnlen(h.objectId, sizeof(h.objectId))));
+        if (id != objectId) continue;
+        if (QGeoCoordinate(h.latDeg, h.lonDeg).distanceTo(site) > SITE_TOLERANCE_M) continue;
+        if (best.isEmpty() || h.baseUtcMs < bestBase) {
+            best     = fi.absoluteFilePath();
+            bestBase = h.baseUtcMs;
+        }
+    }
+    return best;
+}
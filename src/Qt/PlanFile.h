@@ -0,0 +1,111 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <QDateTime>
+#include <QGeoCoordinate>
+#include "EphemerisTypes.h"
+#include "DeviceRegistry.h"
+
+// On-disk header of a compiled step plan; the StepRecords follow at headerSize.
+// Little-endian, as written by the app on every platform it runs on.
+struct PlanFileHeader {
+    quint32 magic;             // PlanFile::MAGIC
+    quint16 version;           // PlanFile::VERSION
+    quint16 headerSize;        // sizeof(PlanFileHeader) at write time
+    quint32 recordSize;        // sizeof(StepRecord) at write time
+    quint32 count;             // number of records
+    qint64  baseUtcMs;         // wall-clock time of offset 0
+    qint64  validUntilUtcMs;   // time of the last record
+    double  latDeg, lonDeg, altM;
+    double  panStepsPerDeg, tiltStepsPerDeg;
+    double  azOffsetDeg, elOffsetDeg;
+    double  startPanDeg;       // absolute pan the plan starts from (180 = home)
+    double  endPanDeg;         // where the plan leaves the pan axis
+    char    objectId[32];      // UTF-8, NUL-padded
+};
+
+/**
+ * Device-ready step plan in a file: the output of buildStepPlan plus what
+ * it was computed for (object, site, mechanics, time window). Reading maps
+ * the file and uses the records in place, so a stored session starts
+ * without Horizons, parsing or conversion. Plans can be compiled anywhere
+ * the app runs (e.g. on a desktop the day before) and copied to plansDir().
+ */
+class PlanFile {
+public:
+    static const quint32 MAGIC   = 0x4E4C5053;   // "SPLN"
+    static const quint16 VERSION = 1;
+    // A stored plan is used only this close to the current site
+    static constexpr double SITE_TOLERANCE_M = 1000.0;
+
+    PlanFile() = default;
+    ~PlanFile() { close(); }
+    PlanFile(const PlanFile &) = delete;
+    PlanFile &operator=(const PlanFile &) = delete;
+
+    // Directory the app saves to and searches, in the app data location
+    static QString plansDir();
+
+    /**
+     * Compiles a trajectory into a step plan and writes it
+     * @param path      target file, replaced atomically
+     * @param objectId  Horizons ID or other target name
+     * @param site      observer position the trajectory was computed for
+     * @param traj      Alt/Az samples; offset 0 is the first sample
+     * @param planner   cable wrap state and limits to start from (copied, not advanced)
+     * @param cal       mechanics and alignment of the target device
+     * @return false (see error) also when the path does not fit the cable limits
+     */
+    static bool compile(const QString &path,
+                        const QString &objectId,
+                        const QGeoCoordinate &site,
+                        const QVector<EphemPoint> &traj,
+                        PanWrapPlanner planner,
+                        const DeviceCalibration &cal,
+                        QString *error = nullptr);
+
+    // Maps the file; false (see errorString) if it is not a plan of this version
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const { return m_header != nullptr; }
+    QString errorString() const { return m_error; }
+
+    QString objectId() const;
+    QGeoCoordinate site() const;
+    DeviceCalibration calibration() const;
+    QDateTime baseTime() const;
+    QDateTime validUntil() const;
+    double startPanDeg() const { return m_header ? m_header->startPanDeg : 0.0; }
+    double endPanDeg() const   { return m_header ? m_header->endPanDeg : 0.0; }
+    int size() const { return m_header ? int(m_header->count) : 0; }
+    // Records in the mapped file, valid while open
+    const StepRecord *records() const { return m_records; }
+
+    // Same mechanics and alignment as a device, so the steps fit it as they are
+    bool fits(const DeviceCalibration &cal) const;
+
+    /**
+     * Plan for a session starting now: records due before `from` are folded
+     * into record 0 (sent with PREP), the rest keep their timing
+     * @param from      first deadline the session can still meet
+     * @param baseTime  receives the wall-clock time of the new offset 0
+     * @return empty if the plan is over by then
+     */
+    QVector<StepRecord> planFrom(const QDateTime &from, QDateTime *baseTime) const;
+
+    /**
+     * Plan in plansDir() for the object near the site: of those still
+     * running at `from`, the one that starts first
+     * @return path, empty if none
+     */
+    static QString find(const QString &objectId, const QGeoCoordinate &site, const QDateTime &from);
+
+private:
+    QFile                  m_file;
+    uchar                 *m_map = nullptr;
+    const PlanFileHeader  *m_header = nullptr;
+    const StepRecord      *m_records = nullptr;
+    QString                m_error;
+};
@@ -0,0 +1,159 @@
+#include "PlanetEphemeris.h"
+#include "AstroMath.h"
+#include <QtMath>
+
+namespace {
+
+// Keplerian elements at J2000 and their rates per Julian century
+// (E. M. Standish, "Approximate Positions of the Planets", table 1)
+struct Elements {
+    double a, aDot;        // [AU]
+    double e, eDot;
+    double i, iDot;        // [deg]
+    double L, LDot;        // mean longitude [deg]
+    double peri, periDot;  // longitude of perihelion [deg]
+    double node, nodeDot;  // longitude of ascending node [deg]
+};
+
+const Elements MERCURY = {  0.38709927,  0.00000037, 0.20563593,  0.00001906,  7.00497902, -0.00594749,
+                          252.25032350, 149472.67411175,  77.45779628,  0.16047689,  48.33076593, -0.12534081 };
+const Elements VENUS   = {  0.72333566,  0.00000390, 0.00677672, -0.00004107,  3.39467605, -0.00078890,
+                          181.97909950,  58517.81538729, 131.60246718,  0.00268329,  76.67984255, -0.27769418 };
+const Elements EMBARY  = {  1.00000261,  0.00000562, 0.01671123, -0.00004392, -0.00001531, -0.01294668,
+                          100.46457166,  35999.37244981, 102.93768193,  0.32327364,   0.0,          0.0 };
+const Elements MARS    = {  1.52371034,  0.00001847, 0.09339410,  0.00007882,  1.84969142, -0.00813131,
+                           -4.55343205,  19140.30268499, -23.94362959,  0.44441088,  49.55953891, -0.29257343 };
+const Elements JUPITER = {  5.20288700, -0.00011607, 0.04838624, -0.00013253,  1.30439695, -0.00183714,
+                           34.39644051,   3034.74612775,  14.72847983,  0.21252668, 100.47390909,  0.20469106 };
+const Elements SATURN  = {  9.53667594, -0.00125060, 0.05386179, -0.00050991,  2.48599187,  0.00193609,
+                           49.95424423,   1222.49362201,  92.59887831, -0.41897216, 113.66242448, -0.28867794 };
+const Elements URANUS  = { 19.18916464, -0.00196176, 0.04725744, -0.00004397,  0.77263783, -0.00242939,
+                          313.23810451,    428.48202785, 170.95427630,  0.40805281,  74.01692503,  0.04240589 };
+const Elements NEPTUNE = { 30.06992276,  0.00026291, 0.00859048,  0.00005105,  1.77004347,  0.00035372,
+                          -55.12002969,    218.45945325,  44.96476227, -0.32241464, 131.78422574, -0.00508664 };
+
+const Elements &elementsOf(PlanetEphemeris::Body b)
+{
+    switch (b) {
+    case PlanetEphemeris::Mercury: return MERCURY;
+    case PlanetEphemeris::Venus:   return VENUS;
+    case PlanetEphemeris::Mars:    return MARS;
+    case PlanetEphemeris::Jupiter: return JUPITER;
+    case PlanetEphemeris::Saturn:  return SATURN;
+    case PlanetEphemeris::Uranus:  return URANUS;
+    case PlanetEphemeris::Neptune: return NEPTUNE;
+    default:                       return EMBARY;
+    }
+}
+
+double sinD(double deg) { return qSin(qDegreesToRadians(deg)); }
+double cosD(double deg) { return qCos(qDegreesToRadians(deg)); }
+
+// Ecliptic (J2000) -> equatorial, then to RA/Dec
+void eclipticToRaDec(const double ecl[3], double &raDeg, double &decDeg)
+{
+    const double eps = qDegreesToRadians(PlanetEphemeris::OBLIQUITY_DEG);
+    const double x = ecl[0];
+    const double y = qCos(eps) * ecl[1] - qSin(eps) * ecl[2];
+    const double z = qSin(eps) * ecl[1] + qCos(eps) * ecl[2];
+    double ra = qRadiansToDegrees(qAtan2(y, x));
+    raDeg  = (ra < 0) ? ra + 360.0 : ra;
+    decDeg = qRadiansToDegrees(qAtan2(z, qSqrt(x * x + y * y)));
+}
+
+} // namespace
+
+QString PlanetEphemeris::name(Body b)
+{
+    static const char *names[] = { "Sun", "Moon", "Mercury", "Venus", "Mars",
+                                   "Jupiter", "Saturn", "Uranus", "Neptune" };
+    return (b >= 0 && b < BodyCount) ? names[b] : "";
+}
+
+QString PlanetEphemeris::horizonsId(Body b)
+{
+    static const char *ids[] = { "10", "301", "199", "299", "499", "599", "699", "799", "899" };
+    return (b >= 0 && b < BodyCount) ? ids[b] : "";
+}
+
+void PlanetEphemeris::heliocentric(Body b, double jd, double xyz[3])
+{
+    const Elements &el = elementsOf(b);
+    const double T = (jd - 2451545.0) / 36525.0;
+
+    const double a    = el.a    + el.aDot    * T;
+    const double e    = el.e    + el.eDot    * T;
+    const double inc  = el.i    + el.iDot    * T;
+    const double L    = el.L    + el.LDot    * T;
+    const double peri = el.peri + el.periDot * T;
+    const double node = el.node + el.nodeDot * T;
+    const double argp = peri - node;
+
+    // Mean anomaly in (-180, 180], then Kepler's equation by Newton iteration
+    double M = fmod(L - peri, 360.0);
+    if (M > 180.0)   M -= 360.0;
+    if (M <= -180.0) M += 360.0;
+    const double Mr = qDegreesToRadians(M);
+    double E = Mr + e * qSin(Mr);
+    for (int k = 0; k < 10; ++k) {
+        double dE = (E - e * qSin(E) - Mr) / (1.0 - e * qCos(E));
+        E -= dE;
+        if (qAbs(dE) < 1e-12) break;
+    }
+
+    // Orbital plane, then rotate into the ecliptic
+    const double xp = a * (qCos(E) - e);
+    const double yp = a * qSqrt(1.0 - e * e) * qSin(E);
+    const double cw = cosD(argp), sw = sinD(argp);
+    const double cO = cosD(node), sO = sinD(node);
+    const double cI = cosD(inc),  sI = sinD(inc);
+    xyz[0] = (cw * cO - sw * sO * cI) * xp + (-sw * cO - cw * sO * cI) * yp;
+    xyz[1] = (cw * sO + sw * cO * cI) * xp + (-sw * sO + cw * cO * cI) * yp;
+    xyz[2] = (sw * sI) * xp + (cw * sI) * yp;
+}
+
+void PlanetEphemeris::raDec(Body b, const QDateTime &utc,
+                            double &raDeg, double &decDeg, double *distKm)
+{
+    const double jd = AstroMath::julianDay(utc);
+
+    if (b == Moon) {
+        // Astronomical Almanac low-precision series, ecliptic of date
+        const double T = (jd - 2451545.0) / 36525.0;
+        const double lon = 218.32 + 481267.881 * T
+                           + 6.29 * sinD(135.0 + 477198.87 * T)
+                           - 1.27 * sinD(259.3 - 413335.36 * T)
+                           + 0.66 * sinD(235.7 + 890534.22 * T)
+                           + 0.21 * sinD(269.9 + 954397.74 * T)
+                           - 0.19 * sinD(357.5 +  35999.05 * T)
+                           - 0.11 * sinD(186.5 + 966404.03 * T);
+        const double lat = 5.13 * sinD( 93.3 + 483202.02 * T)
+                           + 0.28 * sinD(228.2 + 960400.89 * T)
+                           - 0.28 * sinD(318.3 +   6003.15 * T)
+                           - 0.17 * sinD(217.6 - 407332.21 * T);
+        const double hp  = 0.9508
+                           + 0.0518 * cosD(135.0 + 477198.87 * T)
+                           + 0.0095 * cosD(259.3 - 413335.36 * T)
+                           + 0.0078 * cosD(235.7 + 890534.22 * T)
+                           + 0.0028 * cosD(269.9 + 954397.74 * T);
+        const double ecl[3] = { cosD(lat) * cosD(lon), cosD(lat) * sinD(lon), sinD(lat) };
+        eclipticToRaDec(ecl, raDeg, decDeg);
+        if (distKm) *distKm = 6378.14 / sinD(hp);
+        return;
+    }
+
+    double earth[3];
+    heliocentric(Sun, jd, earth);   // Earth-Moon barycenter
+
+    double geo[3];
+    if (b == Sun) {
+        geo[0] = -earth[0]; geo[1] = -earth[1]; geo[2] = -earth[2];
+    } else {
+        double p[3];
+        heliocentric(b, jd, p);
+        geo[0] = p[0] - earth[0]; geo[1] = p[1] - earth[1]; geo[2] = p[2] - earth[2];
+    }
+    eclipticToRaDec(geo, raDeg, decDeg);
+    if (distKm)
+        *distKm = qSqrt(geo[0] * geo[0] + geo[1] * geo[1] + geo[2] * geo[2]) * AU_KM;
+}
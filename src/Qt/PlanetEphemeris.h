@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QString>
+#include <QDateTime>
+
+/**
+ * Low-precision positions of the Sun, Moon and planets computed locally:
+ * planets from the JPL approximate Keplerian elements (1800–2050,
+ * arcminute level), the Moon from the short Astronomical Almanac series
+ * (~0.3°). Good enough for rise/set/transit planning; actual tracking
+ * still uses Horizons ephemerides. RA/Dec are referred to J2000.
+ */
+class PlanetEphemeris {
+public:
+    enum Body { Sun, Moon, Mercury, Venus, Mars, Jupiter, Saturn, Uranus, Neptune, BodyCount };
+
+    static QString name(Body b);
+    static QString horizonsId(Body b);
+
+    /**
+     * Geocentric equatorial coordinates
+     * @param distKm  optional distance from the Earth's center
+     */
+    static void raDec(Body b, const QDateTime &utc,
+                      double &raDeg, double &decDeg, double *distKm = nullptr);
+
+    /**
+     * Heliocentric ecliptic J2000 position [AU] of a planet or of the
+     * Earth-Moon barycenter (Body Sun returns the barycenter)
+     */
+    static void heliocentric(Body b, double jd, double xyz[3]);
+
+    // Obliquity of the ecliptic J2000 [deg]
+    static constexpr double OBLIQUITY_DEG = 23.43928;
+    static constexpr double AU_KM = 149597870.7;
+};
@@ -0,0 +1,175 @@
+#include "SatellitePredictor.h"
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QStandardPaths>
+#include <QDebug>
+#include <QtMath>
+#include <QtNumeric>
+
+// Coarse pass search step; shorter than any LEO pass above a few degrees
+static const int    SEARCH_STEP_SEC   = 30;
+static const int    CROSSING_TOL_MS   = 100;
+static const int    TCA_STEP_MS       = 1000;
+
+QString SatellitePredictor::tleDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/tle";
+}
+
+int SatellitePredictor::loadDirectory(const QString &dir)
+{
+    m_sats.clear();
+    QDir d(dir);
+    const QStringList files = d.entryList({ "*.tle", "*.txt" }, QDir::Files, QDir::Name);
+    for (const QString &f : files)
+        loadFile(d.filePath(f));
+    qDebug() << "TLE: loaded" << m_sats.size() << "satellites from" << dir;
+    return m_sats.size();
+}
+
+bool SatellitePredictor::loadFile(const QString &path)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
+
+    QStringList lines;
+    QTextStream in(&f);
+    while (!in.atEnd()) {
+        QString l = in.readLine();
+        if (!l.trimmed().isEmpty()) lines.append(l);
+    }
+
+    int added = 0;
+    for (int i = 0; i < lines.size(); ++i) {
+        if (!lines[i].startsWith("1 ") || i + 1 >= lines.size()
+            || !lines[i + 1].startsWith("2 "))
+            continue;
+        // Name line is optional
+        QString name = (i > 0 && !lines[i - 1].startsWith("1 ")
+                        && !lines[i - 1].startsWith("2 ")) ? lines[i - 1] : QString();
+        TwoLineElements tle;
+        Sgp4 sat;
+        if (TwoLineElements::parse(name, lines[i], lines[i + 1], tle) && sat.init(tle)) {
+            m_sats.append(sat);
+            ++added;
+        } else {
+            qDebug() << "TLE: skipped" << name.trimmed() << "(malformed or deep space)";
+        }
+        ++i;
+    }
+    return added > 0;
+}
+
+double SatellitePredictor::elevation(int index, const QGeoCoordinate &site,
+                                     const QDateTime &utc) const
+{
+    double az, el;
+    const double altKm = qIsNaN(site.altitude()) ? 0.0 : site.altitude() / 1000.0;
+    if (!m_sats[index].lookAngles(utc, site.latitude(), site.longitude(), altKm, az, el))
+        return -90.0;
+    return el;
+}
+
+QDateTime SatellitePredictor::crossing(int index, const QGeoCoordinate &site,
+                                       QDateTime a, QDateTime b, double minElDeg) const
+{
+    const bool rising = elevation(index, site, a) < minElDeg;
+    while (a.msecsTo(b) > CROSSING_TOL_MS) {
+        QDateTime mid = a.addMSecs(a.msecsTo(b) / 2);
+        bool below = elevation(index, site, mid) < minElDeg;
+        if (below == rising) a = mid; else b = mid;
+    }
+    return b;
+}
+
+bool SatellitePredictor::nextPass(int index,
+                                  const QGeoCoordinate &site,
+                                  const QDateTime &fromUtc,
+                                  double minElDeg,
+                                  double hours,
+                                  SatellitePass &out) const
+{
+    if (index < 0 || index >= m_sats.size()) return false;
+
+    const QDateTime end = fromUtc.addSecs(qint64(hours * 3600.0));
+    QDateTime t = fromUtc;
+    double el = elevation(index, site, t);
+
+    SatellitePass pass;
+    pass.satIndex = index;
+
+    // Rise: already up, or the first coarse sample above the limit
+    if (el >= minElDeg) {
+        pass.aos = fromUtc;
+    } else {
+        while (t < end) {
+            QDateTime next = t.addSecs(SEARCH_STEP_SEC);
+            if (elevation(index, site, next) >= minElDeg) {
+                pass.aos = crossing(index, site, t, next, minElDeg);
+                break;
+            }
+            t = next;
+        }
+        if (!pass.aos.isValid()) return false;
+    }
+
+    // Set, tracking the culmination on the way
+    t = pass.aos;
+    pass.maxElDeg = elevation(index, site, t);
+    pass.tca = t;
+    for (;;) {
+        QDateTime next = t.addSecs(SEARCH_STEP_SEC);
+        double e = elevation(index, site, next);
+        if (e < minElDeg) {
+            pass.los = crossing(index, site, t, next, minElDeg);
+            break;
+        }
+        if (e > pass.maxElDeg) {
+            pass.maxElDeg = e;
+            pass.tca = next;
+        }
+        t = next;
+        if (pass.aos.secsTo(t) > 6 * 3600) return false;   // never sets: not a LEO pass
+    }
+
+    // Culmination to 1 s around the best coarse sample
+    QDateTime from = qMax(pass.aos, pass.tca.addSecs(-SEARCH_STEP_SEC));
+    QDateTime to   = qMin(pass.los, pass.tca.addSecs(SEARCH_STEP_SEC));
+    for (QDateTime s = from; s <= to; s = s.addMSecs(TCA_STEP_MS)) {
+        double e = elevation(index, site, s);
+        if (e > pass.maxElDeg) {
+            pass.maxElDeg = e;
+            pass.tca = s;
+        }
+    }
+
+    out = pass;
+    return true;
+}
+
+QVector<EphemPoint> SatellitePredictor::passTrajectory(const SatellitePass &pass,
+                                                       const QGeoCoordinate &site,
+                                                       double rateHz,
+                                                       const QDateTime &from) const
+{
+    QVector<EphemPoint> out;
+    if (pass.satIndex < 0 || pass.satIndex >= m_sats.size()) return out;
+
+    rateHz = qBound(10.0, rateHz, 50.0);
+    const qint64 periodMs = qRound64(1000.0 / rateHz);
+    QDateTime start = (from.isValid() && from > pass.aos) ? from : pass.aos;
+    const qint64 spanMs = start.msecsTo(pass.los);
+    if (spanMs <= 0) return out;
+
+    const Sgp4 &sat = m_sats[pass.satIndex];
+    const double altKm = qIsNaN(site.altitude()) ? 0.0 : site.altitude() / 1000.0;
+    out.reserve(int(spanMs / periodMs) + 2);
+    for (qint64 ms = 0; ms <= spanMs; ms += periodMs) {
+        QDateTime t = start.addMSecs(ms);
+        double az, el;
+        if (!sat.lookAngles(t, site.latitude(), site.longitude(), altKm, az, el)) break;
+        out.append({ t, az, el });
+    }
+    return out;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <QVector>
+#include <QString>
+#include <QDateTime>
+#include <QGeoCoordinate>
+#include "EphemerisTypes.h"
+#include "Sgp4.h"
+
+// One visible pass of a satellite over the observer
+struct SatellitePass {
+    int       satIndex = -1;
+    QDateTime aos;         // rise above the minimum elevation
+    QDateTime tca;         // highest point
+    QDateTime los;         // set below the minimum elevation
+    double    maxElDeg = 0.0;
+};
+
+/**
+ * Satellite passes from locally stored TLE files (AppDataLocation/tle,
+ * any *.tle or *.txt in the usual 2- or 3-line format). Passes are
+ * found by coarse sampling plus bisection and turned into dense Alt/Az
+ * trajectories that go through the same plan upload as Horizons data.
+ */
+class SatellitePredictor {
+public:
+    // Default directory of the TLE files
+    static QString tleDirectory();
+
+    /**
+     * Loads every TLE file in the directory, replacing the current set
+     * @return number of usable (near-earth) satellites
+     */
+    int loadDirectory(const QString &dir = tleDirectory());
+    bool loadFile(const QString &path);
+
+    int count() const { return m_sats.size(); }
+    QString name(int index) const { return m_sats.at(index).elements().name; }
+    int satNum(int index) const { return m_sats.at(index).elements().satNum; }
+
+    /**
+     * First pass that is still in progress or starts within the horizon
+     * @param minElDeg  elevation that counts as rise/set
+     * @param hours     search window length
+     */
+    bool nextPass(int index,
+                  const QGeoCoordinate &site,
+                  const QDateTime &fromUtc,
+                  double minElDeg,
+                  double hours,
+                  SatellitePass &out) const;
+
+    /**
+     * Dense Alt/Az samples of a pass
+     * @param rateHz  samples per second, 10–50
+     * @param from    start time, later than the pass AOS if it is in progress
+     */
+    QVector<EphemPoint> passTrajectory(const SatellitePass &pass,
+                                       const QGeoCoordinate &site,
+                                       double rateHz,
+                                       const QDateTime &from = QDateTime()) const;
+
+private:
+    double elevation(int index, const QGeoCoordinate &site, const QDateTime &utc) const;
+    // Time in (a, b] where the elevation crosses minElDeg, found by bisection
+    QDateTime crossing(int index, const QGeoCoordinate &site,
+                       QDateTime a, QDateTime b, double minElDeg) const;
+
+    QVector<Sgp4> m_sats;
+};
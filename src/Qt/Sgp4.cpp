@@ -0,0 +1,363 @@
+#include "Sgp4.h"
+#include "AstroMath.h"
+#include <QtMath>
+
+namespace {
+
+// WGS-72 constants used by SGP4
+const double RE       = 6378.135;      // [km]
+const double MU       = 398600.8;      // [km^3/s^2]
+const double J2       = 0.001082616;
+const double J3       = -0.00000253881;
+const double J4       = -0.00000165597;
+const double J3OJ2    = J3 / J2;
+const double X2O3     = 2.0 / 3.0;
+const double TWO_PI   = 2.0 * M_PI;
+const double XKE      = 60.0 / qSqrt(RE * RE * RE / MU);
+const double VKMPERSEC = RE * XKE / 60.0;
+
+// WGS-84 ellipsoid for the observer
+const double WGS84_A  = 6378.137;
+const double WGS84_F  = 1.0 / 298.257223563;
+
+bool checksumOk(const QString &line)
+{
+    if (line.size() < 69) return false;
+    int sum = 0;
+    for (int i = 0; i < 68; ++i) {
+        QChar c = line.at(i);
+        if (c.isDigit())   sum += c.digitValue();
+        else if (c == '-') sum += 1;
+    }
+    return line.at(68).digitValue() == sum % 10;
+}
+
+// "±NNNNN±E" with an implied leading decimal point
+double impliedExponent(const QString &field)
+{
+    QString s = field.trimmed();
+    if (s.isEmpty()) return 0.0;
+    double sign = 1.0;
+    if (s.startsWith('-'))      { sign = -1.0; s.remove(0, 1); }
+    else if (s.startsWith('+')) { s.remove(0, 1); }
+    int expPos = qMax(s.lastIndexOf('-'), s.lastIndexOf('+'));
+    if (expPos <= 0) return sign * ("0." + s).toDouble();
+    double mant = ("0." + s.left(expPos)).toDouble();
+    int    expo = s.mid(expPos).toInt();
+    return sign * mant * qPow(10.0, expo);
+}
+
+} // namespace
+
+bool TwoLineElements::parse(const QString &line0,
+                            const QString &line1,
+                            const QString &line2,
+                            TwoLineElements &out)
+{
+    const QString l1 = line1.trimmed().leftJustified(69, ' ');
+    const QString l2 = line2.trimmed().leftJustified(69, ' ');
+    if (!l1.startsWith("1 ") || !l2.startsWith("2 ")) return false;
+    if (!checksumOk(l1) || !checksumOk(l2)) return false;
+
+    bool ok = true, okField;
+    auto num = [&](const QString &line, int col, int len) {
+        double v = line.mid(col - 1, len).trimmed().toDouble(&okField);
+        ok = ok && okField;
+        return v;
+    };
+
+    TwoLineElements t;
+    t.name   = line0.trimmed();
+    if (t.name.startsWith("0 ")) t.name = t.name.mid(2);
+    t.satNum = l1.mid(2, 5).trimmed().toInt(&okField);
+    ok = ok && okField;
+
+    int    yy  = int(num(l1, 19, 2));
+    double day = num(l1, 21, 12);
+    int    year = (yy < 57) ? 2000 + yy : 1900 + yy;
+    t.epoch = QDateTime(QDate(year, 1, 1), QTime(0, 0), Qt::UTC)
+                  .addMSecs(qint64(qRound64((day - 1.0) * 86400000.0)));
+    t.bstar = impliedExponent(l1.mid(53, 8));
+
+    t.inclDeg        = num(l2, 9, 8);
+    t.raanDeg        = num(l2, 18, 8);
+    t.ecc            = ("0." + l2.mid(26, 7).trimmed()).toDouble(&okField);
+    ok = ok && okField;
+    t.argPerigeeDeg  = num(l2, 35, 8);
+    t.meanAnomalyDeg = num(l2, 44, 8);
+    t.meanMotion     = num(l2, 53, 11);
+
+    if (!ok || t.meanMotion <= 0.0) return false;
+    if (t.name.isEmpty()) t.name = QString::number(t.satNum);
+    out = t;
+    return true;
+}
+
+bool Sgp4::init(const TwoLineElements &tle)
+{
+    m_tle   = tle;
+    m_valid = false;
+
+    m_ecco  = tle.ecc;
+    m_inclo = qDegreesToRadians(tle.inclDeg);
+    m_nodeo = qDegreesToRadians(tle.raanDeg);
+    m_argpo = qDegreesToRadians(tle.argPerigeeDeg);
+    m_mo    = qDegreesToRadians(tle.meanAnomalyDeg);
+    m_no    = tle.meanMotion * TWO_PI / 1440.0;   // [rad/min]
+    m_bstar = tle.bstar;
+
+    // Recover the original mean motion (Brouwer) and semi-major axis
+    const double eccsq  = m_ecco * m_ecco;
+    const double omeosq = 1.0 - eccsq;
+    const double rteosq = qSqrt(omeosq);
+    const double cosio  = qCos(m_inclo);
+    const double cosio2 = cosio * cosio;
+    const double ak     = qPow(XKE / m_no, X2O3);
+    const double d1     = 0.75 * J2 * (3.0 * cosio2 - 1.0) / (rteosq * omeosq);
+    double del          = d1 / (ak * ak);
+    const double adel   = ak * (1.0 - del * del - del * (1.0 / 3.0 + 134.0 * del * del / 81.0));
+    del   = d1 / (adel * adel);
+    m_no  = m_no / (1.0 + del);
+
+    const double ao    = qPow(XKE / m_no, X2O3);
+    const double sinio = qSin(m_inclo);
+    const double po    = ao * omeosq;
+    const double con42 = 1.0 - 5.0 * cosio2;
+    m_con41            = -con42 - cosio2 - cosio2;
+    const double posq  = po * po;
+    const double rp    = ao * (1.0 - m_ecco);
+
+    if (TWO_PI / m_no >= 225.0) return false;     // deep space
+    if (m_ecco < 0.0 || m_ecco >= 1.0) return false;
+
+    // Atmospheric drag coefficients
+    m_isimp = rp < (220.0 / RE + 1.0);
+    double sfour  = 78.0 / RE + 1.0;
+    double qzms24 = qPow((120.0 - 78.0) / RE, 4);
+    const double perige = (rp - 1.0) * RE;
+    if (perige < 156.0) {
+        sfour = perige - 78.0;
+        if (perige < 98.0) sfour = 20.0;
+        qzms24 = qPow((120.0 - sfour) / RE, 4);
+        sfour  = sfour / RE + 1.0;
+    }
+    const double pinvsq = 1.0 / posq;
+    const double tsi    = 1.0 / (ao - sfour);
+    m_eta               = ao * m_ecco * tsi;
+    const double etasq  = m_eta * m_eta;
+    const double eeta   = m_ecco * m_eta;
+    const double psisq  = qAbs(1.0 - etasq);
+    const double coef   = qzms24 * qPow(tsi, 4);
+    const double coef1  = coef / qPow(psisq, 3.5);
+    const double cc2    = coef1 * m_no * (ao * (1.0 + 1.5 * etasq + eeta * (4.0 + etasq))
+                          + 0.375 * J2 * tsi / psisq * m_con41 * (8.0 + 3.0 * etasq * (8.0 + etasq)));
+    m_cc1               = m_bstar * cc2;
+    double cc3          = 0.0;
+    if (m_ecco > 1.0e-4)
+        cc3 = -2.0 * coef * tsi * J3OJ2 * m_no * sinio / m_ecco;
+    m_x1mth2            = 1.0 - cosio2;
+    m_cc4 = 2.0 * m_no * coef1 * ao * omeosq
+            * (m_eta * (2.0 + 0.5 * etasq) + m_ecco * (0.5 + 2.0 * etasq)
+               - J2 * tsi / (ao * psisq)
+                 * (-3.0 * m_con41 * (1.0 - 2.0 * eeta + etasq * (1.5 - 0.5 * eeta))
+                    + 0.75 * m_x1mth2 * (2.0 * etasq - eeta * (1.0 + etasq)) * qCos(2.0 * m_argpo)));
+    m_cc5 = 2.0 * coef1 * ao * omeosq * (1.0 + 2.75 * (etasq + eeta) + eeta * etasq);
+
+    // Secular rates from J2/J4
+    const double cosio4 = cosio2 * cosio2;
+    const double temp1  = 1.5 * J2 * pinvsq * m_no;
+    const double temp2  = 0.5 * temp1 * J2 * pinvsq;
+    const double temp3  = -0.46875 * J4 * pinvsq * pinvsq * m_no;
+    m_mdot    = m_no + 0.5 * temp1 * rteosq * m_con41
+                + 0.0625 * temp2 * rteosq * (13.0 - 78.0 * cosio2 + 137.0 * cosio4);
+    m_argpdot = -0.5 * temp1 * con42 + 0.0625 * temp2 * (7.0 - 114.0 * cosio2 + 395.0 * cosio4)
+                + temp3 * (3.0 - 36.0 * cosio2 + 49.0 * cosio4);
+    const double xhdot1 = -temp1 * cosio;
+    m_nodedot = xhdot1 + (0.5 * temp2 * (4.0 - 19.0 * cosio2) + 2.0 * temp3 * (3.0 - 7.0 * cosio2)) * cosio;
+    m_omgcof  = m_bstar * cc3 * qCos(m_argpo);
+    m_xmcof   = (m_ecco > 1.0e-4) ? -X2O3 * coef * m_bstar / eeta : 0.0;
+    m_nodecf  = 3.5 * omeosq * xhdot1 * m_cc1;
+    m_t2cof   = 1.5 * m_cc1;
+    const double den = (qAbs(cosio + 1.0) > 1.5e-12) ? (1.0 + cosio) : 1.5e-12;
+    m_xlcof   = -0.25 * J3OJ2 * sinio * (3.0 + 5.0 * cosio) / den;
+    m_aycof   = -0.5 * J3OJ2 * sinio;
+    m_delmo   = qPow(1.0 + m_eta * qCos(m_mo), 3);
+    m_sinmao  = qSin(m_mo);
+    m_x7thm1  = 7.0 * cosio2 - 1.0;
+
+    m_d2 = m_d3 = m_d4 = 0.0;
+    m_t3cof = m_t4cof = m_t5cof = 0.0;
+    if (!m_isimp) {
+        const double cc1sq = m_cc1 * m_cc1;
+        m_d2 = 4.0 * ao * tsi * cc1sq;
+        const double temp = m_d2 * tsi * m_cc1 / 3.0;
+        m_d3 = (17.0 * ao + sfour) * temp;
+        m_d4 = 0.5 * temp * ao * tsi * (221.0 * ao + 31.0 * sfour) * m_cc1;
+        m_t3cof = m_d2 + 2.0 * cc1sq;
+        m_t4cof = 0.25 * (3.0 * m_d3 + m_cc1 * (12.0 * m_d2 + 10.0 * cc1sq));
+        m_t5cof = 0.2 * (3.0 * m_d4 + 12.0 * m_cc1 * m_d3 + 6.0 * m_d2 * m_d2
+                         + 15.0 * cc1sq * (2.0 * m_d2 + cc1sq));
+    }
+
+    m_valid = true;
+    double r[3], v[3];
+    m_valid = propagate(0.0, r, v);
+    return m_valid;
+}
+
+bool Sgp4::propagate(double t, double r[3], double v[3]) const
+{
+    if (!m_valid) return false;
+
+    // Secular gravity and drag
+    const double xmdf   = m_mo + m_mdot * t;
+    const double argpdf = m_argpo + m_argpdot * t;
+    const double nodedf = m_nodeo + m_nodedot * t;
+    double argpm = argpdf;
+    double mm    = xmdf;
+    const double t2 = t * t;
+    double nodem = nodedf + m_nodecf * t2;
+    double tempa = 1.0 - m_cc1 * t;
+    double tempe = m_bstar * m_cc4 * t;
+    double templ = m_t2cof * t2;
+
+    if (!m_isimp) {
+        const double delomg = m_omgcof * t;
+        const double delm   = m_xmcof * (qPow(1.0 + m_eta * qCos(xmdf), 3) - m_delmo);
+        const double temp   = delomg + delm;
+        mm    = xmdf + temp;
+        argpm = argpdf - temp;
+        const double t3 = t2 * t, t4 = t3 * t;
+        tempa = tempa - m_d2 * t2 - m_d3 * t3 - m_d4 * t4;
+        tempe = tempe + m_bstar * m_cc5 * (qSin(mm) - m_sinmao);
+        templ = templ + m_t3cof * t3 + t4 * (m_t4cof + t * m_t5cof);
+    }
+
+    double am = qPow(XKE / m_no, X2O3) * tempa * tempa;
+    const double nm = XKE / qPow(am, 1.5);
+    double em = m_ecco - tempe;
+    if (em >= 1.0 || em < -0.001) return false;
+    if (em < 1.0e-6) em = 1.0e-6;
+
+    mm = mm + m_no * templ;
+    double xlm = mm + argpm + nodem;
+    nodem = fmod(nodem, TWO_PI);
+    argpm = fmod(argpm, TWO_PI);
+    xlm   = fmod(xlm, TWO_PI);
+    mm    = fmod(xlm - argpm - nodem, TWO_PI);
+
+    const double sinip = qSin(m_inclo);
+    const double cosip = qCos(m_inclo);
+
+    // Long period periodics
+    const double axnl = em * qCos(argpm);
+    double temp = 1.0 / (am * (1.0 - em * em));
+    const double aynl = em * qSin(argpm) + temp * m_aycof;
+    const double xl   = mm + argpm + nodem + temp * m_xlcof * axnl;
+
+    // Kepler's equation
+    const double u = fmod(xl - nodem, TWO_PI);
+    double eo1 = u, tem5 = 9999.9, sineo1 = 0.0, coseo1 = 0.0;
+    for (int ktr = 1; qAbs(tem5) >= 1.0e-12 && ktr <= 10; ++ktr) {
+        sineo1 = qSin(eo1);
+        coseo1 = qCos(eo1);
+        tem5   = 1.0 - coseo1 * axnl - sineo1 * aynl;
+        tem5   = (u - aynl * coseo1 + axnl * sineo1 - eo1) / tem5;
+        if (qAbs(tem5) >= 0.95) tem5 = tem5 > 0.0 ? 0.95 : -0.95;
+        eo1 += tem5;
+    }
+
+    // Short period periodics
+    const double ecose = axnl * coseo1 + aynl * sineo1;
+    const double esine = axnl * sineo1 - aynl * coseo1;
+    const double el2   = axnl * axnl + aynl * aynl;
+    const double pl    = am * (1.0 - el2);
+    if (pl < 0.0) return false;
+
+    const double rl     = am * (1.0 - ecose);
+    const double rdotl  = qSqrt(am) * esine / rl;
+    const double rvdotl = qSqrt(pl) / rl;
+    const double betal  = qSqrt(1.0 - el2);
+    temp = esine / (1.0 + betal);
+    const double sinu = am / rl * (sineo1 - aynl - axnl * temp);
+    const double cosu = am / rl * (coseo1 - axnl + aynl * temp);
+    double su = qAtan2(sinu, cosu);
+    const double sin2u = (cosu + cosu) * sinu;
+    const double cos2u = 1.0 - 2.0 * sinu * sinu;
+    temp = 1.0 / pl;
+    const double temp1 = 0.5 * J2 * temp;
+    const double temp2 = temp1 * temp;
+
+    const double mrt   = rl * (1.0 - 1.5 * temp2 * betal * m_con41) + 0.5 * temp1 * m_x1mth2 * cos2u;
+    su                 = su - 0.25 * temp2 * m_x7thm1 * sin2u;
+    const double xnode = nodem + 1.5 * temp2 * cosip * sin2u;
+    const double xinc  = m_inclo + 1.5 * temp2 * cosip * sinip * cos2u;
+    const double mvt   = rdotl - nm * temp1 * m_x1mth2 * sin2u / XKE;
+    const double rvdot = rvdotl + nm * temp1 * (m_x1mth2 * cos2u + 1.5 * m_con41) / XKE;
+
+    // Orientation vectors
+    const double sinsu = qSin(su),    cossu = qCos(su);
+    const double snod  = qSin(xnode), cnod  = qCos(xnode);
+    const double sini  = qSin(xinc),  cosi  = qCos(xinc);
+    const double xmx = -snod * cosi;
+    const double xmy =  cnod * cosi;
+    const double ux  = xmx * sinsu + cnod * cossu;
+    const double uy  = xmy * sinsu + snod * cossu;
+    const double uz  = sini * sinsu;
+    const double vx  = xmx * cossu - cnod * sinsu;
+    const double vy  = xmy * cossu - snod * sinsu;
+    const double vz  = sini * cossu;
+
+    r[0] = mrt * ux * RE;
+    r[1] = mrt * uy * RE;
+    r[2] = mrt * uz * RE;
+    v[0] = (mvt * ux + rvdot * vx) * VKMPERSEC;
+    v[1] = (mvt * uy + rvdot * vy) * VKMPERSEC;
+    v[2] = (mvt * uz + rvdot * vz) * VKMPERSEC;
+
+    return mrt >= 1.0;   // below 1 earth radius: decayed
+}
+
+bool Sgp4::propagate(const QDateTime &utc, double r[3], double v[3]) const
+{
+    return propagate(m_tle.epoch.msecsTo(utc) / 60000.0, r, v);
+}
+
+bool Sgp4::lookAngles(const QDateTime &utc,
+                      double latDeg, double lonDeg, double altKm,
+                      double &azDeg, double &elDeg, double *rangeKm) const
+{
+    double r[3], v[3];
+    if (!propagate(utc, r, v)) return false;
+
+    // TEME -> earth fixed: rotation by GMST (polar motion neglected)
+    const double g  = qDegreesToRadians(AstroMath::gmstDeg(AstroMath::julianDay(utc)));
+    const double cg = qCos(g), sg = qSin(g);
+    const double x  =  cg * r[0] + sg * r[1];
+    const double y  = -sg * r[0] + cg * r[1];
+    const double z  =  r[2];
+
+    // Observer on the WGS-84 ellipsoid
+    const double lat = qDegreesToRadians(latDeg);
+    const double lon = qDegreesToRadians(lonDeg);
+    const double sinLat = qSin(lat), cosLat = qCos(lat);
+    const double sinLon = qSin(lon), cosLon = qCos(lon);
+    const double e2 = WGS84_F * (2.0 - WGS84_F);
+    const double n  = WGS84_A / qSqrt(1.0 - e2 * sinLat * sinLat);
+    const double ox = (n + altKm) * cosLat * cosLon;
+    const double oy = (n + altKm) * cosLat * sinLon;
+    const double oz = (n * (1.0 - e2) + altKm) * sinLat;
+
+    // Range vector in east/north/up
+    const double dx = x - ox, dy = y - oy, dz = z - oz;
+    const double east  = -sinLon * dx + cosLon * dy;
+    const double north = -sinLat * cosLon * dx - sinLat * sinLon * dy + cosLat * dz;
+    const double up    =  cosLat * cosLon * dx + cosLat * sinLon * dy + sinLat * dz;
+    const double range = qSqrt(east * east + north * north + up * up);
+
+    double az = qRadiansToDegrees(qAtan2(east, north));
+    azDeg = (az < 0) ? az + 360.0 : az;
+    elDeg = qRadiansToDegrees(qAsin(up / range));
+    if (rangeKm) *rangeKm = range;
+    return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QString>
+#include <QDateTime>
+
+// Mean orbital elements of one NORAD two-line element set
+struct TwoLineElements {
+    QString   name;
+    int       satNum = 0;
+    QDateTime epoch;            // UTC
+    double    inclDeg = 0.0;
+    double    raanDeg = 0.0;
+    double    ecc = 0.0;
+    double    argPerigeeDeg = 0.0;
+    double    meanAnomalyDeg = 0.0;
+    double    meanMotion = 0.0; // [rev/day]
+    double    bstar = 0.0;      // [1/earth radii]
+
+    /**
+     * Parses a TLE; line0 (the name) may be empty
+     * @return false on malformed lines or checksum mismatch
+     */
+    static bool parse(const QString &line0,
+                      const QString &line1,
+                      const QString &line2,
+                      TwoLineElements &out);
+};
+
+/**
+ * SGP4 propagator (near-earth branch, WGS-72, as in Spacetrack Report #3
+ * with the Vallado 2006 corrections). Output is in the TEME frame.
+ * Deep-space orbits (period >= 225 min) are rejected by init(): the
+ * tracker only follows fast low-orbit objects, GEO and HEO birds move
+ * slowly enough for the Horizons path.
+ */
+class Sgp4 {
+public:
+    bool init(const TwoLineElements &tle);
+    bool isValid() const { return m_valid; }
+    const TwoLineElements &elements() const { return m_tle; }
+
+    /**
+     * Position [km] and velocity [km/s] in TEME
+     * @param tsinceMin  minutes since the TLE epoch
+     * @return false if the satellite has decayed or the elements diverged
+     */
+    bool propagate(double tsinceMin, double r[3], double v[3]) const;
+    bool propagate(const QDateTime &utc, double r[3], double v[3]) const;
+
+    /**
+     * Topocentric look angles of the satellite
+     * @param latDeg, lonDeg, altKm  observer, WGS-84 geodetic
+     */
+    bool lookAngles(const QDateTime &utc,
+                    double latDeg, double lonDeg, double altKm,
+                    double &azDeg, double &elDeg, double *rangeKm = nullptr) const;
+
+private:
+    TwoLineElements m_tle;
+    bool m_valid = false;
+
+    // Initialized constants
+    bool   m_isimp = false;
+    double m_ecco, m_inclo, m_nodeo, m_argpo, m_mo, m_no, m_bstar;
+    double m_aycof, m_con41, m_cc1, m_cc4, m_cc5, m_d2, m_d3, m_d4;
+    double m_delmo, m_eta, m_argpdot, m_omgcof, m_sinmao, m_t2cof;
+    double m_t3cof, m_t4cof, m_t5cof, m_x1mth2, m_x7thm1, m_mdot;
+    double m_nodedot, m_xlcof, m_xmcof, m_nodecf;
+};
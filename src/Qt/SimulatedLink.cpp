@@ -0,0 +1,100 @@
+#include "SimulatedLink.h"
+#include <QRandomGenerator>
+#include <QTimer>
+
+SimulatedLink::SimulatedLink(QObject *parent)
+    : QObject(parent)
+{
+    m_clock.start();
+}
+
+void SimulatedLink::setLatency(double meanMs, double jitterMs)
+{
+    m_latencyMs = meanMs;
+    m_jitterMs  = jitterMs;
+}
+
+void SimulatedLink::setBandwidth(double bytesPerSec)
+{
+    m_bytesPerSec = qMax(1.0, bytesPerSec);
+}
+
+void SimulatedLink::setLoss(double probability)
+{
+    m_loss = qBound(0.0, probability, 1.0);
+}
+
+void SimulatedLink::setMotionDelay(double ms)
+{
+    m_motionMs = ms;
+}
+
+double SimulatedLink::schedule(double &busyUntil, int bytes)
+{
+    const double now = m_clock.nsecsElapsed() / 1e6;
+    busyUntil = qMax(busyUntil, now) + bytes * 1000.0 / m_bytesPerSec;
+    const double jitter = (QRandomGenerator::global()->generateDouble() * 2.0 - 1.0) * m_jitterMs;
+    return busyUntil + qMax(0.0, m_latencyMs + jitter);
+}
+
+void SimulatedLink::write(const QByteArray &data)
+{
+    // RFCOMM is ordered: a line never overtakes the previous one
+    double at = qMax(schedule(m_upBusyUntil, data.size()), m_lastUpArrival);
+    m_lastUpArrival = at;
+    const int delay = qMax(0, int(at - m_clock.nsecsElapsed() / 1e6));
+    QTimer::singleShot(delay, this, [this, data]() {
+        m_rx += data;
+        int nl;
+        while ((nl = m_rx.indexOf('\n')) >= 0) {
+            QByteArray line = m_rx.left(nl).trimmed();
+            m_rx.remove(0, nl + 1);
+            deviceLine(line);
+        }
+    });
+}
+
+void SimulatedLink::reply(const QByteArray &line)
+{
+    if (QRandomGenerator::global()->generateDouble() < m_loss) return;
+    const QByteArray data = line + "\n";
+    double at = schedule(m_downBusyUntil, data.size());
+    const int delay = qMax(0, int(at - m_clock.nsecsElapsed() / 1e6));
+    QTimer::singleShot(delay, this, [this, data]() { emit dataReceived(data); });
+}
+
+// Mirrors the benchmark commands of processCmd() in the firmware
+void SimulatedLink::deviceLine(const QByteArray &line)
+{
+    const double now = m_clock.nsecsElapsed() / 1e6;
+
+    if (m_benchRx) {
+        if (line == "BENCH_END") {
+            m_benchRx = false;
+            reply("BENCH_OK " + QByteArray::number(m_benchLines) + " "
+                  + QByteArray::number(m_benchBytes) + " "
+                  + QByteArray::number(qint64((now - m_benchStartMs) * 1000.0)));
+        } else {
+            ++m_benchLines;
+            m_benchBytes += line.size() + 1;
+        }
+        return;
+    }
+
+    if (line.startsWith("PING")) {
+        reply("PONG" + line.mid(4));
+    } else if (line == "BENCH_BEGIN") {
+        m_benchRx = true;
+        m_benchLines = m_benchBytes = 0;
+        m_benchStartMs = now;
+        reply("BENCH_READY");
+    } else if (line.startsWith("BENCH_MOVE ")) {
+        // One step out and back, then the acknowledgement
+        const qint64 firstUs = qint64(m_motionMs * 1000.0);
+        const QByteArray ack = "MOTION_ACK " + line.mid(11) + " " + QByteArray::number(firstUs)
+                               + " " + QByteArray::number(firstUs * 2);
+        QTimer::singleShot(int(m_motionMs * 2.0), this, [this, ack]() { reply(ack); });
+    } else if (!line.isEmpty()) {
+        reply("UNKNOWN:" + line);
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+
+/**
+ * Stand-in for the Bluetooth link and the ESP's benchmark replies, used to
+ * run LinkBenchmark without hardware (--link-benchmark-sim). Every line is
+ * delayed by a latency with jitter and serialized at a fixed byte rate in
+ * each direction; lines can be dropped at random.
+ */
+class SimulatedLink : public QObject {
+    Q_OBJECT
+public:
+    explicit SimulatedLink(QObject *parent = nullptr);
+
+    void setLatency(double meanMs, double jitterMs);
+    void setBandwidth(double bytesPerSec);
+    void setLoss(double probability);
+    // Time the simulated firmware needs to put out the first step [ms]
+    void setMotionDelay(double ms);
+
+    // Host -> device
+    void write(const QByteArray &data);
+
+signals:
+    // Device -> host
+    void dataReceived(const QByteArray &data);
+
+private:
+    void deviceLine(const QByteArray &line);
+    void reply(const QByteArray &line);
+    // Arrival time [ms] of a message sent now on a link that is busy until busyUntil
+    double schedule(double &busyUntil, int bytes);
+
+    QElapsedTimer m_clock;
+    double     m_latencyMs  = 15.0;
+    double     m_jitterMs   = 5.0;
+    double     m_bytesPerSec = 20000.0;
+    double     m_loss       = 0.0;
+    double     m_motionMs   = 0.8;
+    double     m_upBusyUntil   = 0.0;
+    double     m_downBusyUntil = 0.0;
+    double     m_lastUpArrival = 0.0;
+    QByteArray m_rx;
+
+    // Benchmark upload state of the simulated firmware
+    bool       m_benchRx    = false;
+    int        m_benchLines = 0;
+    int        m_benchBytes = 0;
+    double     m_benchStartMs = 0.0;
+};
@@ -0,0 +1,444 @@
+#include "SkyCatalog.h"
+#include "AstroMath.h"
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QDir>
+#include <QHash>
+#include <QDebug>
+#include <QtMath>
+#include <algorithm>
+
+namespace {
+
+const char    *SOURCE_PATH  = ":/catalog/objects.csv";
+const char    *BINARY_NAME  = "skycatalog.bin";
+const quint32  FORMAT_VERSION = 1;
+const int      N_BANDS      = 18;     // 10° declination bands
+const double   BAND_DEG     = 10.0;
+const int      CELLS_AT_EQ  = 36;     // RA cells of the equatorial band
+
+struct FileHeader {
+    char    magic[4];        // "SKYC"
+    quint32 version;
+    quint32 sourceHash;      // hash of the CSV the file was built from
+    quint32 nObjects;
+    quint32 nBands;
+    quint32 nCells;
+    quint32 bandsOffset;
+    quint32 cellsOffset;
+    quint32 recordsOffset;
+    quint32 namesOffset;
+    quint32 namesSize;
+    quint32 reserved;
+};
+
+struct BandEntry {
+    quint32 firstCell;
+    quint32 nCells;
+};
+
+struct CellEntry {
+    float   cx, cy, cz;      // unit vector of the cell center
+    float   radiusDeg;       // farthest object from the center
+    quint32 firstRecord;
+    quint32 count;
+};
+
+struct ObjectRecord {
+    float   x, y, z;         // unit vector, J2000
+    float   raDeg, decDeg;
+    qint16  mag100;          // magnitude * 100
+    quint8  type;
+    quint8  reserved;
+    quint32 nameOffset;      // into the names block
+    quint16 nameLen;
+    quint16 reserved2;
+};
+
+static_assert(sizeof(ObjectRecord) == 32, "catalog record layout");
+
+int cellsInBand(int band)
+{
+    double centerDec = -90.0 + (band + 0.5) * BAND_DEG;
+    return qMax(1, int(qCeil(CELLS_AT_EQ * qCos(qDegreesToRadians(centerDec)))));
+}
+
+int bandOf(double decDeg)
+{
+    return qBound(0, int(qFloor((decDeg + 90.0) / BAND_DEG)), N_BANDS - 1);
+}
+
+int cellOf(double raDeg, int nCells)
+{
+    return qBound(0, int(qFloor(raDeg / (360.0 / nCells))), nCells - 1);
+}
+
+double angleDeg(const double a[3], const float b[3])
+{
+    double dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    return qRadiansToDegrees(qAcos(qBound(-1.0, dot, 1.0)));
+}
+
+SkyObject::Type parseType(const QString &s)
+{
+    if (s == "star")    return SkyObject::Star;
+    if (s == "cluster") return SkyObject::Cluster;
+    if (s == "nebula")  return SkyObject::Nebula;
+    if (s == "galaxy")  return SkyObject::Galaxy;
+    return SkyObject::Other;
+}
+
+} // namespace
+
+SkyCatalog::SkyCatalog() = default;
+
+SkyCatalog::~SkyCatalog()
+{
+    unmap();
+}
+
+bool SkyCatalog::open()
+{
+    if (isOpen()) return true;
+
+    QFile src(SOURCE_PATH);
+    if (!src.open(QIODevice::ReadOnly)) {
+        qWarning() << "SkyCatalog: missing" << SOURCE_PATH;
+        return false;
+    }
+    const QByteArray csv = src.readAll();
+    const quint32 hash = quint32(qHash(csv, 0));
+
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(dir);
+    const QString path = dir + "/" + BINARY_NAME;
+
+    if (mapFile(path, hash)) return true;
+    if (!build(csv, hash, path)) return false;
+    return mapFile(path, hash);
+}
+
+int SkyCatalog::size() const
+{
+    if (!isOpen()) return 0;
+    return int(reinterpret_cast<const FileHeader *>(m_base)->nObjects);
+}
+
+bool SkyCatalog::build(const QByteArray &csv, quint32 sourceHash, const QString &path) const
+{
+    struct Pending {
+        int     cell;
+        float   mag;
+        QByteArray name;
+        ObjectRecord rec;
+    };
+
+    // Global index of the first cell of every band
+    QVector<BandEntry> bands(N_BANDS);
+    quint32 nCells = 0;
+    for (int b = 0; b < N_BANDS; ++b) {
+        bands[b].firstCell = nCells;
+        bands[b].nCells    = quint32(cellsInBand(b));
+        nCells += bands[b].nCells;
+    }
+
+    QVector<Pending> objs;
+    const QList<QByteArray> lines = csv.split('\n');
+    for (const QByteArray &raw : lines) {
+        const QString line = QString::fromUtf8(raw).trimmed();
+        if (line.isEmpty() || line.startsWith('#')) continue;
+        const QStringList cols = line.split(',');
+        if (cols.size() < 5) continue;
+        bool ok1, ok2, ok3;
+        double ra  = cols[2].toDouble(&ok1);
+        double dec = cols[3].toDouble(&ok2);
+        double mag = cols[4].toDouble(&ok3);
+        if (!ok1 || !ok2 || !ok3) continue;
+        ra = fmod(ra, 360.0);
+        if (ra < 0) ra += 360.0;
+
+        Pending p;
+        p.name = cols[0].trimmed().toUtf8();
+        p.mag  = float(mag);
+        int band = bandOf(dec);
+        p.cell = int(bands[band].firstCell) + cellOf(ra, int(bands[band].nCells));
+
+        double v[3];
+        AstroMath::unitVector(ra, dec, v);
+        memset(&p.rec, 0, sizeof(p.rec));
+        p.rec.x = float(v[0]);
+        p.rec.y = float(v[1]);
+        p.rec.z = float(v[2]);
+        p.rec.raDeg  = float(ra);
+        p.rec.decDeg = float(dec);
+        p.rec.mag100 = qint16(qRound(mag * 100.0));
+        p.rec.type   = quint8(parseType(cols[1].trimmed().toLower()));
+        objs.append(p);
+    }
+    if (objs.isEmpty()) {
+        qWarning() << "SkyCatalog: no objects in" << SOURCE_PATH;
+        return false;
+    }
+
+    // Cell order, brightest first inside a cell
+    std::sort(objs.begin(), objs.end(), [](const Pending &a, const Pending &b) {
+        return a.cell != b.cell ? a.cell < b.cell : a.mag < b.mag;
+    });
+
+    QVector<CellEntry> cells(int(nCells));
+    for (int b = 0; b < N_BANDS; ++b) {
+        double decC = -90.0 + (b + 0.5) * BAND_DEG;
+        double width = 360.0 / bands[b].nCells;
+        for (quint32 c = 0; c < bands[b].nCells; ++c) {
+            double v[3];
+            AstroMath::unitVector((c + 0.5) * width, decC, v);
+            CellEntry &e = cells[int(bands[b].firstCell + c)];
+            e.cx = float(v[0]);
+            e.cy = float(v[1]);
+            e.cz = float(v[2]);
+            e.radiusDeg   = 0.0f;
+            e.firstRecord = 0;
+            e.count       = 0;
+        }
+    }
+
+    QByteArray names;
+    QVector<ObjectRecord> records;
+    records.reserve(objs.size());
+    for (int i = 0; i < objs.size(); ++i) {
+        Pending &p = objs[i];
+        CellEntry &e = cells[p.cell];
+        if (e.count == 0) e.firstRecord = quint32(i);
+        ++e.count;
+
+        double v[3] = { p.rec.x, p.rec.y, p.rec.z };
+        const float c[3] = { e.cx, e.cy, e.cz };
+        e.radiusDeg = qMax(e.radiusDeg, float(angleDeg(v, c)) + 0.01f);
+
+        p.rec.nameOffset = quint32(names.size());
+        p.rec.nameLen    = quint16(p.name.size());
+        names.append(p.name);
+        records.append(p.rec);
+    }
+
+    FileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "SKYC", 4);
+    h.version       = FORMAT_VERSION;
+    h.sourceHash    = sourceHash;
+    h.nObjects      = quint32(records.size());
+    h.nBands        = N_BANDS;
+    h.nCells        = nCells;
+    h.bandsOffset   = sizeof(FileHeader);
+    h.cellsOffset   = h.bandsOffset + N_BANDS * sizeof(BandEntry);
+    h.recordsOffset = h.cellsOffset + nCells * sizeof(CellEntry);
+    h.namesOffset   = h.recordsOffset + h.nObjects * sizeof(ObjectRecord);
+    h.namesSize     = quint32(names.size());
+
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly)) {
+        qWarning() << "SkyCatalog: cannot write" << path;
+        return false;
+    }
+    out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    out.write(reinterpret_cast<const char *>(bands.constData()), bands.size() * sizeof(BandEntry));
+    out.write(reinterpret_cast<const char *>(cells.constData()), cells.size() * sizeof(CellEntry));
+    out.write(reinterpret_cast<const char *>(records.constData()), records.size() * sizeof(ObjectRecord));
+    out.write(names);
+    if (!out.commit()) {
+        qWarning() << "SkyCatalog: cannot write" << path;
+        return false;
+    }
+    qDebug() << "SkyCatalog: built" << h.nObjects << "objects in" << nCells << "cells";
+    return true;
+}
+
+bool SkyCatalog::mapFile(const QString &path, quint32 sourceHash)
+{
+    unmap();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) return false;
+
+    const qint64 size = m_file.size();
+    if (size < qint64(sizeof(FileHeader))) {
+        m_file.close();
+        return false;
+    }
+    uchar *base = m_file.map(0, size);
+    if (!base) {
+        m_file.close();
+        return false;
+    }
+
+    // Stale or foreign file: caller rebuilds it
+    const FileHeader *h = reinterpret_cast<const FileHeader *>(base);
+    bool ok = memcmp(h->magic, "SKYC", 4) == 0
+              && h->version == FORMAT_VERSION
+              && h->sourceHash == sourceHash
+              && h->nBands == N_BANDS
+              && qint64(h->namesOffset) + h->namesSize <= size;
+    if (!ok) {
+        m_file.unmap(base);
+        m_file.close();
+        return false;
+    }
+    m_base = base;
+    m_mappedSize = size;
+    return true;
+}
+
+void SkyCatalog::unmap()
+{
+    if (m_base) m_file.unmap(const_cast<uchar *>(m_base));
+    m_base = nullptr;
+    m_mappedSize = 0;
+    if (m_file.isOpen()) m_file.close();
+}
+
+SkyObject SkyCatalog::objectAt(int index) const
+{
+    const FileHeader *h = reinterpret_cast<const FileHeader *>(m_base);
+    const ObjectRecord &r =
+        reinterpret_cast<const ObjectRecord *>(m_base + h->recordsOffset)[index];
+    SkyObject o;
+    o.name   = QString::fromUtf8(reinterpret_cast<const char *>(m_base + h->namesOffset + r.nameOffset),
+                                 r.nameLen);
+    o.type   = SkyObject::Type(r.type);
+    o.raDeg  = r.raDeg;
+    o.decDeg = r.decDeg;
+    o.mag    = r.mag100 / 100.0f;
+    return o;
+}
+
+QVector<SkyObject> SkyCatalog::visible(double minElDeg,
+                                       const QGeoCoordinate &site,
+                                       const QDateTime &utc,
+                                       int maxCount) const
+{
+    QVector<SkyObject> out;
+    if (!isOpen()) return out;
+
+    const FileHeader *h = reinterpret_cast<const FileHeader *>(m_base);
+    const BandEntry *bands = reinterpret_cast<const BandEntry *>(m_base + h->bandsOffset);
+    const CellEntry *cells = reinterpret_cast<const CellEntry *>(m_base + h->cellsOffset);
+    const ObjectRecord *recs = reinterpret_cast<const ObjectRecord *>(m_base + h->recordsOffset);
+
+    // Zenith as an equatorial unit vector: RA = LST, Dec = latitude
+    const double lat = site.latitude();
+    const double lst = AstroMath::lstDeg(AstroMath::julianDay(utc), site.longitude());
+    double zen[3];
+    AstroMath::unitVector(lst, lat, zen);
+    const double sinMin  = qSin(qDegreesToRadians(minElDeg));
+    const double maxDist = 90.0 - minElDeg;   // allowed zenith distance
+
+    struct Hit { int index; double dot; };
+    QVector<Hit> hits;
+
+    for (quint32 b = 0; b < h->nBands; ++b) {
+        double lo = -90.0 + b * BAND_DEG, hi = lo + BAND_DEG;
+        double bandDist = (lat >= lo && lat <= hi) ? 0.0
+                                                   : qMin(qAbs(lat - lo), qAbs(lat - hi));
+        if (bandDist > maxDist) continue;
+
+        for (quint32 c = bands[b].firstCell; c < bands[b].firstCell + bands[b].nCells; ++c) {
+            const CellEntry &cell = cells[c];
+            if (cell.count == 0) continue;
+            const float cv[3] = { cell.cx, cell.cy, cell.cz };
+            if (angleDeg(zen, cv) - cell.radiusDeg > maxDist) continue;
+
+            for (quint32 i = cell.firstRecord; i < cell.firstRecord + cell.count; ++i) {
+                const ObjectRecord &r = recs[i];
+                double dot = zen[0] * r.x + zen[1] * r.y + zen[2] * r.z;
+                if (dot >= sinMin) hits.append({ int(i), dot });
+            }
+        }
+    }
+
+    std::sort(hits.begin(), hits.end(), [recs](const Hit &a, const Hit &b) {
+        return recs[a.index].mag100 < recs[b.index].mag100;
+    });
+    if (maxCount > 0 && hits.size() > maxCount) hits.resize(maxCount);
+
+    out.reserve(hits.size());
+    for (const Hit &hit : hits) {
+        SkyObject o = objectAt(hit.index);
+        AstroMath::raDecToAltAz(o.raDeg, o.decDeg, lat, lst, o.azDeg, o.elDeg);
+        out.append(o);
+    }
+    return out;
+}
+
+QVector<SkyObject> SkyCatalog::objects(float maxMag) const
+{
+    QVector<SkyObject> out;
+    if (!isOpen()) return out;
+
+    const FileHeader *h = reinterpret_cast<const FileHeader *>(m_base);
+    const ObjectRecord *recs = reinterpret_cast<const ObjectRecord *>(m_base + h->recordsOffset);
+    const int limit = qRound(maxMag * 100.0f);
+
+    QVector<int> idx;
+    for (quint32 i = 0; i < h->nObjects; ++i)
+        if (recs[i].mag100 <= limit) idx.append(int(i));
+    std::sort(idx.begin(), idx.end(), [recs](int a, int b) {
+        return recs[a].mag100 < recs[b].mag100;
+    });
+
+    out.reserve(idx.size());
+    for (int i : idx)
+        out.append(objectAt(i));
+    return out;
+}
+
+bool SkyCatalog::nearest(double azDeg, double elDeg,
+                         const QGeoCoordinate &site,
+                         const QDateTime &utc,
+                         double maxSepDeg,
+                         SkyObject &out) const
+{
+    if (!isOpen()) return false;
+
+    const FileHeader *h = reinterpret_cast<const FileHeader *>(m_base);
+    const CellEntry *cells = reinterpret_cast<const CellEntry *>(m_base + h->cellsOffset);
+    const ObjectRecord *recs = reinterpret_cast<const ObjectRecord *>(m_base + h->recordsOffset);
+
+    const double lat = site.latitude();
+    const double lst = AstroMath::lstDeg(AstroMath::julianDay(utc), site.longitude());
+    double ra, dec, t[3];
+    AstroMath::altAzToRaDec(azDeg, elDeg, lat, lst, ra, dec);
+    AstroMath::unitVector(ra, dec, t);
+
+    int best = -1;
+    double bestSep = maxSepDeg;
+    for (quint32 c = 0; c < h->nCells; ++c) {
+        const CellEntry &cell = cells[c];
+        if (cell.count == 0) continue;
+        const float cv[3] = { cell.cx, cell.cy, cell.cz };
+        if (angleDeg(t, cv) - cell.radiusDeg > bestSep) continue;
+
+        for (quint32 i = cell.firstRecord; i < cell.firstRecord + cell.count; ++i) {
+            const float rv[3] = { recs[i].x, recs[i].y, recs[i].z };
+            double sep = angleDeg(t, rv);
+            if (sep <= bestSep) {
+                bestSep = sep;
+                best = int(i);
+            }
+        }
+    }
+    if (best < 0) return false;
+
+    out = objectAt(best);
+    AstroMath::raDecToAltAz(out.raDeg, out.decDeg, lat, lst, out.azDeg, out.elDeg);
+    return true;
+}
+
+QString SkyCatalog::typeName(SkyObject::Type t)
+{
+    switch (t) {
+    case SkyObject::Star:    return "star";
+    case SkyObject::Cluster: return "cluster";
+    case SkyObject::Nebula:  return "nebula";
+    case SkyObject::Galaxy:  return "galaxy";
+    default:                 return "other";
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QFile>
+#include <QDateTime>
+#include <QGeoCoordinate>
+
+// One catalog entry resolved for a given site and time
+struct SkyObject {
+    enum Type : quint8 { Star = 0, Cluster, Nebula, Galaxy, Other };
+
+    QString name;
+    Type    type = Other;
+    double  raDeg = 0.0;
+    double  decDeg = 0.0;
+    float   mag = 0.0f;
+    double  azDeg = 0.0;   // filled by visible() / nearest()
+    double  elDeg = 0.0;
+};
+
+/**
+ * Bundled star and deep-sky catalog (:/catalog/objects.csv).
+ * On first use the CSV is compiled into a binary file in AppDataLocation:
+ * objects are bucketed into 10° declination bands split into RA cells of
+ * roughly equal area, each cell stores its center and angular radius, and
+ * the whole file is memory-mapped so queries never parse text or allocate
+ * per object. A query only touches the cells that can reach above the
+ * requested elevation.
+ */
+class SkyCatalog {
+public:
+    SkyCatalog();
+    ~SkyCatalog();
+
+    /**
+     * Maps the compiled catalog, rebuilding it when missing or when the
+     * bundled CSV has changed
+     * @return false if neither the binary nor the CSV could be used
+     */
+    bool open();
+    bool isOpen() const { return m_base != nullptr; }
+    int size() const;
+
+    /**
+     * Objects above minElDeg at the given site and time, brightest first
+     * @param minElDeg  minimum elevation in degrees
+     * @param site      observer location (latitude, longitude)
+     * @param utc       time of the query
+     * @param maxCount  result limit, 0 = all
+     */
+    QVector<SkyObject> visible(double minElDeg,
+                               const QGeoCoordinate &site,
+                               const QDateTime &utc,
+                               int maxCount = 0) const;
+
+    /**
+     * Catalog object closest to a pointing direction
+     * @param azDeg      azimuth in degrees
+     * @param elDeg      elevation in degrees
+     * @param maxSepDeg  search radius in degrees
+     * @param out        result, valid only when true is returned
+     */
+    bool nearest(double azDeg, double elDeg,
+                 const QGeoCoordinate &site,
+                 const QDateTime &utc,
+                 double maxSepDeg,
+                 SkyObject &out) const;
+
+    /**
+     * Every object at or brighter than maxMag, brightest first; az/el are
+     * not filled (night planning evaluates them over time)
+     */
+    QVector<SkyObject> objects(float maxMag = 99.0f) const;
+
+    static QString typeName(SkyObject::Type t);
+
+private:
+    bool build(const QByteArray &csv, quint32 sourceHash, const QString &path) const;
+    bool mapFile(const QString &path, quint32 sourceHash);
+    void unmap();
+    SkyObject objectAt(int index) const;
+
+    QFile        m_file;
+    const uchar *m_base = nullptr;
+    qint64       m_mappedSize = 0;
+};
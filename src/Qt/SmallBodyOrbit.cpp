@@ -0,0 +1,347 @@
+#include "SmallBodyOrbit.h"
+#include "PlanetEphemeris.h"
+#include "AstroMath.h"
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtMath>
+#include <QDebug>
+#include <cmath>
+
+namespace {
+
+const double K_GAUSS        = 0.01720209895;      // [AU^1.5 / day]
+const double C_AU_PER_DAY   = 173.1446326846693;
+const double EARTH_RADIUS_KM = 6378.137;
+// Only an exactly parabolic orbit (MPC writes e = 1) takes Barker's equation
+const double PARABOLIC_TOL  = 1e-9;
+const int    KEPLER_ITER    = 50;
+
+double sinD(double deg) { return qSin(qDegreesToRadians(deg)); }
+double cosD(double deg) { return qCos(qDegreesToRadians(deg)); }
+
+// Ecliptic J2000 -> equatorial J2000
+void eclipticToEquatorial(const double ecl[3], double eq[3])
+{
+    const double eps = qDegreesToRadians(PlanetEphemeris::OBLIQUITY_DEG);
+    eq[0] = ecl[0];
+    eq[1] = qCos(eps) * ecl[1] - qSin(eps) * ecl[2];
+    eq[2] = qSin(eps) * ecl[1] + qCos(eps) * ecl[2];
+}
+
+void vectorToRaDec(const double v[3], double &raDeg, double &decDeg)
+{
+    const double ra = qRadiansToDegrees(qAtan2(v[1], v[0]));
+    raDeg  = (ra < 0) ? ra + 360.0 : ra;
+    decDeg = qRadiansToDegrees(qAtan2(v[2], qSqrt(v[0] * v[0] + v[1] * v[1])));
+}
+
+double jdTT(const QDateTime &utc)
+{
+    return AstroMath::julianDay(utc) + SmallBodyOrbit::TT_MINUS_UTC_SEC / 86400.0;
+}
+
+// JD of 0h on a calendar date
+double jdOfDate(int y, int m, double day)
+{
+    const QDate d(y, m, 1);
+    return d.isValid() ? double(d.toJulianDay()) - 0.5 + (day - 1.0) : 0.0;
+}
+
+// MPC packed date, e.g. "K2555" = 2025-05-05
+double jdOfPackedDate(const QString &p)
+{
+    if (p.size() != 5) return 0.0;
+    auto digit = [](QChar c) {
+        if (c.isDigit()) return c.digitValue();
+        if (c >= 'A' && c <= 'V') return 10 + (c.unicode() - 'A');
+        return -1;
+    };
+    const int century = (p[0] == 'I') ? 18 : (p[0] == 'J') ? 19 : (p[0] == 'K') ? 20 : -1;
+    const int month = digit(p[3]), day = digit(p[4]);
+    bool ok;
+    const int yy = p.mid(1, 2).toInt(&ok);
+    if (century < 0 || !ok || month < 1 || month > 12 || day < 1) return 0.0;
+    return jdOfDate(century * 100 + yy, month, day);
+}
+
+// "C/2023 A3 (Tsuchinshan-ATLAS)" -> "C/2023 A3"
+QString designationOf(const QString &name)
+{
+    const int paren = name.indexOf(" (");
+    return (paren > 0) ? name.left(paren).trimmed() : name.trimmed();
+}
+
+} // namespace
+
+QString OrbitalElements::id() const
+{
+    QString out;
+    for (const QChar c : designation)
+        if (c.isLetterOrNumber() && c.unicode() < 128) out += c;
+    return out.left(11);
+}
+
+bool OrbitalElements::parseHorizons(const QString &text, const QString &designation,
+                                    OrbitalElements &out)
+{
+    const QStringList lines = text.split('\n');
+    QString name;
+    bool inTable = false;
+    for (const QString &raw : lines) {
+        const QString line = raw.trimmed();
+        if (line.startsWith("Target body name:")) {
+            name = line.mid(17);
+            const int brace = name.indexOf('{');
+            if (brace > 0) name = name.left(brace);
+            name = name.trimmed();
+        } else if (line.startsWith("$$SOE")) {
+            inTable = true;
+        } else if (line.startsWith("$$EOE")) {
+            break;
+        } else if (inTable) {
+            // JDTDB, Calendar Date, EC, QR, IN, OM, W, Tp, N, MA, TA, A, AD, PR
+            const QStringList cols = line.split(',');
+            if (cols.size() < 8) continue;
+            OrbitalElements el;
+            bool ok[7];
+            el.epochJd    = cols[0].toDouble(&ok[0]);
+            el.e          = cols[2].toDouble(&ok[1]);
+            el.q          = cols[3].toDouble(&ok[2]);
+            el.inclDeg    = cols[4].toDouble(&ok[3]);
+            el.nodeDeg    = cols[5].toDouble(&ok[4]);
+            el.argPeriDeg = cols[6].toDouble(&ok[5]);
+            el.tPeriJd    = cols[7].toDouble(&ok[6]);
+            if (!(ok[0] && ok[1] && ok[2] && ok[3] && ok[4] && ok[5] && ok[6])) continue;
+            el.name        = name.isEmpty() ? designation : name;
+            el.designation = designation.isEmpty() ? designationOf(name) : designation;
+            if (!el.isValid()) continue;
+            out = el;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool OrbitalElements::parseMpcAsteroid(const QString &line, OrbitalElements &out)
+{
+    if (line.size() < 103) return false;
+    const double epoch = jdOfPackedDate(line.mid(20, 5).trimmed());
+    bool ok[6];
+    double M        = line.mid(26, 9).toDouble(&ok[0]);
+    const double w  = line.mid(37, 9).toDouble(&ok[1]);
+    const double om = line.mid(48, 9).toDouble(&ok[2]);
+    const double i  = line.mid(59, 9).toDouble(&ok[3]);
+    const double e  = line.mid(70, 9).toDouble(&ok[4]);
+    const double a  = line.mid(92, 11).toDouble(&ok[5]);
+    if (epoch <= 0.0 || !(ok[0] && ok[1] && ok[2] && ok[3] && ok[4] && ok[5]) || a <= 0.0 || e >= 1.0)
+        return false;
+
+    OrbitalElements el;
+    el.epochJd    = epoch;
+    el.e          = e;
+    el.q          = a * (1.0 - e);
+    el.inclDeg    = i;
+    el.nodeDeg    = om;
+    el.argPeriDeg = w;
+    // Perihelion time from the mean anomaly at the epoch, nearest passage
+    M = fmod(M, 360.0);
+    if (M > 180.0) M -= 360.0;
+    const double nDegPerDay = qRadiansToDegrees(K_GAUSS / qPow(a, 1.5));
+    el.tPeriJd = epoch - M / nDegPerDay;
+    const QString readable = (line.size() > 166) ? line.mid(166, 28).trimmed() : QString();
+    el.name        = readable.isEmpty() ? line.left(7).trimmed() : readable;
+    el.designation = el.name;
+    el.designation.remove('(').remove(')');
+    out = el;
+    return true;
+}
+
+bool OrbitalElements::parseMpcComet(const QString &line, OrbitalElements &out)
+{
+    if (line.size() < 102 || !QString("CPDXIA").contains(line[4])) return false;
+    bool ok[9];
+    const int    py  = line.mid(14, 4).toInt(&ok[0]);
+    const int    pm  = line.mid(19, 2).toInt(&ok[1]);
+    const double pd  = line.mid(22, 7).toDouble(&ok[2]);
+    const double q   = line.mid(30, 9).toDouble(&ok[3]);
+    const double e   = line.mid(41, 8).toDouble(&ok[4]);
+    const double w   = line.mid(51, 8).toDouble(&ok[5]);
+    const double om  = line.mid(61, 8).toDouble(&ok[6]);
+    const double i   = line.mid(71, 8).toDouble(&ok[7]);
+    if (!(ok[0] && ok[1] && ok[2] && ok[3] && ok[4] && ok[5] && ok[6] && ok[7])) return false;
+
+    OrbitalElements el;
+    el.tPeriJd    = jdOfDate(py, pm, pd);
+    el.q          = q;
+    el.e          = e;
+    el.inclDeg    = i;
+    el.nodeDeg    = om;
+    el.argPeriDeg = w;
+    // Unperturbed solutions have no epoch: the elements hold at perihelion
+    const int ey = line.mid(81, 4).toInt(&ok[8]);
+    el.epochJd = ok[8] ? jdOfDate(ey, line.mid(85, 2).toInt(), line.mid(87, 2).toInt()) : el.tPeriJd;
+    if (el.tPeriJd <= 0.0 || !el.isValid()) return false;
+    el.name        = line.mid(102, 56).trimmed();
+    el.designation = designationOf(el.name);
+    out = el;
+    return true;
+}
+
+QString SmallBodyOrbit::orbitsDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/orbits";
+}
+
+QVector<OrbitalElements> SmallBodyOrbit::loadDirectory(const QString &dir)
+{
+    QVector<OrbitalElements> out;
+    const QDir d(dir);
+    const QStringList files = d.entryList({ "*.txt", "*.dat" }, QDir::Files, QDir::Name);
+    for (const QString &fn : files) {
+        QFile f(d.filePath(fn));
+        if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) continue;
+        const QString text = QString::fromUtf8(f.readAll());
+
+        if (text.contains("$$SOE")) {
+            // Reply stored by saveHorizons: "# <designation>" on the first line
+            QString designation;
+            if (text.startsWith("# ")) designation = text.mid(2, text.indexOf('\n') - 2).trimmed();
+            OrbitalElements el;
+            if (OrbitalElements::parseHorizons(text, designation, el)) out.append(el);
+            continue;
+        }
+        const QStringList lines = text.split('\n');
+        for (const QString &line : lines) {
+            OrbitalElements el;
+            if (OrbitalElements::parseMpcComet(line, el) || OrbitalElements::parseMpcAsteroid(line, el))
+                out.append(el);
+        }
+    }
+    qDebug() << "Small-body orbits loaded:" << out.size() << "from" << dir;
+    return out;
+}
+
+bool SmallBodyOrbit::saveHorizons(const OrbitalElements &el, const QString &text, const QString &dir)
+{
+    if (el.id().isEmpty()) return false;
+    QDir().mkpath(dir);
+    QSaveFile f(QString("%1/%2.txt").arg(dir, el.id()));
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+    f.write(QString("# %1\n").arg(el.designation).toUtf8());
+    f.write(text.toUtf8());
+    return f.commit();
+}
+
+void SmallBodyOrbit::heliocentric(double jd, double xyz[3]) const
+{
+    const double q = m_el.q, e = m_el.e;
+    const double dt = jd - m_el.tPeriJd;
+    double xp, yp;   // orbital plane, x towards perihelion [AU]
+
+    if (qAbs(e - 1.0) < PARABOLIC_TOL) {
+        // Barker's equation: s^3 + 3s = W, s = tan(v/2). Solved for |W|, the
+        // inbound leg by symmetry: W/2 + sqrt(W^2/4 + 1) cancels for W << 0
+        const double W = 3.0 * K_GAUSS * dt / qSqrt(2.0 * q * q * q);
+        const double Y = std::cbrt(qAbs(W) / 2.0 + qSqrt(W * W / 4.0 + 1.0));
+        const double s = std::copysign(Y - 1.0 / Y, W);
+        xp = q * (1.0 - s * s);
+        yp = 2.0 * q * s;
+    } else if (e < 1.0) {
+        const double a = q / (1.0 - e);
+        double M = fmod(K_GAUSS / qPow(a, 1.5) * dt, 2.0 * M_PI);
+        if (M > M_PI)   M -= 2.0 * M_PI;
+        if (M <= -M_PI) M += 2.0 * M_PI;
+        // Near-parabolic ellipses start from the e -> 1 limit E^3 / 6 = M
+        double E = (e < 0.8) ? M : qBound(-M_PI, std::cbrt(6.0 * M), M_PI);
+        for (int k = 0; k < KEPLER_ITER; ++k) {
+            const double dE = (E - e * qSin(E) - M) / (1.0 - e * qCos(E));
+            E = qBound(-M_PI, E - dE, M_PI);
+            if (qAbs(dE) < 1e-13) break;
+        }
+        xp = a * (qCos(E) - e);
+        yp = a * qSqrt(1.0 - e * e) * qSin(E);
+    } else {
+        const double a = q / (e - 1.0);
+        const double M = K_GAUSS / qPow(a, 1.5) * dt;
+        double H = std::asinh(M / e);
+        for (int k = 0; k < KEPLER_ITER; ++k) {
+            const double dH = (e * std::sinh(H) - H - M) / (e * std::cosh(H) - 1.0);
+            H -= dH;
+            if (qAbs(dH) < 1e-13) break;
+        }
+        xp = a * (e - std::cosh(H));
+        yp = a * qSqrt(e * e - 1.0) * std::sinh(H);
+    }
+
+    const double cw = cosD(m_el.argPeriDeg), sw = sinD(m_el.argPeriDeg);
+    const double cO = cosD(m_el.nodeDeg),    sO = sinD(m_el.nodeDeg);
+    const double cI = cosD(m_el.inclDeg),    sI = sinD(m_el.inclDeg);
+    xyz[0] = (cw * cO - sw * sO * cI) * xp + (-sw * cO - cw * sO * cI) * yp;
+    xyz[1] = (cw * sO + sw * cO * cI) * xp + (-sw * sO + cw * cO * cI) * yp;
+    xyz[2] = (sw * sI) * xp + (cw * sI) * yp;
+}
+
+void SmallBodyOrbit::geocentric(double jd, double geo[3]) const
+{
+    double earth[3];
+    PlanetEphemeris::heliocentric(PlanetEphemeris::Sun, jd, earth);   // Earth-Moon barycenter
+
+    // Light time: where the body was when the light now arriving left it
+    double tau = 0.0;
+    for (int k = 0; k < 3; ++k) {
+        double p[3];
+        heliocentric(jd - tau, p);
+        geo[0] = p[0] - earth[0];
+        geo[1] = p[1] - earth[1];
+        geo[2] = p[2] - earth[2];
+        tau = qSqrt(geo[0] * geo[0] + geo[1] * geo[1] + geo[2] * geo[2]) / C_AU_PER_DAY;
+    }
+}
+
+void SmallBodyOrbit::raDec(const QDateTime &utc, double &raDeg, double &decDeg, double *distAu) const
+{
+    double geo[3], eq[3];
+    geocentric(jdTT(utc), geo);
+    eclipticToEquatorial(geo, eq);
+    vectorToRaDec(eq, raDeg, decDeg);
+    if (distAu) *distAu = qSqrt(eq[0] * eq[0] + eq[1] * eq[1] + eq[2] * eq[2]);
+}
+
+QVector<EphemRD> SmallBodyOrbit::ephemeris(const QGeoCoordinate &site,
+                                           const QDateTime &start,
+                                           const QDateTime &end,
+                                           int stepSec) const
+{
+    QVector<EphemRD> out;
+    if (stepSec <= 0 || !(start < end)) return out;
+    out.reserve(int(start.secsTo(end) / stepSec) + 2);
+
+    // Precession barely changes over a session: one matrix for all samples
+    double P[3][3];
+    AstroMath::precessionMatrix(jdTT(start.addSecs(start.secsTo(end) / 2)), P);
+    const double rObs = EARTH_RADIUS_KM / PlanetEphemeris::AU_KM;
+    const double cLat = cosD(site.latitude()), sLat = sinD(site.latitude());
+
+    auto sample = [&](const QDateTime &t) {
+        const QDateTime utc = t.toUTC();
+        double geo[3], eq[3], v[3];
+        geocentric(jdTT(utc), geo);
+        eclipticToEquatorial(geo, eq);
+        for (int r = 0; r < 3; ++r)
+            v[r] = P[r][0] * eq[0] + P[r][1] * eq[1] + P[r][2] * eq[2];
+        // Observer on the equator of date; parallax reaches arcminutes for close approaches
+        const double lst = AstroMath::lstDeg(AstroMath::julianDay(utc), site.longitude());
+        v[0] -= rObs * cLat * cosD(lst);
+        v[1] -= rObs * cLat * sinD(lst);
+        v[2] -= rObs * sLat;
+        double ra, dec;
+        vectorToRaDec(v, ra, dec);
+        out.append({ utc, ra, dec });
+    };
+    for (QDateTime t = start; t < end; t = t.addSecs(stepSec))
+        sample(t);
+    sample(end);
+    return out;
+}
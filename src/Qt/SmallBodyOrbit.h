@@ -0,0 +1,90 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QDateTime>
+#include <QGeoCoordinate>
+#include "EphemerisTypes.h"
+
+/**
+ * Heliocentric osculating elements of a comet or asteroid, ecliptic and
+ * equinox J2000. Perihelion distance and time describe every conic, so
+ * elliptic, parabolic and hyperbolic orbits share one form.
+ */
+struct OrbitalElements {
+    QString designation;       // as typed / as in the source, e.g. "C/2023 A3", "433"
+    QString name;              // readable name, may equal the designation
+    double  epochJd = 0.0;     // osculation epoch, TT
+    double  q = 0.0;           // perihelion distance [AU]
+    double  e = 0.0;
+    double  inclDeg = 0.0;
+    double  nodeDeg = 0.0;
+    double  argPeriDeg = 0.0;
+    double  tPeriJd = 0.0;     // time of perihelion passage, TT
+
+    bool isValid() const { return q > 0.0 && e >= 0.0 && epochJd > 0.0; }
+    // Object ID for plan names: letters and digits of the designation, 11 at most
+    QString id() const;
+
+    /**
+     * Horizons ELEMENTS reply (CSV, heliocentric, ecliptic J2000); the
+     * first row after $$SOE is used
+     * @return false if the reply has no element rows
+     */
+    static bool parseHorizons(const QString &text, const QString &designation,
+                              OrbitalElements &out);
+    // One line of an MPCORB-format file (asteroids, mean anomaly at epoch)
+    static bool parseMpcAsteroid(const QString &line, OrbitalElements &out);
+    // One line of the MPC comet format (CometEls.txt, perihelion time)
+    static bool parseMpcComet(const QString &line, OrbitalElements &out);
+};
+
+/**
+ * Two-body propagation of a small body: Kepler's equation for the
+ * heliocentric position, the Earth from PlanetEphemeris, light-time
+ * iterated, then precessed to the equator of date and shifted to the
+ * observer. Elements a few weeks from their epoch stay within
+ * arcseconds to arcminutes (planetary perturbations are ignored), which
+ * is what the tracker resolves, and no table has to be downloaded.
+ */
+class SmallBodyOrbit {
+public:
+    // Stored element files (AppDataLocation/orbits): Horizons replies and MPC extracts
+    static QString orbitsDirectory();
+    // Every orbit in the directory; MPC files are read line by line, keep them to extracts
+    static QVector<OrbitalElements> loadDirectory(const QString &dir = orbitsDirectory());
+    // Stores a Horizons ELEMENTS reply for later sessions as <id>.txt
+    static bool saveHorizons(const OrbitalElements &el, const QString &text,
+                             const QString &dir = orbitsDirectory());
+
+    explicit SmallBodyOrbit(const OrbitalElements &el) : m_el(el) {}
+    const OrbitalElements &elements() const { return m_el; }
+
+    // Heliocentric ecliptic J2000 position [AU] at a TT Julian date
+    void heliocentric(double jdTT, double xyz[3]) const;
+
+    /**
+     * Geocentric astrometric RA/Dec (J2000, light-time corrected), the
+     * frame PlanetEphemeris::raDec uses; for planning
+     * @param distAu  optional distance from the Earth
+     */
+    void raDec(const QDateTime &utc, double &raDeg, double &decDeg, double *distAu = nullptr) const;
+
+    /**
+     * Topocentric RA/Dec of date at a fixed step, the input of the
+     * Horizons conversion chain (radecToAltAz, interpolation)
+     */
+    QVector<EphemRD> ephemeris(const QGeoCoordinate &site,
+                               const QDateTime &start,
+                               const QDateTime &end,
+                               int stepSec) const;
+
+    // TT - UTC, fixed since the 2017 leap second [s]
+    static constexpr double TT_MINUS_UTC_SEC = 69.184;
+
+private:
+    // Geocentric ecliptic J2000 vector [AU] with light time applied
+    void geocentric(double jdTT, double geo[3]) const;
+
+    OrbitalElements m_el;
+};
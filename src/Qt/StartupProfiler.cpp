@@ -0,0 +1,129 @@
+#include "StartupProfiler.h"
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <QDebug>
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+namespace {
+
+QElapsedTimer g_clock;
+QDateTime     g_launched;
+qint64        g_preMainMs = -1;
+
+// Time from exec to now [ms]: process start time and uptime, both from /proc
+qint64 measurePreMain()
+{
+#ifdef Q_OS_LINUX
+    QFile stat("/proc/self/stat"), uptime("/proc/uptime");
+    if (!stat.open(QIODevice::ReadOnly) || !uptime.open(QIODevice::ReadOnly)) return -1;
+    // Field 22 (starttime) counts after the ")" closing the command name
+    const QByteArray s = stat.readAll();
+    const QList<QByteArray> f = s.mid(s.lastIndexOf(')') + 2).split(' ');
+    const QList<QByteArray> u = uptime.readAll().split(' ');
+    if (f.size() < 20 || u.isEmpty()) return -1;
+    const double startedSec = f.at(19).toDouble() / double(sysconf(_SC_CLK_TCK));
+    const double nowSec = u.at(0).toDouble();
+    return (nowSec >= startedSec) ? qint64((nowSec - startedSec) * 1000.0) : -1;
+#else
+    return -1;
+#endif
+}
+
+} // namespace
+
+QVector<QPair<QString, qint64>> &StartupProfiler::phases()
+{
+    static QVector<QPair<QString, qint64>> list;
+    return list;
+}
+
+void StartupProfiler::start()
+{
+    g_clock.start();
+    g_launched = QDateTime::currentDateTimeUtc();
+    g_preMainMs = measurePreMain();
+    phases().clear();
+    mark("main");
+}
+
+void StartupProfiler::mark(const QString &phase)
+{
+    if (!g_clock.isValid()) return;
+    for (const auto &p : phases())
+        if (p.first == phase) return;
+    phases().append({ phase, g_clock.elapsed() });
+}
+
+qint64 StartupProfiler::elapsedMs()
+{
+    return g_clock.isValid() ? g_clock.elapsed() : 0;
+}
+
+qint64 StartupProfiler::preMainMs()
+{
+    return g_preMainMs;
+}
+
+QString StartupProfiler::summary()
+{
+    QString out = QString("Startup phases [ms]%1\n")
+                      .arg(g_preMainMs >= 0 ? QString(", exec -> main %1").arg(g_preMainMs) : QString());
+    qint64 prev = 0;
+    for (const auto &p : phases()) {
+        out += QString("  %1 %2  +%3\n")
+                   .arg(p.first, -28)
+                   .arg(p.second, 6)
+                   .arg(p.second - prev, 5);
+        prev = p.second;
+    }
+    return out;
+}
+
+QString StartupProfiler::resultsDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/startup";
+}
+
+bool StartupProfiler::report()
+{
+    qDebug().noquote() << summary();
+
+    QJsonObject run;
+    run["launched"]  = g_launched.toString(Qt::ISODateWithMs);
+    run["system"]    = QSysInfo::prettyProductName();
+    run["preMainMs"] = g_preMainMs;
+    QJsonArray list;
+    for (const auto &p : phases())
+        list.append(QJsonObject{ { "phase", p.first }, { "ms", p.second } });
+    run["phases"] = list;
+
+    QDir().mkpath(resultsDirectory());
+    const QString path = resultsDirectory() + "/runs.json";
+    QJsonArray runs;
+    QFile in(path);
+    if (in.open(QIODevice::ReadOnly))
+        runs = QJsonDocument::fromJson(in.readAll()).array();
+    if (!runs.isEmpty() && runs.last().toObject().value("launched") == run["launched"])
+        runs.removeLast();
+    runs.append(run);
+    while (runs.size() > MAX_RUNS)
+        runs.removeFirst();
+
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly)) {
+        qDebug() << "Startup profile: cannot write" << path;
+        return false;
+    }
+    out.write(QJsonDocument(runs).toJson());
+    return out.commit();
+}
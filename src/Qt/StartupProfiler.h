@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QPair>
+
+/**
+ * Timestamped breakdown of an app launch: process start -> main() ->
+ * QApplication -> main window -> first painted frame -> deferred
+ * initialization -> first Horizons reply. A mark is one QElapsedTimer
+ * read, so the phases can stay in release builds. Marks are taken on the
+ * GUI thread only.
+ */
+class StartupProfiler {
+public:
+    // First statement of main(); its time is zero for all later marks
+    static void start();
+    // Records `phase` at the current time; a phase already marked keeps its first time
+    static void mark(const QString &phase);
+    static qint64 elapsedMs();
+    // Process start (exec) to main() [ms]: library loading and static init, -1 if unknown
+    static qint64 preMainMs();
+
+    // One line per phase with its time and the gap to the previous one
+    static QString summary();
+    /**
+     * Logs the summary and stores this launch in
+     * <AppDataLocation>/startup/runs.json (the last MAX_RUNS launches);
+     * reporting again after later marks replaces the launch's entry
+     */
+    static bool report();
+    static QString resultsDirectory();
+
+    static constexpr int MAX_RUNS = 20;
+
+private:
+    static QVector<QPair<QString, qint64>> &phases();
+};
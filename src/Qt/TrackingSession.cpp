@@ -0,0 +1,188 @@
+#include "TrackingSession.h"
+#include "bluetoothmanager.h"
+#include <QDebug>
+#include <algorithm>
+
+TrackingSession::TrackingSession(BluetoothManager *bt, QObject *parent)
+    : QObject(parent)
+    , m_bt(bt)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &TrackingSession::onDeadline);
+}
+
+void TrackingSession::start(const QVector<StepRecord> &plan, const QDateTime &baseTime, int firstIndex)
+{
+    ++m_generation;
+    m_prepPending = false;
+    m_timer.stop();
+    m_plan     = plan;
+    m_index    = qBound(0, firstIndex, int(m_plan.size()));
+    m_lateness.clear();
+    m_commands = 0;
+    m_merged   = 0;
+    m_records  = 0;
+    m_catchUp  = false;
+
+    // Wall clock is read once; from here on only the monotonic clock counts
+    m_clock.start();
+    m_originMs = QDateTime::currentDateTime().msecsTo(baseTime);
+    m_state    = Running;
+    armNext();
+}
+
+void TrackingSession::startWithPrep(const QVector<StepRecord> &plan, const QDateTime &baseTime)
+{
+    if (!m_bt || plan.isEmpty()) return;
+    const int generation = ++m_generation;
+    m_timer.stop();
+    m_plan  = plan;
+    m_index = 0;
+    m_handOverAt = QDateTime();
+    m_state = Running;
+    m_prepPending = true;
+
+    m_bt->sendCommand("PREP\n");
+    QTimer::singleShot(PREP_GAP_MS, this, [this, generation, baseTime]() {
+        if (generation != m_generation || m_state != Running) return;   // restarted or cancelled
+        const StepRecord &prep = m_plan.first();
+        m_bt->sendCommand(QString("STEP %1 %2\n").arg(prep.deltaPan).arg(prep.deltaTilt).toUtf8());
+        start(m_plan, baseTime, 1);   // 0 went out as STEP
+        m_commands = 2;               // PREP and that STEP
+    });
+}
+
+void TrackingSession::handOver(const QDateTime &at)
+{
+    if (!isActive()) return;
+    m_handOverAt = at;
+    if (m_state == Running && !m_prepPending) armNext();
+}
+
+bool TrackingSession::nudge(int pan, int tilt)
+{
+    if (m_state != Running || m_prepPending) return false;
+    send(pan, tilt);
+    return true;
+}
+
+void TrackingSession::pause()
+{
+    if (m_state != Running || m_prepPending) return;
+    m_timer.stop();
+    m_state = Paused;
+    qDebug() << "Tracking paused at record" << m_index;
+}
+
+void TrackingSession::resume()
+{
+    if (m_state != Paused) return;
+    // The sky kept moving: everything due meanwhile goes out as one move
+    m_state   = Running;
+    m_catchUp = true;
+    armNext();
+}
+
+void TrackingSession::cancel()
+{
+    if (!isActive()) return;
+    ++m_generation;
+    m_prepPending = false;
+    m_timer.stop();
+    m_state = Cancelled;
+    m_handOverAt = QDateTime();
+    emit finished(stats());
+}
+
+void TrackingSession::armNext()
+{
+    if (m_index < m_plan.size() && m_handOverAt.isValid()
+        && deadlineMs(m_index) >= m_clock.elapsed() + QDateTime::currentDateTimeUtc().msecsTo(m_handOverAt)) {
+        // The rest of the plan runs on the device
+        m_timer.stop();
+        m_state = Finished;
+        m_handOverAt = QDateTime();
+        qDebug() << "Step session handed over to the device at record" << m_index;
+        emit finished(stats());
+        return;
+    }
+    if (m_index >= m_plan.size()) {
+        m_state = Finished;
+        m_handOverAt = QDateTime();
+        const Stats st = stats();
+        qDebug() << "Trajectory completed:" << st.commands << "commands," << st.merged
+                 << "merged, lateness of" << st.latenessSamples << "mean" << st.latenessMeanMs << "ms p95"
+                 << st.latenessP95Ms << "ms max" << st.latenessMaxMs << "ms";
+        emit finished(st);
+        return;
+    }
+    m_timer.start(int(qMax<qint64>(0, deadlineMs(m_index) - m_clock.elapsed())));
+}
+
+void TrackingSession::onDeadline()
+{
+    if (m_state != Running) return;
+
+    // Everything due by now is merged into one command
+    const qint64 now = m_clock.elapsed();
+    const qint64 firstDeadline = deadlineMs(m_index);
+    int pan = 0, tilt = 0, n = 0;
+    while (m_index < m_plan.size() && deadlineMs(m_index) <= now) {
+        pan  += m_plan[m_index].deltaPan;
+        tilt += m_plan[m_index].deltaTilt;
+        ++m_index;
+        ++n;
+    }
+    if (n == 0) {   // woke up early
+        armNext();
+        return;
+    }
+
+    m_records += n;
+    m_merged  += n - 1;
+    // Steps that cancel out send nothing, so there is no lateness to record
+    if (send(pan, tilt) && !m_catchUp) m_lateness.append(double(now - firstDeadline));
+    m_catchUp = false;
+
+    emit progress(m_index, m_plan.size());
+    armNext();
+}
+
+bool TrackingSession::send(int pan, int tilt)
+{
+    if (!m_bt || (pan == 0 && tilt == 0)) return false;
+    ++m_commands;
+
+    if (qAbs(pan) > 1 || qAbs(tilt) > 1 || (pan != 0 && tilt != 0)) {
+        // Both axes or a larger correction (pan unwind): one relative move
+        m_bt->sendCommand(QString("MOVE %1 %2\n").arg(pan).arg(tilt).toUtf8());
+    } else if (pan != 0) {
+        m_bt->sendCommand(pan > 0 ? QByteArray("FRIGHT\n") : QByteArray("FLEFT\n"));
+    } else {
+        m_bt->sendCommand(tilt > 0 ? QByteArray("FUP\n") : QByteArray("FDOWN\n"));
+    }
+    return true;
+}
+
+TrackingSession::Stats TrackingSession::stats() const
+{
+    Stats st;
+    st.commands        = m_commands;
+    st.latenessSamples = m_lateness.size();
+    st.records         = m_records;
+    st.merged          = m_merged;
+    if (m_lateness.isEmpty()) return st;
+
+    QVector<double> sorted = m_lateness;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for (double v : sorted) {
+        sum += v;
+        if (v > LATE_MS) ++st.late;
+    }
+    st.latenessMeanMs = sum / sorted.size();
+    st.latenessP95Ms  = sorted[qMin(int(sorted.size()) - 1, int(sorted.size() * 0.95))];
+    st.latenessMaxMs  = sorted.last();
+    return st;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <QObject>
+#include <QVector>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QTimer>
+#include "EphemerisTypes.h"
+
+class BluetoothManager;
+
+/**
+ * Plays a step plan (StepRecord offsets from a base time) to the ESP in
+ * real time. The session owns its plan and arms one precise single-shot
+ * timer for the next deadline on the monotonic clock; when it fires, all
+ * records already due are merged into one command. Lateness of every
+ * command against its deadline is collected.
+ */
+class TrackingSession : public QObject {
+    Q_OBJECT
+public:
+    enum State { Idle, Running, Paused, Finished, Cancelled };
+
+    struct Stats {
+        int    commands = 0;        // commands sent: steps, moves, nudges, catch-ups
+        int    records = 0;         // plan records consumed
+        int    merged = 0;          // records folded into an earlier command
+        int    latenessSamples = 0; // commands timed against a deadline (not catch-ups, nudges)
+        int    late = 0;            // of those, more than LATE_MS after their deadline
+        double latenessMeanMs = 0.0;
+        double latenessP95Ms = 0.0;
+        double latenessMaxMs = 0.0;
+    };
+
+    // A command this late is counted in Stats::late
+    static constexpr double LATE_MS = 10.0;
+    // Time the ESP gets to handle PREP before the first STEP
+    static const int PREP_GAP_MS = 200;
+
+    explicit TrackingSession(BluetoothManager *bt, QObject *parent = nullptr);
+
+    /**
+     * Starts playing the plan
+     * @param plan        step records, offsets ascending
+     * @param baseTime    wall-clock time of offset 0
+     * @param firstIndex  first record to play (earlier ones were sent already)
+     */
+    void start(const QVector<StepRecord> &plan, const QDateTime &baseTime, int firstIndex = 0);
+
+    /**
+     * Full device handshake: PREP (slew to the first point), record 0 as
+     * STEP after PREP_GAP_MS, then the rest on their deadlines. The gap is
+     * a timer, not a sleep, so sessions on other devices keep running.
+     */
+    void startWithPrep(const QVector<StepRecord> &plan, const QDateTime &baseTime);
+
+    /**
+     * The device takes the session over at `at` (SPLICE into a stepped
+     * session): records due from then on are not sent. An invalid time
+     * withdraws the handover, e.g. when the device refused the splice
+     */
+    void handOver(const QDateTime &at);
+    /**
+     * Manual correction while playing: one relative move now, the plan
+     * continues from the shifted position
+     * @return false if the session is not playing
+     */
+    bool nudge(int pan, int tilt);
+
+    // Stops sending; resume() catches up with one merged command
+    void pause();
+    void resume();
+    void cancel();
+
+    State state() const { return m_state; }
+    bool isActive() const { return m_state == Running || m_state == Paused; }
+    int position() const { return m_index; }
+    int size() const { return m_plan.size(); }
+    Stats stats() const;
+
+signals:
+    void progress(int index, int total);
+    void finished(const TrackingSession::Stats &stats);
+
+private slots:
+    void onDeadline();
+
+private:
+    qint64 deadlineMs(int index) const { return m_originMs + qint64(m_plan[index].offset_ms); }
+    void armNext();
+    // @return false if there was nothing to send
+    bool send(int pan, int tilt);
+
+    BluetoothManager   *m_bt;
+    QVector<StepRecord> m_plan;
+    int                 m_index = 0;
+    State               m_state = Idle;
+    QTimer              m_timer;
+    QElapsedTimer       m_clock;
+    qint64              m_originMs = 0;      // monotonic time of offset 0
+    bool                m_catchUp = false;   // next batch follows a pause
+    QVector<double>     m_lateness;
+    int                 m_commands = 0;
+    int                 m_merged = 0;
+    int                 m_records = 0;
+    int                 m_generation = 0;    // invalidates a pending PREP gap
+    bool                m_prepPending = false;
+    QDateTime           m_handOverAt;        // device tracks on its own from here
+};
@@ -0,0 +1,264 @@
+#include "VisibilityPlanner.h"
+#include "AstroMath.h"
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtMath>
+#include <QDebug>
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+// Coarse sampling: shorter than any window worth planning for
+const int    SAMPLE_STEP_SEC = 300;
+const int    ROOT_TOL_MS     = 1000;
+// Standard altitudes of the apparent horizon (refraction, Sun's semi-diameter)
+const double HORIZON_DEG     = -0.5667;
+const double SUN_HORIZON_DEG = -0.8333;
+
+using ElevationFn = std::function<double(const QDateTime &)>;
+
+// Bisection on a sign change of f(t) - level inside [a, b]
+QDateTime refineCrossing(const ElevationFn &f, QDateTime a, QDateTime b, double level)
+{
+    const bool aBelow = f(a) < level;
+    while (a.msecsTo(b) > ROOT_TOL_MS) {
+        QDateTime mid = a.addMSecs(a.msecsTo(b) / 2);
+        if ((f(mid) < level) == aBelow) a = mid; else b = mid;
+    }
+    return a.addMSecs(a.msecsTo(b) / 2);
+}
+
+// Golden-section search for the maximum of a unimodal f in [a, b]
+QDateTime refineMaximum(const ElevationFn &f, QDateTime a, QDateTime b)
+{
+    const double r = 0.6180339887498949;
+    qint64 span = a.msecsTo(b);
+    QDateTime c = b.addMSecs(-qint64(span * r));
+    QDateTime d = a.addMSecs(qint64(span * r));
+    double fc = f(c), fd = f(d);
+    while (a.msecsTo(b) > ROOT_TOL_MS) {
+        if (fc > fd) {
+            b = d; d = c; fd = fc;
+            c = b.addMSecs(-qint64(a.msecsTo(b) * r));
+            fc = f(c);
+        } else {
+            a = c; c = d; fc = fd;
+            d = a.addMSecs(qint64(a.msecsTo(b) * r));
+            fd = f(d);
+        }
+    }
+    return a.addMSecs(a.msecsTo(b) / 2);
+}
+
+} // namespace
+
+VisibilityTarget VisibilityTarget::planet(PlanetEphemeris::Body b)
+{
+    VisibilityTarget t;
+    t.kind = SolarSystem;
+    t.body = b;
+    t.name = PlanetEphemeris::name(b);
+    return t;
+}
+
+VisibilityTarget VisibilityTarget::fixed(const QString &name, double raDeg, double decDeg, float mag)
+{
+    VisibilityTarget t;
+    t.kind   = Fixed;
+    t.name   = name;
+    t.raDeg  = raDeg;
+    t.decDeg = decDeg;
+    t.mag    = mag;
+    return t;
+}
+
+VisibilityTarget VisibilityTarget::smallBody(const OrbitalElements &el)
+{
+    VisibilityTarget t;
+    t.kind  = SmallBody;
+    t.name  = el.name.isEmpty() ? el.designation : el.name;
+    t.orbit = el;
+    return t;
+}
+
+VisibilityPlanner::VisibilityPlanner(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_watcher, &QFutureWatcher<TargetVisibility>::finished,
+            this, &VisibilityPlanner::onFinished);
+}
+
+VisibilityPlanner::~VisibilityPlanner()
+{
+    m_watcher.cancel();
+    m_watcher.waitForFinished();
+}
+
+double VisibilityPlanner::elevation(const VisibilityTarget &target,
+                                    const QGeoCoordinate &site,
+                                    const QDateTime &utc)
+{
+    double az, el;
+    altAz(target, site, utc, az, el);
+    return el;
+}
+
+void VisibilityPlanner::altAz(const VisibilityTarget &target,
+                              const QGeoCoordinate &site,
+                              const QDateTime &utc,
+                              double &azDeg,
+                              double &elDeg)
+{
+    double ra = target.raDeg, dec = target.decDeg, distKm = 0.0;
+    if (target.kind == VisibilityTarget::SolarSystem)
+        PlanetEphemeris::raDec(target.body, utc, ra, dec, &distKm);
+    else if (target.kind == VisibilityTarget::SmallBody)
+        SmallBodyOrbit(target.orbit).raDec(utc, ra, dec);
+
+    const double lst = AstroMath::lstDeg(AstroMath::julianDay(utc), site.longitude());
+    AstroMath::raDecToAltAz(ra, dec, site.latitude(), lst, azDeg, elDeg);
+
+    // Moon: geocentric -> topocentric, parallax up to ~1°
+    if (target.kind == VisibilityTarget::SolarSystem && target.body == PlanetEphemeris::Moon)
+        elDeg -= qRadiansToDegrees(qAsin(6378.14 / distKm)) * qCos(qDegreesToRadians(elDeg));
+}
+
+TargetVisibility VisibilityPlanner::evaluate(const VisibilityTarget &target,
+                                             const QGeoCoordinate &site,
+                                             const QDateTime &fromUtc,
+                                             const QDateTime &toUtc,
+                                             double minElDeg,
+                                             const HorizonMask *mask)
+{
+    TargetVisibility out;
+    out.target = target;
+    if (!(fromUtc < toUtc)) return out;
+
+    const ElevationFn f = [&](const QDateTime &t) { return elevation(target, site, t); };
+    // Height above what can be seen there: the threshold or the local horizon
+    const ElevationFn clearance = [&](const QDateTime &t) {
+        double az, el;
+        altAz(target, site, t, az, el);
+        return el - (mask ? qMax(minElDeg, mask->limitAt(az)) : minElDeg);
+    };
+    const double horizon = (target.kind == VisibilityTarget::SolarSystem
+                            && target.body == PlanetEphemeris::Sun) ? SUN_HORIZON_DEG : HORIZON_DEG;
+
+    // Coarse samples, the last one exactly at the end
+    QVector<QDateTime> ts;
+    QVector<double>    els, clr;
+    for (QDateTime t = fromUtc; t < toUtc; t = t.addSecs(SAMPLE_STEP_SEC)) {
+        ts.append(t);
+        els.append(f(t));
+        clr.append(clearance(t));
+    }
+    ts.append(toUtc);
+    els.append(f(toUtc));
+    clr.append(clearance(toUtc));
+
+    QDateTime windowStart;
+    if (clr.first() >= 0.0) windowStart = fromUtc;
+
+    for (int k = 0; k + 1 < ts.size(); ++k) {
+        const double e0 = els[k], e1 = els[k + 1];
+
+        if ((e0 < horizon) != (e1 < horizon)) {
+            QDateTime t = refineCrossing(f, ts[k], ts[k + 1], horizon);
+            if (e0 < horizon) { if (!out.rise.isValid()) out.rise = t; }
+            else              { if (!out.set.isValid())  out.set  = t; }
+        }
+        if ((clr[k] < 0.0) != (clr[k + 1] < 0.0)) {
+            QDateTime t = refineCrossing(clearance, ts[k], ts[k + 1], 0.0);
+            if (clr[k] < 0.0) {
+                windowStart = t;
+            } else if (windowStart.isValid()) {
+                out.windows.append({ windowStart, t });
+                windowStart = QDateTime();
+            }
+        }
+    }
+    if (windowStart.isValid())
+        out.windows.append({ windowStart, toUtc });
+
+    // Culmination: refine around the best sample unless it sits on an edge
+    int best = int(std::max_element(els.begin(), els.end()) - els.begin());
+    out.maxElDeg = els[best];
+    if (best > 0 && best + 1 < ts.size()) {
+        out.transit  = refineMaximum(f, ts[best - 1], ts[best + 1]);
+        out.maxElDeg = qMax(out.maxElDeg, f(out.transit));
+    }
+
+    // Rank: usable time weighted by how high it gets
+    for (const VisibilityWindow &w : out.windows)
+        out.visibleSecs += w.start.secsTo(w.end);
+    out.score = out.visibleSecs / 3600.0 * qSin(qDegreesToRadians(qMax(0.0, out.maxElDeg)));
+    return out;
+}
+
+bool VisibilityPlanner::nightWindow(const QGeoCoordinate &site,
+                                    const QDateTime &fromUtc,
+                                    double sunAltDeg,
+                                    QDateTime &duskUtc,
+                                    QDateTime &dawnUtc)
+{
+    const VisibilityTarget sun = VisibilityTarget::planet(PlanetEphemeris::Sun);
+    const ElevationFn f = [&](const QDateTime &t) { return elevation(sun, site, t); };
+    const QDateTime limit = fromUtc.addSecs(24 * 3600);
+
+    duskUtc = QDateTime();
+    QDateTime t = fromUtc;
+    if (f(t) < sunAltDeg) {
+        duskUtc = fromUtc;
+    } else {
+        for (; t < limit; t = t.addSecs(SAMPLE_STEP_SEC)) {
+            QDateTime next = t.addSecs(SAMPLE_STEP_SEC);
+            if (f(next) < sunAltDeg) {
+                duskUtc = refineCrossing(f, t, next, sunAltDeg);
+                break;
+            }
+        }
+        if (!duskUtc.isValid()) return false;
+    }
+
+    // Polar night: no dawn within a day, plan one day ahead
+    dawnUtc = duskUtc.addSecs(24 * 3600);
+    for (t = duskUtc; t < duskUtc.addSecs(24 * 3600); t = t.addSecs(SAMPLE_STEP_SEC)) {
+        QDateTime next = t.addSecs(SAMPLE_STEP_SEC);
+        if (f(next) >= sunAltDeg) {
+            dawnUtc = refineCrossing(f, t, next, sunAltDeg);
+            break;
+        }
+    }
+    return true;
+}
+
+void VisibilityPlanner::plan(const QVector<VisibilityTarget> &targets,
+                             const QGeoCoordinate &site,
+                             const QDateTime &fromUtc,
+                             const QDateTime &toUtc,
+                             double minElDeg,
+                             const HorizonMask &mask)
+{
+    if (m_watcher.isRunning()) {
+        m_watcher.cancel();
+        m_watcher.waitForFinished();
+    }
+    std::function<TargetVisibility(const VisibilityTarget &)> fn =
+        [site, fromUtc, toUtc, minElDeg, mask](const VisibilityTarget &t) {
+            return evaluate(t, site, fromUtc, toUtc, minElDeg, &mask);
+        };
+    m_watcher.setFuture(QtConcurrent::mapped(targets, fn));
+}
+
+void VisibilityPlanner::onFinished()
+{
+    if (m_watcher.isCanceled()) return;
+
+    QVector<TargetVisibility> schedule = m_watcher.future().results();
+    std::stable_sort(schedule.begin(), schedule.end(),
+                     [](const TargetVisibility &a, const TargetVisibility &b) {
+                         return a.score > b.score;
+                     });
+    qDebug() << "Visibility plan:" << schedule.size() << "targets";
+    emit planReady(schedule);
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <QObject>
+#include <QVector>
+#include <QDateTime>
+#include <QGeoCoordinate>
+#include <QFutureWatcher>
+#include "PlanetEphemeris.h"
+#include "HorizonMask.h"
+#include "SmallBodyOrbit.h"
+
+// Something the planner can compute Alt/Az for without network access
+struct VisibilityTarget {
+    enum Kind { SolarSystem, Fixed, SmallBody };
+
+    Kind                  kind = Fixed;
+    QString               name;
+    PlanetEphemeris::Body body = PlanetEphemeris::Sun;  // SolarSystem only
+    double                raDeg = 0.0;                  // Fixed only, J2000
+    double                decDeg = 0.0;
+    float                 mag = 0.0f;
+    OrbitalElements       orbit;                        // SmallBody only
+
+    static VisibilityTarget planet(PlanetEphemeris::Body b);
+    static VisibilityTarget fixed(const QString &name, double raDeg, double decDeg, float mag);
+    static VisibilityTarget smallBody(const OrbitalElements &el);
+};
+
+struct VisibilityWindow {
+    QDateTime start;
+    QDateTime end;
+};
+
+// Result for one target over the scanned interval
+struct TargetVisibility {
+    VisibilityTarget          target;
+    QDateTime                 rise;       // invalid if not within the interval
+    QDateTime                 set;
+    QDateTime                 transit;    // highest point, invalid if at an interval edge
+    double                    maxElDeg = -90.0;
+    QVector<VisibilityWindow> windows;    // above the threshold and the local horizon
+    qint64                    visibleSecs = 0;
+    double                    score = 0.0;
+
+    bool isVisible() const { return !windows.isEmpty(); }
+};
+
+/**
+ * Scans a time interval (typically the coming night) for many targets at
+ * once. Elevation is sampled coarsely and every rise/set/threshold
+ * crossing is refined by bisection, the culmination by golden-section
+ * search. Targets are evaluated in parallel on the global thread pool;
+ * the schedule comes back ranked, best first.
+ */
+class VisibilityPlanner : public QObject {
+    Q_OBJECT
+public:
+    explicit VisibilityPlanner(QObject *parent = nullptr);
+    ~VisibilityPlanner();
+
+    /**
+     * Starts planning in the background, planReady is emitted when done;
+     * a plan still running is cancelled
+     * @param minElDeg  elevation threshold of the usable windows
+     * @param mask      local horizon; windows also end where it blocks the view
+     */
+    void plan(const QVector<VisibilityTarget> &targets,
+              const QGeoCoordinate &site,
+              const QDateTime &fromUtc,
+              const QDateTime &toUtc,
+              double minElDeg,
+              const HorizonMask &mask = HorizonMask());
+    bool isRunning() const { return m_watcher.isRunning(); }
+
+    // Single target, synchronous (session clipping)
+    static TargetVisibility evaluate(const VisibilityTarget &target,
+                                     const QGeoCoordinate &site,
+                                     const QDateTime &fromUtc,
+                                     const QDateTime &toUtc,
+                                     double minElDeg,
+                                     const HorizonMask *mask = nullptr);
+
+    /**
+     * Next dark interval: Sun below sunAltDeg, starting no earlier than fromUtc
+     * @return false if the Sun does not go that low within 24 h
+     */
+    static bool nightWindow(const QGeoCoordinate &site,
+                            const QDateTime &fromUtc,
+                            double sunAltDeg,
+                            QDateTime &duskUtc,
+                            QDateTime &dawnUtc);
+
+    // Topocentric elevation of a target
+    static double elevation(const VisibilityTarget &target,
+                            const QGeoCoordinate &site,
+                            const QDateTime &utc);
+    // Topocentric azimuth and elevation of a target
+    static void altAz(const VisibilityTarget &target,
+                      const QGeoCoordinate &site,
+                      const QDateTime &utc,
+                      double &azDeg,
+                      double &elDeg);
+
+signals:
+    void planReady(const QVector<TargetVisibility> &schedule);
+
+private slots:
+    void onFinished();
+
+private:
+    QFutureWatcher<TargetVisibility> m_watcher;
+};
@@ -4,14 +4,8 @@
 
 BluetoothManager::BluetoothManager(QObject* parent)
     : QObject(parent)
-    , m_discoveryAgent(new QBluetoothDeviceDiscoveryAgent(this))
     , m_socket(new QBluetoothSocket(QBluetoothServiceInfo::RfcommProtocol, this))
 {
-    connect(m_discoveryAgent, &QBluetoothDeviceDiscoveryAgent::deviceDiscovered,
-            this, &BluetoothManager::onDeviceDiscovered);
-    connect(m_discoveryAgent, &QBluetoothDeviceDiscoveryAgent::finished,
-            this, &BluetoothManager::onScanFinished);
-
     connect(m_socket, &QBluetoothSocket::connected,
             this, &BluetoothManager::onSocketConnected);
     connect(m_socket, &QBluetoothSocket::disconnected,
@@ -32,6 +26,14 @@ BluetoothManager::~BluetoothManager()
 
 void BluetoothManager::startScan()
 {
+    // Created on first use: the agent binds the adapter, which only slows startup
+    if (!m_discoveryAgent) {
+        m_discoveryAgent = new QBluetoothDeviceDiscoveryAgent(this);
+        connect(m_discoveryAgent, &QBluetoothDeviceDiscoveryAgent::deviceDiscovered,
+                this, &BluetoothManager::onDeviceDiscovered);
+        connect(m_discoveryAgent, &QBluetoothDeviceDiscoveryAgent::finished,
+                this, &BluetoothManager::onScanFinished);
+    }
     m_discoveryAgent->start();
 }
 
@@ -54,6 +56,8 @@ void BluetoothManager::connectToDevice(const QBluetoothAddress& address)
 
 void BluetoothManager::onSocketConnected()
 {
+    resetStats();
+    m_stats.connectedAtMs = QDateTime::currentMSecsSinceEpoch();
     emit connected();
     // Synchronize ESP time with host
     qint64 utcMs = QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
@@ -63,12 +67,14 @@ void BluetoothManager::onSocketConnected()
 
 void BluetoothManager::onSocketDisconnected()
 {
+    m_stats.connectedAtMs = 0;
     emit disconnected();
 }
 
 void BluetoothManager::onSocketError(QBluetoothSocket::SocketError err)
 {
     Q_UNUSED(err)
+    ++m_stats.errors;
     emit errorOccurred(m_socket->errorString());
 }
 
@@ -77,7 +83,10 @@ void BluetoothManager::sendCommand(const QByteArray& data)
     // Improved connection state check
     if (m_socket->state() == QBluetoothSocket::SocketState::ConnectedState) {
         m_socket->write(data);
+        m_stats.bytesSent += quint64(data.size());
+        ++m_stats.writes;
     } else {
+        ++m_stats.rejectedWrites;
         emit errorOccurred(QStringLiteral("Not connected"));
     }
 }
@@ -85,9 +94,21 @@ void BluetoothManager::sendCommand(const QByteArray& data)
 void BluetoothManager::onReadyRead()
 {
     QByteArray fromEsp = m_socket->readAll();
+    m_stats.bytesReceived += quint64(fromEsp.size());
+    ++m_stats.reads;
     emit dataReceived(fromEsp);
 }
 
 QBluetoothSocket* BluetoothManager::socket() const {
     return m_socket;
 }
+
+bool BluetoothManager::isConnected() const {
+    return m_socket->state() == QBluetoothSocket::SocketState::ConnectedState;
+}
+
+void BluetoothManager::resetStats() {
+    const qint64 since = m_stats.connectedAtMs;
+    m_stats = LinkStats();
+    m_stats.connectedAtMs = since;
+}
@@ -7,6 +7,17 @@
 #include <QtBluetooth/QBluetoothUuid>
 #include <QtBluetooth/QBluetoothServiceInfo>
 
+// Traffic counters since connect (or the last resetStats)
+struct LinkStats {
+    quint64 bytesSent = 0;
+    quint64 bytesReceived = 0;
+    int     writes = 0;
+    int     reads = 0;
+    int     rejectedWrites = 0;   // sendCommand while not connected
+    int     errors = 0;
+    qint64  connectedAtMs = 0;    // UTC, 0 = not connected
+};
+
 class BluetoothManager : public QObject {
     Q_OBJECT
 public:
@@ -17,6 +28,9 @@ public:
     void connectToDevice(const QBluetoothAddress& address);
     void sendCommand(const QByteArray& data);
     QBluetoothSocket* socket() const;
+    bool isConnected() const;
+    const LinkStats& stats() const { return m_stats; }
+    void resetStats();
 
 signals:
     void deviceDiscovered(const QBluetoothDeviceInfo& info);
@@ -34,7 +48,8 @@ private slots:
     void onReadyRead();
 
 private:
-    QBluetoothDeviceDiscoveryAgent* m_discoveryAgent;
+    QBluetoothDeviceDiscoveryAgent* m_discoveryAgent = nullptr;   // created by startScan()
     QBluetoothSocket* m_socket;
+    LinkStats m_stats;
 };
 
@@ -1,7 +1,7 @@
 TEMPLATE = app
 TARGET = gigaprojekt
 
-QT += core gui network positioning bluetooth widgets
+QT += core gui network positioning bluetooth widgets concurrent
 
 RESOURCES += resources.qrc
 
@@ -11,12 +11,47 @@ SOURCES += \
     main.cpp \
     mainwindow.cpp \
     bluetoothmanager.cpp \
-    HorizonsManager.cpp
+    HorizonsManager.cpp \
+    PanWrapPlanner.cpp \
+    JoystickWidget.cpp \
+    AstroMath.cpp \
+    SkyCatalog.cpp \
+    Sgp4.cpp \
+    SatellitePredictor.cpp \
+    PlanetEphemeris.cpp \
+    VisibilityPlanner.cpp \
+    LinkBenchmark.cpp \
+    TrackingSession.cpp \
+    PlanFile.cpp \
+    HorizonMask.cpp \
+    SmallBodyOrbit.cpp \
+    StartupProfiler.cpp \
+    DeviceRegistry.cpp \
+    EphemerisPrefetcher.cpp \
+    SimulatedLink.cpp
 
 HEADERS += \
     mainwindow.h \
     bluetoothmanager.h \
-    HorizonsManager.h
+    HorizonsManager.h \
+    EphemerisTypes.h \
+    PanWrapPlanner.h \
+    JoystickWidget.h \
+    AstroMath.h \
+    SkyCatalog.h \
+    Sgp4.h \
+    SatellitePredictor.h \
+    PlanetEphemeris.h \
+    VisibilityPlanner.h \
+    LinkBenchmark.h \
+    TrackingSession.h \
+    PlanFile.h \
+    HorizonMask.h \
+    SmallBodyOrbit.h \
+    StartupProfiler.h \
+    DeviceRegistry.h \
+    EphemerisPrefetcher.h \
+    SimulatedLink.h
 
 FORMS += mainwindow.ui
 
@@ -1,31 +1,55 @@
 #include "mainwindow.h"
-#include <QSslSocket>
-#include <QSslCertificate>
-#include <QSslConfiguration>
+#include "LinkBenchmark.h"
+#include "SimulatedLink.h"
+#include "StartupProfiler.h"
+#include "HorizonsManager.h"
+#include <QCommandLineParser>
+#include <QTextStream>
 
 #include <QApplication>
 
+// Headless LinkBenchmark run against SimulatedLink, prints and saves the result
+static int runSimulatedLinkBenchmark(QApplication &app)
+{
+    QCommandLineParser p;
+    p.addOption({ "link-benchmark-sim", "Benchmark the simulated link and exit" });
+    p.addOption({ "sim-latency",   "One-way latency [ms]",   "ms",    "15" });
+    p.addOption({ "sim-jitter",    "Latency jitter [ms]",    "ms",    "5" });
+    p.addOption({ "sim-bandwidth", "Link rate [bytes/s]",    "bytes", "20000" });
+    p.addOption({ "sim-loss",      "Reply loss probability", "p",     "0" });
+    p.process(app);
+
+    SimulatedLink link;
+    link.setLatency(p.value("sim-latency").toDouble(), p.value("sim-jitter").toDouble());
+    link.setBandwidth(p.value("sim-bandwidth").toDouble());
+    link.setLoss(p.value("sim-loss").toDouble());
+
+    LinkBenchmark bench([&link](const QByteArray &d) { link.write(d); });
+    QObject::connect(&link, &SimulatedLink::dataReceived, &bench, &LinkBenchmark::feed);
+    QObject::connect(&bench, &LinkBenchmark::finished, &app, [&app](const LinkBenchmarkResult &r) {
+        QTextStream(stdout) << r.summary() << "\n";
+        LinkBenchmark::saveResult(r);
+        app.exit(r.completed ? 0 : 1);
+    });
+    bench.start("simulated");
+    return app.exec();
+}
+
 int main(int argc, char *argv[])
 {
-    qDebug() << "SSL support:" << QSslSocket::supportsSsl();
-    // → true
-    qDebug() << "SSL build version:" << QSslSocket::sslLibraryBuildVersionString();
-    // → np. “OpenSSL 1.1.1k …”
+    StartupProfiler::start();
 
     QApplication a(argc, argv);
+    if (a.arguments().contains("--link-benchmark-sim"))
+        return runSimulatedLinkBenchmark(a);
+    StartupProfiler::mark("QApplication");
+
+    // Parsing the bundle (and loading the TLS library) runs beside the UI
+    // setup; HorizonsManager applies it before its first HTTPS connection
+    HorizonsManager::loadCaCertificates(":/certs/cacert.pem");
 
-    auto caCerts = QSslCertificate::fromPath(":/certs/cacert.pem", QSsl::Pem);
-    qDebug() << "Loaded CA certificates:" << caCerts.count();
-    if (caCerts.isEmpty()) {
-        qWarning() << "Failed to load CACERT.PEM!";
-    } else {
-        // Add certificates to the default SSL configuration
-        QSslConfiguration cfg = QSslConfiguration::defaultConfiguration();
-        cfg.setCaCertificates(caCerts);
-        QSslConfiguration::setDefaultConfiguration(cfg);
-        qDebug() << "CACERT.PEM successfully loaded from resources.";
-    }
     MainWindow w;
+    StartupProfiler::mark("main window constructed");
     w.show();
     return a.exec();
 }
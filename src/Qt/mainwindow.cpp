@@ -1,10 +1,58 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "bluetoothmanager.h"
+#include "JoystickWidget.h"
+#include "DeviceRegistry.h"
+#include "EphemerisPrefetcher.h"
+#include "PlanFile.h"
+#include "AstroMath.h"
+#include "StartupProfiler.h"
 #include <QTimer>
 #include <QMessageBox>
+#include <algorithm>
 
 
+// "What's up": objects lower than this are not offered
+static const double CATALOG_MIN_EL  = 15.0;
+static const int    CATALOG_MAX_LIST = 60;
+
+// Satellite passes: search window, plan rate and time to slew to the start
+static const double SAT_SEARCH_HOURS = 2.0;
+static const double SAT_RATE_HZ      = 20.0;
+static const int    SAT_LEAD_SEC     = 15;
+static const int    SAT_TCA_GUARD_SEC = 60;   // no pan unwind this close to the highest point
+
+// Night plan starts at civil dusk; planet sessions are clipped to this elevation
+static const double NIGHT_SUN_ALT    = -6.0;
+static const double SESSION_MIN_EL   = 5.0;
+static const int    SESSION_SECS     = 3600;
+static const int    SESSION_STEP_SEC = 4;
+// No pan unwind this close to the culmination: azimuth moves fastest there
+// and it is usually the best part of the session
+static const int    TRANSIT_GUARD_SEC = 900;
+
+// Comet / asteroid elements older than this are fetched again before a session
+static const double ORBIT_MAX_AGE_DAYS = 30.0;
+
+// Local horizon: recording sample rate, and obstructions shorter than this
+// are tracked through instead of splitting a session
+static const int    HORIZON_POLL_MS    = 200;
+static const int    HORIZON_BRIDGE_SEC = 60;
+
+// Catalog_Combo item data
+enum { ItemKindRole = Qt::UserRole, ItemIndexRole };
+enum { CatalogItem, SatelliteItem, PlannedItem, SmallBodyItem };
+
+// Manual jog: stream rate and speed range [steps/s]
+static const int    JOG_PERIOD_MS    = 40;
+static const double JOG_MAX_PAN      = 2000.0;
+static const double JOG_MAX_TILT     = 1000.0;
+static const double JOG_MIN_FRACTION = 0.1;   // speed right after the hold starts
+static const double JOG_RAMP_SEC     = 1.5;   // hold time to reach full speed
+// A tap while a plan is followed shifts its path by this much [deg]
+static const double NUDGE_DEG        = 0.1;
+static const int    NUDGE_BLEND_MS   = 500;
+
 #ifdef Q_OS_ANDROID
 #include <QJniObject>
 #include <QJniEnvironment>
@@ -15,18 +63,36 @@ MainWindow::MainWindow(QWidget *parent)
     , ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
-
-#ifdef Q_OS_ANDROID
-    requestAndroidPermissions();
-#endif
-
+    StartupProfiler::mark("UI set up");
+    // Permissions, positioning, stored orbits and the network warm-up wait
+    // for the first frame: deferredInit()
+    installEventFilter(this);
 
     m_bt = new BluetoothManager(this);
+    connect(m_bt, &BluetoothManager::dataReceived, this, &MainWindow::onDeviceData);
+
+    // The main link is tracker 1; more can be added from the Other page
+    m_devices = new DeviceRegistry(this);
+    m_devices->adoptDevice(m_bt, "main");
+    connect(m_devices, &DeviceRegistry::deviceConnected, this, [=](int id) {
+        statusBar()->showMessage(QString("%1 connected (%2 of %3 trackers)")
+                                     .arg(m_devices->name(id))
+                                     .arg(m_devices->connectedCount())
+                                     .arg(m_devices->size()), 3000);
+    });
+    connect(m_devices, &DeviceRegistry::deviceDisconnected, this, [=](int id) {
+        statusBar()->showMessage(m_devices->name(id) + " disconnected", 3000);
+    });
+    connect(m_devices, &DeviceRegistry::deviceError, this, [=](int, const QString &message) {
+        statusBar()->showMessage(message, 5000);
+    });
+    connect(ui->Add_Tracker_Button, &QPushButton::clicked, this, &MainWindow::onAddTrackerClicked);
 
     connect(ui->Homing, &QPushButton::clicked, this, [=]() {
         ui->stackedWidget->setCurrentWidget(ui->Page_Homing);
         ui->statusbar->showMessage("Send Home");
-        m_bt->sendCommand("HOME");
+        m_devices->broadcast("HOME");
+        m_devices->resetToHome();
     });
     connect(ui->Choose_Object, &QPushButton::clicked, this, [=]() {
         ui->stackedWidget->setCurrentWidget(ui->Page_Choose_Object);
@@ -41,6 +107,14 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->BT_Connect, &QPushButton::clicked, this, [=]() {
         this->on_BT_Connect_clicked();
     });
+
+    m_linkBench = new LinkBenchmark([this](const QByteArray &d) { m_bt->sendCommand(d); }, this);
+    connect(m_bt, &BluetoothManager::dataReceived, m_linkBench, &LinkBenchmark::feed);
+    connect(m_linkBench, &LinkBenchmark::progress, this, [=](const QString &phase, int percent) {
+        statusBar()->showMessage(QString("Benchmark: %1 %2%").arg(phase).arg(percent));
+    });
+    connect(m_linkBench, &LinkBenchmark::finished, this, &MainWindow::onBenchmarkFinished);
+    connect(ui->Benchmark_Button, &QPushButton::clicked, this, &MainWindow::onBenchmarkClicked);
     // --- MANUAL CONTROL SETUP ---
     repeatTimer = new QTimer(this);
     repeatTimer->setInterval(200);
@@ -57,21 +131,32 @@ MainWindow::MainWindow(QWidget *parent)
         connect(b, &QPushButton::released, this, &MainWindow::onManualReleased);
     }
 
-    m_posSource = QGeoPositionInfoSource::createDefaultSource(this);
-    if (m_posSource) {
-        connect(m_posSource, &QGeoPositionInfoSource::positionUpdated,
-                this,        &MainWindow::onPositionUpdated);
-        m_posSource->setUpdateInterval(10000);
-        m_posSource->startUpdates();
-    } else {
-        statusBar()->showMessage("GPS unapproachable!");
-    }
+    jogTimer = new QTimer(this);
+    jogTimer->setInterval(JOG_PERIOD_MS);
+    connect(jogTimer, &QTimer::timeout, this, &MainWindow::onJogTick);
+
+    m_joystick = new JoystickWidget(ui->Page_Manual_Control);
+    m_joystick->setGeometry(94, 20, 200, 200);
+    connect(m_joystick, &JoystickWidget::moved,    this, &MainWindow::onJoystickMoved);
+    connect(m_joystick, &JoystickWidget::released, this, &MainWindow::onJoystickReleased);
+
+    // Horizon recording: jog along the treeline / rooftops, the axes are sampled
+    m_horizonTimer = new QTimer(this);
+    m_horizonTimer->setInterval(HORIZON_POLL_MS);
+    connect(m_horizonTimer, &QTimer::timeout, this, [=]() { m_bt->sendCommand("POS?\n"); });
+    connect(ui->Horizon_Record_Button, &QPushButton::clicked,
+            this, &MainWindow::onHorizonRecordClicked);
 
     m_horizonsMgr = new HorizonsManager(this);
     connect(m_horizonsMgr, &HorizonsManager::ephemerisReady,
             this, &MainWindow::onEphemerisReady);
     connect(m_horizonsMgr, &HorizonsManager::ephemerisError,
             this, &MainWindow::onEphemerisError);
+    connect(m_horizonsMgr, &HorizonsManager::elementsReady,
+            this, &MainWindow::onElementsReady);
+
+    // Plans for the likely targets are fetched as soon as a fix arrives
+    m_prefetcher = new EphemerisPrefetcher(m_horizonsMgr, SESSION_STEP_SEC, this);
 
     const auto objButtons = {
         ui->Sun_Button,
@@ -87,12 +172,72 @@ MainWindow::MainWindow(QWidget *parent)
                 this, &MainWindow::onObjectButtonClicked, Qt::UniqueConnection);
     }
 
+    connect(ui->WhatsUp_Button, &QPushButton::clicked,
+            this, &MainWindow::onWhatsUpClicked);
+    connect(ui->Catalog_Track_Button, &QPushButton::clicked,
+            this, &MainWindow::onCatalogTrackClicked);
+    connect(ui->SmallBody_Track_Button, &QPushButton::clicked,
+            this, &MainWindow::onSmallBodyTrackClicked);
+    connect(ui->SmallBody_Edit, &QLineEdit::returnPressed,
+            this, &MainWindow::onSmallBodyTrackClicked);
+
+    m_visPlanner = new VisibilityPlanner(this);
+    connect(m_visPlanner, &VisibilityPlanner::planReady,
+            this, &MainWindow::onPlanReady);
+    connect(ui->NightPlan_Button, &QPushButton::clicked,
+            this, &MainWindow::onNightPlanClicked);
+
+    connect(ui->Refresh_Button, &QPushButton::clicked,
+            this, &MainWindow::onRefreshClicked);
+
     connect(ui->Break_Button, &QPushButton::clicked, this, [=]() {
-        m_bt->sendCommand(QByteArray("BREAK\n"));
-        m_horizonsMgr->stopLiveTracking();
+        m_devices->broadcast(QByteArray("BREAK\n"));
+        m_devices->stopAll();
+        m_sessionId.clear();
+        m_sessionEnd = QDateTime();
+        m_refreshRequestId = 0;
         statusBar()->showMessage("Tracking Stop", 2000);
     });
 }
+bool MainWindow::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == this && event->type() == QEvent::Paint && !m_deferredInitDone) {
+        // Painting now; the rest runs once this frame is on screen
+        m_deferredInitDone = true;
+        StartupProfiler::mark("first frame");
+        QTimer::singleShot(0, this, &MainWindow::deferredInit);
+    }
+    return QMainWindow::eventFilter(watched, event);
+}
+
+void MainWindow::deferredInit()
+{
+    removeEventFilter(this);
+#ifdef Q_OS_ANDROID
+    requestAndroidPermissions();
+    StartupProfiler::mark("permissions requested");
+#endif
+
+    m_posSource = QGeoPositionInfoSource::createDefaultSource(this);
+    if (m_posSource) {
+        connect(m_posSource, &QGeoPositionInfoSource::positionUpdated,
+                this,        &MainWindow::onPositionUpdated);
+        m_posSource->setUpdateInterval(10000);
+        m_posSource->startUpdates();
+    } else {
+        statusBar()->showMessage("GPS unapproachable!");
+    }
+    StartupProfiler::mark("positioning started");
+
+    // The first fetch (usually the prefetch after the GPS fix) finds the connection open
+    m_horizonsMgr->prewarm();
+    StartupProfiler::mark("Horizons pre-warm queued");
+
+    m_smallBodies = SmallBodyOrbit::loadDirectory();
+    StartupProfiler::mark("deferred init done");
+    StartupProfiler::report();
+}
+
 #ifdef Q_OS_ANDROID
 void MainWindow::requestAndroidPermissions()
 {
@@ -198,11 +343,88 @@ void MainWindow::on_BT_Connect_clicked()
         ui->statusbar->showMessage("Connected", 5000);
     });
 }
+void MainWindow::onAddTrackerClicked()
+{
+    const QString addr = ui->Combo_Devices->currentData().toString();
+    if (addr.isEmpty()) {
+        ui->statusbar->showMessage("Please select a device first");
+        return;
+    }
+    for (int id : m_devices->ids()) {
+        BluetoothManager *bt = m_devices->link(id);
+        if (bt->isConnected() && bt->socket()->peerAddress().toString() == addr) {
+            ui->statusbar->showMessage("Device already connected", 3000);
+            return;
+        }
+    }
+    m_devices->addDevice(QBluetoothAddress(addr), ui->Combo_Devices->currentText());
+    ui->statusbar->showMessage("Connecting extra tracker " + addr, 3000);
+}
+
+void MainWindow::startSiderealOnAll(double raDeg, double decDeg)
+{
+    // RA/Dec of date goes to every ESP, each computes Alt/Az in its own frame
+    m_devices->stopAll();
+    m_sessionId.clear();
+    m_sessionEnd = QDateTime();
+    for (int id : m_devices->ids()) {
+        BluetoothManager *bt = m_devices->link(id);
+        if (bt->isConnected())
+            m_horizonsMgr->startSiderealTracking(bt, raDeg, decDeg, m_currentCenter);
+    }
+}
+
+void MainWindow::onBenchmarkClicked()
+{
+    if (m_linkBench->isRunning()) {
+        m_linkBench->cancel();
+        return;
+    }
+    if (!m_bt->isConnected()) {
+        statusBar()->showMessage("Connect to the device first", 3000);
+        return;
+    }
+    // Results are kept per device, keyed by its address
+    QString device = ui->Combo_Devices->currentData().toString();
+    if (device.isEmpty()) device = m_bt->socket()->peerAddress().toString();
+    m_bt->resetStats();
+    ui->Benchmark_Button->setText("Cancel benchmark");
+    m_linkBench->start(device);
+}
+
+void MainWindow::onBenchmarkFinished(const LinkBenchmarkResult &result)
+{
+    ui->Benchmark_Button->setText("Link benchmark");
+    LinkBenchmark::saveResult(result);
+
+    const LinkStats &st = m_bt->stats();
+    QMessageBox::information(this, "Link benchmark",
+                             result.summary()
+                                 + QString("\n\nSent %1 kB in %2 writes, received %3 kB, %4 errors")
+                                       .arg(st.bytesSent / 1024.0, 0, 'f', 1)
+                                       .arg(st.writes)
+                                       .arg(st.bytesReceived / 1024.0, 0, 'f', 1)
+                                       .arg(st.errors));
+}
+
 void MainWindow::onManualPressed()
 {
     currentDir = directionForSender(sender());
     if (currentDir == None) return;
 
+    if (sessionRunning()) {
+        // Tracking: a tap corrects the path on every tracker, holding still jogs
+        switch (currentDir) {
+        case Up:    m_devices->offsetOnDevices(0, NUDGE_DEG, NUDGE_BLEND_MS);  break;
+        case Down:  m_devices->offsetOnDevices(0, -NUDGE_DEG, NUDGE_BLEND_MS); break;
+        case Left:  m_devices->offsetOnDevices(-NUDGE_DEG, 0, NUDGE_BLEND_MS); break;
+        case Right: m_devices->offsetOnDevices(NUDGE_DEG, 0, NUDGE_BLEND_MS);  break;
+        default:    break;
+        }
+        repeatTimer->start();
+        return;
+    }
+
     // Send initial short movement
     switch (currentDir) {
     case Up:    m_bt->sendCommand("UP\n");    break;
@@ -219,26 +441,67 @@ void MainWindow::onManualPressed()
 void MainWindow::onManualReleased()
 {
     repeatTimer->stop();
-    m_bt->sendCommand("STOP\n");
+    jogTimer->stop();
+    sendJog(0, 0);
     currentDir = None;
 }
 
 void MainWindow::onRepeatTimeout()
 {
+    // Long press → stream JOG, speed grows with the hold time
+    repeatTimer->stop();
     if (currentDir == None)
         return;
+    m_pressClock.start();
+    onJogTick();
+    jogTimer->start();
+}
 
-    // Long press → smooth continuous movement
-    switch (currentDir) {
-    case Up:    m_bt->sendCommand("UP_START\n");    break;
-    case Down:  m_bt->sendCommand("DOWN_START\n");  break;
-    case Left:  m_bt->sendCommand("LEFT_START\n");  break;
-    case Right: m_bt->sendCommand("RIGHT_START\n"); break;
-    default:    break;
+void MainWindow::onJogTick()
+{
+    double pan = 0, tilt = 0;
+    if (m_joystick->isHeld()) {
+        // Quadratic response: fine control near the center
+        const QPointF d = m_joystick->deflection();
+        pan  = d.x() * qAbs(d.x()) * JOG_MAX_PAN;
+        tilt = d.y() * qAbs(d.y()) * JOG_MAX_TILT;
+    } else if (currentDir != None) {
+        double k = qBound(JOG_MIN_FRACTION,
+                          m_pressClock.elapsed() / 1000.0 / JOG_RAMP_SEC, 1.0);
+        switch (currentDir) {
+        case Up:    tilt =  k * JOG_MAX_TILT; break;
+        case Down:  tilt = -k * JOG_MAX_TILT; break;
+        case Left:  pan  = -k * JOG_MAX_PAN;  break;
+        case Right: pan  =  k * JOG_MAX_PAN;  break;
+        default:    break;
+        }
+    } else {
+        jogTimer->stop();
+        return;
     }
+    sendJog(pan, tilt);
+}
 
-    // No further repeats needed – ESP will continue motion
-    repeatTimer->stop();
+void MainWindow::onJoystickMoved(double x, double y)
+{
+    Q_UNUSED(x) Q_UNUSED(y)
+    if (!jogTimer->isActive()) {
+        onJogTick();
+        jogTimer->start();
+    }
+}
+
+void MainWindow::onJoystickReleased()
+{
+    jogTimer->stop();
+    sendJog(0, 0);
+}
+
+void MainWindow::sendJog(double panSpeed, double tiltSpeed)
+{
+    m_bt->sendCommand(QString("JOG %1 %2\n")
+                          .arg(qRound(panSpeed))
+                          .arg(qRound(tiltSpeed)).toUtf8());
 }
 
 MainWindow::Direction MainWindow::directionForSender(QObject *s) const
@@ -252,90 +515,622 @@ MainWindow::Direction MainWindow::directionForSender(QObject *s) const
 void MainWindow::onPositionUpdated(const QGeoPositionInfo &info)
 {
     m_currentCenter = info.coordinate();
+    m_prefetcher->setPosition(m_currentCenter);
+    // Horizon of the new site, once per move rather than per fix
+    if (!m_horizonSite.isValid()
+        || m_horizonSite.distanceTo(m_currentCenter) > HorizonMask::SITE_TOLERANCE_M) {
+        m_horizonSite = m_currentCenter;
+        if (m_horizon.load(m_currentCenter))
+            qDebug() << "Horizon mask loaded, highest" << m_horizon.maxLimit() << "deg";
+    }
     QString msg = QString("Location: %1°, %2°")
                       .arg(m_currentCenter.latitude(),  0, 'f', 6)
                       .arg(m_currentCenter.longitude(), 0, 'f', 6);
     statusBar()->showMessage(msg, 5000);
 }
+void MainWindow::onWhatsUpClicked()
+{
+    if (!m_currentCenter.isValid()) {
+        statusBar()->showMessage("No GPS position yet", 3000);
+        return;
+    }
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    ui->Catalog_Combo->clear();
+
+    // Satellite passes first: they are the ones that cannot wait
+    if (m_satPredictor.count() == 0)
+        m_satPredictor.loadDirectory();
+    m_satPasses.clear();
+    for (int i = 0; i < m_satPredictor.count(); ++i) {
+        SatellitePass pass;
+        if (m_satPredictor.nextPass(i, m_currentCenter, now,
+                                    CATALOG_MIN_EL, SAT_SEARCH_HOURS, pass))
+            m_satPasses.append(pass);
+    }
+    std::sort(m_satPasses.begin(), m_satPasses.end(),
+              [](const SatellitePass &a, const SatellitePass &b) { return a.aos < b.aos; });
+    for (int i = 0; i < m_satPasses.size(); ++i) {
+        const SatellitePass &p = m_satPasses.at(i);
+        ui->Catalog_Combo->addItem(QString("%1 %2 max %3°")
+                                       .arg(m_satPredictor.name(p.satIndex))
+                                       .arg(p.aos.toLocalTime().toString("HH:mm"))
+                                       .arg(p.maxElDeg, 0, 'f', 0));
+        ui->Catalog_Combo->setItemData(i, SatelliteItem, ItemKindRole);
+        ui->Catalog_Combo->setItemData(i, i, ItemIndexRole);
+    }
+
+    m_visibleObjects.clear();
+    if (m_catalog.open()) {
+        m_visibleObjects = m_catalog.visible(CATALOG_MIN_EL, m_currentCenter, now,
+                                             CATALOG_MAX_LIST);
+        m_visibleObjects.erase(std::remove_if(m_visibleObjects.begin(), m_visibleObjects.end(),
+                                              [this](const SkyObject &o) {
+                                                  return !m_horizon.isClear(o.azDeg, o.elDeg);
+                                              }),
+                               m_visibleObjects.end());
+    } else {
+        statusBar()->showMessage("Catalog unavailable", 3000);
+    }
+    for (int i = 0; i < m_visibleObjects.size(); ++i) {
+        const SkyObject &o = m_visibleObjects.at(i);
+        ui->Catalog_Combo->addItem(QString("%1 (%2, %3m) el %4°")
+                                       .arg(o.name, SkyCatalog::typeName(o.type))
+                                       .arg(o.mag, 0, 'f', 1)
+                                       .arg(o.elDeg, 0, 'f', 0));
+        int row = ui->Catalog_Combo->count() - 1;
+        ui->Catalog_Combo->setItemData(row, CatalogItem, ItemKindRole);
+        ui->Catalog_Combo->setItemData(row, i, ItemIndexRole);
+    }
+
+    // Comets and asteroids with stored elements, positions propagated locally
+    int smallBodiesUp = 0;
+    for (int i = 0; i < m_smallBodies.size(); ++i) {
+        const VisibilityTarget t = VisibilityTarget::smallBody(m_smallBodies.at(i));
+        double az, el;
+        VisibilityPlanner::altAz(t, m_currentCenter, now, az, el);
+        if (el < CATALOG_MIN_EL || !m_horizon.isClear(az, el)) continue;
+        ui->Catalog_Combo->addItem(QString("%1 el %2°").arg(t.name).arg(el, 0, 'f', 0));
+        int row = ui->Catalog_Combo->count() - 1;
+        ui->Catalog_Combo->setItemData(row, SmallBodyItem, ItemKindRole);
+        ui->Catalog_Combo->setItemData(row, i, ItemIndexRole);
+        ++smallBodiesUp;
+    }
+
+    ui->Catalog_Track_Button->setEnabled(ui->Catalog_Combo->count() > 0);
+    statusBar()->showMessage(QString("%1 objects above %2°, %3 satellite passes, %4 comets/asteroids")
+                                 .arg(m_visibleObjects.size())
+                                 .arg(CATALOG_MIN_EL)
+                                 .arg(m_satPasses.size())
+                                 .arg(smallBodiesUp), 3000);
+}
+
+void MainWindow::onCatalogTrackClicked()
+{
+    int row = ui->Catalog_Combo->currentIndex();
+    if (row < 0) return;
+    const int kind = ui->Catalog_Combo->itemData(row, ItemKindRole).toInt();
+    const int idx  = ui->Catalog_Combo->itemData(row, ItemIndexRole).toInt();
+
+    if (kind == PlannedItem) {
+        if (idx < 0 || idx >= m_nightPlan.size()) return;
+        const VisibilityTarget &t = m_nightPlan.at(idx).target;
+        if (t.kind == VisibilityTarget::SolarSystem) {
+            setObjectButtonsEnabled(false);
+            requestSolarSystemSession(t.body);
+        } else if (t.kind == VisibilityTarget::SmallBody) {
+            trackSmallBody(t.orbit);
+        } else {
+            startSiderealOnAll(t.raDeg, t.decDeg);
+            statusBar()->showMessage("Tracking " + t.name, 3000);
+        }
+        return;
+    }
+
+    if (kind == SatelliteItem) {
+        if (idx < 0 || idx >= m_satPasses.size()) return;
+        const SatellitePass &pass = m_satPasses.at(idx);
+        // A pass already in progress starts a little ahead, leaving time for the slew
+        const QVector<EphemPoint> pts = m_satPredictor.passTrajectory(
+            pass, m_currentCenter, SAT_RATE_HZ,
+            QDateTime::currentDateTimeUtc().addSecs(SAT_LEAD_SEC));
+        if (pts.size() < 2) {
+            statusBar()->showMessage("Pass is over", 3000);
+            return;
+        }
+        // Only the part of the pass above the local horizon goes to the devices
+        const QVector<QVector<EphemPoint>> runs = m_horizon.visibleRuns(pts, 0.0, HORIZON_BRIDGE_SEC);
+        if (runs.isEmpty()) {
+            statusBar()->showMessage("Pass is hidden by the local horizon", 3000);
+            return;
+        }
+        const QVector<EphemPoint> traj = *std::max_element(
+            runs.begin(), runs.end(),
+            [](const QVector<EphemPoint> &a, const QVector<EphemPoint> &b) { return a.size() < b.size(); });
+        const QString name = QString("sat%1_%2")
+                                 .arg(m_satPredictor.satNum(pass.satIndex))
+                                 .arg(traj.first().utc.toUTC().toString("MMddHHmm"));
+        m_devices->setCriticalWindows({ { pass.tca.addSecs(-SAT_TCA_GUARD_SEC),
+                                          pass.tca.addSecs(SAT_TCA_GUARD_SEC) } });
+        m_devices->trackOnDevices(traj, name);
+        m_sessionId.clear();   // a pass is not refetched, only nudged
+        m_sessionPlan = name;
+        m_sessionEnd  = traj.last().utc.toUTC();
+        statusBar()->showMessage(QString("Tracking %1, %2 points")
+                                     .arg(m_satPredictor.name(pass.satIndex))
+                                     .arg(traj.size()), 3000);
+        return;
+    }
+
+    if (kind == SmallBodyItem) {
+        if (idx < 0 || idx >= m_smallBodies.size()) return;
+        trackSmallBody(m_smallBodies.at(idx));
+        return;
+    }
+
+    if (idx < 0 || idx >= m_visibleObjects.size()) return;
+    const SkyObject &o = m_visibleObjects.at(idx);
+    startSiderealOnAll(o.raDeg, o.decDeg);
+    statusBar()->showMessage("Tracking " + o.name, 3000);
+}
+
+void MainWindow::onNightPlanClicked()
+{
+    if (!m_currentCenter.isValid()) {
+        statusBar()->showMessage("No GPS position yet", 3000);
+        return;
+    }
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    QDateTime dusk, dawn;
+    if (!VisibilityPlanner::nightWindow(m_currentCenter, now, NIGHT_SUN_ALT, dusk, dawn)) {
+        // No darkness today (polar summer): plan the next 12 h anyway
+        dusk = now;
+        dawn = now.addSecs(12 * 3600);
+    }
+
+    QVector<VisibilityTarget> targets;
+    for (int b = PlanetEphemeris::Moon; b < PlanetEphemeris::BodyCount; ++b)
+        targets.append(VisibilityTarget::planet(PlanetEphemeris::Body(b)));
+    if (m_catalog.open()) {
+        const QVector<SkyObject> objs = m_catalog.objects();
+        for (const SkyObject &o : objs)
+            targets.append(VisibilityTarget::fixed(o.name, o.raDeg, o.decDeg, o.mag));
+    }
+    for (const OrbitalElements &el : m_smallBodies)
+        targets.append(VisibilityTarget::smallBody(el));
+
+    ui->NightPlan_Button->setEnabled(false);
+    m_visPlanner->plan(targets, m_currentCenter, dusk, dawn, CATALOG_MIN_EL, m_horizon);
+    statusBar()->showMessage(QString("Planning %1 targets, %2 - %3")
+                                 .arg(targets.size())
+                                 .arg(dusk.toLocalTime().toString("HH:mm"))
+                                 .arg(dawn.toLocalTime().toString("HH:mm")), 3000);
+}
+
+void MainWindow::onPlanReady(const QVector<TargetVisibility> &schedule)
+{
+    ui->NightPlan_Button->setEnabled(true);
+    m_nightPlan.clear();
+    for (const TargetVisibility &tv : schedule)
+        if (tv.isVisible()) m_nightPlan.append(tv);
+
+    ui->Catalog_Combo->clear();
+    for (int i = 0; i < m_nightPlan.size(); ++i) {
+        const TargetVisibility &tv = m_nightPlan.at(i);
+        const VisibilityWindow &w = tv.windows.first();
+        QString text = QString("%1 %2-%3 max %4°")
+                           .arg(tv.target.name)
+                           .arg(w.start.toLocalTime().toString("HH:mm"))
+                           .arg(w.end.toLocalTime().toString("HH:mm"))
+                           .arg(tv.maxElDeg, 0, 'f', 0);
+        if (tv.transit.isValid())
+            text += " at " + tv.transit.toLocalTime().toString("HH:mm");
+        ui->Catalog_Combo->addItem(text);
+        ui->Catalog_Combo->setItemData(i, PlannedItem, ItemKindRole);
+        ui->Catalog_Combo->setItemData(i, i, ItemIndexRole);
+    }
+
+    ui->Catalog_Track_Button->setEnabled(!m_nightPlan.isEmpty());
+    statusBar()->showMessage(QString("%1 of %2 targets above %3° tonight")
+                                 .arg(m_nightPlan.size())
+                                 .arg(schedule.size())
+                                 .arg(CATALOG_MIN_EL), 3000);
+}
+
 void MainWindow::onObjectButtonClicked()
 {
     auto *btn = qobject_cast<QPushButton*>(sender());
     if (!btn) return;
 
-    ui->Sun_Button->setEnabled(false);
-    ui->Moon_Button->setEnabled(false);
-    ui->Mercury_Button->setEnabled(false);
-    ui->Venus_Button->setEnabled(false);
-    ui->Mars_Button->setEnabled(false);
-    ui->Jupyter_Button->setEnabled(false);
-    ui->Saturn_Button->setEnabled(false);
-
-    // 1) Determine Horizons object ID
-    QString objectId;
-    if      (btn == ui->Sun_Button)      objectId = "10";
-    else if (btn == ui->Moon_Button)     objectId = "301";
-    else if (btn == ui->Mercury_Button)objectId = "199";
-    else if (btn == ui->Venus_Button)    objectId = "299";
-    else if (btn == ui->Mars_Button)     objectId = "499";
-    else if (btn == ui->Jupyter_Button)  objectId = "599";
-    else if (btn == ui->Saturn_Button)   objectId = "699";
+    PlanetEphemeris::Body body;
+    if      (btn == ui->Sun_Button)      body = PlanetEphemeris::Sun;
+    else if (btn == ui->Moon_Button)     body = PlanetEphemeris::Moon;
+    else if (btn == ui->Mercury_Button)  body = PlanetEphemeris::Mercury;
+    else if (btn == ui->Venus_Button)    body = PlanetEphemeris::Venus;
+    else if (btn == ui->Mars_Button)     body = PlanetEphemeris::Mars;
+    else if (btn == ui->Jupyter_Button)  body = PlanetEphemeris::Jupiter;
+    else if (btn == ui->Saturn_Button)   body = PlanetEphemeris::Saturn;
     else return;
 
-    // 2) Start time = now rounded to nearest minute + 2 minutes
-    QDateTime now = QDateTime::currentDateTimeUtc();
-    int secs = now.time().second();
-    int offset = 120 - secs;
-    QDateTime start = now.addSecs(offset)
-                          .toLocalTime();
-    start.setTime(QTime(start.time().hour(),
-                        start.time().minute(), 0));
-    QDateTime end = start.addSecs(3600);  // tracking for 1 hour
-
-    // 3) Request ephemeris from JPL
-    m_horizonsMgr->fetchEphemeris(
+    setObjectButtonsEnabled(false);
+    requestSolarSystemSession(body);
+}
+
+void MainWindow::requestSolarSystemSession(PlanetEphemeris::Body body)
+{
+    // 1-2) Start in about 2 minutes, or at the next rise, for up to an hour
+    QDateTime start, end;
+    if (!sessionWindow(VisibilityTarget::planet(body), start, end)) {
+        setObjectButtonsEnabled(true);
+        return;
+    }
+    start = start.toLocalTime();
+    end   = end.toLocalTime();
+
+    // 3) Compiled plan stored for this target and site: no pipeline at all
+    const QString objectId = PlanetEphemeris::horizonsId(body);
+    m_prefetcher->setLastUsed(objectId);
+    const QString planPath = PlanFile::find(objectId, m_currentCenter, QDateTime::currentDateTimeUtc());
+    if (!planPath.isEmpty()) {
+        PlanFile plan;
+        if (plan.open(planPath) && m_devices->startPlanFile(plan) > 0) {
+            // Not stored on the devices: nothing to splice into, but it can be nudged
+            m_sessionId.clear();
+            m_sessionEnd = plan.validUntil();
+            statusBar()->showMessage(QString("Tracking %1 from the stored plan")
+                                         .arg(PlanetEphemeris::name(body)), 5000);
+            setObjectButtonsEnabled(true);
+            return;
+        }
+        qDebug() << "Stored plan" << planPath << "not used:" << plan.errorString();
+    }
+
+    // 4) Prefetched trajectory covering the session: start right away
+    const QVector<EphemPoint> cached = m_prefetcher->lookup(objectId, m_currentCenter, start, end);
+    if (cached.size() >= 2) {
+        statusBar()->showMessage(QString("Tracking %1 from the prefetched plan")
+                                     .arg(PlanetEphemeris::name(body)), 5000);
+        startSession(objectId, cached);
+        return;
+    }
+
+    // 5) Request ephemeris from JPL
+    m_pendingRequestId = m_horizonsMgr->fetchEphemeris(
         objectId,
         m_currentCenter,
         start,
         end,
-        /*step (sec):*/ 4
+        SESSION_STEP_SEC
         );
 
     statusBar()->showMessage(
         QString("Fetching trajectory for %1 from %2 to %3")
-            .arg(btn->text())
+            .arg(PlanetEphemeris::name(body))
             .arg(start.toString(Qt::ISODate))
             .arg(end.toString(Qt::ISODate)),
         5000
         );
-    m_horizonsMgr->fetchEphemeris(objectId, m_currentCenter, start, end, 4);
-}
-void MainWindow::onEphemerisReady(const QVector<EphemPoint> &traj) {
-    qDebug() << "Ephemeris received, records:" << traj.size();
-
-    ui->Sun_Button->setEnabled(true);
-    ui->Moon_Button->setEnabled(true);
-    ui->Mercury_Button->setEnabled(true);
-    ui->Venus_Button->setEnabled(true);
-    ui->Mars_Button->setEnabled(true);
-    ui->Jupyter_Button->setEnabled(true);
-    ui->Saturn_Button->setEnabled(true);
-    // Send data to ESP or display graphically
-    qDebug() << "Starting sendTrajectorySteps...";
-    double panStepsPerDeg  = (8 * 180) / (14 * 1.8);
-    double tiltStepsPerDeg = (8 * 84)  / (14 * 1.8);
+}
+
+void MainWindow::onSmallBodyTrackClicked()
+{
+    const QString designation = ui->SmallBody_Edit->text().trimmed();
+    if (designation.isEmpty()) return;
+    if (!m_currentCenter.isValid()) {
+        statusBar()->showMessage("No GPS position yet", 3000);
+        return;
+    }
+    OrbitalElements typed;
+    typed.designation = designation;
+    for (const OrbitalElements &el : m_smallBodies) {
+        if (el.id().compare(typed.id(), Qt::CaseInsensitive) == 0) {
+            trackSmallBody(el);
+            return;
+        }
+    }
+    setObjectButtonsEnabled(false);
+    m_pendingRequestId = m_horizonsMgr->fetchElements(designation);
+    statusBar()->showMessage("Fetching orbital elements for " + designation, 5000);
+}
+
+void MainWindow::trackSmallBody(const OrbitalElements &el)
+{
+    const double ageDays = AstroMath::julianDay(QDateTime::currentDateTimeUtc()) - el.epochJd;
+    if (qAbs(ageDays) <= ORBIT_MAX_AGE_DAYS) {
+        startSmallBodySession(el);
+        return;
+    }
+    // Perturbations grow with the distance from the epoch: one small fetch renews them
+    setObjectButtonsEnabled(false);
+    m_pendingRequestId = m_horizonsMgr->fetchElements(el.designation);
+    statusBar()->showMessage(QString("Elements of %1 are %2 days old, fetching new ones")
+                                 .arg(el.designation).arg(qRound(ageDays)), 5000);
+}
+
+void MainWindow::onElementsReady(int requestId, const OrbitalElements &elements)
+{
+    // Newer elements replace the stored ones of the same body
+    auto it = std::find_if(m_smallBodies.begin(), m_smallBodies.end(),
+                           [&](const OrbitalElements &el) { return el.id() == elements.id(); });
+    if (it != m_smallBodies.end()) *it = elements;
+    else m_smallBodies.append(elements);
+
+    if (requestId == m_refreshRequestId) {
+        m_refreshRequestId = 0;
+        spliceSession(m_horizonsMgr->propagateTrajectory(
+            elements, m_currentCenter, QDateTime::currentDateTime().addSecs(-SESSION_STEP_SEC),
+            m_sessionEnd.toLocalTime(), SESSION_STEP_SEC));
+        return;
+    }
+    if (requestId != m_pendingRequestId) return;
+    m_pendingRequestId = 0;
+    setObjectButtonsEnabled(true);
+    startSmallBodySession(elements);
+}
+
+void MainWindow::onRefreshClicked()
+{
+    if (m_sessionId.isEmpty() || !sessionRunning()) {
+        statusBar()->showMessage("No session to refresh", 3000);
+        return;
+    }
+    if (!m_currentCenter.isValid()) {
+        statusBar()->showMessage("No GPS position yet", 3000);
+        return;
+    }
+    // From a step back, so the new plan covers the splice moment
+    const QDateTime from = QDateTime::currentDateTime().addSecs(-SESSION_STEP_SEC);
+    auto el = std::find_if(m_smallBodies.cbegin(), m_smallBodies.cend(),
+                           [&](const OrbitalElements &e) { return e.id() == m_sessionId; });
+    if (el != m_smallBodies.cend()) {
+        // Comet / asteroid: new elements, propagated here
+        m_refreshRequestId = m_horizonsMgr->fetchElements(el->designation);
+    } else {
+        m_refreshRequestId = m_horizonsMgr->fetchEphemeris(
+            m_sessionId, m_currentCenter, from, m_sessionEnd.toLocalTime(), SESSION_STEP_SEC);
+    }
+    statusBar()->showMessage("Refreshing the plan of " + m_sessionId, 3000);
+}
 
-    m_horizonsMgr->sendTrajectorySteps(m_bt, panStepsPerDeg, tiltStepsPerDeg);
+void MainWindow::spliceSession(const QVector<EphemPoint> &fullTraj)
+{
+    const QVector<QVector<EphemPoint>> runs = m_horizon.visibleRuns(fullTraj, 0.0, HORIZON_BRIDGE_SEC);
+    if (runs.isEmpty()) {
+        statusBar()->showMessage(m_sessionId + ": refreshed plan is hidden by the local horizon", 5000);
+        return;
+    }
+    if (m_devices->scheduledStart().isValid()) {
+        // Not started yet: the new trajectory simply replaces it
+        startSession(m_sessionId, fullTraj);
+        return;
+    }
+    const QVector<EphemPoint> &traj = runs.first();
+    const int version = m_devices->spliceOnDevices(traj, m_sessionPlan);
+    m_sessionEnd = traj.last().utc.toUTC();
+    statusBar()->showMessage(QString("Plan v%1 of %2 splices in").arg(version).arg(m_sessionId), 5000);
+}
+
+bool MainWindow::sessionRunning() const
+{
+    return m_sessionEnd.isValid() && QDateTime::currentDateTimeUtc() < m_sessionEnd;
+}
+
+void MainWindow::startSmallBodySession(const OrbitalElements &el)
+{
+    if (!m_currentCenter.isValid()) {
+        statusBar()->showMessage("No GPS position yet", 3000);
+        return;
+    }
+    const VisibilityTarget target = VisibilityTarget::smallBody(el);
+    QDateTime start, end;
+    if (!sessionWindow(target, start, end)) return;
+
+    // No ephemeris download: the orbit is propagated here. A session after the
+    // next rise is held by DeviceRegistry until shortly before its first sample
+    const QVector<EphemPoint> traj = m_horizonsMgr->propagateTrajectory(
+        el, m_currentCenter, start.toLocalTime(), end.toLocalTime(), SESSION_STEP_SEC);
+    if (traj.size() < 2) {
+        statusBar()->showMessage(target.name + ": nothing to track", 3000);
+        return;
+    }
+    statusBar()->showMessage(QString("Tracking %1 from %2")
+                                 .arg(target.name)
+                                 .arg(start.toLocalTime().toString("HH:mm")), 5000);
+    startSession(el.id(), traj);
+}
+
+bool MainWindow::sessionWindow(const VisibilityTarget &target, QDateTime &start, QDateTime &end)
+{
+    // Next full minute with time for the slew
+    start = QDateTime::currentDateTimeUtc().addSecs(120);
+    start.setTime(QTime(start.time().hour(), start.time().minute(), 0));
+    end = start.addSecs(SESSION_SECS);
+    m_devices->setCriticalWindows({});
+    if (!m_currentCenter.isValid()) return true;
+
+    const TargetVisibility vis = VisibilityPlanner::evaluate(
+        target, m_currentCenter, start, start.addSecs(12 * 3600), SESSION_MIN_EL, &m_horizon);
+    if (!vis.isVisible()) {
+        statusBar()->showMessage(QString("%1 stays below %2° for the next 12 h")
+                                     .arg(target.name).arg(SESSION_MIN_EL), 5000);
+        return false;
+    }
+    const VisibilityWindow &w = vis.windows.first();
+    if (w.start > start) {
+        start = w.start.addSecs(60);
+        start.setTime(QTime(start.time().hour(), start.time().minute(), 0));
+    }
+    end = qMin(start.addSecs(SESSION_SECS), w.end);
+    if (vis.transit.isValid())
+        m_devices->setCriticalWindows({ { vis.transit.addSecs(-TRANSIT_GUARD_SEC),
+                                          vis.transit.addSecs(TRANSIT_GUARD_SEC) } });
+    return true;
+}
+
+void MainWindow::setObjectButtonsEnabled(bool enabled)
+{
+    ui->Sun_Button->setEnabled(enabled);
+    ui->Moon_Button->setEnabled(enabled);
+    ui->Mercury_Button->setEnabled(enabled);
+    ui->Venus_Button->setEnabled(enabled);
+    ui->Mars_Button->setEnabled(enabled);
+    ui->Jupyter_Button->setEnabled(enabled);
+    ui->Saturn_Button->setEnabled(enabled);
+}
+
+void MainWindow::onEphemerisReady(int requestId, const QString &objectId,
+                                  const QVector<EphemPoint> &traj) {
+    qDebug() << "Ephemeris received for" << objectId << "records:" << traj.size();
+    if (requestId == m_refreshRequestId) {
+        m_refreshRequestId = 0;
+        spliceSession(traj);
+        return;
+    }
+    // Other results (prefetched targets) are kept by EphemerisPrefetcher
+    if (requestId != m_pendingRequestId) return;
+    m_pendingRequestId = 0;
+    startSession(objectId, traj);
+}
+
+void MainWindow::startSession(const QString &objectId, const QVector<EphemPoint> &fullTraj)
+{
+    setObjectButtonsEnabled(true);
+    // Nothing behind the local horizon (or below 0°) is planned or uploaded:
+    // the first clear stretch of the trajectory is the session
+    const QVector<QVector<EphemPoint>> runs = m_horizon.visibleRuns(fullTraj, 0.0, HORIZON_BRIDGE_SEC);
+    if (runs.isEmpty()) {
+        statusBar()->showMessage(objectId + " is hidden by the local horizon", 5000);
+        return;
+    }
+    const QVector<EphemPoint> &traj = runs.first();
+    if (traj.size() < fullTraj.size())
+        qDebug() << "Trajectory clipped to the local horizon:" << traj.size() << "of"
+                 << fullTraj.size() << "points," << runs.size() << "clear stretches";
+    // One trajectory for all trackers, steps per device calibration; the
+    // steps play at the run's own times, not from the start of the fetch
+    qDebug() << "Starting sendTrajectorySteps...";
+    m_devices->sendTrajectorySteps(traj);
     qDebug() << "sendTrajectorySteps completed";
+    const QDateTime scheduled = m_devices->scheduledStart();
+    if (scheduled.isValid())
+        statusBar()->showMessage(QString("%1 clears the horizon at %2, tracking starts then")
+                                     .arg(objectId)
+                                     .arg(scheduled.toLocalTime().toString("HH:mm")), 5000);
+
+    // Keep a copy on the device: survives resets and can be restarted with TRACK <name>
+    if (!traj.isEmpty()) {
+        const QString name = QString("%1_%2")
+                                 .arg(objectId)
+                                 .arg(traj.first().utc.toUTC().toString("MMddHHmm"));
+        m_devices->uploadTrajectory(traj, name);
+        // Refresh splices the next version of this plan in
+        m_sessionId   = objectId;
+        m_sessionPlan = name;
+        m_sessionEnd  = traj.last().utc.toUTC();
+    }
+
+    // Compiled plan for a restart within the window; on a desktop without
+    // trackers this is how plans are prepared for the phone
+    if (!traj.isEmpty() && m_currentCenter.isValid()) {
+        const QList<int> ids = m_devices->ids();
+        const DeviceCalibration cal = ids.isEmpty() ? DeviceCalibration() : m_devices->calibration(ids.first());
+        const QString path = QString("%1/%2_%3.plan")
+                                 .arg(PlanFile::plansDir(), objectId,
+                                      traj.first().utc.toUTC().toString("yyyyMMddHHmm"));
+        PanWrapPlanner planner(180.0, cal.panLimitCcwDeg, cal.panLimitCwDeg);
+        planner.setCriticalWindows(m_devices->criticalWindows());
+        QString error;
+        if (!PlanFile::compile(path, objectId, m_currentCenter, traj, planner, cal, &error))
+            qDebug() << "Plan file not written:" << error;
+    }
+}
+
+void MainWindow::onDeviceData(const QByteArray &data)
+{
+    m_rxBuffer += data;
+    QStringList resumeOffer;
+    int nl;
+    while ((nl = m_rxBuffer.indexOf('\n')) >= 0) {
+        const QString line = QString::fromUtf8(m_rxBuffer.left(nl)).trimmed();
+        m_rxBuffer.remove(0, nl + 1);
+
+        // Interrupted session stored on the device and still within its plan
+        if (line.startsWith("RESUME_READY ")) {
+            resumeOffer = line.split(' ');
+        } else if (line.startsWith("RESUMED") || line.startsWith("TRACK_STARTED")) {
+            statusBar()->showMessage(line, 5000);
+        } else if (line.startsWith("POS ") && m_horizon.isRecording()) {
+            // "POS <pan> <tilt> <az> <el>" in the device frame, the mask is in the sky's
+            const QStringList parts = line.split(' ', Qt::SkipEmptyParts);
+            if (parts.size() < 5) continue;
+            const QList<int> ids = m_devices->ids();
+            const DeviceCalibration cal = ids.isEmpty() ? DeviceCalibration() : m_devices->calibration(ids.first());
+            m_horizon.record(parts[3].toDouble() - cal.azOffsetDeg, parts[4].toDouble() - cal.elOffsetDeg);
+            statusBar()->showMessage(QString("Horizon: %1 of %2 bins")
+                                         .arg(m_horizon.recordedBins()).arg(HorizonMask::BINS));
+        }
+    }
+
+    // A modal question here would spin a nested event loop inside the parser
+    // (re-entering this slot with m_rxBuffer half consumed); ask afterwards
+    if (!resumeOffer.isEmpty() && !m_resumePromptQueued) {
+        m_resumePromptQueued = true;
+        const QString plan = resumeOffer.value(1), point = resumeOffer.value(2);
+        QMetaObject::invokeMethod(this, [this, plan, point] { promptResume(plan, point); },
+                                  Qt::QueuedConnection);
+    }
 }
 
-void MainWindow::onEphemerisError(const QString &errorString) {
-    ui->Sun_Button->setEnabled(true);
-    ui->Moon_Button->setEnabled(true);
-    ui->Mercury_Button->setEnabled(true);
-    ui->Venus_Button->setEnabled(true);
-    ui->Mars_Button->setEnabled(true);
-    ui->Jupyter_Button->setEnabled(true);
-    ui->Saturn_Button->setEnabled(true);
+void MainWindow::promptResume(const QString &plan, const QString &point)
+{
+    const auto answer = QMessageBox::question(
+        this, "Resume tracking",
+        QString("Resume interrupted session %1 at point %2?").arg(plan, point));
+    m_resumePromptQueued = false;
+    if (answer == QMessageBox::Yes)
+        m_bt->sendCommand("RESUME\n");
+}
+
+void MainWindow::onHorizonRecordClicked()
+{
+    if (!m_horizon.isRecording()) {
+        if (!m_currentCenter.isValid()) {
+            statusBar()->showMessage("No GPS position yet", 3000);
+            return;
+        }
+        m_horizon.beginRecording();
+        m_horizonTimer->start();
+        ui->Horizon_Record_Button->setText("Finish horizon");
+        statusBar()->showMessage("Jog along the top of the obstructions all around", 5000);
+        return;
+    }
+
+    m_horizonTimer->stop();
+    ui->Horizon_Record_Button->setText("Record horizon");
+    if (!m_horizon.finishRecording()) {
+        statusBar()->showMessage("Horizon not recorded: sweep a wider arc", 5000);
+        return;
+    }
+    QString error;
+    if (!m_horizon.save(m_currentCenter, &error))
+        qDebug() << "Horizon mask not saved:" << error;
+    m_horizonSite = m_currentCenter;
+    statusBar()->showMessage(QString("Horizon recorded, highest %1°")
+                                 .arg(m_horizon.maxLimit(), 0, 'f', 1), 5000);
+}
+
+void MainWindow::onEphemerisError(int requestId, const QString &objectId,
+                                  const QString &errorString) {
+    if (requestId == m_refreshRequestId) {
+        m_refreshRequestId = 0;
+        statusBar()->showMessage("Plan not refreshed: " + errorString, 5000);
+        return;
+    }
+    if (requestId != m_pendingRequestId) {
+        qDebug() << "Ephemeris prefetch failed for" << objectId << errorString;
+        return;
+    }
+    m_pendingRequestId = 0;
+    setObjectButtonsEnabled(true);
     QMessageBox::critical(this, "Ephemeris download error", errorString);
 }
 
@@ -3,15 +3,24 @@
 #include <QMainWindow>
 #include <QtBluetooth/QBluetoothAddress>
 #include <QTimer>                // <-- dodane
+#include <QElapsedTimer>
 #include <QGeoPositionInfoSource>
 #include <QGeoCoordinate>
 #include "HorizonsManager.h"
+#include "SkyCatalog.h"
+#include "SatellitePredictor.h"
+#include "VisibilityPlanner.h"
+#include "HorizonMask.h"
+#include "LinkBenchmark.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
 
 class BluetoothManager;
+class JoystickWidget;
+class DeviceRegistry;
+class EphemerisPrefetcher;
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
@@ -20,24 +29,57 @@ public:
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+protected:
+    // Catches the first paint of the window to start deferredInit()
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
 private slots:
+    // Everything not needed for the first frame: permissions, GPS, TLS warm-up
+    void deferredInit();
+
     void on_BT_Connect_clicked();
+    void onAddTrackerClicked();
 
     // --- manual control handlers ---
     void onManualPressed();
     void onManualReleased();
     void onRepeatTimeout();
+    void onJogTick();
+    void onJoystickMoved(double x, double y);
+    void onJoystickReleased();
+    // Starts / finishes recording the local horizon
+    void onHorizonRecordClicked();
 
     void onPositionUpdated(const QGeoPositionInfo &info);
     void onObjectButtonClicked();
+    void onWhatsUpClicked();
+    void onCatalogTrackClicked();
+    void onNightPlanClicked();
+    void onPlanReady(const QVector<TargetVisibility> &schedule);
+    // Comet / asteroid by designation: stored elements or one Horizons fetch
+    void onSmallBodyTrackClicked();
+    void onElementsReady(int requestId, const OrbitalElements &elements);
+    // Recomputes the running session (new ephemeris or elements) and splices it in
+    void onRefreshClicked();
 
     // --- Ephemeris handlers ---
-    void onEphemerisReady(const QVector<EphemPoint> &traj);
-    void onEphemerisError(const QString &errorString);
+    void onEphemerisReady(int requestId, const QString &objectId,
+                          const QVector<EphemPoint> &traj);
+    void onEphemerisError(int requestId, const QString &objectId,
+                          const QString &errorString);
+
+    // --- Link benchmark ---
+    void onBenchmarkClicked();
+    void onBenchmarkFinished(const LinkBenchmarkResult &result);
+
+    // --- ESP replies ---
+    void onDeviceData(const QByteArray &data);
 
 private:
     Ui::MainWindow *ui;
     BluetoothManager *m_bt;
+    // All trackers driven by this app, m_bt included
+    DeviceRegistry   *m_devices = nullptr;
 
     void populatePairedDevices();
 #ifdef Q_OS_ANDROID
@@ -51,10 +93,78 @@ private:
 
     Direction directionForSender(QObject *s) const;
 
+    // Streaming jog: JOG <pan> <tilt> sent at a fixed rate while held,
+    // the ESP stops on its own when these heartbeats stop arriving
+    QTimer         *jogTimer   = nullptr;
+    QElapsedTimer   m_pressClock;
+    JoystickWidget *m_joystick = nullptr;
+    void sendJog(double panSpeed, double tiltSpeed);
+
+    // Horizons session for a planet, clipped to when it is above the horizon
+    void requestSolarSystemSession(PlanetEphemeris::Body body);
+    void setObjectButtonsEnabled(bool enabled);
+    void startSiderealOnAll(double raDeg, double decDeg);
+    // Steps to all trackers, a copy of the plan stored on them and a compiled plan file,
+    // for the part of the trajectory clear of the local horizon
+    void startSession(const QString &objectId, const QVector<EphemPoint> &fullTraj);
+    /**
+     * Session time range of a target, UTC: from the next full minute (2 min
+     * ahead for the slew), or from its next rise above SESSION_MIN_EL and the
+     * local horizon, for at most SESSION_SECS. Steps play at the samples' own
+     * times, so a later start is waited for, not played early. The target's
+     * culmination becomes the trackers' critical window: no pan unwind there
+     * @return false (and a status message) if it stays down for 12 h
+     */
+    bool sessionWindow(const VisibilityTarget &target, QDateTime &start, QDateTime &end);
+    // Stored elements if they are recent enough, otherwise fetched again first
+    void trackSmallBody(const OrbitalElements &el);
+    // Session from locally propagated elements, clipped like a planet session
+    void startSmallBodySession(const OrbitalElements &el);
+    // Corrected trajectory of the running session, clipped like startSession
+    void spliceSession(const QVector<EphemPoint> &fullTraj);
+    // A plan is being followed: taps nudge its path instead of moving the axes
+    bool sessionRunning() const;
+    // RESUME_READY: asks whether to resume; runs from the event loop, not the reply parser
+    void promptResume(const QString &plan, const QString &point);
+
     // GPS/Wi-Fi position source
     QGeoPositionInfoSource *m_posSource = nullptr;
+    bool                    m_deferredInitDone = false;
     QGeoCoordinate          m_currentCenter;
 
+    // Local horizon of the current site, recorded by polling POS? while jogging
+    HorizonMask             m_horizon;
+    QGeoCoordinate          m_horizonSite;   // where m_horizon was loaded for
+    QTimer                 *m_horizonTimer = nullptr;
+
     // Ephemeris manager
     HorizonsManager        *m_horizonsMgr = nullptr;
+    int                     m_pendingRequestId = 0;   // object the user is waiting for
+    EphemerisPrefetcher    *m_prefetcher = nullptr;
+
+    // Bundled star / deep-sky catalog, fixed targets tracked on the ESP
+    SkyCatalog              m_catalog;
+    QVector<SkyObject>      m_visibleObjects;
+
+    // LEO satellites from local TLE files, dense plans run on the ESP
+    SatellitePredictor      m_satPredictor;
+    QVector<SatellitePass>  m_satPasses;
+
+    // Session on the trackers; a refresh splices its next version in
+    QString                 m_sessionId;     // Horizons ID or small-body ID, empty if not refreshable
+    QString                 m_sessionPlan;   // copy stored on the devices
+    QDateTime               m_sessionEnd;    // last sample, UTC
+    int                     m_refreshRequestId = 0;
+
+    // Comets and asteroids with stored elements, propagated locally
+    QVector<OrbitalElements> m_smallBodies;
+
+    // Rise/set/transit for all targets over the coming night
+    VisibilityPlanner      *m_visPlanner = nullptr;
+    QVector<TargetVisibility> m_nightPlan;
+
+    // RTT / throughput / command-to-motion measurement of the BT link
+    LinkBenchmark          *m_linkBench = nullptr;
+    QByteArray              m_rxBuffer;
+    bool                    m_resumePromptQueued = false;   // one question per offer
 };
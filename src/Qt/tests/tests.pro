@@ -0,0 +1,6 @@
+# Unit tests of the planning code; run with `qmake && make check`
+TEMPLATE = subdirs
+SUBDIRS += \
+    tst_trajectorytiming.pro \
+    tst_panwrapplanner.pro \
+    tst_orbits.pro
@@ -0,0 +1,252 @@
+#include <QtTest>
+#include <QtMath>
+#include "Sgp4.h"
+#include "SmallBodyOrbit.h"
+#include "PlanetEphemeris.h"
+#include "AstroMath.h"
+
+// Orbit propagation checked against published reference values
+class OrbitsTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void sgp4MatchesValladoReference();
+    void sgp4RejectsDeepSpace();
+    void keplerSolverStaysOnTheConic();
+    void cometDistancesMatchHorizons();
+    void asteroidOppositionsFromMpcLine();
+    void precessionToDate();
+};
+
+namespace {
+
+double distance(const double a[3], const double b[3])
+{
+    return qSqrt((a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1])
+                 + (a[2] - b[2]) * (a[2] - b[2]));
+}
+
+const double K_GAUSS = 0.01720209895;
+
+double norm(const double a[3])
+{
+    return qSqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+}
+
+OrbitalElements cometElements(double q, double e, double incl, double node, double peri, double tPeriJd)
+{
+    OrbitalElements el;
+    el.epochJd    = tPeriJd;
+    el.q          = q;
+    el.e          = e;
+    el.inclDeg    = incl;
+    el.nodeDeg    = node;
+    el.argPeriDeg = peri;
+    el.tPeriJd    = tPeriJd;
+    return el;
+}
+
+// C/2020 F3 (NEOWISE), 1997 Hale-Bopp and 1I/'Oumuamua, perihelion elements
+const OrbitalElements NEOWISE   = cometElements(0.294647, 0.999176, 128.9375,  61.0101,  37.2786, 2459034.18);
+const OrbitalElements HALE_BOPP = cometElements(0.914,    0.9951,    89.43,   282.47,   130.59,   2450539.64);
+const OrbitalElements OUMUAMUA  = cometElements(0.2556,   1.2011,   122.74,    24.60,   241.81,   2458005.99);
+
+// MPCORB line of (1) Ceres, epoch 2020-05-31, split at the semi-major axis
+const QString CERES_MPC = QStringLiteral(
+    "00001    3.53  0.15 K205V 162.68631   73.73161   80.28698   10.58862  0.0775571  0.21406009   2.7676569"
+    "  0 MPO492748  6751 115 1801-2019 0.60 M-v 30h MPCLINUX   0000 (1) Ceres                   20190915");
+
+// Ecliptic longitude of an equatorial J2000 direction [deg]
+double eclipticLongitude(double raDeg, double decDeg)
+{
+    const double eps = qDegreesToRadians(PlanetEphemeris::OBLIQUITY_DEG);
+    const double ra = qDegreesToRadians(raDeg), dec = qDegreesToRadians(decDeg);
+    return qRadiansToDegrees(qAtan2(qSin(ra) * qCos(eps) + qTan(dec) * qSin(eps), qCos(ra)));
+}
+
+} // namespace
+
+void OrbitsTest::sgp4MatchesValladoReference()
+{
+    // Catalog 00005 (Vanguard 1) from the test set of Vallado et al.,
+    // "Revisiting Spacetrack Report #3" (AIAA 2006-6753), near-earth branch
+    TwoLineElements tle;
+    QVERIFY(TwoLineElements::parse("",
+        "1 00005U 58002B   00179.78495062  .00000023  00000-0  28098-4 0  4753",
+        "2 00005  34.2682 348.7242 1859667 331.7664  19.3264 10.82419157413667", tle));
+    QCOMPARE(tle.satNum, 5);
+    QCOMPARE(tle.epoch.date(), QDate(2000, 6, 27));
+    QCOMPARE(tle.ecc, 0.1859667);
+
+    Sgp4 sgp4;
+    QVERIFY(sgp4.init(tle));
+
+    // TEME position [km] at tsince [min]
+    struct Ref { double tsince; double r[3]; };
+    const Ref refs[] = {
+        {    0.0, {  7022.46529266, -1400.08296755,     0.03995155 } },
+        {  360.0, { -7154.03120202, -3783.17682504, -3536.19412294 } },
+        {  720.0, { -7134.59340119,  6531.68641334,  3260.27186483 } },
+        { 1080.0, {  5568.53901181,  4492.06992591,  3863.87641983 } },
+        { 1440.0, {  -938.55923943, -6268.18748831, -4294.02924751 } },
+    };
+    for (const Ref &ref : refs) {
+        double r[3], v[3];
+        QVERIFY(sgp4.propagate(ref.tsince, r, v));
+        QVERIFY2(distance(r, ref.r) < 0.01,
+                 qPrintable(QString("tsince %1: %2 km off").arg(ref.tsince).arg(distance(r, ref.r))));
+    }
+
+    double r[3], v[3];
+    QVERIFY(sgp4.propagate(0.0, r, v));
+    const double v0[3] = { 1.893841015, 6.405893759, 4.534807250 };
+    QVERIFY(distance(v, v0) < 1e-5);
+
+    // The clock overload counts from the TLE epoch
+    double rt[3], vt[3];
+    QVERIFY(sgp4.propagate(tle.epoch.addSecs(360 * 60), rt, vt));
+    QVERIFY(distance(rt, refs[1].r) < 0.01);
+}
+
+void OrbitsTest::sgp4RejectsDeepSpace()
+{
+    // Geostationary, one revolution a day: period far above 225 min
+    TwoLineElements tle;
+    QVERIFY(TwoLineElements::parse("GEO",
+        "1 26038U 00006A   24001.50000000 -.00000286  00000-0  00000+0 0  9993",
+        "2 26038   0.0157 299.8532 0002245  26.7009 157.9813  1.00271587 89999", tle));
+    Sgp4 sgp4;
+    QVERIFY(!sgp4.init(tle));
+    QVERIFY(!sgp4.isValid());
+    double r[3], v[3];
+    QVERIFY(!sgp4.propagate(0.0, r, v));
+
+    // A broken checksum is refused before that
+    QVERIFY(!TwoLineElements::parse("",
+        "1 26038U 00006A   24001.50000000 -.00000286  00000-0  00000+0 0  9994",
+        "2 26038   0.0157 299.8532 0002245  26.7009 157.9813  1.00271587 89999", tle));
+}
+
+void OrbitsTest::keplerSolverStaysOnTheConic()
+{
+    // Elliptic, near-parabolic, exactly parabolic (Barker) and hyperbolic
+    OrbitalElements parabolic = NEOWISE;
+    parabolic.e = 1.0;
+    OrbitalElements ceres;
+    QVERIFY(OrbitalElements::parseMpcAsteroid(CERES_MPC, ceres));
+    const OrbitalElements orbits[] = { ceres, NEOWISE, HALE_BOPP, parabolic, OUMUAMUA };
+
+    for (const OrbitalElements &el : orbits) {
+        const SmallBodyOrbit orbit(el);
+        double p[3];
+        orbit.heliocentric(el.tPeriJd, p);
+        QVERIFY(qAbs(norm(p) - el.q) < 1e-9);
+
+        // Energy (vis-viva) and angular momentum of the conic, from a central
+        // difference, near perihelion and far out on both legs
+        for (double dt : { -3000.0, -40.0, 5.0, 40.0, 3000.0 }) {
+            const double h = 1e-3;
+            double a[3], b[3], v[3];
+            orbit.heliocentric(el.tPeriJd + dt, p);
+            orbit.heliocentric(el.tPeriJd + dt - h, a);
+            orbit.heliocentric(el.tPeriJd + dt + h, b);
+            for (int i = 0; i < 3; ++i) v[i] = (b[i] - a[i]) / (2.0 * h);
+            const double r  = norm(p);
+            const double k2 = K_GAUSS * K_GAUSS;
+            const double v2 = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+            const double energy = v2 - k2 * (2.0 / r - (1.0 - el.e) / el.q);
+            const double hvec[3] = { p[1] * v[2] - p[2] * v[1],
+                                     p[2] * v[0] - p[0] * v[2],
+                                     p[0] * v[1] - p[1] * v[0] };
+            const double semiLatus = el.q * (1.0 + el.e);
+            const QString where = QString("e %1, t-T %2 d").arg(el.e).arg(dt);
+            // The difference quotient itself is good to a few 1e-7
+            QVERIFY2(qAbs(energy) / (k2 * 2.0 / r) < 2e-5, qPrintable(where));
+            QVERIFY2(qAbs(norm(hvec) * norm(hvec) / k2 - semiLatus) / semiLatus < 2e-5, qPrintable(where));
+        }
+    }
+}
+
+void OrbitsTest::cometDistancesMatchHorizons()
+{
+    // Closest approaches to the Earth as listed by JPL (SBDB / Horizons)
+    struct Approach { OrbitalElements el; QDateTime utc; double distAu; };
+    OrbitalElements neowise;
+    QVERIFY(OrbitalElements::parseMpcComet(
+        "    C2020F3   2020 07 03.6800  0.294647  0.999176   37.2786   61.0101  128.9375  20200703"
+        "  12.0 3.2   C/2020 F3 (NEOWISE)", neowise));
+    QCOMPARE(neowise.designation, QString("C/2020 F3"));
+    QVERIFY(qAbs(neowise.tPeriJd - NEOWISE.tPeriJd) < 1e-6);
+
+    const Approach approaches[] = {
+        { neowise,   QDateTime(QDate(2020,  7, 23), QTime(1, 0), Qt::UTC),  0.6913 },
+        { HALE_BOPP, QDateTime(QDate(1997,  3, 22), QTime(0, 0), Qt::UTC),  1.315  },
+        { OUMUAMUA,  QDateTime(QDate(2017, 10, 14), QTime(0, 0), Qt::UTC),  0.1616 },
+    };
+    for (const Approach &ap : approaches) {
+        const SmallBodyOrbit orbit(ap.el);
+        double ra, dec, dist, before, after;
+        orbit.raDec(ap.utc, ra, dec, &dist);
+        orbit.raDec(ap.utc.addDays(-3), ra, dec, &before);
+        orbit.raDec(ap.utc.addDays(3), ra, dec, &after);
+        const QString what = QString("%1 at %2: %3 AU").arg(ap.el.designation, ap.utc.toString(Qt::ISODate)).arg(dist);
+        QVERIFY2(qAbs(dist - ap.distAu) < 0.003, qPrintable(what));
+        QVERIFY2(dist < before && dist < after, qPrintable(what));
+    }
+}
+
+void OrbitsTest::asteroidOppositionsFromMpcLine()
+{
+    OrbitalElements el;
+    QVERIFY(OrbitalElements::parseMpcAsteroid(CERES_MPC, el));
+    QCOMPARE(el.designation, QString("1 Ceres"));
+    QCOMPARE(el.epochJd, 2459000.5);
+    QVERIFY(qAbs(el.q - 2.7676569 * (1.0 - 0.0775571)) < 1e-9);
+
+    // Oppositions of Ceres: opposite the Sun in ecliptic longitude
+    const SmallBodyOrbit ceres(el);
+    const QDate oppositions[] = { QDate(2019, 5, 28), QDate(2020, 8, 28), QDate(2021, 11, 27), QDate(2023, 3, 21) };
+    for (const QDate &d : oppositions) {
+        const QDateTime utc(d, QTime(0, 0), Qt::UTC);
+        double ra, dec, sunRa, sunDec;
+        ceres.raDec(utc, ra, dec);
+        PlanetEphemeris::raDec(PlanetEphemeris::Sun, utc, sunRa, sunDec);
+        double diff = std::fmod(eclipticLongitude(ra, dec) - eclipticLongitude(sunRa, sunDec) + 720.0, 360.0);
+        QVERIFY2(qAbs(diff - 180.0) < 2.0, qPrintable(d.toString(Qt::ISODate) + QString(": %1").arg(diff)));
+    }
+}
+
+void OrbitsTest::precessionToDate()
+{
+    double m[3][3];
+    AstroMath::precessionMatrix(2451545.0, m);
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c)
+            QVERIFY(qAbs(m[r][c] - (r == c ? 1.0 : 0.0)) < 1e-12);
+
+    // Equinox of J2000 seen from J2050: 0.6406° in RA, 0.2783° in Dec (IAU 1976)
+    AstroMath::precessionMatrix(2451545.0 + 50 * 365.25, m);
+    QVERIFY(qAbs(qRadiansToDegrees(qAtan2(m[1][0], m[0][0])) - 0.6406) < 1e-3);
+    QVERIFY(qAbs(qRadiansToDegrees(qAsin(m[2][0])) - 0.2783) < 1e-3);
+
+    // ephemeris() is of date: the J2000 direction precessed, up to Ceres' few arcseconds of parallax
+    OrbitalElements el;
+    QVERIFY(OrbitalElements::parseMpcAsteroid(CERES_MPC, el));
+    const SmallBodyOrbit ceres(el);
+    const QDateTime start(QDate(2024, 3, 1), QTime(22, 0), Qt::UTC);
+    const QVector<EphemRD> eph = ceres.ephemeris(QGeoCoordinate(52.0, 21.0), start, start.addSecs(600), 60);
+    QCOMPARE(eph.size(), 11);
+    double ra, dec, v[3], d[3];
+    ceres.raDec(start, ra, dec);
+    AstroMath::precessionMatrix(AstroMath::julianDay(start) + SmallBodyOrbit::TT_MINUS_UTC_SEC / 86400.0, m);
+    AstroMath::unitVector(ra, dec, v);
+    for (int r = 0; r < 3; ++r)
+        d[r] = m[r][0] * v[0] + m[r][1] * v[1] + m[r][2] * v[2];
+    const double raDate  = std::fmod(qRadiansToDegrees(qAtan2(d[1], d[0])) + 360.0, 360.0);
+    const double decDate = qRadiansToDegrees(qAsin(d[2]));
+    QVERIFY(AstroMath::separationDeg(ra, dec, eph.first().raDeg, eph.first().decDeg) > 0.2);
+    QVERIFY(AstroMath::separationDeg(raDate, decDate, eph.first().raDeg, eph.first().decDeg) < 0.005);
+}
+
+QTEST_GUILESS_MAIN(OrbitsTest)
+#include "tst_orbits.moc"
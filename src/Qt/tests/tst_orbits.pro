@@ -0,0 +1,24 @@
+# Orbit propagation: SGP4 and small bodies against published reference values
+TEMPLATE = app
+TARGET = tst_orbits
+
+QT += testlib positioning
+QT -= gui
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    tst_orbits.cpp \
+    ../Sgp4.cpp \
+    ../SmallBodyOrbit.cpp \
+    ../PlanetEphemeris.cpp \
+    ../AstroMath.cpp
+
+HEADERS += \
+    ../Sgp4.h \
+    ../SmallBodyOrbit.h \
+    ../PlanetEphemeris.h \
+    ../EphemerisTypes.h \
+    ../AstroMath.h
@@ -0,0 +1,112 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <cmath>
+#include "PanWrapPlanner.h"
+#include "PlanFile.h"
+
+// Cable wrap planning: the session branch, where unwinds go, and what
+// happens with limits the path cannot fit
+class PanWrapPlannerTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void unwindAvoidsCriticalWindow();
+    void narrowLimitsAreInfeasible();
+    void planFileRefusesInfeasiblePath();
+};
+
+namespace {
+
+const QDateTime START = QDateTime::fromSecsSinceEpoch(1735689600, Qt::UTC);
+
+/*
+ * One sample a minute, azimuth 0 -> 400° unwrapped: fast at first, slowest
+ * (0.5°/min) around the culmination at samples 49..68, which lies where
+ * both branches fit 180±200°, so that is where an unwind would go
+ */
+QVector<EphemPoint> culminatingPass()
+{
+    QVector<double> steps;
+    steps.fill(10.0, 33);
+    steps << QVector<double>(15, 1.0) << QVector<double>(20, 0.5) << QVector<double>(45, 1.0);
+    QVector<EphemPoint> out;
+    double u = 0.0;
+    out.append({ START, u, 40.0 });
+    for (int i = 0; i < steps.size(); ++i) {
+        u += steps[i];
+        out.append({ START.addSecs(60 * (i + 1)), std::fmod(u, 360.0), 40.0 });
+    }
+    return out;
+}
+
+} // namespace
+
+void PanWrapPlannerTest::unwindAvoidsCriticalWindow()
+{
+    const QVector<EphemPoint> traj = culminatingPass();
+    PanWrapPlanner planner(180.0, 200.0, 200.0);
+
+    // Without a window the unwind takes the slowest stretch, the culmination
+    const PanPlan free = planner.plan(traj);
+    QVERIFY(free.feasible);
+    QCOMPARE(free.reversals.size(), 1);
+    QCOMPARE(free.reversals.first(), 49);
+
+    const QPair<QDateTime, QDateTime> window(traj[45].utc, traj[72].utc);
+    planner.setCriticalWindows({ window });
+    const PanPlan plan = planner.plan(traj);
+    QVERIFY(plan.feasible);
+    QCOMPARE(plan.reversals.size(), 1);
+    const QDateTime at = traj[plan.reversals.first()].utc;
+    QVERIFY(at < window.first || at > window.second);
+
+    // Every sample within the limits, the unwind a whole turn, nothing else jumps
+    for (int i = 0; i < plan.panAbsDeg.size(); ++i) {
+        QVERIFY(plan.panAbsDeg[i] >= planner.minDeg() && plan.panAbsDeg[i] <= planner.maxDeg());
+        if (i == 0) continue;
+        const double step = plan.panAbsDeg[i] - plan.panAbsDeg[i - 1];
+        if (i == plan.reversals.first()) QVERIFY(qAbs(qAbs(step) - 360.0) < 11.0);
+        else                              QVERIFY(qAbs(step) <= 10.0 + 1e-9);
+    }
+}
+
+void PanWrapPlannerTest::narrowLimitsAreInfeasible()
+{
+    // 350° of azimuth between limits 200° apart: no unwind brings it back inside
+    QVector<EphemPoint> traj;
+    for (int i = 0; i < 36; ++i)
+        traj.append({ START.addSecs(60 * i), std::fmod(100.0 + 10.0 * i, 360.0), 40.0 });
+    const PanPlan plan = PanWrapPlanner(180.0, 100.0, 100.0).plan(traj);
+    QVERIFY(!plan.feasible);
+
+    // The same path fits the default limits on one branch
+    const PanPlan wide = PanWrapPlanner().plan(traj);
+    QVERIFY(wide.feasible);
+    QVERIFY(wide.reversals.isEmpty());
+}
+
+void PanWrapPlannerTest::planFileRefusesInfeasiblePath()
+{
+    QVector<EphemPoint> traj;
+    for (int i = 0; i < 36; ++i)
+        traj.append({ START.addSecs(60 * i), std::fmod(100.0 + 10.0 * i, 360.0), 40.0 });
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("narrow.plan");
+
+    DeviceCalibration cal;
+    cal.panLimitCcwDeg = 100.0;
+    cal.panLimitCwDeg  = 100.0;
+    QString error;
+    QVERIFY(!PlanFile::compile(path, "499", QGeoCoordinate(52.0, 21.0), traj,
+                               PanWrapPlanner(180.0, cal.panLimitCcwDeg, cal.panLimitCwDeg), cal, &error));
+    QVERIFY(error.contains("cable"));
+    QVERIFY(!QFile::exists(path));
+
+    QVERIFY(PlanFile::compile(path, "499", QGeoCoordinate(52.0, 21.0), traj,
+                              PanWrapPlanner(), DeviceCalibration(), &error));
+    QVERIFY(QFile::exists(path));
+}
+
+QTEST_GUILESS_MAIN(PanWrapPlannerTest)
+#include "tst_panwrapplanner.moc"
@@ -0,0 +1,35 @@
+# Cable wrap planning: branch choice, unwind placement, limits
+TEMPLATE = app
+TARGET = tst_panwrapplanner
+
+QT += testlib network positioning bluetooth concurrent
+QT -= gui
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    tst_panwrapplanner.cpp \
+    ../HorizonsManager.cpp \
+    ../DeviceRegistry.cpp \
+    ../PlanFile.cpp \
+    ../PanWrapPlanner.cpp \
+    ../TrackingSession.cpp \
+    ../bluetoothmanager.cpp \
+    ../AstroMath.cpp \
+    ../PlanetEphemeris.cpp \
+    ../SmallBodyOrbit.cpp \
+    ../StartupProfiler.cpp
+
+HEADERS += \
+    ../HorizonsManager.h \
+    ../DeviceRegistry.h \
+    ../PlanFile.h \
+    ../PanWrapPlanner.h \
+    ../TrackingSession.h \
+    ../bluetoothmanager.h \
+    ../AstroMath.h \
+    ../PlanetEphemeris.h \
+    ../SmallBodyOrbit.h \
+    ../StartupProfiler.h
@@ -0,0 +1,117 @@
+#include <QtTest>
+#include <cmath>
+#include "HorizonMask.h"
+#include "HorizonsManager.h"
+#include "DeviceRegistry.h"
+#include "PanWrapPlanner.h"
+
+// Playback timing of trajectories: every step record must play at the time
+// its sample was computed for, wherever the session starts
+class TrajectoryTimingTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void lateRunPlaysAtItsOwnTime();
+    void uploadRoundTripsSubSecondStart();
+    void uploadCarriesPlannedPanBranch();
+};
+
+namespace {
+
+// Azimuth 100..160° at a constant 30° elevation, one sample per 4 s
+QVector<EphemPoint> sweep(const QDateTime &start, int secs)
+{
+    QVector<EphemPoint> out;
+    for (int t = 0; t <= secs; t += 4)
+        out.append({ start.addSecs(t), 100.0 + 60.0 * t / secs, 30.0 });
+    return out;
+}
+
+// Obstruction up to 50° between azimuth 100 and 140
+HorizonMask blockedMask()
+{
+    HorizonMask mask;
+    mask.beginRecording();
+    for (int az = 0; az < HorizonMask::BINS; ++az)
+        mask.record(az + 0.5, (az >= 100 && az < 140) ? 50.0 : 0.0);
+    mask.finishRecording();
+    return mask;
+}
+
+} // namespace
+
+void TrajectoryTimingTest::lateRunPlaysAtItsOwnTime()
+{
+    // Fetched from now, visible only from azimuth 140 on: 40 min later
+    const QDateTime fetchStart = QDateTime::currentDateTimeUtc().addSecs(120);
+    const QVector<EphemPoint> full = sweep(fetchStart, 3600);
+    const QVector<QVector<EphemPoint>> runs = blockedMask().visibleRuns(full, 0.0, 60);
+    QCOMPARE(runs.size(), 1);
+    const QVector<EphemPoint> &run = runs.first();
+    QVERIFY(fetchStart.secsTo(run.first().utc) >= 39 * 60);
+
+    // Record k plays at base + offset: that has to be the run's own sample time
+    const QDateTime base = HorizonsManager::stepSessionBaseTime(run);
+    QCOMPARE(base, run.first().utc);
+    PanWrapPlanner planner;
+    const QVector<StepRecord> plan = HorizonsManager::buildStepPlan(planner, run, 8.0, 8.0);
+    QCOMPARE(plan.size(), run.size());
+    for (int k = 0; k < plan.size(); ++k)
+        QCOMPARE(base.addMSecs(plan[k].offset_ms), run[k].utc);
+
+    // A run this far ahead is not started now but kept until shortly before it
+    DeviceRegistry devices;
+    devices.sendTrajectorySteps(run);
+    QCOMPARE(devices.scheduledStart(), run.first().utc);
+    devices.stopAll();
+    QVERIFY(!devices.scheduledStart().isValid());
+}
+
+void TrajectoryTimingTest::uploadRoundTripsSubSecondStart()
+{
+    // 20 Hz satellite plan starting at an arbitrary millisecond
+    QVector<EphemPoint> traj;
+    const QDateTime start = QDateTime::fromMSecsSinceEpoch(1735689615737LL, Qt::UTC);
+    for (int i = 0; i < 200; ++i)
+        traj.append({ start.addMSecs(50 * i), 120.0 + 0.1 * i, 20.0 + 0.05 * i });
+
+    const QList<QByteArray> lines = HorizonsManager::trajectoryPayload(traj, "sat").split('\n');
+    const QList<QByteArray> header = lines.first().split(' ');
+    QCOMPARE(header.size(), 4);
+    QCOMPARE(header[0], QByteArray("TRAJ"));
+    QCOMPARE(header[3].toInt(), traj.size());
+    QCOMPARE(lines.at(traj.size() + 1), QByteArray("TRAJ_END"));
+
+    // What SphericalTracker::indexForTime computes: T0 [s] * 1000 + t [ms]
+    const qint64 t0Ms = header[2].toLongLong() * 1000;
+    for (int i = 0; i < traj.size(); ++i) {
+        const QList<QByteArray> f = lines.at(i + 1).split(' ');
+        QCOMPARE(f.size(), 3);
+        QVERIFY(f[0].toLongLong() >= 0);
+        QCOMPARE(t0Ms + f[0].toLongLong(), traj[i].utc.toMSecsSinceEpoch());
+    }
+}
+
+void TrajectoryTimingTest::uploadCarriesPlannedPanBranch()
+{
+    // Through north: 340 -> 20°, the planned pan angle goes on past 360
+    QVector<EphemPoint> traj;
+    const QDateTime start = QDateTime::fromSecsSinceEpoch(1735689600, Qt::UTC);
+    for (int i = 0; i <= 40; ++i)
+        traj.append({ start.addSecs(4 * i), std::fmod(340.0 + i, 360.0), 30.0 });
+
+    PanWrapPlanner planner;
+    const PanPlan plan = planner.plan(traj);
+    const QVector<EphemPoint> planned = DeviceRegistry::plannedPanTrajectory(traj, plan);
+    for (int i = 1; i < planned.size(); ++i)
+        QCOMPARE(planned[i].az - planned[i - 1].az, 1.0);
+    QCOMPARE(DeviceRegistry::plannedPanAt(planned, start.addSecs(82)), planned[20].az + 0.5);
+    QVERIFY(qIsNaN(DeviceRegistry::plannedPanAt(planned, start.addSecs(-1))));
+
+    const QList<QByteArray> lines = HorizonsManager::trajectoryPayload(planned, "p", true).split('\n');
+    QCOMPARE(lines.first().split(' ').value(4), QByteArray("PAN"));
+    QCOMPARE(lines.at(41).split(' ').value(1).toDouble(), planned.last().az);
+}
+
+QTEST_GUILESS_MAIN(TrajectoryTimingTest)
+#include "tst_trajectorytiming.moc"
@@ -0,0 +1,37 @@
+# Playback timing of step plans and uploads
+TEMPLATE = app
+TARGET = tst_trajectorytiming
+
+QT += testlib network positioning bluetooth concurrent
+QT -= gui
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    tst_trajectorytiming.cpp \
+    ../HorizonMask.cpp \
+    ../HorizonsManager.cpp \
+    ../DeviceRegistry.cpp \
+    ../PlanFile.cpp \
+    ../PanWrapPlanner.cpp \
+    ../TrackingSession.cpp \
+    ../bluetoothmanager.cpp \
+    ../AstroMath.cpp \
+    ../PlanetEphemeris.cpp \
+    ../SmallBodyOrbit.cpp \
+    ../StartupProfiler.cpp
+
+HEADERS += \
+    ../HorizonMask.h \
+    ../HorizonsManager.h \
+    ../DeviceRegistry.h \
+    ../PlanFile.h \
+    ../PanWrapPlanner.h \
+    ../TrackingSession.h \
+    ../bluetoothmanager.h \
+    ../AstroMath.h \
+    ../PlanetEphemeris.h \
+    ../SmallBodyOrbit.h \
+    ../StartupProfiler.h
@@ -0,0 +1,260 @@
+#!/usr/bin/env python3
+"""Local stand-in for the JPL Horizons API with record / replay.
+
+Responses are stored per query in a directory, keyed by the request path and
+its sorted query parameters without START_TIME / STOP_TIME, so the app gets
+the same answer for the same question on any day without network access.
+On replay the rows of an observer table are moved to the requested start
+(and cut at the requested stop); the positions stay those of the recorded
+night, close enough for slow targets. Faults can be injected to exercise
+the error paths and to benchmark the fetch -> parse -> plan chain; with
+--seed each request draws them from its own generator, so a run repeats
+whatever order the threads serve in.
+
+    # capture real replies while using the app
+    horizons_standin.py --dir recordings --record
+
+    # replay offline, with 300 ms latency, 20 kB/s and 10 % truncated replies
+    horizons_standin.py --dir recordings --latency 300 --rate 20000 --truncate-rate 0.1
+
+Point the app at it with
+    HORIZONS_BASE_URL=http://127.0.0.1:8765/api/horizons.api
+"""
+
+import argparse
+import calendar
+import hashlib
+import json
+import os
+import random
+import sys
+import threading
+import time
+import urllib.error
+import urllib.parse
+import urllib.request
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+UPSTREAM = 'https://ssd.jpl.nasa.gov'
+
+# Horizons answers bad queries with HTTP 200 and a text body without $$SOE
+HORIZONS_ERROR_BODY = (b'API VERSION: 1.2\nAPI SOURCE: NASA/JPL Horizons API\n\n'
+                       b'No ephemeris for target "stand-in" after A.D. 9999-DEC-31 (injected error)\n')
+
+
+# Query window, left out of the key: the app asks for "now" onwards
+TIME_PARAMS = ('START_TIME', 'STOP_TIME')
+MONTHS = {m: i for i, m in enumerate(calendar.month_abbr) if m}
+
+
+def query_params(path):
+    url = urllib.parse.urlsplit(path)
+    return url.path, sorted(urllib.parse.parse_qsl(url.query, keep_blank_values=True))
+
+
+def query_key(path):
+    """Canonical form of a request: path + parameters sorted by name, without the time window."""
+    url_path, params = query_params(path)
+    return url_path + '?' + urllib.parse.urlencode([(k, v) for k, v in params if k not in TIME_PARAMS])
+
+
+def parse_horizons_time(text):
+    """'2025-Jan-01 00:00' (optionally quoted, date only allowed) -> unix seconds, None if not a time."""
+    text = text.strip().strip("'").strip()
+    try:
+        date, _, clock = text.partition(' ')
+        y, mon, d = date.split('-')
+        hh, mm = (clock.split(':')[:2] if clock else ('0', '0'))
+        return calendar.timegm((int(y), MONTHS[mon], int(d), int(hh), int(mm), 0))
+    except (ValueError, KeyError):
+        return None
+
+
+def format_horizons_time(secs):
+    t = time.gmtime(secs)
+    return '%04d-%s-%02d %02d:%02d' % (t.tm_year, calendar.month_abbr[t.tm_mon], t.tm_mday, t.tm_hour, t.tm_min)
+
+
+def shift_rows(body, path):
+    """Observer table rows moved to the requested START_TIME, rows past STOP_TIME dropped.
+
+    Element tables (EPHEM_TYPE=ELEMENTS) are left alone: their epoch is part of the answer.
+    """
+    params = dict(query_params(path)[1])
+    if params.get('EPHEM_TYPE', '').strip("'").upper() == 'ELEMENTS':
+        return body
+    start = parse_horizons_time(params.get('START_TIME', ''))
+    stop = parse_horizons_time(params.get('STOP_TIME', ''))
+    if start is None:
+        return body
+    lines = body.decode('utf-8', 'replace').split('\n')
+    try:
+        soe, eoe = lines.index('$$SOE'), lines.index('$$EOE')
+    except ValueError:
+        return body
+    rows, delta = [], None
+    for line in lines[soe + 1:eoe]:
+        stamp, sep, rest = line.partition(',')
+        t = parse_horizons_time(stamp)
+        if t is None:
+            rows.append(line)
+            continue
+        if delta is None:
+            delta = start - t
+        if stop is not None and t + delta > stop:
+            break
+        lead = stamp[:len(stamp) - len(stamp.lstrip())]
+        rows.append(lead + format_horizons_time(t + delta) + sep + rest)
+    return '\n'.join(lines[:soe + 1] + rows + lines[eoe:]).encode('utf-8')
+
+
+def key_file(directory, key):
+    return os.path.join(directory, hashlib.sha1(key.encode('utf-8')).hexdigest()[:20])
+
+
+class Store:
+    """Recorded replies: <hash>.body holds the bytes, <hash>.json the metadata."""
+
+    def __init__(self, directory):
+        self.directory = directory
+        self.lock = threading.Lock()
+        self.served = {}   # requests seen per key, for the per-request fault seed
+        os.makedirs(directory, exist_ok=True)
+
+    def next_index(self, key):
+        with self.lock:
+            n = self.served.get(key, 0)
+            self.served[key] = n + 1
+            return n
+
+    def load(self, key):
+        base = key_file(self.directory, key)
+        try:
+            with open(base + '.json') as f:
+                meta = json.load(f)
+            with open(base + '.body', 'rb') as f:
+                return meta, f.read()
+        except FileNotFoundError:
+            return None, None
+
+    def save(self, key, status, content_type, body):
+        base = key_file(self.directory, key)
+        meta = {'key': key, 'status': status, 'content_type': content_type,
+                'recorded': time.strftime('%Y-%m-%dT%H:%M:%SZ', time.gmtime()), 'bytes': len(body)}
+        with self.lock:
+            with open(base + '.body', 'wb') as f:
+                f.write(body)
+            with open(base + '.json', 'w') as f:
+                json.dump(meta, f, indent=1)
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1'
+    opts = None
+    store = None
+
+    def log_message(self, fmt, *args):
+        pass
+
+    def do_GET(self):
+        t0 = time.monotonic()
+        o = self.opts
+        key = query_key(self.path)
+        status, content_type, body, source = 404, 'text/plain', b'', 'miss'
+
+        meta, recorded = self.store.load(key)
+        if recorded is not None and not o.record_refresh:
+            status, content_type, body, source = meta['status'], meta['content_type'], recorded, 'replay'
+            if status == 200:
+                body = shift_rows(body, self.path)
+        elif o.record:
+            status, content_type, body = self.fetch_upstream()
+            if status == 200:
+                self.store.save(key, status, content_type, body)
+            source = 'record'
+        else:
+            body = ('No recording for query %s\n' % key).encode('utf-8')
+
+        # Fault injection, in order: hard error, Horizons-style error, truncation.
+        # Seeded per request (key and how many times it was asked), not shared
+        # by the server threads, so the same run draws the same faults
+        if o.seed is not None:
+            rng = random.Random('%d:%s:%d' % (o.seed, key, self.store.next_index(key)))
+        else:
+            rng = random.Random()
+        r = rng.random()
+        if r < o.error_rate:
+            status, content_type, body, source = o.error_status, 'text/plain', b'injected error\n', 'error'
+        elif r < o.error_rate + o.horizons_error_rate:
+            status, content_type, body, source = 200, 'text/plain', HORIZONS_ERROR_BODY, 'horizons-error'
+        elif status == 200 and rng.random() < o.truncate_rate:
+            body = body[:int(len(body) * o.truncate_fraction)]
+            source += '+truncated'
+
+        delay = max(0.0, rng.gauss(o.latency, o.jitter)) / 1000.0
+        if delay:
+            time.sleep(delay)
+        self.send_response(status)
+        self.send_header('Content-Type', content_type)
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        self.send_body(body)
+
+        print('%-16s %3d %7d B %7.1f ms  %s' % (source, status, len(body),
+                                                (time.monotonic() - t0) * 1000.0, key[:120]), flush=True)
+
+    def send_body(self, body):
+        rate = self.opts.rate
+        if rate <= 0:
+            self.wfile.write(body)
+            return
+        chunk = max(1, int(rate / 50))   # 20 ms worth of data per write
+        for i in range(0, len(body), chunk):
+            self.wfile.write(body[i:i + chunk])
+            self.wfile.flush()
+            time.sleep(len(body[i:i + chunk]) / rate)
+
+    def fetch_upstream(self):
+        url = self.opts.upstream.rstrip('/') + self.path
+        try:
+            with urllib.request.urlopen(url, timeout=60) as resp:
+                return resp.status, resp.headers.get('Content-Type', 'text/plain'), resp.read()
+        except urllib.error.HTTPError as e:
+            return e.code, 'text/plain', e.read()
+        except (urllib.error.URLError, OSError) as e:
+            return 502, 'text/plain', ('upstream unavailable: %s\n' % e).encode('utf-8')
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument('--host', default='127.0.0.1')
+    ap.add_argument('--port', type=int, default=8765)
+    ap.add_argument('--dir', default='horizons_recordings', help='recorded replies')
+    ap.add_argument('--record', action='store_true', help='forward unknown queries upstream and store the replies')
+    ap.add_argument('--record-refresh', action='store_true', help='with --record, fetch again even if recorded')
+    ap.add_argument('--upstream', default=UPSTREAM)
+    ap.add_argument('--latency', type=float, default=0.0, help='added delay before the reply [ms]')
+    ap.add_argument('--jitter', type=float, default=0.0, help='standard deviation of the delay [ms]')
+    ap.add_argument('--rate', type=float, default=0.0, help='body transfer rate [bytes/s], 0 = unlimited')
+    ap.add_argument('--error-rate', type=float, default=0.0, help='probability of an HTTP error reply')
+    ap.add_argument('--error-status', type=int, default=503)
+    ap.add_argument('--horizons-error-rate', type=float, default=0.0,
+                    help='probability of a 200 reply without ephemeris rows')
+    ap.add_argument('--truncate-rate', type=float, default=0.0, help='probability of a cut-off body')
+    ap.add_argument('--truncate-fraction', type=float, default=0.5, help='part of the body kept when truncating')
+    ap.add_argument('--seed', type=int, help='random seed for reproducible fault sequences')
+    args = ap.parse_args()
+
+    Handler.opts = args
+    Handler.store = Store(args.dir)
+    server = ThreadingHTTPServer((args.host, args.port), Handler)
+    print('Horizons stand-in on http://%s:%d/api/horizons.api (%s, %s)'
+          % (args.host, args.port, 'record' if args.record else 'replay', args.dir), file=sys.stderr)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+"""Decoder for the ESP flight recorder dump (REC_DUMP, see src/ESP/FlightRecorder.h).
+
+Reads a capture of the serial / Bluetooth stream containing
+
+    REC_DUMP <count> <micros now> <unix ms now>\n
+    <count> x 12-byte little-endian records: u32 tUs, u8 type, u8 axis, u16 seq, i32 value
+    \r\nREC_END
+
+and prints a timeline. Without a capture file it can ask the device itself:
+
+    rec_decode.py capture.bin
+    rec_decode.py --port /dev/rfcomm0            (needs pyserial)
+    rec_decode.py capture.bin --csv > events.csv
+    rec_decode.py capture.bin --plot             (needs matplotlib)
+"""
+
+import argparse
+import datetime
+import struct
+import sys
+
+RECORD = struct.Struct('<IBBHi')
+
+TYPES = {
+    1: 'CMD',
+    2: 'CMD_END',
+    3: 'LOOP_GAP',
+    4: 'CTRL_LATE',
+    5: 'SEGMENT',
+    6: 'POS_ERR',
+    7: 'UNWIND',
+    8: 'STEP',
+    9: 'SLEW',
+    10: 'SLEW_END',
+    11: 'TRACK',
+    12: 'TRACK_STOP',
+    13: 'IMU_OVERRUN',
+    14: 'SPLICE',
+    15: 'OFFSET',
+}
+AXES = {0: '', 1: 'pan', 2: 'tilt'}
+
+# Values worth flagging in the timeline [us]
+SLOW_CMD_US = 5000
+SLOW_LOOP_US = 10000
+
+
+def parse(data):
+    """Returns (events, micros_now, unix_ms_now); events are dicts in write order."""
+    start = data.find(b'REC_DUMP ')
+    if start < 0:
+        raise ValueError('no REC_DUMP header in capture')
+    eol = data.index(b'\n', start)
+    fields = data[start:eol].decode('ascii').split()
+    count, micros_now, unix_ms = int(fields[1]), int(fields[2]), int(fields[3])
+
+    body = data[eol + 1:eol + 1 + count * RECORD.size]
+    if len(body) < count * RECORD.size:
+        print('warning: capture truncated, %d of %d events'
+              % (len(body) // RECORD.size, count), file=sys.stderr)
+        count = len(body) // RECORD.size
+
+    events = []
+    for k in range(count):
+        t_us, etype, axis, seq, value = RECORD.unpack_from(body, k * RECORD.size)
+        events.append({'t_us': t_us, 'type': etype, 'axis': axis, 'seq': seq, 'value': value})
+
+    # micros() wraps every 2^32 us: unwrap backwards from the dump time
+    ref = micros_now
+    offset = 0
+    for e in reversed(events):
+        if e['t_us'] > ref:
+            offset -= 1 << 32
+        ref = e['t_us']
+        e['t_us'] += offset
+    end_us = micros_now
+    for e in events:
+        e['rel_us'] = e['t_us'] - end_us
+        e['unix_ms'] = unix_ms + e['rel_us'] / 1000.0 if unix_ms else None
+    return events, micros_now, unix_ms
+
+
+def tag(value):
+    raw = struct.pack('<i', value).rstrip(b'\0')
+    return raw.decode('ascii', 'replace')
+
+
+def describe(e):
+    t, v = e['type'], e['value']
+    if t == 1:
+        return "'%s'" % tag(v)
+    if t == 2:
+        return '%d us%s' % (v, '  <-- slow' if v > SLOW_CMD_US else '')
+    if t in (3, 4):
+        return '%d us%s' % (v, '  <-- stall' if v > SLOW_LOOP_US else '')
+    if t == 6:
+        return '%+d steps' % v
+    if t == 7:
+        return '%+d deg' % v
+    if t in (9, 10):
+        return '%d ms' % v
+    return str(v)
+
+
+def timeline(events, out):
+    prev = None
+    for e in events:
+        if e['unix_ms'] is not None:
+            wall = datetime.datetime.fromtimestamp(e['unix_ms'] / 1000.0, datetime.timezone.utc)
+            stamp = wall.strftime('%H:%M:%S.%f')
+        else:
+            stamp = '%+14.6f s' % (e['rel_us'] / 1e6)
+        delta = '' if prev is None else '%+10.3f ms' % ((e['t_us'] - prev) / 1000.0)
+        prev = e['t_us']
+        out.write('%s %s  %-10s %-4s %s\n' % (stamp, delta.rjust(13), TYPES.get(e['type'], e['type']),
+                                            AXES.get(e['axis'], e['axis']), describe(e)))
+
+
+def summary(events, out):
+    cmds = [e['value'] for e in events if e['type'] == 2]
+    gaps = [e['value'] for e in events if e['type'] in (3, 4)]
+    errs = {1: [], 2: []}
+    for e in events:
+        if e['type'] == 6 and e['axis'] in errs:
+            errs[e['axis']].append(abs(e['value']))
+    span = (events[-1]['t_us'] - events[0]['t_us']) / 1e6 if events else 0.0
+    out.write('\n%d events over %.3f s\n' % (len(events), span))
+    if cmds:
+        out.write('commands: %d, longest %d us\n' % (len(cmds), max(cmds)))
+    if gaps:
+        out.write('loop stalls: %d, longest %d us\n' % (len(gaps), max(gaps)))
+    for axis, v in errs.items():
+        if v:
+            out.write('%s position error: max %d steps\n' % (AXES[axis], max(v)))
+
+
+def write_csv(events, out):
+    out.write('t_us,unix_ms,type,axis,value\n')
+    for e in events:
+        out.write('%d,%s,%s,%s,%d\n' % (e['t_us'], '' if e['unix_ms'] is None else '%.3f' % e['unix_ms'],
+                                         TYPES.get(e['type'], e['type']), AXES.get(e['axis'], ''), e['value']))
+
+
+def plot(events):
+    import matplotlib.pyplot as plt
+    fig, (ax_err, ax_ev) = plt.subplots(2, 1, sharex=True)
+    for axis, color in ((1, 'tab:blue'), (2, 'tab:orange')):
+        pts = [(e['rel_us'] / 1e6, e['value']) for e in events if e['type'] == 6 and e['axis'] == axis]
+        if pts:
+            ax_err.plot(*zip(*pts), color=color, label=AXES[axis])
+    ax_err.set_ylabel('position error [steps]')
+    ax_err.legend()
+    rows = sorted({e['type'] for e in events if e['type'] != 6})
+    for row, etype in enumerate(rows):
+        xs = [e['rel_us'] / 1e6 for e in events if e['type'] == etype]
+        ax_ev.plot(xs, [row] * len(xs), '|', markersize=12)
+    ax_ev.set_yticks(range(len(rows)))
+    ax_ev.set_yticklabels([TYPES.get(t, str(t)) for t in rows])
+    ax_ev.set_xlabel('time before dump [s]')
+    plt.show()
+
+
+def capture(port, baud):
+    import serial
+    with serial.Serial(port, baud, timeout=2) as s:
+        s.reset_input_buffer()
+        s.write(b'REC_DUMP\n')
+        data = b''
+        while b'REC_END' not in data:
+            chunk = s.read(4096)
+            if not chunk:
+                break
+            data += chunk
+    return data
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument('capture', nargs='?', help='file containing a REC_DUMP reply')
+    ap.add_argument('--port', help='serial / rfcomm device to request the dump from')
+    ap.add_argument('--baud', type=int, default=115200)
+    ap.add_argument('--save', help='store the raw capture read from --port')
+    ap.add_argument('--csv', action='store_true', help='print CSV instead of the timeline')
+    ap.add_argument('--plot', action='store_true', help='plot position errors and events')
+    args = ap.parse_args()
+
+    if args.port:
+        data = capture(args.port, args.baud)
+        if args.save:
+            with open(args.save, 'wb') as f:
+                f.write(data)
+    elif args.capture:
+        with open(args.capture, 'rb') as f:
+            data = f.read()
+    else:
+        ap.error('give a capture file or --port')
+
+    events, _, _ = parse(data)
+    if args.csv:
+        write_csv(events, sys.stdout)
+    else:
+        timeline(events, sys.stdout)
+        summary(events, sys.stdout)
+    if args.plot:
+        plot(events)
+
+
+if __name__ == '__main__':
+    main()